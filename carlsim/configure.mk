@@ -182,8 +182,14 @@ CARLSIM3_FLG := -I$(CARLSIM3_INC_DIR) -L$(CARLSIM3_LIB_DIR) -Wno-deprecated-gpu-
 CARLSIM3_LIB := -l$(SIM_LIB_NAME)
 ifeq ($(CARLSIM3_NO_CUDA),1)
 	CARLSIM3_FLG += -D__NO_CUDA__
+	CARLSIM3_LIB += -pthread
 else
-	CARLSIM3_LIB += -lcurand
+	CARLSIM3_LIB += -lcurand -Xcompiler -pthread
+endif
+
+# shm_open and clock_gettime live in librt on Linux (part of libc on Darwin)
+ifeq ("$(OSUPPER)","LINUX")
+	CARLSIM3_LIB += -lrt
 endif
 
 ifeq ($(CARLSIM3_COVERAGE),1)
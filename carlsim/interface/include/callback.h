@@ -42,6 +42,8 @@
 #ifndef _CALLBACK_H_
 #define _CALLBACK_H_
 
+#include <vector>
+
 // CARLsim user interface classes
 class CARLsim; // forward-declaration
 
@@ -52,7 +54,8 @@ class CARLsim; // forward-declaration
  *
  * For fine-grained control over spike generation, individual spike times can be specified per neuron in each group.
  * This is accomplished using a callback mechanism, which is called at each time step, to specify whether a neuron has
- * fired or not. */
+ * fired or not. Alternatively, spike times can be specified for a whole group at once via the batch callback
+ * nextSpikeTimes, which is considerably faster for large groups. */
 class SpikeGenerator {
 public:
 	//SpikeGenerator() {};
@@ -71,7 +74,32 @@ public:
 	 */
 	virtual unsigned int nextSpikeTime(CARLsim* s, int grpId, int i,
 											unsigned int currentTime, unsigned int lastScheduledSpikeTime,
-											unsigned int endOfTimeSlice) = 0;
+											unsigned int endOfTimeSlice) { return 0xFFFFFFFF; }
+
+	/*!
+	 * \brief controls spike generation for a whole group and scheduling time slice at once (batch interface)
+	 *
+	 * Instead of calling nextSpikeTime once per scheduled spike (plus once per neuron to end the loop), CARLsim first
+	 * calls this method once per group and scheduling time slice. An implementation appends all spike events in the
+	 * time slice to the buffers nIds and spkTimes (one entry per spike), and returns true. The spikes of a neuron must
+	 * be appended in increasing order. The default implementation returns false, in which case CARLsim falls back to
+	 * the per-neuron nextSpikeTime callback.
+	 * Events are subject to the same rules as spike times returned by nextSpikeTime: spikes outside
+	 * [currentTime, endOfTimeSlice) or not later than the last scheduled spike of the neuron are dropped.
+	 *
+	 * \attention The virtual method should never be called directly
+	 * \param s pointer to the simulator object
+	 * \param grpId the group id
+	 * \param currentTime the current simluation time
+	 * \param endOfTimeSlice the end of the current scheduling time slice. Spike times after this will not be scheduled.
+	 * \param lastScheduledSpikeTimes the last spike time which was scheduled, for every neuron in the group
+	 * \param nIds buffer of neuron indices (in the group) to schedule spikes for, one entry per spike
+	 * \param spkTimes buffer of spike times, one entry per spike
+	 * \returns true if the batch interface is implemented, false otherwise
+	 */
+	virtual bool nextSpikeTimes(CARLsim* s, int grpId, unsigned int currentTime, unsigned int endOfTimeSlice,
+								const std::vector<unsigned int>& lastScheduledSpikeTimes, std::vector<int>& nIds,
+								std::vector<unsigned int>& spkTimes) { return false; }
 };
 
 /*!
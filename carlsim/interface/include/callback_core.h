@@ -42,6 +42,8 @@
 #ifndef _CALLBACK_CORE_H_
 #define _CALLBACK_CORE_H_
 
+#include <vector>
+
 class CARLsim;
 class CpuSNN;
 
@@ -69,6 +71,13 @@ public:
 											unsigned int currentTime, unsigned int lastScheduledSpikeTime,
 											unsigned int endOfTimeSlice);
 
+	//! controls spike generation for a whole group and scheduling time slice at once
+	/*! \attention The virtual method should never be called directly
+	 */
+	virtual bool nextSpikeTimes(CpuSNN* s, int grpId, unsigned int currentTime, unsigned int endOfTimeSlice,
+								const std::vector<unsigned int>& lastScheduledSpikeTimes, std::vector<int>& nIds,
+								std::vector<unsigned int>& spkTimes);
+
 private:
 	CARLsim* carlsim;
 	SpikeGenerator* sGen;
@@ -54,7 +54,11 @@
 // include the following core functionalities instead of forward-declaring, so that the user only needs to include
 // carlsim.h
 #include <poisson_rate.h>
+#include <poisson_rate_schedule.h>
+#include <current_schedule.h>
+#include <spike_injection_queue.h>
 #include <spike_monitor.h>
+#include <spike_stream.h>
 #include <connection_monitor.h>
 #include <group_monitor.h>
 #include <linear_algebra.h>
@@ -111,6 +115,45 @@ class GroupMonitorCore;
 class ConnectionMonitorCore;
 class ConnectionGeneratorCore;
 class SpikeGeneratorCore;
+class CARLsim;
+
+/*!
+ * \brief A handle to an asynchronous run of the network
+ *
+ * RunFuture is returned by CARLsim::runNetworkAsync and plays the role of a future: It can be used to check whether
+ * the run has finished (isReady), and to wait for it to finish and retrieve the return value of runNetwork (wait).
+ * RunFuture is a light-weight handle that can be copied freely. The run itself is managed by the CARLsim object,
+ * which must outlive all of its RunFuture handles.
+ *
+ * \see CARLsim::runNetworkAsync
+ * \since v3.1
+ */
+class RunFuture {
+public:
+	//! creates an invalid handle (not associated with any run)
+	RunFuture() : sim_(NULL), runId_(0) {}
+
+	//! returns true if the handle is associated with a run
+	bool isValid() { return sim_!=NULL; }
+
+	//! returns true if the run has finished (never blocks)
+	bool isReady();
+
+	/*!
+	 * \brief blocks until the run has finished
+	 *
+	 * \returns the return value of runNetwork
+	 * \note wait must be called from the thread that started the run.
+	 */
+	int wait();
+
+private:
+	friend class CARLsim;
+	RunFuture(CARLsim* sim, unsigned int runId) : sim_(sim), runId_(runId) {}
+
+	CARLsim* sim_;			//!< the CARLsim object that runs the network
+	unsigned int runId_;	//!< ID of the run (1 for the first asynchronous run of sim_)
+};
 
 /*!
  * \brief CARLsim User Interface
@@ -702,6 +745,30 @@ public:
 	 */
 	void setISTDP(int grpId, bool isSet, stdpType_t type, PulseCurve curve);
 
+	/*!
+	 * \brief Sets eligibility traces for the DA-modulated STDP of a group
+	 *
+	 * By default, DA-modulated STDP (DA_MOD) multiplies the accumulated weight change with the dopamine concentration
+	 * at the time of the weight update. With eligibility traces enabled, every plastic synapse instead keeps a trace c
+	 * that collects the STDP increments and decays with time constant tauElig, and the synaptic weight changes
+	 * according to the product of that trace and the dopamine concentration (Izhikevich, 2007):
+	 * \f{eqnarray}
+	 * \frac{dc}{dt} & = & \frac{-c}{tauElig} + STDP(\Delta t) \delta(t-t_{spk}) \\
+	 * \frac{dw}{dt} & = & c  DA \f}
+	 * This allows a reward that arrives hundreds of milliseconds after a pre-post pairing to still reinforce the
+	 * synapse. The traces are integrated lazily, so the cost scales with the number of spikes rather than with the
+	 * number of plastic synapses times the number of time steps.
+	 *
+	 * \STATE ::CONFIG_STATE
+	 * \param[in] grpId   the group ID of the post-synaptic group
+	 * \param[in] isSet   the flag indicating if eligibility traces are enabled
+	 * \param[in] tauElig decay time constant of the eligibility trace (ms)
+	 * \note The group must have E-STDP or I-STDP of type DA_MOD. The traces apply to all plastic synapses of the group.
+	 * \note Eligibility traces are only supported in ::CPU_MODE.
+	 * \since v3.1
+	 */
+	void setEligibilityTrace(int grpId, bool isSet, float tauElig=1000.0f);
+
 	/*!
 	 * \brief Sets STP params U, tau_u, and tau_x of a neuron group (pre-synaptically)
 	 *
@@ -766,6 +833,22 @@ public:
 	 */
 	void setWeightAndWeightChangeUpdate(updateInterval_t wtANDwtChangeUpdateInterval, bool enableWtChangeDecay, float wtChangeDecay=0.9f);
 
+	/*!
+	 * \brief Sets the length of the epoch after which monitors are updated and the firing tables are cleared
+	 *
+	 * Spike monitors and group monitors are updated automatically at the end of every epoch, and all spike and
+	 * neuromodulator buffers hold exactly one epoch worth of data. A short epoch (e.g., 100 ms) bounds the latency
+	 * with which recorded activity becomes available in a closed-loop setting; a long epoch (e.g., 10 s) reduces the
+	 * per-epoch overhead of batch runs. Connection monitors are not affected and still take their snapshots every
+	 * second.
+	 *
+	 * \STATE ::CONFIG_STATE
+	 * \param[in] epochMs epoch length (ms), must be in [1,60000]. Default: 1000.
+	 * \note In GPU mode, the epoch length is fixed to 1000 ms.
+	 * \since v3.1
+	 */
+	void setEpochLength(int epochMs);
+
 
 	// +++++ PUBLIC METHODS: RUNNING A SIMULATION ++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++ //
 
@@ -780,6 +863,42 @@ public:
 	 */
 	int runNetwork(int nSec, int nMsec=0, bool printRunSummary=true, bool copyState=false);
 
+	/*!
+	 * \brief run the simulation in a background thread and return immediately
+	 *
+	 * This method does the same as runNetwork, but returns right away, so that the calling thread can prepare the
+	 * next stimulus (e.g., decode an image and fill a PoissonRate object) while the network is running. The returned
+	 * RunFuture can be used to check whether the run has finished, and to wait for it.
+	 *
+	 * While an asynchronous run is in progress, only the following CARLsim calls are safe:
+	 * - setSpikeRate and setExternalCurrent: These calls are staged and applied at the end of the run (before the
+	 *   RunFuture becomes ready), so that the next run uses the new stimulus. Do not modify a PoissonRate object
+	 *   that is currently used by the network; prepare the next stimulus in a different object instead.
+	 * - the getters of network structure that do not change after setupNetwork (e.g., getGroupId,
+	 *   getGroupNumNeurons, getGroupName, getNumGroups, getNumNeurons).
+	 * - isRunningAsync, RunFuture::isReady, RunFuture::wait, and pushing events into a SpikeInjectionQueue.
+	 *
+	 * All other calls (in particular runNetwork, runNetworkAsync, saveSimulation, and everything that reads from
+	 * monitors or changes weights) must wait until the run has finished. CARLsim methods that change or read the
+	 * state of the network (including getSimTime and getSpikeMonitor) report an error if they are called too early.
+	 * The methods of SpikeMonitor, GroupMonitor, and ConnectionMonitor objects are not checked. Deleting the CARLsim
+	 * object waits for the run to finish.
+	 *
+	 * \STATE ::SETUP_STATE, ::RUN_STATE. Will make CARLsim state switch from ::SETUP_STATE to ::RUN_STATE.
+	 * \param[in] nSec 			  number of seconds to run the network
+	 * \param[in] nMsec 		  number of milliseconds to run the network
+	 * \param[in] printRunSummary enable the printing of a summary at the end of this run
+	 * \param[in] copyState 	  enable copying of data from device to host
+	 * \returns a RunFuture handle to the run
+	 * \see runNetwork
+	 * \see RunFuture
+	 * \since v3.1
+	 */
+	RunFuture runNetworkAsync(int nSec, int nMsec=0, bool printRunSummary=true, bool copyState=false);
+
+	//! returns true if an asynchronous run (see runNetworkAsync) is in progress
+	bool isRunningAsync();
+
 	/*!
 	 * \brief build the network
 	 *
@@ -1045,6 +1164,28 @@ public:
 	 */
 	void setExternalCurrent(int grpId, float current);
 
+	/*!
+	 * \brief Sets a time-varying schedule of external currents
+	 *
+	 * This method attaches a CurrentSchedule to a group. The schedule starts at the current simulation time, and
+	 * CARLsim applies its (sparse) current changes internally at the right millisecond. This allows step protocols,
+	 * pulse trains, and per-ms waveforms to be injected in a single call to runNetwork, instead of calling
+	 * setExternalCurrent and runNetwork once per millisecond. Once all entries have been applied, the last currents
+	 * are held, just like a current set via setExternalCurrent.
+	 *
+	 * \STATE ::SETUP_STATE, ::RUN_STATE
+	 * \param[in] grpId    the group ID
+	 * \param[in] schedule pointer to CurrentSchedule object
+	 *
+	 * \note This method cannot be applied to SpikeGenerator groups.
+	 * \note setExternalCurrentSchedule will *not* take over ownership of the schedule, which must stay alive and
+	 * must not be modified until all of its entries have been applied. A subsequent call to setExternalCurrent (or
+	 * setExternalCurrentSchedule) replaces the schedule.
+	 * \see setExternalCurrent
+	 * \see CurrentSchedule
+	 */
+	void setExternalCurrentSchedule(int grpId, CurrentSchedule* schedule);
+
 	/*!
 	 * \brief Sets a group monitor for a group, custom GroupMonitor class
 	 *
@@ -1105,9 +1246,10 @@ public:
 	 *
 	 * To retrieve outputs, a spike-monitoring callback mechanism is used. This mechanism allows the user to calculate
 	 * basic statistics, store spike trains, or perform more complicated output monitoring. Spike monitors are
-	 * registered for a group and are called automatically by the simulator every second. Similar to an address event
-	 * representation (AER), the spike monitor indicates which neurons spiked by using the neuron ID within a group
-	 * (0-indexed) and the time of the spike. Only one spike monitor is allowed per group.
+	 * registered for a group and are called automatically by the simulator at the end of every epoch (every second by
+	 * default, see setEpochLength). Similar to an address event representation (AER), the spike monitor indicates
+	 * which neurons spiked by using the neuron ID within a group (0-indexed) and the time of the spike. Only one spike
+	 * monitor is allowed per group.
 	 *
 	 * CARLsim supports two different recording mechanisms: Recording to a spike file (binary) and recording to a
 	 * SpikeMonitor object. The former is useful for off-line analysis of activity (e.g., using \ref ch9_matlab_oat).
@@ -1144,6 +1286,83 @@ public:
 	 */
 	SpikeMonitor* setSpikeMonitor(int grpId, const std::string& fileName);
 
+	/*!
+	 * \brief Feeds spikes and external currents into the running simulation (closed-loop input)
+	 *
+	 * This method attaches a SpikeInjectionQueue, which is drained at the beginning of every millisecond of
+	 * runNetwork. A producer thread (e.g., a sensor driver) can push spikes into spike generator groups and external
+	 * currents into regular groups while a single, long-running call to runNetwork is in progress, and the
+	 * network will react to them within one time step. Injected spikes are counted by SpikeMonitor and SpikeCounter
+	 * just like the spikes of a SpikeGenerator.
+	 *
+	 * \STATE ::SETUP_STATE, ::RUN_STATE
+	 * \param[in] queue  pointer to a SpikeInjectionQueue, or NULL to detach the current queue
+	 *
+	 * \note setSpikeInjectionQueue will *not* take over ownership of the queue, which must stay alive as long as it is
+	 * attached.
+	 * \note Spike injection is only supported in CPU_MODE.
+	 * \attention Invalid group or neuron IDs in the queue (or spikes for groups that are not spike generators, and
+	 * currents for groups that are) terminate the simulation.
+	 * \see SpikeInjectionQueue
+	 * \since v3.1
+	 */
+	void setSpikeInjectionQueue(SpikeInjectionQueue* queue);
+
+	/*!
+	 * \brief Makes runNetwork advance at a fixed ratio of simulated time to wall-clock time
+	 *
+	 * With real-time pacing enabled, runNetwork waits at the end of every time step until the step's deadline has
+	 * been reached: With factor=1, one millisecond of simulation takes one millisecond of wall-clock time; with
+	 * factor=2, the simulation runs twice as fast as real time. Waiting is done by sleeping for most of the remaining
+	 * time and spinning for the last fraction of a millisecond, which is precise but keeps one core busy.
+	 *
+	 * Deadlines are relative to the start of each call to runNetwork. If a time step misses its deadline, the
+	 * following steps run without waiting until the simulation has caught up; all of them count as missed deadlines.
+	 * The compute time per time step, the number of missed deadlines, and the number of distinct stalls can be
+	 * retrieved via getRealTimeStats.
+	 *
+	 * Together with setSpikeInjectionQueue, this allows the network to run in a closed loop with hardware.
+	 *
+	 * \STATE ::CONFIG_STATE, ::SETUP_STATE, ::RUN_STATE
+	 * \param[in] factor  milliseconds of simulation per millisecond of wall-clock time. Set to 0 to run as fast as
+	 *                    possible (default).
+	 * \see getRealTimeStats
+	 * \since v3.1
+	 */
+	void setRealTimeFactor(float factor);
+
+	/*!
+	 * \brief Publishes the spikes of a group to a shared-memory spike stream
+	 *
+	 * This method makes the spikes of a group available to other processes while the simulation is running, without
+	 * going through files or sockets. At every time step, the spikes of all streamed groups are written into a
+	 * lock-free ring buffer in a POSIX shared-memory object named streamName, which external consumers can map via
+	 * SpikeStreamReader (see spike_stream.h for the memory layout). Each spike consists of its time (ms), group ID,
+	 * and neuron ID (0-indexed relative to the group). Several groups can be streamed under the same name.
+	 *
+	 * The simulation never waits for consumers: A consumer that falls behind by more than capacity spikes loses the
+	 * oldest ones, which is reported by SpikeStreamReader::getNumSpikesLost. The shared-memory object is removed when
+	 * the network is deleted.
+	 *
+	 * If a shared-memory object named streamName already exists, it may belong to another simulation that is still
+	 * running, so it is an error to stream to it unless replaceExisting is set (which is meant for objects that were
+	 * left behind by a crashed run). The capacity and replaceExisting of the first call for a stream name apply.
+	 *
+	 * \STATE ::CONFIG_STATE, ::SETUP_STATE
+	 * \param[in] grpId           the group ID
+	 * \param[in] streamName      name of the shared-memory object (e.g., "carlsim_spikes")
+	 * \param[in] capacity        number of spikes the ring buffer can hold (rounded up to the next power of two, at
+	 *                            most SPIKE_STREAM_MAX_CAPACITY = 2^30). Default: SPIKE_STREAM_DEFAULT_CAPACITY (2^20
+	 *                            spikes, 16 MB).
+	 * \param[in] replaceExisting whether to replace an existing shared-memory object of the same name. Default: false.
+	 *
+	 * \note Spike streams are only supported in CPU_MODE on POSIX systems.
+	 * \see SpikeStreamReader
+	 * \since v3.1
+	 */
+	void setSpikeStream(int grpId, const std::string& streamName, int capacity=SPIKE_STREAM_DEFAULT_CAPACITY,
+		bool replaceExisting=false);
+
 	/*!
 	 * \brief Sets a spike rate
 	 * \TODO finish docu
@@ -1163,6 +1382,48 @@ public:
 	 */
 	void setSpikeRate(int grpId, PoissonRate* spikeRate, int refPeriod=1);
 
+	/*!
+	 * \brief Sets a time-varying schedule of spike rates
+	 *
+	 * This method attaches a PoissonRateSchedule to a spike generator group. The schedule starts at the current
+	 * simulation time, and CARLsim switches to the rates of the next segment internally at the right millisecond.
+	 * This allows a long stimulus sequence to be presented in a single call to runNetwork, instead of calling
+	 * setSpikeRate and runNetwork once per frame. Once the schedule has run out, the group stops firing.
+	 *
+	 * \STATE ::SETUP_STATE, ::RUN_STATE
+	 * \param[in] grpId      group ID
+	 * \param[in] schedule   pointer to PoissonRateSchedule object
+	 * \param[in] refPeriod  refactory period (ms). Default: 1ms.
+	 *
+	 * \note This method can only be applied to SpikeGenerator groups.
+	 * \note setSpikeRateSchedule will *not* take over ownership of the schedule, which must stay alive as long as
+	 * it is used. A subsequent call to setSpikeRate (or setSpikeRateSchedule) replaces the schedule.
+	 * \see setSpikeRate
+	 * \see PoissonRateSchedule
+	 */
+	void setSpikeRateSchedule(int grpId, PoissonRateSchedule* schedule, int refPeriod=1);
+
+	/*!
+	 * \brief Sets how a Poisson group generates spikes from its PoissonRate
+	 *
+	 * In the default mode (::POISSON_ISI), the spikes of a whole scheduling time slice are drawn at once from
+	 * exponentially distributed inter-spike intervals. In ::POISSON_BERNOULLI mode, every neuron fires with
+	 * probability rate/1000 in every millisecond (unless it is still refractory), which is how GPU mode generates
+	 * Poisson spikes. Bernoulli mode spreads the cost of spike generation evenly over all time steps, which avoids
+	 * periodic latency spikes for large input groups.
+	 *
+	 * \STATE ::CONFIG_STATE, ::SETUP_STATE, ::RUN_STATE
+	 * \param[in] grpId  group ID
+	 * \param[in] mode   Poisson mode (see ::poissonMode_t). Default: ::POISSON_ISI.
+	 *
+	 * \note This method can only be applied to SpikeGenerator groups.
+	 * \note In GPU mode, Poisson spikes are always generated in Bernoulli mode.
+	 * \note When switching from ISI to Bernoulli mode in ::RUN_STATE, all spikes of the group that were already
+	 * scheduled for the rest of the current time slice are discarded.
+	 * \see setSpikeRate
+	 */
+	void setPoissonMode(int grpId, poissonMode_t mode);
+
 	/*!
 	 * \brief Sets the weight value of a specific synapse
 	 *
@@ -1546,6 +1807,28 @@ public:
 	 */
 	GroupNeuromodulatorInfo_t getGroupNeuromodulatorInfo(int grpId);
 
+	/*!
+	 * \brief returns how well the simulation has kept up with real-time pacing
+	 *
+	 * This function returns the compute time per time step (median, 99th percentile, maximum) and the number of
+	 * missed deadlines, measured over all calls to runNetwork with real-time pacing enabled since the statistics were
+	 * last reset. A network configuration is real-time capable on a machine if it runs without deadline misses.
+	 *
+	 * \STATE ::CONFIG_STATE, ::SETUP_STATE, ::RUN_STATE
+	 * \sa RealTimeStats
+	 * \see setRealTimeFactor
+	 * \since v3.1
+	 */
+	RealTimeStats_t getRealTimeStats();
+
+	/*!
+	 * \brief resets the real-time pacing statistics (see getRealTimeStats)
+	 *
+	 * \STATE ::CONFIG_STATE, ::SETUP_STATE, ::RUN_STATE
+	 * \since v3.1
+	 */
+	void resetRealTimeStats();
+
 	/*!
 	 * \brief returns the current simulation mode
 	 *
@@ -1790,6 +2073,21 @@ private:
 
 	void printSimulationSpecs();
 
+	// asynchronous runs (see runNetworkAsync)
+	friend class RunFuture;
+	void assertNotRunningAsync(const std::string& funcName); //!< reports an error if an asynchronous run is in progress
+	void applyStagedStimuli();			//!< applies the stimuli that were staged during an asynchronous run
+	bool isAsyncRunReady(unsigned int runId); //!< whether asynchronous run runId has finished
+	int waitForAsyncRun(unsigned int runId); //!< waits until asynchronous run runId has finished
+	void joinAsyncRun();				//!< joins the thread of the last asynchronous run, if necessary
+	void lockAsync();					//!< locks asyncLock_
+	void unlockAsync();					//!< unlocks asyncLock_
+#if defined(WIN32) || defined(WIN64)
+	static DWORD WINAPI asyncRunThread(LPVOID sim);
+#else
+	static void* asyncRunThread(void* sim);
+#endif
+
 	// +++++ PRIVATE STATIC PROPERTIES ++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++ //
 	static bool gpuAllocation[MAX_NUM_CUDA_DEVICES];
 	static std::string gpuOccupiedBy[MAX_NUM_CUDA_DEVICES];
@@ -1824,6 +2122,24 @@ private:
 	std::vector<SpikeGeneratorCore*> spkGen_; //!< a list of all created spike generators
 	std::vector<ConnectionGeneratorCore*> connGen_; //!< a list of all created connection generators
 
+	// asynchronous runs (see runNetworkAsync)
+	struct StagedSpikeRate { int grpId; PoissonRate* spikeRate; int refPeriod; };
+	struct StagedCurrent { int grpId; std::vector<float> current; };
+	bool asyncRunning_;				//!< whether an asynchronous run is in progress (protected by asyncLock_)
+	bool asyncThreadActive_;		//!< whether the thread of the last asynchronous run still needs to be joined
+	std::vector<int> asyncResults_;	//!< return value of every asynchronous run (indexed by run ID - 1)
+	int asyncNSec_, asyncNMsec_;	//!< run duration of the current asynchronous run
+	bool asyncPrintRunSummary_, asyncCopyState_; //!< options of the current asynchronous run
+	std::vector<StagedSpikeRate> stagedSpikeRates_; //!< setSpikeRate calls made during an asynchronous run
+	std::vector<StagedCurrent> stagedCurrents_; //!< setExternalCurrent calls made during an asynchronous run
+#if defined(WIN32) || defined(WIN64)
+	HANDLE asyncThread_;
+	HANDLE asyncLock_;
+#else
+	pthread_t asyncThread_;
+	pthread_mutex_t asyncLock_;
+#endif
+
 	bool hasSetHomeoALL_;			//!< informs that homeostasis have been set for ALL groups (can't add more groups)
 	bool hasSetHomeoBaseFiringALL_;	//!< informs that base firing has been set for ALL groups (can't add more groups)
 	bool hasSetSTDPALL_; 			//!< informs that STDP have been set for ALL groups (can't add more groups)
@@ -188,6 +188,24 @@ static const char* spikeMonMode_string[] = {
 	"SpikeCount Mode","SpikeTime Mode"
 };
 
+/*!
+ * \brief Poisson spike generation modes
+ *
+ * Spike generator groups driven by a PoissonRate object can generate their spikes in different modes:
+ * POISSON_ISI:       At the beginning of each scheduling time slice, spike times are drawn for the whole time slice
+ *                    from exponentially distributed inter-spike intervals (default).
+ * POISSON_BERNOULLI: Every millisecond, each neuron fires with probability rate/1000 (unless it is still refractory).
+ *                    This spreads the cost of spike generation evenly over the time slice, and is how GPU mode
+ *                    generates Poisson spikes.
+ */
+enum poissonMode_t {
+	POISSON_ISI,		//!< spike times are scheduled per time slice from inter-spike intervals
+	POISSON_BERNOULLI	//!< a Bernoulli trial per neuron and millisecond
+};
+static const char* poissonMode_string[] = {
+	"ISI mode", "Bernoulli mode"
+};
+
 /*!
  * \brief GroupMonitor flag
  *
@@ -386,6 +404,31 @@ typedef struct GroupSTDPInfo {
 	float		DELTA;				//!< the range of inhibitory LTD if the pulse I-STDP curve is used
 } GroupSTDPInfo_t;
 
+/*!
+ * \brief A struct for retrieving how well a simulation keeps up with wall-clock time
+ *
+ * The compute time of a time step is the wall-clock time spent in runNetwork on that step, not counting the time spent
+ * waiting for the step's deadline. A deadline is missed if a step finishes later than the real-time pacing allows.
+ * Percentiles are accurate to about 3%.
+ *
+ * Deadlines are absolute (counted from the start of runNetwork), so a single stall makes all following time steps
+ * miss their deadlines until the simulation has caught up. numDeadlineMisses therefore counts every late time step,
+ * whereas numStalls counts each run of consecutive late time steps once.
+ *
+ * \sa CARLsim::setRealTimeFactor()
+ * \sa CARLsim::getRealTimeStats()
+ */
+typedef struct RealTimeStats {
+	float		factor;				//!< simulated ms per real ms (0 if real-time pacing is off)
+	int			numSteps;			//!< number of time steps measured
+	int			numDeadlineMisses;	//!< number of time steps that finished after their deadline
+	int			numStalls;			//!< number of runs of consecutive time steps that missed their deadline
+	float		computeP50Us;		//!< median compute time per time step (us)
+	float		computeP99Us;		//!< 99th percentile of the compute time per time step (us)
+	float		computeMaxUs;		//!< maximum compute time per time step (us)
+	float		maxLatenessUs;		//!< how late (us) the latest time step finished after its deadline
+} RealTimeStats_t;
+
 /*!
  * \brief A struct for retrieving neuromodulator information of a group
  *
@@ -0,0 +1,163 @@
+/* 
+ * Copyright (c) 2014 Regents of the University of California. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * 3. The names of its contributors may not be used to endorse or promote
+ *    products derived from this software without specific prior written
+ *    permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * *********************************************************************************************** *
+ * CARLsim
+ * created by: 		(MDR) Micah Richert, (JN) Jayram M. Nageswaran
+ * maintained by:	(MA) Mike Avery <averym@uci.edu>, (MB) Michael Beyeler <mbeyeler@uci.edu>,
+ *					(KDC) Kristofor Carlson <kdcarlso@uci.edu>
+ *					(TSC) Ting-Shuo Chou <tingshuc@uci.edu>
+ *
+ * CARLsim available from http://socsci.uci.edu/~jkrichma/CARLsim/
+ * Ver 11/26/2014
+ */
+
+#ifndef _CURRENT_SCHEDULE_H_
+#define _CURRENT_SCHEDULE_H_
+
+#include <vector>
+
+/*!
+ * \brief a time-varying schedule of external currents
+ *
+ * A CurrentSchedule is a sorted list of sparse current changes. Every entry specifies the time (ms, relative to the
+ * start of the schedule) at which a neuron (or all neurons) of a group starts receiving a certain external current.
+ * The current is held until it is changed by a later entry. Attaching a schedule to a group via
+ * CARLsim::setExternalCurrentSchedule makes CARLsim apply the changes internally at the right millisecond, so that a
+ * whole stimulation protocol (steps, pulse trains, per-ms waveforms) can be run in a single call to
+ * CARLsim::runNetwork (instead of calling CARLsim::setExternalCurrent and CARLsim::runNetwork once per millisecond).
+ *
+ * Since only changes are stored, the cost of a schedule at run-time is proportional to the number of changes, not to
+ * the number of neurons in the group.
+ *
+ * Example: a patch-clamp-style current-step protocol on neuron 0, followed by a 10 Hz sine wave on neuron 1
+ * \code
+ * CurrentSchedule sched(nNeur);
+ * for (int s=0; s<10; s++)
+ *     sched.addPulse(s*1000+100, 500, 0, s*2.0f); // 500 ms step of s*2 mA, every second
+ * std::vector<float> sine(1000);
+ * for (int t=0; t<1000; t++)
+ *     sine[t] = 5.0f*sin(2*M_PI*10*t/1000.0f);
+ * sched.addWaveform(10000, 1, sine);
+ * sim.setExternalCurrentSchedule(g0, &sched);
+ * sim.runNetwork(11,0);
+ * \endcode
+ *
+ * \note setExternalCurrentSchedule will *not* take over ownership of the schedule, which must stay alive as long as
+ * it is used by CARLsim.
+ * \attention A schedule must not be modified (or cleared) while it is attached to a group, because CARLsim keeps
+ * track of the next entry to apply by its index. To change the protocol, build a new schedule (or modify this one
+ * after it has run out) and call setExternalCurrentSchedule again.
+ * \since v3.1
+ */
+class CurrentSchedule {
+public:
+	/*!
+	 * \brief CurrentSchedule constructor
+	 *
+	 * Creates a new, empty schedule.
+	 * \param[in] nNeur the number of neurons for which to schedule currents
+	 */
+	CurrentSchedule(int nNeur);
+
+	//! CurrentSchedule destructor
+	~CurrentSchedule();
+
+	/*!
+	 * \brief Changes the current of a single neuron (or all neurons) at a specific time
+	 *
+	 * From timeMs on, neuron neurId receives the specified current, until it is changed by a later entry. Entries
+	 * may be added in any order; entries with the same time are applied in the order they were added.
+	 * \param[in] timeMs  time (ms) relative to the start of the schedule
+	 * \param[in] neurId  neuron ID (relative to the group), or ALL for all neurons in the group
+	 * \param[in] current the external current (mA)
+	 */
+	void addCurrent(int timeMs, int neurId, float current);
+
+	/*!
+	 * \brief Changes the current of all neurons at a specific time
+	 *
+	 * \param[in] timeMs  time (ms) relative to the start of the schedule
+	 * \param[in] current vector of external currents (mA), one element per neuron
+	 */
+	void addCurrent(int timeMs, const std::vector<float>& current);
+
+	/*!
+	 * \brief Adds a rectangular current pulse
+	 *
+	 * Neuron neurId receives the specified current from startMs on for durationMs milliseconds, after which its
+	 * current is set back to zero.
+	 * \param[in] startMs    time (ms) at which the pulse starts, relative to the start of the schedule
+	 * \param[in] durationMs duration (ms) of the pulse
+	 * \param[in] neurId     neuron ID (relative to the group), or ALL for all neurons in the group
+	 * \param[in] amplitude  the external current (mA) during the pulse
+	 */
+	void addPulse(int startMs, int durationMs, int neurId, float amplitude);
+
+	/*!
+	 * \brief Adds a waveform that is sampled every millisecond
+	 *
+	 * Neuron neurId receives current samples[t] at time startMs+t. The last sample is held after the waveform has
+	 * ended. Only samples that differ from their predecessor are stored.
+	 * \param[in] startMs time (ms) at which the waveform starts, relative to the start of the schedule
+	 * \param[in] neurId  neuron ID (relative to the group), or ALL for all neurons in the group
+	 * \param[in] samples the external current (mA), one sample per millisecond
+	 */
+	void addWaveform(int startMs, int neurId, const std::vector<float>& samples);
+
+	//! deletes all entries
+	void clear();
+
+	//! returns the number of neurons for which to schedule currents
+	int getNumNeurons();
+
+	//! returns the number of entries (current changes) in the schedule
+	int getNumEntries();
+
+	//! returns the time (ms) after which all entries have been applied; that is, the time of the last entry plus one
+	int getLengthMs();
+
+	//! returns the time (ms) of an entry relative to the start of the schedule (entries are sorted by time)
+	int getEntryTimeMs(int entryId);
+
+	//! returns the neuron ID of an entry (relative to the group), or ALL
+	int getEntryNeurId(int entryId);
+
+	//! returns the external current (mA) of an entry
+	float getEntryCurrent(int entryId);
+
+private:
+	// This class provides a pImpl for the CARLsim User API.
+	// \see https://marcmutz.wordpress.com/translated-articles/pimp-my-pimpl/
+	class Impl;
+	Impl* _impl;
+};
+
+#endif
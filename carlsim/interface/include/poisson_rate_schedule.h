@@ -0,0 +1,154 @@
+/* 
+ * Copyright (c) 2014 Regents of the University of California. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * 3. The names of its contributors may not be used to endorse or promote
+ *    products derived from this software without specific prior written
+ *    permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * *********************************************************************************************** *
+ * CARLsim
+ * created by: 		(MDR) Micah Richert, (JN) Jayram M. Nageswaran
+ * maintained by:	(MA) Mike Avery <averym@uci.edu>, (MB) Michael Beyeler <mbeyeler@uci.edu>,
+ *					(KDC) Kristofor Carlson <kdcarlso@uci.edu>
+ *					(TSC) Ting-Shuo Chou <tingshuc@uci.edu>
+ *
+ * CARLsim available from http://socsci.uci.edu/~jkrichma/CARLsim/
+ * Ver 11/26/2014
+ */
+
+#ifndef _POISSON_RATE_SCHEDULE_H_
+#define _POISSON_RATE_SCHEDULE_H_
+
+#include <vector>
+
+/*!
+ * \brief a time-varying schedule of Poisson firing rates
+ *
+ * A PoissonRateSchedule is a sequence of piecewise-constant segments, each of which assigns a firing rate to every
+ * neuron for a certain duration (ms). Segments are played back-to-back, so a schedule is essentially a
+ * (time x neuron) rate matrix with variable row durations. Attaching a schedule to a spike generator group via
+ * CARLsim::setSpikeRateSchedule makes CARLsim switch rates internally at the right millisecond, so that a whole
+ * stimulus sequence can be presented in a single call to CARLsim::runNetwork (instead of calling
+ * CARLsim::setSpikeRate and CARLsim::runNetwork once per frame).
+ *
+ * Example: present 100 frames of 50 ms each, followed by 500 ms of 1 Hz background activity
+ * \code
+ * PoissonRateSchedule sched(nNeur);
+ * for (int f=0; f<100; f++)
+ *     sched.addSegment(50, frameRates[f]); // frameRates[f] is a std::vector<float> of size nNeur
+ * sched.addSegment(500, 1.0f);
+ * sim.setSpikeRateSchedule(g0, &sched);
+ * sim.runNetwork(5,500);
+ * \endcode
+ *
+ * \note setSpikeRateSchedule will *not* take over ownership of the schedule, which must stay alive as long as it is
+ * used by CARLsim.
+ * \since v3.1
+ */
+class PoissonRateSchedule {
+public:
+	/*!
+	 * \brief PoissonRateSchedule constructor
+	 *
+	 * Creates a new, empty schedule.
+	 * \param[in] nNeur the number of neurons for which to schedule firing rates
+	 */
+	PoissonRateSchedule(int nNeur);
+
+	//! PoissonRateSchedule destructor
+	~PoissonRateSchedule();
+
+	/*!
+	 * \brief Appends a segment in which all neurons fire at the same rate
+	 *
+	 * \param[in] durationMs duration (ms) of the segment
+	 * \param[in] rate       the firing rate (Hz) of all neurons
+	 */
+	void addSegment(int durationMs, float rate);
+
+	/*!
+	 * \brief Appends a segment with one firing rate per neuron
+	 *
+	 * \param[in] durationMs duration (ms) of the segment
+	 * \param[in] rates      vector of firing rates (Hz), one element per neuron
+	 */
+	void addSegment(int durationMs, const std::vector<float>& rates);
+
+	/*!
+	 * \brief Appends a sequence of equally long frames from a (frame x neuron) rate matrix
+	 *
+	 * The rate matrix is stored frame by frame; that is, rates[f*getNumNeurons()+i] is the rate of neuron i in frame
+	 * f. Its size must be a multiple of getNumNeurons().
+	 * \param[in] frameDurMs duration (ms) of every frame
+	 * \param[in] rates      the rate matrix (Hz), one row of getNumNeurons() elements per frame
+	 */
+	void addFrames(int frameDurMs, const std::vector<float>& rates);
+
+	//! deletes all segments
+	void clear();
+
+	//! returns the number of neurons for which to schedule firing rates
+	int getNumNeurons();
+
+	//! returns the number of segments in the schedule
+	int getNumSegments();
+
+	//! returns the total duration (ms) of all segments
+	int getLengthMs();
+
+	/*!
+	 * \brief returns the segment that is active at a specific time
+	 *
+	 * \param[in] timeMs time (ms) relative to the start of the schedule
+	 * \returns segment ID, or -1 if timeMs lies outside the schedule
+	 */
+	int getSegmentId(int timeMs);
+
+	//! returns the start time (ms) of a segment relative to the start of the schedule
+	int getSegmentStartMs(int segId);
+
+	//! returns the duration (ms) of a segment
+	int getSegmentDurationMs(int segId);
+
+	//! returns the firing rates of a segment, one element per neuron
+	std::vector<float> getSegmentRates(int segId);
+
+	/*!
+	 * \brief Returns pointer to the firing rates of a segment
+	 *
+	 * This function gives CARLsim access to the rates of a segment without copying them. The array contains
+	 * getNumNeurons() elements and is invalidated by the next call to any of the add methods or clear.
+	 */
+	const float* getSegmentRatePtr(int segId);
+
+private:
+	// This class provides a pImpl for the CARLsim User API.
+	// \see https://marcmutz.wordpress.com/translated-articles/pimp-my-pimpl/
+	class Impl;
+	Impl* _impl;
+};
+
+#endif
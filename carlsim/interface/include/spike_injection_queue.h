@@ -0,0 +1,148 @@
+/* 
+ * Copyright (c) 2014 Regents of the University of California. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * 3. The names of its contributors may not be used to endorse or promote
+ *    products derived from this software without specific prior written
+ *    permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * *********************************************************************************************** *
+ * CARLsim
+ * created by: 		(MDR) Micah Richert, (JN) Jayram M. Nageswaran
+ * maintained by:	(MA) Mike Avery <averym@uci.edu>, (MB) Michael Beyeler <mbeyeler@uci.edu>,
+ *					(KDC) Kristofor Carlson <kdcarlso@uci.edu>
+ *					(TSC) Ting-Shuo Chou <tingshuc@uci.edu>
+ *
+ * CARLsim available from http://socsci.uci.edu/~jkrichma/CARLsim/
+ * Ver 11/26/2014
+ */
+
+#ifndef _SPIKE_INJECTION_QUEUE_H_
+#define _SPIKE_INJECTION_QUEUE_H_
+
+//! type of an event in a SpikeInjectionQueue
+enum injectionType_t {
+	INJECT_SPIKE,		//!< make a neuron of a spike generator group fire
+	INJECT_CURRENT		//!< set the external current of a neuron
+};
+
+//! an event in a SpikeInjectionQueue
+typedef struct injection_event_s {
+	injectionType_t type;	//!< INJECT_SPIKE or INJECT_CURRENT
+	int grpId;				//!< group ID
+	int neurId;				//!< neuron ID (0-indexed, relative to the group)
+	unsigned int timeMs;	//!< simulation time (ms) at which to fire (INJECT_SPIKE only)
+	float current;			//!< external current (INJECT_CURRENT only)
+} injection_event_t;
+
+/*!
+ * \brief a lock-free queue that feeds spikes and currents into a running simulation
+ *
+ * SpikeInjectionQueue is a single-producer/single-consumer (SPSC) ring buffer for closed-loop experiments. One thread
+ * (the producer, e.g. a sensor driver) pushes spikes and current updates while another thread runs the network; the
+ * simulation (the consumer) drains the queue at the beginning of every millisecond. In contrast to setting
+ * InteractiveSpikeGenerator quotas or calling setExternalCurrent between many short runNetwork calls, this allows a
+ * single long-running call to CARLsim::runNetwork to react to input with a latency of one time step.
+ *
+ * Neither side ever blocks: push returns false if the queue is full, in which case the producer may retry later.
+ *
+ * Example:
+ * \code
+ * SpikeInjectionQueue queue;
+ * sim.setSpikeInjectionQueue(&queue);
+ * // producer thread:
+ * while (queue.pushSpike(gIn, sensorId) == false) {} // fire as soon as possible
+ * queue.pushCurrent(gOut, 0, 5.0f);                 // set external current of neuron 0
+ * // main thread:
+ * sim.runNetwork(60,0);
+ * \endcode
+ *
+ * \note There must be at most one producer thread at a time. All methods other than the push methods and
+ * getSimTime are meant for the simulation.
+ * \see CARLsim::setSpikeInjectionQueue
+ * \since v3.1
+ */
+class SpikeInjectionQueue {
+public:
+	/*!
+	 * \brief SpikeInjectionQueue constructor
+	 *
+	 * \param[in] capacity the maximum number of events the queue can hold (rounded up to the next power of two).
+	 *                     Default: 4096.
+	 */
+	SpikeInjectionQueue(int capacity=4096);
+
+	//! SpikeInjectionQueue destructor
+	~SpikeInjectionQueue();
+
+	/*!
+	 * \brief Makes a neuron of a spike generator group fire (producer side)
+	 *
+	 * \param[in] grpId   ID of a spike generator group
+	 * \param[in] neurId  neuron ID (0-indexed, relative to the group)
+	 * \param[in] timeMs  simulation time (ms) at which the neuron should fire. Spikes that are due at or before the
+	 *                    time at which they are drained fire right away. Default: 0 (as soon as possible).
+	 * \returns false if the queue is full
+	 */
+	bool pushSpike(int grpId, int neurId, unsigned int timeMs=0);
+
+	/*!
+	 * \brief Sets the external current of a neuron (producer side)
+	 *
+	 * The current stays in effect until it is changed again, same as with CARLsim::setExternalCurrent.
+	 * \param[in] grpId    ID of a group that is not a spike generator group
+	 * \param[in] neurId   neuron ID (0-indexed, relative to the group)
+	 * \param[in] current  external current
+	 * \returns false if the queue is full
+	 */
+	bool pushCurrent(int grpId, int neurId, float current);
+
+	//! removes the oldest event from the queue (consumer side), returns false if the queue is empty
+	bool pop(injection_event_t& ev);
+
+	//! returns the maximum number of events the queue can hold
+	int getCapacity();
+
+	//! returns the number of events that could not be pushed because the queue was full
+	unsigned int getNumRejected();
+
+	/*!
+	 * \brief returns the last simulation time (ms) at which the queue was drained
+	 *
+	 * This can be called from the producer thread, e.g. to schedule spikes relative to the simulation time.
+	 */
+	unsigned int getSimTime();
+
+	//! records the simulation time at which the queue was drained (consumer side)
+	void setSimTime(unsigned int simTimeMs);
+
+private:
+	// This class provides a pImpl for the CARLsim User API.
+	// \see https://marcmutz.wordpress.com/translated-articles/pimp-my-pimpl/
+	class Impl;
+	Impl* _impl;
+};
+
+#endif
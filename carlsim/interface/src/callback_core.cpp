@@ -60,6 +60,16 @@ unsigned int SpikeGeneratorCore::nextSpikeTime(CpuSNN* s, int grpId, int i,
 		return 0xFFFFFFFF;
 }
 
+bool SpikeGeneratorCore::nextSpikeTimes(CpuSNN* s, int grpId, unsigned int currentTime, unsigned int endOfTimeSlice,
+										const std::vector<unsigned int>& lastScheduledSpikeTimes,
+										std::vector<int>& nIds, std::vector<unsigned int>& spkTimes) {
+	if (sGen != NULL)
+		return sGen->nextSpikeTimes(carlsim, grpId, currentTime, endOfTimeSlice, lastScheduledSpikeTimes, nIds,
+			spkTimes);
+	else
+		return false;
+}
+
 ConnectionGeneratorCore::ConnectionGeneratorCore(CARLsim* c, ConnectionGenerator* cg) {
 	carlsim = c;
 	cGen = cg;
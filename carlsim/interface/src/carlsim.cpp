@@ -97,6 +97,13 @@ CARLsim::CARLsim(const std::string& netName, simMode_t simMode, loggerMode_t log
 	hasSetConductances_			= false;
 	carlsimState_				= CONFIG_STATE;
 
+	asyncRunning_				= false;
+	asyncThreadActive_			= false;
+#if defined(WIN32) || defined(WIN64)
+	asyncLock_ = CreateMutex(NULL, FALSE, NULL);
+#else
+	pthread_mutex_init(&asyncLock_, NULL);
+#endif
 
 	snn_ = NULL;
 
@@ -104,6 +111,14 @@ CARLsim::CARLsim(const std::string& netName, simMode_t simMode, loggerMode_t log
 }
 
 CARLsim::~CARLsim() {
+	// wait for an asynchronous run to finish
+	joinAsyncRun();
+#if defined(WIN32) || defined(WIN64)
+	CloseHandle(asyncLock_);
+#else
+	pthread_mutex_destroy(&asyncLock_);
+#endif
+
 	// save simulation
 	if (carlsimState_ == SETUP_STATE || carlsimState_ == RUN_STATE)
 		saveSimulation(def_save_fileName_,def_save_synapseInfo_);
@@ -240,6 +255,11 @@ short int CARLsim::connect(int grpId1, int grpId2, const std::string& connType,
 	UserErrors::assertTrue(connProb>=0.0f && connProb<=1.0f, UserErrors::MUST_BE_IN_RANGE, funcName,
 		"Connection Probability connProb", "[0,1]");
 	UserErrors::assertTrue(delay.min>0, UserErrors::MUST_BE_POSITIVE, funcName, "delay.min");
+	int maxDelayAllowed = (simMode_==GPU_MODE) ? MAX_SynapticDelayGPU : MAX_SynapticDelay;
+	std::stringstream maxDelayStr; maxDelayStr << maxDelayAllowed << " ms in " << (simMode_==GPU_MODE?"GPU":"CPU")
+		<< "_MODE";
+	UserErrors::assertTrue(delay.max<=maxDelayAllowed, UserErrors::CANNOT_BE_LARGER, funcName, "delay.max",
+		maxDelayStr.str());
 	UserErrors::assertTrue(connType.compare("one-to-one")!=0
 		|| (connType.compare("one-to-one")==0 && getGroupNumNeurons(grpId1) == getGroupNumNeurons(grpId2)),
 		UserErrors::MUST_BE_IDENTICAL, funcName, "For type \"one-to-one\", number of neurons in pre and post");
@@ -799,6 +819,18 @@ void CARLsim::setISTDP(int grpId, bool isSet, stdpType_t type, PulseCurve curve)
 	}
 }
 
+// set eligibility trace for DA-modulated STDP
+void CARLsim::setEligibilityTrace(int grpId, bool isSet, float tauElig) {
+	std::string funcName = "setEligibilityTrace(\""+getGroupName(grpId)+"\")";
+	UserErrors::assertTrue(!isSet || (isSet && !isPoissonGroup(grpId)), UserErrors::WRONG_NEURON_TYPE, funcName, funcName);
+	UserErrors::assertTrue(!isSet || tauElig>0.0f, UserErrors::MUST_BE_POSITIVE, funcName, "tauElig");
+	UserErrors::assertTrue(!isSet || getSimMode()==CPU_MODE, UserErrors::CAN_ONLY_BE_CALLED_IN_MODE, funcName,
+		funcName, "CPU_MODE.");
+	UserErrors::assertTrue(carlsimState_==CONFIG_STATE, UserErrors::CAN_ONLY_BE_CALLED_IN_STATE, funcName, funcName, "CONFIG.");
+
+	snn_->setEligibilityTrace(grpId, isSet, tauElig);
+}
+
 // set STP, default
 void CARLsim::setSTP(int grpId, bool isSet) {
 	std::string funcName = "setSTP(\""+getGroupName(grpId)+"\")";
@@ -849,6 +881,18 @@ void CARLsim::setWeightAndWeightChangeUpdate(updateInterval_t wtANDwtChangeUpdat
 	snn_->setWeightAndWeightChangeUpdate(wtANDwtChangeUpdateInterval, enableWtChangeDecay, wtChangeDecay);
 }
 
+// set the length of the bookkeeping epoch of firing tables and monitors
+void CARLsim::setEpochLength(int epochMs) {
+	std::string funcName = "setEpochLength()";
+	UserErrors::assertTrue(epochMs > 0, UserErrors::MUST_BE_POSITIVE, funcName, "epochMs");
+	UserErrors::assertTrue(epochMs <= 60000, UserErrors::CANNOT_BE_LARGER, funcName, "epochMs", "60000");
+	UserErrors::assertTrue(simMode_==CPU_MODE || epochMs==1000, UserErrors::MUST_BE_SET_TO, funcName,
+		"epochMs in GPU mode", "1000");
+	UserErrors::assertTrue(carlsimState_==CONFIG_STATE, UserErrors::CAN_ONLY_BE_CALLED_IN_STATE, funcName, funcName, "CONFIG.");
+
+	snn_->setEpochLength(epochMs);
+}
+
 
 // +++++++++ PUBLIC METHODS: RUNNING A SIMULATION +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++ //
 
@@ -857,6 +901,8 @@ int CARLsim::runNetwork(int nSec, int nMsec, bool printRunSummary, bool copyStat
 	std::string funcName = "runNetwork()";
 	UserErrors::assertTrue(carlsimState_ == SETUP_STATE || carlsimState_ == RUN_STATE,
 				UserErrors::CAN_ONLY_BE_CALLED_IN_STATE, funcName, funcName, "SETUP or RUN.");
+	assertNotRunningAsync(funcName);
+	joinAsyncRun();
 
 	// run some checks before running network for the first time
 	if (carlsimState_ != RUN_STATE) {
@@ -873,6 +919,52 @@ int CARLsim::runNetwork(int nSec, int nMsec, bool printRunSummary, bool copyStat
 	return snn_->runNetwork(nSec, nMsec, printRunSummary, copyState);
 }
 
+// run network in a background thread
+RunFuture CARLsim::runNetworkAsync(int nSec, int nMsec, bool printRunSummary, bool copyState) {
+	std::string funcName = "runNetworkAsync()";
+	UserErrors::assertTrue(carlsimState_ == SETUP_STATE || carlsimState_ == RUN_STATE,
+				UserErrors::CAN_ONLY_BE_CALLED_IN_STATE, funcName, funcName, "SETUP or RUN.");
+	assertNotRunningAsync(funcName);
+	joinAsyncRun();
+
+	// same checks as in runNetwork, which must happen in the calling thread
+	if (carlsimState_ != RUN_STATE) {
+		if (!hasSetConductances_) {
+			userWarnings_.push_back("CARLsim::setConductances has not been called. Setting simulation mode to CUBA.");
+		}
+		handleUserWarnings();
+	}
+	carlsimState_ = RUN_STATE;
+
+	asyncNSec_ = nSec;
+	asyncNMsec_ = nMsec;
+	asyncPrintRunSummary_ = printRunSummary;
+	asyncCopyState_ = copyState;
+	asyncResults_.push_back(0);
+	asyncRunning_ = true;
+
+#if defined(WIN32) || defined(WIN64)
+	asyncThread_ = CreateThread(NULL, 0, asyncRunThread, this, 0, NULL);
+	bool success = asyncThread_ != NULL;
+#else
+	bool success = pthread_create(&asyncThread_, NULL, asyncRunThread, this) == 0;
+#endif
+	if (!success) {
+		asyncRunning_ = false;
+		UserErrors::assertTrue(false, UserErrors::UNKNOWN, funcName, "", "Could not create thread.");
+	}
+	asyncThreadActive_ = true;
+
+	return RunFuture(this, asyncResults_.size());
+}
+
+bool CARLsim::isRunningAsync() {
+	lockAsync();
+	bool running = asyncRunning_;
+	unlockAsync();
+	return running;
+}
+
 // setup network with custom options
 void CARLsim::setupNetwork(bool removeTempMemory) {
 	std::string funcName = "setupNetwork()";
@@ -906,6 +998,7 @@ void CARLsim::saveSimulation(const std::string& fileName, bool saveSynapseInfo)
 	UserErrors::assertTrue(fpSave!=NULL,UserErrors::FILE_CANNOT_OPEN,fileName);
 	UserErrors::assertTrue(carlsimState_ == SETUP_STATE || carlsimState_ == RUN_STATE,
 					UserErrors::CAN_ONLY_BE_CALLED_IN_STATE, funcName, funcName, "SETUP or RUN.");
+	assertNotRunningAsync(funcName);
 
 	snn_->saveSimulation(fpSave,saveSynapseInfo);
 
@@ -916,6 +1009,7 @@ void CARLsim::setLogFile(const std::string& fileName) {
 	std::string funcName = "setLogFile("+fileName+")";
 	UserErrors::assertTrue(loggerMode_!=CUSTOM,UserErrors::CANNOT_BE_SET_TO, funcName,
 		"Logger mode", "CUSTOM");
+	assertNotRunningAsync(funcName);
 
 	FILE* fpLog = NULL;
 	std::string fileNameNonConst = fileName;
@@ -938,6 +1032,7 @@ void CARLsim::setLogFile(const std::string& fileName) {
 // set new file pointer for all files in CUSTOM mode
 void CARLsim::setLogsFpCustom(FILE* fpInf, FILE* fpErr, FILE* fpDeb, FILE* fpLog) {
 	UserErrors::assertTrue(loggerMode_==CUSTOM,UserErrors::MUST_BE_SET_TO,"setLogsFpCustom","Logger mode","CUSTOM");
+	assertNotRunningAsync("setLogsFpCustom");
 
 	snn_->setLogsFp(fpInf,fpErr,fpDeb,fpLog);
 }
@@ -950,6 +1045,7 @@ void CARLsim::biasWeights(short int connId, float bias, bool updateWeightRange)
 	std::stringstream funcName;	funcName << "biasWeights(" << connId << "," << bias << "," << updateWeightRange << ")";
 	UserErrors::assertTrue(carlsimState_==SETUP_STATE || carlsimState_==RUN_STATE,
 		UserErrors::CAN_ONLY_BE_CALLED_IN_STATE, funcName.str(), funcName.str(), "SETUP or RUN.");
+	assertNotRunningAsync(funcName.str());
 	UserErrors::assertTrue(connId>=0 && connId<getNumConnections(), UserErrors::MUST_BE_IN_RANGE, funcName.str(),
 		"connId", "[0,getNumConnections()]");
 
@@ -960,6 +1056,7 @@ void CARLsim::startTesting(bool updateWeights) {
 	std::string funcName = "startTesting()";
 	UserErrors::assertTrue(carlsimState_==SETUP_STATE || carlsimState_==RUN_STATE, 
 		UserErrors::CAN_ONLY_BE_CALLED_IN_STATE, funcName, funcName, "SETUP or RUN.");
+	assertNotRunningAsync(funcName);
 	snn_->startTesting(updateWeights);
 }
 
@@ -967,6 +1064,7 @@ void CARLsim::stopTesting() {
 	std::string funcName = "stopTesting()";
 	UserErrors::assertTrue(carlsimState_==SETUP_STATE || carlsimState_==RUN_STATE, 
 		UserErrors::CAN_ONLY_BE_CALLED_IN_STATE, funcName, funcName, "SETUP or RUN.");
+	assertNotRunningAsync(funcName);
 	snn_->stopTesting();
 }
 
@@ -983,6 +1081,7 @@ void CARLsim::resetSpikeCounter(int grpId) {
 	std::string funcName = "resetSpikeCounter()";
 	UserErrors::assertTrue(carlsimState_==SETUP_STATE||carlsimState_==RUN_STATE,
 		UserErrors::CAN_ONLY_BE_CALLED_IN_STATE, funcName, funcName, "SETUP or RUN.");
+	assertNotRunningAsync(funcName);
 
 	snn_->resetSpikeCounter(grpId);
 }
@@ -992,6 +1091,7 @@ void CARLsim::scaleWeights(short int connId, float scale, bool updateWeightRange
 	std::stringstream funcName;	funcName << "scaleWeights(" << connId << "," << scale << "," << updateWeightRange << ")";
 	UserErrors::assertTrue(carlsimState_==SETUP_STATE || carlsimState_==RUN_STATE,
 		UserErrors::CAN_ONLY_BE_CALLED_IN_STATE, funcName.str(), funcName.str(), "SETUP or RUN.");
+	assertNotRunningAsync(funcName.str());
 	UserErrors::assertTrue(connId>=0 && connId<getNumConnections(), UserErrors::MUST_BE_IN_RANGE, funcName.str(),
 		"connId", "[0,getNumConnections()]");
 	UserErrors::assertTrue(scale>=0.0f, UserErrors::CANNOT_BE_NEGATIVE, funcName.str(), "Scaling factor");
@@ -1046,6 +1146,16 @@ void CARLsim::setExternalCurrent(int grpId, const std::vector<float>& current) {
 	UserErrors::assertTrue(carlsimState_==SETUP_STATE || carlsimState_==RUN_STATE,
 		UserErrors::CAN_ONLY_BE_CALLED_IN_STATE, funcName, funcName, "SETUP or RUN.");
 
+	// during an asynchronous run, the current is applied at the end of the run
+	lockAsync();
+	if (asyncRunning_) {
+		StagedCurrent staged = {grpId, current};
+		stagedCurrents_.push_back(staged);
+		unlockAsync();
+		return;
+	}
+	unlockAsync();
+
 	snn_->setExternalCurrent(grpId, current);
 }
 
@@ -1057,7 +1167,21 @@ void CARLsim::setExternalCurrent(int grpId, float current) {
 		UserErrors::CAN_ONLY_BE_CALLED_IN_STATE, funcName, funcName, "SETUP or RUN.");
 
 	std::vector<float> vecCurrent(getGroupNumNeurons(grpId), current);
-	snn_->setExternalCurrent(grpId, vecCurrent);
+	setExternalCurrent(grpId, vecCurrent);
+}
+
+void CARLsim::setExternalCurrentSchedule(int grpId, CurrentSchedule* schedule) {
+	std::string funcName = "setExternalCurrentSchedule(\""+getGroupName(grpId)+"\")";
+	UserErrors::assertFalse(grpId==ALL, UserErrors::ALL_NOT_ALLOWED, funcName, "grpId");
+	UserErrors::assertTrue(!isPoissonGroup(grpId), UserErrors::WRONG_NEURON_TYPE, funcName, funcName);
+	UserErrors::assertTrue(carlsimState_==SETUP_STATE || carlsimState_==RUN_STATE,
+		UserErrors::CAN_ONLY_BE_CALLED_IN_STATE, funcName, funcName, "SETUP or RUN.");
+	UserErrors::assertTrue(schedule!=NULL, UserErrors::CANNOT_BE_NULL, funcName, "schedule");
+	UserErrors::assertTrue(schedule->getNumNeurons()==getGroupNumNeurons(grpId), UserErrors::MUST_BE_IDENTICAL,
+		funcName, "CurrentSchedule length", "number of neurons in the group.");
+	assertNotRunningAsync(funcName);
+
+	snn_->setExternalCurrentSchedule(grpId, schedule);
 }
 
 // set group monitor for a group
@@ -1154,6 +1278,40 @@ SpikeMonitor* CARLsim::setSpikeMonitor(int grpId, const std::string& fileName) {
 	return snn_->setSpikeMonitor(grpId, fid);
 }
 
+void CARLsim::setRealTimeFactor(float factor) {
+	std::string funcName = "setRealTimeFactor()";
+	UserErrors::assertTrue(factor>=0.0f, UserErrors::CANNOT_BE_NEGATIVE, funcName, "factor");
+	assertNotRunningAsync(funcName);
+
+	snn_->setRealTimeFactor(factor);
+}
+
+void CARLsim::setSpikeInjectionQueue(SpikeInjectionQueue* queue) {
+	std::string funcName = "setSpikeInjectionQueue()";
+	UserErrors::assertTrue(queue==NULL || getSimMode()==CPU_MODE, UserErrors::CAN_ONLY_BE_CALLED_IN_MODE, funcName,
+		funcName, "CPU_MODE.");
+	UserErrors::assertTrue(carlsimState_==SETUP_STATE || carlsimState_==RUN_STATE,
+					UserErrors::CAN_ONLY_BE_CALLED_IN_STATE, funcName, funcName, "SETUP or RUN.");
+	assertNotRunningAsync(funcName);
+
+	snn_->setSpikeInjectionQueue(queue);
+}
+
+void CARLsim::setSpikeStream(int grpId, const std::string& streamName, int capacity, bool replaceExisting) {
+	std::string funcName = "setSpikeStream(\""+getGroupName(grpId)+"\",\""+streamName+"\")";
+	UserErrors::assertFalse(grpId==ALL, UserErrors::ALL_NOT_ALLOWED, funcName, "grpId");
+	UserErrors::assertTrue(grpId>=0, UserErrors::CANNOT_BE_NEGATIVE, funcName, "grpId");
+	UserErrors::assertTrue(!streamName.empty(), UserErrors::UNKNOWN, funcName, "", "streamName cannot be empty.");
+	UserErrors::assertTrue(capacity>0 && capacity<=SPIKE_STREAM_MAX_CAPACITY, UserErrors::MUST_BE_IN_RANGE,
+		funcName, "capacity", "[1,2^30].");
+	UserErrors::assertTrue(getSimMode()==CPU_MODE, UserErrors::CAN_ONLY_BE_CALLED_IN_MODE, funcName, funcName,
+		"CPU_MODE.");
+	UserErrors::assertTrue(carlsimState_==CONFIG_STATE || carlsimState_==SETUP_STATE,
+					UserErrors::CAN_ONLY_BE_CALLED_IN_STATE, funcName, funcName, "CONFIG or SETUP.");
+
+	snn_->setSpikeStream(grpId, streamName, capacity, replaceExisting);
+}
+
 // assign spike rate to poisson group
 void CARLsim::setSpikeRate(int grpId, PoissonRate* spikeRate, int refPeriod) {
 	std::string funcName = "setSpikeRate()";
@@ -1165,14 +1323,49 @@ void CARLsim::setSpikeRate(int grpId, PoissonRate* spikeRate, int refPeriod) {
 	UserErrors::assertTrue(!spikeRate->isOnGPU() || (spikeRate->isOnGPU()&&getSimMode()==GPU_MODE),
 		UserErrors::CAN_ONLY_BE_CALLED_IN_MODE, funcName, "PoissonRate on GPU", "GPU_MODE.");
 
+	// during an asynchronous run, the rate is applied at the end of the run
+	lockAsync();
+	if (asyncRunning_) {
+		StagedSpikeRate staged = {grpId, spikeRate, refPeriod};
+		stagedSpikeRates_.push_back(staged);
+		unlockAsync();
+		return;
+	}
+	unlockAsync();
+
 	snn_->setSpikeRate(grpId, spikeRate, refPeriod);
 }
 
+void CARLsim::setSpikeRateSchedule(int grpId, PoissonRateSchedule* schedule, int refPeriod) {
+	std::string funcName = "setSpikeRateSchedule()";
+	UserErrors::assertTrue(carlsimState_==SETUP_STATE || carlsimState_==RUN_STATE,
+					UserErrors::CAN_ONLY_BE_CALLED_IN_STATE, funcName, funcName, "SETUP or RUN.");
+	assertNotRunningAsync(funcName);
+	UserErrors::assertTrue(isPoissonGroup(grpId), UserErrors::WRONG_NEURON_TYPE, funcName, funcName);
+	UserErrors::assertTrue(schedule!=NULL, UserErrors::CANNOT_BE_NULL, funcName, "schedule");
+	UserErrors::assertTrue(schedule->getNumNeurons()==getGroupNumNeurons(grpId), UserErrors::MUST_BE_IDENTICAL,
+		funcName, "PoissonRateSchedule length and the number of neurons in the group");
+	UserErrors::assertTrue(schedule->getNumSegments()>0, UserErrors::CANNOT_BE_ZERO, funcName,
+		"Number of segments");
+	UserErrors::assertTrue(refPeriod>=1, UserErrors::MUST_BE_POSITIVE, funcName, "refPeriod");
+
+	snn_->setSpikeRateSchedule(grpId, schedule, refPeriod);
+}
+
+void CARLsim::setPoissonMode(int grpId, poissonMode_t mode) {
+	std::string funcName = "setPoissonMode()";
+	UserErrors::assertTrue(isPoissonGroup(grpId), UserErrors::WRONG_NEURON_TYPE, funcName, funcName);
+	assertNotRunningAsync(funcName);
+
+	snn_->setPoissonMode(grpId, mode);
+}
+
 void CARLsim::setWeight(short int connId, int neurIdPre, int neurIdPost, float weight, bool updateWeightRange) {
 	std::stringstream funcName;	funcName << "setWeight(" << connId << "," << neurIdPre << "," << neurIdPost << ","
 		<< updateWeightRange << ")";
 	UserErrors::assertTrue(carlsimState_==SETUP_STATE || carlsimState_==RUN_STATE,
 		UserErrors::CAN_ONLY_BE_CALLED_IN_STATE, funcName.str(), funcName.str(), "SETUP or RUN.");
+	assertNotRunningAsync(funcName.str());
 	UserErrors::assertTrue(connId>=0 && connId<getNumConnections(), UserErrors::MUST_BE_IN_RANGE,
 		funcName.str(), "connectionId", "[0,getNumConnections()]");
 	UserErrors::assertTrue(weight>=0.0f, UserErrors::CANNOT_BE_NEGATIVE, funcName.str(), "Weight value");
@@ -1185,6 +1378,7 @@ void CARLsim::writePopWeights(std::string fname, int gIDpre, int gIDpost) {
 	std::string funcName = "writePopWeights("+fname+")";
 	UserErrors::assertTrue(carlsimState_ == SETUP_STATE || carlsimState_ == RUN_STATE,
 					UserErrors::CAN_ONLY_BE_CALLED_IN_STATE, funcName, funcName, "SETUP or RUN.");
+	assertNotRunningAsync(funcName);
 
 	snn_->writePopWeights(fname,gIDpre,gIDpost);
 }
@@ -1197,6 +1391,7 @@ std::vector<float> CARLsim::getConductanceAMPA(int grpId) {
 	std::string funcName = "getConductanceAMPA()";
 	UserErrors::assertTrue(carlsimState_ == RUN_STATE, UserErrors::CAN_ONLY_BE_CALLED_IN_STATE,
 		funcName, funcName, "RUN.");
+	assertNotRunningAsync(funcName);
 	UserErrors::assertFalse(grpId==ALL, UserErrors::ALL_NOT_ALLOWED, funcName, "grpId");
 	UserErrors::assertTrue(grpId>=0 && grpId<getNumGroups(), UserErrors::MUST_BE_IN_RANGE, funcName, "grpId",
 		"[0,getNumGroups()]");
@@ -1208,6 +1403,7 @@ std::vector<float> CARLsim::getConductanceNMDA(int grpId) {
 	std::string funcName = "getConductanceNMDA()";
 	UserErrors::assertTrue(carlsimState_ == RUN_STATE, UserErrors::CAN_ONLY_BE_CALLED_IN_STATE,
 		funcName, funcName, "RUN.");
+	assertNotRunningAsync(funcName);
 	UserErrors::assertFalse(grpId==ALL, UserErrors::ALL_NOT_ALLOWED, funcName, "grpId");
 	UserErrors::assertTrue(grpId>=0 && grpId<getNumGroups(), UserErrors::MUST_BE_IN_RANGE, funcName, "grpId",
 		"[0,getNumGroups()]");
@@ -1219,6 +1415,7 @@ std::vector<float> CARLsim::getConductanceGABAa(int grpId) {
 	std::string funcName = "getConductanceGABAa()";
 	UserErrors::assertTrue(carlsimState_ == RUN_STATE, UserErrors::CAN_ONLY_BE_CALLED_IN_STATE,
 		funcName, funcName, "RUN.");
+	assertNotRunningAsync(funcName);
 	UserErrors::assertFalse(grpId==ALL, UserErrors::ALL_NOT_ALLOWED, funcName, "grpId");
 	UserErrors::assertTrue(grpId>=0 && grpId<getNumGroups(), UserErrors::MUST_BE_IN_RANGE, funcName, "grpId",
 		"[0,getNumGroups()]");
@@ -1230,6 +1427,7 @@ std::vector<float> CARLsim::getConductanceGABAb(int grpId) {
 	std::string funcName = "getConductanceGABAb()";
 	UserErrors::assertTrue(carlsimState_ == RUN_STATE, UserErrors::CAN_ONLY_BE_CALLED_IN_STATE,
 		funcName, funcName, "RUN.");
+	assertNotRunningAsync(funcName);
 	UserErrors::assertFalse(grpId==ALL, UserErrors::ALL_NOT_ALLOWED, funcName, "grpId");
 	UserErrors::assertTrue(grpId>=0 && grpId<getNumGroups(), UserErrors::MUST_BE_IN_RANGE, funcName, "grpId",
 		"[0,getNumGroups()]");
@@ -1384,12 +1582,33 @@ GroupNeuromodulatorInfo_t CARLsim::getGroupNeuromodulatorInfo(int grpId) {
 	return snn_->getGroupNeuromodulatorInfo(grpId);
 }
 
+RealTimeStats_t CARLsim::getRealTimeStats() {
+	assertNotRunningAsync("getRealTimeStats()");
+	return snn_->getRealTimeStats();
+}
+
+void CARLsim::resetRealTimeStats() {
+	assertNotRunningAsync("resetRealTimeStats()");
+	snn_->resetRealTimeStats();
+}
+
 
 simMode_t CARLsim::getSimMode() { return simMode_; }
 
-uint64_t CARLsim::getSimTime() { return snn_->getSimTime(); }
-uint32_t CARLsim::getSimTimeSec() { return snn_->getSimTimeSec(); }
-uint32_t CARLsim::getSimTimeMsec() { return snn_->getSimTimeMs(); }
+uint64_t CARLsim::getSimTime() {
+	assertNotRunningAsync("getSimTime()");
+	return snn_->getSimTime();
+}
+
+uint32_t CARLsim::getSimTimeSec() {
+	assertNotRunningAsync("getSimTimeSec()");
+	return snn_->getSimTimeSec();
+}
+
+uint32_t CARLsim::getSimTimeMsec() {
+	assertNotRunningAsync("getSimTimeMsec()");
+	return snn_->getSimTimeMs();
+}
 
 // get spiking information out for a given group
 int* CARLsim::getSpikeCounter(int grpId) {
@@ -1397,6 +1616,7 @@ int* CARLsim::getSpikeCounter(int grpId) {
 	UserErrors::assertFalse(grpId==ALL, UserErrors::ALL_NOT_ALLOWED, funcName.str(), "grpId");
 	UserErrors::assertTrue(carlsimState_==RUN_STATE, UserErrors::CAN_ONLY_BE_CALLED_IN_STATE, funcName.str(),
 		"RUN.");
+	assertNotRunningAsync(funcName.str());
 
 	return snn_->getSpikeCounter(grpId);
 }
@@ -1406,6 +1626,7 @@ SpikeMonitor* CARLsim::getSpikeMonitor(int grpId) {
 	std::stringstream funcName; funcName << "getSpikeMonitor(" << grpId << ")";
 	UserErrors::assertTrue(grpId>=0 && grpId<getNumGroups(), UserErrors::MUST_BE_IN_RANGE, funcName.str(),
 		"grpId", "[0,getNumGroups()]");
+	assertNotRunningAsync(funcName.str());
 
 	return snn_->getSpikeMonitor(grpId);
 }
@@ -1625,3 +1846,101 @@ void CARLsim::printSimulationSpecs() {
 					copyState_?"on":"off");
 	}
 }
+
+// report an error if an asynchronous run is in progress
+void CARLsim::assertNotRunningAsync(const std::string& funcName) {
+	UserErrors::assertTrue(!isRunningAsync(), UserErrors::UNKNOWN, funcName, "",
+		"Cannot be called while an asynchronous run is in progress (see runNetworkAsync).");
+}
+
+// apply all setSpikeRate and setExternalCurrent calls that were made during an asynchronous run, in order
+void CARLsim::applyStagedStimuli() {
+	for (unsigned int i=0; i<stagedSpikeRates_.size(); i++) {
+		StagedSpikeRate& staged = stagedSpikeRates_[i];
+		snn_->setSpikeRate(staged.grpId, staged.spikeRate, staged.refPeriod);
+	}
+	for (unsigned int i=0; i<stagedCurrents_.size(); i++) {
+		snn_->setExternalCurrent(stagedCurrents_[i].grpId, stagedCurrents_[i].current);
+	}
+	stagedSpikeRates_.clear();
+	stagedCurrents_.clear();
+}
+
+bool CARLsim::isAsyncRunReady(unsigned int runId) {
+	assert(runId>0 && runId<=asyncResults_.size());
+	lockAsync();
+	bool ready = !asyncRunning_ || runId<asyncResults_.size();
+	unlockAsync();
+	return ready;
+}
+
+int CARLsim::waitForAsyncRun(unsigned int runId) {
+	assert(runId>0 && runId<=asyncResults_.size());
+	if (runId == asyncResults_.size()) {
+		joinAsyncRun();
+	}
+	return asyncResults_[runId-1];
+}
+
+void CARLsim::joinAsyncRun() {
+	if (!asyncThreadActive_)
+		return;
+
+#if defined(WIN32) || defined(WIN64)
+	WaitForSingleObject(asyncThread_, INFINITE);
+	CloseHandle(asyncThread_);
+#else
+	pthread_join(asyncThread_, NULL);
+#endif
+	asyncThreadActive_ = false;
+}
+
+void CARLsim::lockAsync() {
+#if defined(WIN32) || defined(WIN64)
+	WaitForSingleObject(asyncLock_, INFINITE);
+#else
+	pthread_mutex_lock(&asyncLock_);
+#endif
+}
+
+void CARLsim::unlockAsync() {
+#if defined(WIN32) || defined(WIN64)
+	ReleaseMutex(asyncLock_);
+#else
+	pthread_mutex_unlock(&asyncLock_);
+#endif
+}
+
+// thread function of runNetworkAsync: run the network, then apply the staged stimuli before the run is marked as
+// finished, so that they are in place for the next run
+#if defined(WIN32) || defined(WIN64)
+DWORD WINAPI CARLsim::asyncRunThread(LPVOID sim) {
+#else
+void* CARLsim::asyncRunThread(void* sim) {
+#endif
+	CARLsim* s = (CARLsim*)sim;
+	int result = s->snn_->runNetwork(s->asyncNSec_, s->asyncNMsec_, s->asyncPrintRunSummary_, s->asyncCopyState_);
+
+	s->lockAsync();
+	s->asyncResults_.back() = result;
+	s->applyStagedStimuli();
+	s->asyncRunning_ = false;
+	s->unlockAsync();
+
+	return 0;
+}
+
+
+/// **************************************************************************************************************** ///
+/// RUNFUTURE
+/// **************************************************************************************************************** ///
+
+bool RunFuture::isReady() {
+	UserErrors::assertTrue(sim_!=NULL, UserErrors::CANNOT_BE_NULL, "RunFuture::isReady()", "RunFuture");
+	return sim_->isAsyncRunReady(runId_);
+}
+
+int RunFuture::wait() {
+	UserErrors::assertTrue(sim_!=NULL, UserErrors::CANNOT_BE_NULL, "RunFuture::wait()", "RunFuture");
+	return sim_->waitForAsyncRun(runId_);
+}
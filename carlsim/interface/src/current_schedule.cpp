@@ -0,0 +1,179 @@
+/* 
+ * Copyright (c) 2014 Regents of the University of California. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * 3. The names of its contributors may not be used to endorse or promote
+ *    products derived from this software without specific prior written
+ *    permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * *********************************************************************************************** *
+ * CARLsim
+ * created by: 		(MDR) Micah Richert, (JN) Jayram M. Nageswaran
+ * maintained by:	(MA) Mike Avery <averym@uci.edu>, (MB) Michael Beyeler <mbeyeler@uci.edu>,
+ *					(KDC) Kristofor Carlson <kdcarlso@uci.edu>
+ *					(TSC) Ting-Shuo Chou <tingshuc@uci.edu>
+ *
+ * CARLsim available from http://socsci.uci.edu/~jkrichma/CARLsim/
+ * Ver 11/26/2014
+ */
+#include <current_schedule.h>
+
+#include <carlsim_definitions.h>	// ALL
+#include <user_errors.h>			// fancy error messages
+#include <algorithm>				// std::stable_sort
+#include <cassert>					// assert
+
+
+class CurrentSchedule::Impl {
+public:
+	// +++++ PUBLIC METHODS +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++ //
+	Impl(int nNeur) : nNeur_(nNeur), isSorted_(true) {
+		UserErrors::assertTrue(nNeur>0, UserErrors::MUST_BE_POSITIVE, "CurrentSchedule", "nNeur");
+	}
+
+	~Impl() {}
+
+	void addCurrent(int timeMs, int neurId, float current) {
+		std::string funcName = "CurrentSchedule::addCurrent";
+		UserErrors::assertTrue(timeMs>=0, UserErrors::CANNOT_BE_NEGATIVE, funcName, "timeMs");
+		UserErrors::assertTrue(neurId==ALL || (neurId>=0 && neurId<nNeur_), UserErrors::MUST_BE_IN_RANGE, funcName,
+			"neurId", "[0,nNeur) or ALL");
+
+		// entries are sorted by time only when they are read (see sortEntries)
+		CurrentEntry entry = {timeMs, neurId, current};
+		if (!entries_.empty() && isEarlier(entry, entries_.back()))
+			isSorted_ = false;
+		entries_.push_back(entry);
+	}
+
+	void addCurrent(int timeMs, const std::vector<float>& current) {
+		UserErrors::assertTrue((int)current.size()==nNeur_, UserErrors::MUST_BE_IDENTICAL, "CurrentSchedule::addCurrent",
+			"Vector size", "the number of neurons");
+		for (int i=0; i<nNeur_; i++)
+			addCurrent(timeMs, i, current[i]);
+	}
+
+	void addPulse(int startMs, int durationMs, int neurId, float amplitude) {
+		UserErrors::assertTrue(durationMs>0, UserErrors::MUST_BE_POSITIVE, "CurrentSchedule::addPulse",
+			"durationMs");
+		addCurrent(startMs, neurId, amplitude);
+		addCurrent(startMs+durationMs, neurId, 0.0f);
+	}
+
+	void addWaveform(int startMs, int neurId, const std::vector<float>& samples) {
+		UserErrors::assertTrue(!samples.empty(), UserErrors::CANNOT_BE_ZERO, "CurrentSchedule::addWaveform",
+			"Number of samples");
+		addCurrent(startMs, neurId, samples[0]);
+		for (size_t t=1; t<samples.size(); t++) {
+			if (samples[t] != samples[t-1])
+				addCurrent(startMs+(int)t, neurId, samples[t]);
+		}
+	}
+
+	void clear() {
+		entries_.clear();
+		isSorted_ = true;
+	}
+
+	int getNumNeurons() { return nNeur_; }
+	int getNumEntries() { return entries_.size(); }
+	int getLengthMs() {
+		sortEntries();
+		return entries_.empty() ? 0 : entries_.back().timeMs+1;
+	}
+
+	int getEntryTimeMs(int entryId) {
+		assert(entryId>=0 && entryId<getNumEntries());
+		sortEntries();
+		return entries_[entryId].timeMs;
+	}
+
+	int getEntryNeurId(int entryId) {
+		assert(entryId>=0 && entryId<getNumEntries());
+		sortEntries();
+		return entries_[entryId].neurId;
+	}
+
+	float getEntryCurrent(int entryId) {
+		assert(entryId>=0 && entryId<getNumEntries());
+		sortEntries();
+		return entries_[entryId].current;
+	}
+
+private:
+	// +++++ PRIVATE METHODS ++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++ //
+
+	struct CurrentEntry {
+		int timeMs;
+		int neurId;
+		float current;
+	};
+
+	static bool isEarlier(const CurrentEntry& a, const CurrentEntry& b) { return a.timeMs < b.timeMs; }
+
+	// sorts the entries by time once after they have been added out of order (a stable sort keeps entries with the
+	// same time in the order they were added)
+	void sortEntries() {
+		if (isSorted_)
+			return;
+		std::stable_sort(entries_.begin(), entries_.end(), isEarlier);
+		isSorted_ = true;
+	}
+
+	// +++++ PRIVATE PROPERTIES +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++ //
+
+	const int nNeur_;						//!< number of neurons to manage
+	std::vector<CurrentEntry> entries_;		//!< current changes in the order they were added
+	bool isSorted_;							//!< whether entries_ is sorted by time
+};
+
+
+// ****************************************************************************************************************** //
+// CURRENTSCHEDULE API IMPLEMENTATION
+// ****************************************************************************************************************** //
+
+// create and destroy a pImpl instance
+CurrentSchedule::CurrentSchedule(int nNeur) : _impl( new Impl(nNeur) ) {}
+CurrentSchedule::~CurrentSchedule() { delete _impl; }
+
+void CurrentSchedule::addCurrent(int timeMs, int neurId, float current) {
+	_impl->addCurrent(timeMs, neurId, current);
+}
+void CurrentSchedule::addCurrent(int timeMs, const std::vector<float>& current) {
+	_impl->addCurrent(timeMs, current);
+}
+void CurrentSchedule::addPulse(int startMs, int durationMs, int neurId, float amplitude) {
+	_impl->addPulse(startMs, durationMs, neurId, amplitude);
+}
+void CurrentSchedule::addWaveform(int startMs, int neurId, const std::vector<float>& samples) {
+	_impl->addWaveform(startMs, neurId, samples);
+}
+void CurrentSchedule::clear() { _impl->clear(); }
+int CurrentSchedule::getNumNeurons() { return _impl->getNumNeurons(); }
+int CurrentSchedule::getNumEntries() { return _impl->getNumEntries(); }
+int CurrentSchedule::getLengthMs() { return _impl->getLengthMs(); }
+int CurrentSchedule::getEntryTimeMs(int entryId) { return _impl->getEntryTimeMs(entryId); }
+int CurrentSchedule::getEntryNeurId(int entryId) { return _impl->getEntryNeurId(entryId); }
+float CurrentSchedule::getEntryCurrent(int entryId) { return _impl->getEntryCurrent(entryId); }
@@ -0,0 +1,162 @@
+/* 
+ * Copyright (c) 2014 Regents of the University of California. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * 3. The names of its contributors may not be used to endorse or promote
+ *    products derived from this software without specific prior written
+ *    permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * *********************************************************************************************** *
+ * CARLsim
+ * created by: 		(MDR) Micah Richert, (JN) Jayram M. Nageswaran
+ * maintained by:	(MA) Mike Avery <averym@uci.edu>, (MB) Michael Beyeler <mbeyeler@uci.edu>,
+ *					(KDC) Kristofor Carlson <kdcarlso@uci.edu>
+ *					(TSC) Ting-Shuo Chou <tingshuc@uci.edu>
+ *
+ * CARLsim available from http://socsci.uci.edu/~jkrichma/CARLsim/
+ * Ver 11/26/2014
+ */
+#include <poisson_rate_schedule.h>
+
+#include <user_errors.h>	// fancy error messages
+#include <algorithm>		// std::upper_bound
+#include <cassert>			// assert
+
+
+class PoissonRateSchedule::Impl {
+public:
+	// +++++ PUBLIC METHODS +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++ //
+	Impl(int nNeur) : nNeur_(nNeur) {
+		UserErrors::assertTrue(nNeur>0, UserErrors::MUST_BE_POSITIVE, "PoissonRateSchedule", "nNeur");
+		clear();
+	}
+
+	~Impl() {}
+
+	void addSegment(int durationMs, float rate) {
+		UserErrors::assertTrue(rate>=0.0f, UserErrors::CANNOT_BE_NEGATIVE, "PoissonRateSchedule::addSegment",
+			"Firing rate");
+		std::vector<float> rates(nNeur_, rate);
+		addSegment(durationMs, rates);
+	}
+
+	void addSegment(int durationMs, const std::vector<float>& rates) {
+		std::string funcName = "PoissonRateSchedule::addSegment";
+		UserErrors::assertTrue(durationMs>0, UserErrors::MUST_BE_POSITIVE, funcName, "durationMs");
+		UserErrors::assertTrue((int)rates.size()==nNeur_, UserErrors::MUST_BE_IDENTICAL, funcName, "Vector size",
+			"the number of neurons");
+		for (int i=0; i<nNeur_; i++) {
+			UserErrors::assertTrue(rates[i]>=0.0f, UserErrors::CANNOT_BE_NEGATIVE, funcName, "Firing rate");
+		}
+
+		rates_.insert(rates_.end(), rates.begin(), rates.end());
+		segStartMs_.push_back(segStartMs_.back() + durationMs);
+	}
+
+	void addFrames(int frameDurMs, const std::vector<float>& rates) {
+		std::string funcName = "PoissonRateSchedule::addFrames";
+		UserErrors::assertTrue(frameDurMs>0, UserErrors::MUST_BE_POSITIVE, funcName, "frameDurMs");
+		UserErrors::assertTrue(rates.size()%nNeur_==0, UserErrors::UNKNOWN, funcName, "",
+			"Size of the rate matrix must be a multiple of the number of neurons.");
+		for (size_t i=0; i<rates.size(); i++) {
+			UserErrors::assertTrue(rates[i]>=0.0f, UserErrors::CANNOT_BE_NEGATIVE, funcName, "Firing rate");
+		}
+
+		rates_.insert(rates_.end(), rates.begin(), rates.end());
+		for (size_t f=0; f<rates.size()/nNeur_; f++)
+			segStartMs_.push_back(segStartMs_.back() + frameDurMs);
+	}
+
+	void clear() {
+		rates_.clear();
+		segStartMs_.clear();
+		segStartMs_.push_back(0);
+	}
+
+	int getNumNeurons() { return nNeur_; }
+	int getNumSegments() { return segStartMs_.size()-1; }
+	int getLengthMs() { return segStartMs_.back(); }
+
+	int getSegmentId(int timeMs) {
+		if (timeMs < 0 || timeMs >= getLengthMs())
+			return -1;
+
+		// segStartMs_ is sorted: find the last segment that starts at or before timeMs
+		return std::upper_bound(segStartMs_.begin(), segStartMs_.end(), timeMs) - segStartMs_.begin() - 1;
+	}
+
+	int getSegmentStartMs(int segId) {
+		assert(segId>=0 && segId<getNumSegments());
+		return segStartMs_[segId];
+	}
+
+	int getSegmentDurationMs(int segId) {
+		assert(segId>=0 && segId<getNumSegments());
+		return segStartMs_[segId+1] - segStartMs_[segId];
+	}
+
+	std::vector<float> getSegmentRates(int segId) {
+		const float* rates = getSegmentRatePtr(segId);
+		return std::vector<float>(rates, rates + nNeur_);
+	}
+
+	const float* getSegmentRatePtr(int segId) {
+		assert(segId>=0 && segId<getNumSegments());
+		return &rates_[(size_t)segId*nNeur_];
+	}
+
+private:
+	// +++++ PRIVATE PROPERTIES +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++ //
+
+	const int nNeur_;				//!< number of neurons to manage
+	std::vector<float> rates_;		//!< the (segment x neuron) rate matrix
+	std::vector<int> segStartMs_;	//!< start time (ms) of every segment, plus the end of the last one
+};
+
+
+// ****************************************************************************************************************** //
+// POISSONRATESCHEDULE API IMPLEMENTATION
+// ****************************************************************************************************************** //
+
+// create and destroy a pImpl instance
+PoissonRateSchedule::PoissonRateSchedule(int nNeur) : _impl( new Impl(nNeur) ) {}
+PoissonRateSchedule::~PoissonRateSchedule() { delete _impl; }
+
+void PoissonRateSchedule::addSegment(int durationMs, float rate) { _impl->addSegment(durationMs, rate); }
+void PoissonRateSchedule::addSegment(int durationMs, const std::vector<float>& rates) {
+	_impl->addSegment(durationMs, rates);
+}
+void PoissonRateSchedule::addFrames(int frameDurMs, const std::vector<float>& rates) {
+	_impl->addFrames(frameDurMs, rates);
+}
+void PoissonRateSchedule::clear() { _impl->clear(); }
+int PoissonRateSchedule::getNumNeurons() { return _impl->getNumNeurons(); }
+int PoissonRateSchedule::getNumSegments() { return _impl->getNumSegments(); }
+int PoissonRateSchedule::getLengthMs() { return _impl->getLengthMs(); }
+int PoissonRateSchedule::getSegmentId(int timeMs) { return _impl->getSegmentId(timeMs); }
+int PoissonRateSchedule::getSegmentStartMs(int segId) { return _impl->getSegmentStartMs(segId); }
+int PoissonRateSchedule::getSegmentDurationMs(int segId) { return _impl->getSegmentDurationMs(segId); }
+std::vector<float> PoissonRateSchedule::getSegmentRates(int segId) { return _impl->getSegmentRates(segId); }
+const float* PoissonRateSchedule::getSegmentRatePtr(int segId) { return _impl->getSegmentRatePtr(segId); }
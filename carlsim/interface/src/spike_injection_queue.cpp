@@ -0,0 +1,146 @@
+/* 
+ * Copyright (c) 2014 Regents of the University of California. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * 3. The names of its contributors may not be used to endorse or promote
+ *    products derived from this software without specific prior written
+ *    permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * *********************************************************************************************** *
+ * CARLsim
+ * created by: 		(MDR) Micah Richert, (JN) Jayram M. Nageswaran
+ * maintained by:	(MA) Mike Avery <averym@uci.edu>, (MB) Michael Beyeler <mbeyeler@uci.edu>,
+ *					(KDC) Kristofor Carlson <kdcarlso@uci.edu>
+ *					(TSC) Ting-Shuo Chou <tingshuc@uci.edu>
+ *
+ * CARLsim available from http://socsci.uci.edu/~jkrichma/CARLsim/
+ * Ver 11/26/2014
+ */
+#include <spike_injection_queue.h>
+
+#include <user_errors.h>	// fancy error messages
+#include <vector>			// std::vector
+
+#if defined(WIN32) || defined(WIN64)
+	#include <Windows.h>	// MemoryBarrier
+#endif
+
+namespace {
+	// acquire load and release store of the queue indices, atomic increment of the rejection counter
+#if defined(WIN32) || defined(WIN64)
+	inline unsigned int loadAcquire(const unsigned int* p) {
+		unsigned int v = *(const volatile unsigned int*)p;
+		MemoryBarrier();
+		return v;
+	}
+	inline void storeRelease(unsigned int* p, unsigned int v) {
+		MemoryBarrier();
+		*(volatile unsigned int*)p = v;
+	}
+	inline void incrementRelaxed(unsigned int* p) { InterlockedIncrement((volatile LONG*)p); }
+#else
+	inline unsigned int loadAcquire(const unsigned int* p) { return __atomic_load_n(p, __ATOMIC_ACQUIRE); }
+	inline void storeRelease(unsigned int* p, unsigned int v) { __atomic_store_n(p, v, __ATOMIC_RELEASE); }
+	inline void incrementRelaxed(unsigned int* p) { __atomic_fetch_add(p, 1, __ATOMIC_RELAXED); }
+#endif
+}
+
+class SpikeInjectionQueue::Impl {
+public:
+	// +++++ PUBLIC METHODS +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++ //
+	Impl(int capacity) : head_(0), simTime_(0), tail_(0), numRejected_(0) {
+		UserErrors::assertTrue(capacity>0, UserErrors::MUST_BE_POSITIVE, "SpikeInjectionQueue", "capacity");
+		capacity_ = 1;
+		while (capacity_ < (unsigned int)capacity)
+			capacity_ <<= 1;
+		events_.resize(capacity_);
+	}
+
+	~Impl() {}
+
+	bool push(const injection_event_t& ev) {
+		// only the producer writes tail_, so it can be read without synchronization
+		unsigned int tail = tail_;
+		if (tail - loadAcquire(&head_) >= capacity_) {
+			incrementRelaxed(&numRejected_);
+			return false;
+		}
+		events_[tail & (capacity_-1)] = ev;
+		storeRelease(&tail_, tail+1);
+		return true;
+	}
+
+	bool pop(injection_event_t& ev) {
+		// only the consumer writes head_
+		unsigned int head = head_;
+		if (head == loadAcquire(&tail_))
+			return false;
+		ev = events_[head & (capacity_-1)];
+		storeRelease(&head_, head+1);
+		return true;
+	}
+
+	int getCapacity() { return capacity_; }
+	unsigned int getNumRejected() { return loadAcquire(&numRejected_); }
+	unsigned int getSimTime() { return loadAcquire(&simTime_); }
+	void setSimTime(unsigned int simTimeMs) { storeRelease(&simTime_, simTimeMs); }
+
+private:
+	// +++++ PRIVATE PROPERTIES +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++ //
+	// the indices only ever increase (modulo 2^32); the consumer and producer indices live on separate cache lines so
+	// that the two threads do not keep invalidating each other's cache
+	unsigned int head_;				//!< index of the next event to pop (written by the consumer)
+	unsigned int simTime_;			//!< last simulation time the queue was drained (written by the consumer)
+	char padConsumer_[56];
+	unsigned int tail_;				//!< index of the next event to push (written by the producer)
+	unsigned int numRejected_;		//!< number of events that did not fit into the queue (written by the producer)
+	char padProducer_[56];
+
+	unsigned int capacity_;			//!< number of events the queue can hold (power of two)
+	std::vector<injection_event_t> events_;	//!< ring buffer
+};
+
+
+// ****************************************************************************************************************** //
+// SPIKEINJECTIONQUEUE API IMPLEMENTATION
+// ****************************************************************************************************************** //
+
+// create and destroy a pImpl instance
+SpikeInjectionQueue::SpikeInjectionQueue(int capacity) : _impl( new Impl(capacity) ) {}
+SpikeInjectionQueue::~SpikeInjectionQueue() { delete _impl; }
+
+bool SpikeInjectionQueue::pushSpike(int grpId, int neurId, unsigned int timeMs) {
+	injection_event_t ev = {INJECT_SPIKE, grpId, neurId, timeMs, 0.0f};
+	return _impl->push(ev);
+}
+bool SpikeInjectionQueue::pushCurrent(int grpId, int neurId, float current) {
+	injection_event_t ev = {INJECT_CURRENT, grpId, neurId, 0, current};
+	return _impl->push(ev);
+}
+bool SpikeInjectionQueue::pop(injection_event_t& ev) { return _impl->pop(ev); }
+int SpikeInjectionQueue::getCapacity() { return _impl->getCapacity(); }
+unsigned int SpikeInjectionQueue::getNumRejected() { return _impl->getNumRejected(); }
+unsigned int SpikeInjectionQueue::getSimTime() { return _impl->getSimTime(); }
+void SpikeInjectionQueue::setSimTime(unsigned int simTimeMs) { _impl->setSimTime(simTimeMs); }
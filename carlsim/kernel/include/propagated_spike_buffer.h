@@ -58,6 +58,9 @@ public:
      */
     void scheduleSpikeTargetGroup(spikegroupid_t stg, delaystep_t delay);
 
+    //! Removes all scheduled spikes of the spike target groups stgFirst..stgLast (inclusive)
+    void cancelSpikeTargetGroups(spikegroupid_t stgFirst, spikegroupid_t stgLast);
+
     //! Structure which stores the index of the spike target group and a pointer to the next element in various lists
     struct StgNode
     {
@@ -76,6 +76,10 @@
 
 #include <propagated_spike_buffer.h>
 #include <poisson_rate.h>
+#include <poisson_rate_schedule.h>
+#include <current_schedule.h>
+#include <spike_injection_queue.h>
+#include <spike_stream.h>
 #ifndef __NO_CUDA__
 	#include <gpu_random.h>
 #endif
@@ -313,6 +317,21 @@ public:
 	 */
 	void setISTDP(int grpId, bool isSet, stdpType_t type, stdpCurve_t curve, float ab1, float ab2, float tau1, float tau2);
 
+	/*!
+	 * \brief Enables eligibility traces for the DA-modulated STDP of a group (CPU mode only)
+	 *
+	 * Instead of multiplying the accumulated wtChange with the dopamine concentration at the time of the weight
+	 * update, every plastic synapse keeps an eligibility trace c that collects the STDP increments and decays with
+	 * time constant tauElig. The weight change then integrates c*DA over time (Izhikevich, 2007):
+	 * dc/dt = -c/tauElig + STDP(tDiff)*\delta(t-t_spk), dw/dt = c*DA.
+	 * The integration is evaluated lazily: a synapse is only touched when it receives an STDP increment or when its
+	 * weight is updated, using per-group running sums of the decay-weighted dopamine concentration.
+	 * \param[in] grpId    ID of the post-synaptic group
+	 * \param[in] isSet    set to true to enable eligibility traces for this group
+	 * \param[in] tauElig  decay time constant of the eligibility trace (ms)
+	 */
+	void setEligibilityTrace(int grpId, bool isSet, float tauElig);
+
 	/*!
 	 * \brief Sets STP params U, tau_u, and tau_x of a neuron group (pre-synaptically)
 	 * CARLsim implements the short-term plasticity model of (Tsodyks & Markram, 1998; Mongillo, Barak, & Tsodyks, 2008)
@@ -343,6 +362,12 @@ public:
 	 */
 	void setWeightAndWeightChangeUpdate(updateInterval_t wtANDwtChangeUpdateInterval, bool enableWtChangeDecay, float wtChangeDecay);
 
+	//! Sets the length of the bookkeeping window of firing tables, monitors, and neuromodulator buffers
+	/*!
+	 * \param[in] epochMs epoch length (ms), in [1,MAX_EPOCH_LENGTH_MS]
+	 */
+	void setEpochLength(int epochMs);
+
 	// +++++ PUBLIC METHODS: RUNNING A SIMULATION +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++ //
 
 	/*!
@@ -407,6 +432,9 @@ public:
 	//! injects current (mA) into the soma of every neuron in the group
 	void setExternalCurrent(int grpId, const std::vector<float>& current);
 
+	//! applies the current changes of a CurrentSchedule inside the simulation loop (replaces any previous schedule)
+	void setExternalCurrentSchedule(int grpId, CurrentSchedule* schedule);
+
 	/*!
 	 * \brief A Spike Counter keeps track of the number of spikes per neuron in a group.
 	 * A Spike Counter keeps track of all spikes per neuron for a certain time period (recordDur).
@@ -442,6 +470,21 @@ public:
 	 */
 	void setSpikeRate(int grpId, PoissonRate* spikeRate, int refPeriod);
 
+	//! attaches a schedule of Poisson rates to a group, starting at the current simulation time
+	void setSpikeRateSchedule(int grpId, PoissonRateSchedule* schedule, int refPeriod);
+
+	//! makes runNetwork advance at a fixed ratio of simulated to wall-clock time (0 to run as fast as possible)
+	void setRealTimeFactor(float factor);
+
+	//! attaches a queue from which spikes and currents are fed into the running simulation (NULL to detach)
+	void setSpikeInjectionQueue(SpikeInjectionQueue* queue);
+
+	//! publishes the spikes of a group to a shared-memory spike stream (groups with the same stream name share it)
+	void setSpikeStream(int grpId, const std::string& streamName, int capacity, bool replaceExisting);
+
+	//! sets how a Poisson group generates its spikes from its PoissonRate (see poissonMode_t)
+	void setPoissonMode(int grpId, poissonMode_t mode);
+
 	//! sets the weight value of a specific synapse
 	void setWeight(short int connId, int neurIdPre, int neurIdPost, float weight, bool updateWeightRange=false);
 
@@ -461,9 +504,9 @@ public:
 	 * \brief copy required spikes from firing buffer to spike buffer
 	 *
 	 * This function is public in CpuSNN, but it should probably not be a public user function in CARLsim.
-	 * It is usually called once every 1000ms by the core to update spike binaries and SpikeMonitor objects. In GPU
+	 * It is usually called once every epoch by the core to update spike binaries and SpikeMonitor objects. In GPU
 	 * mode, it will first copy the firing info to the host. The input argument can either be a specific group ID or
-	 * keyword ALL (for all groups).
+	 * keyword ALL (for all groups), in which case all monitors are served by a single pass over the firing tables.
 	 * Core and utility functions can call updateSpikeMonitor at any point in time. The function will automatically
 	 * determine the last time it was called, and update SpikeMonitor information only if necessary.
 	 */
@@ -526,6 +569,8 @@ public:
 	std::string getGroupName(int grpId);
 	GroupSTDPInfo_t getGroupSTDPInfo(int grpId);
 	GroupNeuromodulatorInfo_t getGroupNeuromodulatorInfo(int grpId);
+	RealTimeStats_t getRealTimeStats();
+	void resetRealTimeStats();
 
 	loggerMode_t getLoggerMode() { return loggerMode_; }
 
@@ -559,6 +604,7 @@ public:
 	unsigned int getSimTime()		{ return simTime; }
 	unsigned int getSimTimeSec()	{ return simTimeSec; }
 	unsigned int getSimTimeMs()		{ return simTimeMs; }
+	int getEpochLength()			{ return epochLengthMs_; }
 
 	//! Returns pointer to existing SpikeMonitor object, NULL else
 	SpikeMonitor* getSpikeMonitor(int grpId);
@@ -587,9 +633,11 @@ public:
 	std::vector<float> getConductanceGABAb(int grpId);
 
 	//! temporary getter to return pointer to stpu[] \TODO replace with NeuronMonitor or ConnectionMonitor
+	//! \note stpu is indexed with STP_BUF_POS(STP_NEUR_ID(nid,grpId),t) and only holds neurons of groups with STP
 	float* getSTPu() { return stpu; }
 
 	//! temporary getter to return pointer to stpx[] \TODO replace with NeuronMonitor or ConnectionMonitor
+	//! \note stpx is indexed with STP_BUF_POS(STP_NEUR_ID(nid,grpId),t) and only holds neurons of groups with STP
 	float* getSTPx() { return stpx; }
 
 	//! returns whether synapses in connection are fixed (false) or plastic (true)
@@ -641,6 +689,16 @@ private:
 	void buildNetwork();
 	void buildPoissonGroup(int groupId);
 
+	/*!
+	 * \brief tabulates the E-STDP and I-STDP curves of a group at integer spike-time differences
+	 *
+	 * Gets called from setESTDP and setISTDP. The tables are used by findFiring and generatePostSpike in place of
+	 * evaluating exp() for every pre/post pairing. Table entries are computed with the exact same expressions as
+	 * getSTDPCurveValue, so the lookup does not change simulation results.
+	 */
+	void buildSTDPLookupTables(int grpId);
+	void buildSTDPLookupTable(stdp_lut_t* lut, int grpId, bool isExc, bool isLTP, float tauInv);
+
 	/*!
 	 * \brief reset Spike Counters to zero if simTime % recordDur == 0
 	 *
@@ -672,16 +730,42 @@ private:
 	//! this used to be in updateParameters
 	void findMaxNumSynapses(int* numPostSynapses, int* numPreSynapses);
 
+	//! catches up on the decay of the STP variables of a neuron since its last spike and applies the
+	//! spike-dependent update for a spike at simTime
+	void firingUpdateSTP(int nid, int grpId);
+
+	//! integrates the eligibility traces of all plastic synapses of a group up to the current ms and starts a new epoch
+	void flushEligibilityTraces(int grpId);
+
 	void generatePostSpike(unsigned int pre_i, unsigned int idx_d, unsigned int offset, unsigned int tD);
 	void generateSpikes();
 	void generateSpikes(int grpId);
 	void generateSpikesFromFuncPtr(int grpId);
 	void generateSpikesFromRate(int grpId);
+	void generateSpikesFromRateBernoulli(int grpId);
+
+	//! switches the rates of all groups with a PoissonRateSchedule whose active segment ends at the current time step
+	void updateRateSchedules();
+
+	//! applies the entries of all CurrentSchedules that are due in the current time step to extCurrent
+	void updateCurrentSchedules();
+
+	//! writes the spikes of the current time step to all spike streams
+	void publishSpikeStreams();
+
+	//! schedules the spikes and applies the currents that were pushed into the spike injection queue
+	void drainSpikeInjectionQueue();
+
+	//! adds the compute time (ns) and lateness (ns, negative if early) of a time step to the real-time statistics
+	void recordRealTimeStep(uint64_t computeNs, int64_t latenessNs);
 
 	//! stops the CPU/GPU timer and retrieves actual execution time for printSimSummary
 	float getActualExecutionTimeMs();
 
 	int getPoissNeuronPos(int nid);
+
+	//! evaluates an exponential STDP curve of a group at spike-time difference tDiff (ms), ignoring the cutoff
+	double getSTDPCurveValue(int grpId, bool isExc, bool isLTP, int tDiff);
 	float getWeights(int connProp, float initWt, float maxWt, unsigned int nid, int grpId);
 
 	void globalStateUpdate();
@@ -690,6 +774,9 @@ private:
 	//! total size of the synaptic connection is 'length'
 	void initSynapticWeights();
 
+	//! adds the dopamine concentration of the current ms to the running sums of all groups with eligibility traces
+	void integrateEligibilityTraces();
+
 	//! performs various verification checkups before building the network
 	void verifyNetwork();
 
@@ -728,6 +815,14 @@ private:
      */
 	unsigned int poissonSpike(unsigned int currTime, float frate, int refractPeriod);
 
+	/*!
+	 * \brief fills poissonRandBuf with (at least) n uniformly distributed 32-bit random numbers
+	 *
+	 * Used by generateSpikesFromRateBernoulli. The numbers come from POISSON_RNG_LANES independent xorshift128
+	 * streams that are advanced in lockstep, so that the compiler can vectorize the inner loop.
+	 */
+	void generatePoissonRandNums(int n);
+
 	// NOTE: all these printer functions should be in printSNNInfo.cpp
 	// FIXME: are any of these actually supposed to be public?? they are not yet in carlsim.h
 	void printConnectionInfo(short int connId);
@@ -764,6 +859,9 @@ private:
 	void resetSynapticConnections(bool changeWeights=false);
 	void resetTimingTable();
 
+	//! schedules the delivery of a spike of a D2 neuron on the spike wheel (once per delay run of the neuron)
+	void scheduleSpikeDelivery(int nid);
+
 	post_info_t SET_CONN_ID(int nid, int sid, int grpId);
 
 	inline void setConnection(int srcGrpId, int destGrpId, unsigned int src, unsigned int dest, float synWt,
@@ -783,9 +881,10 @@ private:
 	void updateSpikeGenerators();
 	void updateSpikeGeneratorsInit();
 	int updateSpikeTables();
+	bool growFiringTable(unsigned int** table, unsigned int* maxSpikes, unsigned int fireCnt);
 
 	//void updateStateAndFiringTable();
-	bool updateTime(); //!< updates simTime, returns true when a new second is started
+	bool updateTime(); //!< updates simTime, returns true when a new epoch is started
 
 	float getCompCurrent(int grpId, int neurId, float const0=0.0f, float const1=0.0f);
 
@@ -794,6 +893,49 @@ private:
 
 	void updateWeights();
 
+	/*!
+	 * \brief applies the pending weight changes of all plastic synapses of a post-neuron
+	 *
+	 * \param[in] nid       id of the post-neuron
+	 * \param[in] numPasses number of entries in passScale (see updateWeights)
+	 * \param[in] passScale scale factors for wtChange, one per STDP type of the group
+	 * \returns true if any wtChange of the neuron is still non-zero after the decay
+	 */
+	bool updateWeightsOfNeuron(int nid, int numPasses, const float* passScale);
+
+	/*!
+	 * \brief integrates c*DA of a synapse into wtChange up to (but excluding) ms untilTime and decays its trace
+	 *
+	 * The trace is constant between STDP events except for the decay, so the integral can be expressed through the
+	 * per-group running sum eligDAIntegral: sum_{s=t0}^{t1-1} c*decay^(s-t0)*DA(s)
+	 * = c/decay^(t0-start) * (eligDAIntegral[t1-start]-eligDAIntegral[t0-start]).
+	 * \returns true if the trace is non-zero after the update
+	 */
+	inline bool syncEligibilityTrace(unsigned int pos, int grpId, uint32_t untilTime) {
+		float c = eligTrace[pos];
+		uint32_t t0 = eligTraceTime[pos];
+		eligTraceTime[pos] = untilTime;
+		if (c == 0.0f || t0 >= untilTime)
+			return c != 0.0f;
+
+		const group_info2_t* gInfo = &grp_Info2[grpId];
+		assert(t0 >= gInfo->eligEpochStart);
+		assert(untilTime-gInfo->eligEpochStart <= (uint32_t)gInfo->eligEpochLen);
+		int k0 = t0 - gInfo->eligEpochStart;
+		int k1 = untilTime - gInfo->eligEpochStart;
+		wtChange[pos] += c * (gInfo->eligDAIntegral[k1] - gInfo->eligDAIntegral[k0]) / gInfo->eligDecayPow[k0];
+		eligTrace[pos] = c * gInfo->eligDecayPow[k1-k0];
+		return eligTrace[pos] != 0.0f;
+	}
+
+	//! marks the plastic synapses of a post-neuron as having pending weight changes
+	inline void setWtChangeDirty(int nid) {
+		if (!wtChangeDirty[nid]) {
+			wtChangeDirty[nid] = true;
+			wtChangeDirtyList.push_back(nid);
+		}
+	}
+
 
 	// +++++ GPU MODE +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++ //
 	// TODO: consider moving to snn_gpu.h
@@ -919,6 +1061,11 @@ private:
 	bool simulatorDeleted;
 	bool spikeRateUpdated;
 
+	//! state of the xorshift128 streams and buffer of random numbers used for Bernoulli Poisson input
+	uint32_t poissonRngX[POISSON_RNG_LANES], poissonRngY[POISSON_RNG_LANES];
+	uint32_t poissonRngZ[POISSON_RNG_LANES], poissonRngW[POISSON_RNG_LANES];
+	std::vector<uint32_t> poissonRandBuf;
+
 	float prevCpuExecutionTime;
 	float cpuExecutionTime;
 	float prevGpuExecutionTime;
@@ -953,6 +1100,11 @@ private:
 	//! Buffer to store spikes
 	PropagatedSpikeBuffer* pbuf;
 
+	//! scratch buffers of the batch SpikeGenerator interface (reused across groups and time slices)
+	std::vector<unsigned int> spkGenLastTimes;	//!< last scheduled spike time of every neuron in the group
+	std::vector<int> spkGenNeurIds;				//!< neuron indices (in the group) of the generated spikes
+	std::vector<unsigned int> spkGenTimes;		//!< times of the generated spikes
+
 	bool sim_with_conductances;		//!< flag to inform whether we run in COBA mode (true) or CUBA mode (false)
 	bool sim_with_NMDA_rise;	//!< a flag to inform whether to compute NMDA rise time
 	bool sim_with_GABAb_rise;	//!< a flag to inform whether to compute GABAb rise time
@@ -971,6 +1123,7 @@ private:
 	bool sim_with_modulated_stdp;
 	bool sim_with_homeostasis;
 	bool sim_with_stp;
+	bool sim_with_elig_trace;	//!< flag will be true if any group has DA-STDP with eligibility traces
 	bool sim_with_spikecounters; //!< flag will be true if there are any spike counters around
 
 	integrationMethod_t simIntegrationMethod_;	//!< integration method
@@ -1005,6 +1158,15 @@ private:
 	float			*wtChange, *wt;	//!< stores the synaptic weight and weight change of a synaptic connection
 	float	 		*maxSynWt;		//!< maximum synaptic weight for given connection..
 	uint32_t    	*synSpikeTime;	//!< stores the spike time of each synapse
+
+	//! post-neurons whose plastic synapses have pending weight changes, i.e. the blocks updateWeights has to visit
+	//! in groups without homeostasis (CPU mode only)
+	std::vector<int>	wtChangeDirtyList;
+	bool*			wtChangeDirty;	//!< whether a (regular) neuron is in wtChangeDirtyList
+	bool			wtChangeDirtyAll;	//!< weights were written from outside the STDP path: visit (and clamp) all
+
+	float*			eligTrace;		//!< eligibility trace of each synapse (only allocated if sim_with_elig_trace)
+	uint32_t*		eligTraceTime;	//!< first ms that has not yet been integrated into wtChange for each synapse
 	unsigned int		postSynCnt; //!< stores the total number of post-synaptic connections in the network
 	unsigned int		preSynCnt; //!< stores the total number of pre-synaptic connections in the network
 	#ifdef NEURON_NOISE
@@ -1017,7 +1179,13 @@ private:
 	unsigned int		*cumulativePre;
 	post_info_t		*preSynapticIds;
 	post_info_t		*postSynapticIds;		//!< 10 bit syn id, 22 bit neuron id, ordered based on delay
-	delay_info_t    *postDelayInfo;      	//!< delay information
+	delay_info_t    *postDelayInfo;      	//!< delay runs of all neurons, only for delays that are in use
+	unsigned int	*cumulativeDelayRuns;	//!< runs of neuron nid are postDelayInfo[cumulativeDelayRuns[nid..nid+1]]
+	unsigned int	numDelayRuns;			//!< total number of delay runs in the network
+
+	//! spike delivery wheel (CPU mode): spikeWheel[t & (spikeWheel.size()-1)] holds the delay runs of all spikes of
+	//! D2 neurons (grp_Info[g].MaxDelay>1) that are due at simTime t, in the order in which they were fired
+	std::vector<std::vector<delayed_spike_t> > spikeWheel;
 
 	//! size of memory used for different parts of the network
 	typedef struct snnSize_s {
@@ -1043,6 +1211,7 @@ private:
 	unsigned int		*firingTableD1;
 	unsigned int		maxSpikesD1;
 	unsigned int		maxSpikesD2;
+	unsigned long long	numSpikesDropped;	//!< number of spikes that did not fit into the firing tables
 
 	//time and timestep
 
@@ -1051,11 +1220,13 @@ private:
 	unsigned int    simTimeLastRunSummary; //!< the time at which the last run summary was printed
 
 	unsigned int	simTimeMs;
+	unsigned int	simTimeEpochMs;	//!< time (ms) within the current epoch, used to index the firing tables
+	int				epochLengthMs_;	//!< length (ms) of an epoch, after which monitors and firing tables are updated
 	uint64_t        simTimeSec;		//!< this is used to store the seconds.
 	unsigned int	simTime;		//!< The absolute simulation time. The unit is millisecond. this value is not reset but keeps increasing to its max value.
 	unsigned int	spikeCountAll1secHost;
 	unsigned int	secD1fireCntHost;
-	unsigned int	secD2fireCntHost;	//!< firing counts for each second
+	unsigned int	secD2fireCntHost;	//!< firing counts for each epoch
 	unsigned int	spikeCountAllHost;
 	unsigned int	spikeCountD1Host;
 	unsigned int	spikeCountD2Host;	//!< overall firing counts values
@@ -1082,6 +1253,22 @@ private:
 	SpikeMonitorCore* spikeMonCoreList[MAX_GRP_PER_SNN];
 	SpikeMonitor*     spikeMonList[MAX_GRP_PER_SNN];
 
+	//! shared-memory spike streams (see setSpikeStream), indexed by group_info_t::SpikeStreamId
+	std::vector<SpikeStreamWriter*> spikeStreams;
+
+	SpikeInjectionQueue* spikeInjectionQueue;	//!< closed-loop input (see setSpikeInjectionQueue), NULL if none
+	std::vector<injection_event_t> spikeInjectionDeferred; //!< injected spikes that are due beyond the spike buffer
+
+	// real-time pacing (see setRealTimeFactor)
+	float realTimeFactor_;					//!< simulated ms per real ms, 0 if pacing is off
+	std::vector<unsigned int> rtHistogram_;	//!< log-linear histogram of compute times per time step (ns)
+	int rtNumSteps_;						//!< number of time steps measured
+	int rtNumMisses_;						//!< number of missed deadlines
+	int rtNumStalls_;						//!< number of runs of consecutive missed deadlines
+	bool rtLastStepLate_;					//!< whether the previous time step of this runNetwork call was late
+	uint64_t rtMaxComputeNs_;				//!< maximum compute time per time step
+	int64_t rtMaxLatenessNs_;				//!< maximum lateness of a time step
+
 	// \FIXME \DEPRECATED this one moved to group-based
 	int64_t    simTimeLastUpdSpkMon_; //!< last time we ran updateSpikeMonitor
 
@@ -1118,6 +1305,9 @@ private:
 	   maxDelay_ (time constant for recovery from depression), and F (time constant for recovery from facilitation). */
 	   float *stpu;
 	   float *stpx;
+	   unsigned int *stpLastSpikeTime;	//!< time of the last STP update of each STP neuron (compact index)
+	   int numNSTP;						//!< number of neurons in groups with STP (size of the compact STP buffers)
+	   int stpBufLen_;					//!< length of the STP ring of each neuron, a power of two >= maxDelay_+1
 
 	   float *gAMPA;
 	   float *gNMDA;
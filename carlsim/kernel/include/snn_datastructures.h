@@ -50,11 +50,19 @@
 //! connection types, used internally (externally it's a string)
 enum conType_t { CONN_RANDOM, CONN_ONE_TO_ONE, CONN_FULL, CONN_FULL_NO_DIRECT, CONN_GAUSSIAN, CONN_USER_DEFINED, CONN_UNKNOWN};
 
+//! a run of post-synaptic connections of a neuron that all have the same delay
 typedef struct {
 	short  delay_index_start;
 	short  delay_length;
+	uint8_t delay;				//!< axonal delay (ms) of all connections in the run
 } delay_info_t;
 
+//! a delay run (index into CpuSNN::postDelayInfo) of a spiking neuron that is scheduled for delivery
+typedef struct {
+	int				nid;
+	unsigned int	runIdx;
+} delayed_spike_t;
+
 typedef struct {
 	int	postId;
 	uint8_t	grpId;
@@ -261,7 +269,17 @@ typedef struct group_info_s {
 	short int  	MaxFiringRate; //!< this is for the monitoring mechanism, it needs to know what is the maximum firing rate in order to allocate a buffer big enough to store spikes...
 	int			SpikeMonitorId;		//!< spike monitor id
 	int			GroupMonitorId; //!< group monitor id
+	int			SpikeStreamId;	//!< spike stream id (-1 if the group is not streamed)
 	float   	RefractPeriod;
+	poissonMode_t	PoissonMode;	//!< how spikes are generated from RatePtr (see CpuSNN::setPoissonMode)
+	PoissonRateSchedule* RateSchedule;	//!< schedule of rates to be copied into RateScheduleRates (NULL if none)
+	PoissonRate*	RateScheduleRates;	//!< kernel-owned rates of the active schedule segment (RatePtr points here)
+	uint32_t	RateScheduleStart;		//!< simulation time (ms) at which the schedule started
+	uint32_t	RateScheduleNextMs;		//!< simulation time (ms) at which to switch to the next segment
+	uint32_t	RateScheduleLastSwitch;	//!< simulation time (ms) of the last segment switch
+	CurrentSchedule* CurrSchedule;		//!< schedule of external currents (NULL if none or if it has run out)
+	uint32_t	CurrScheduleStart;		//!< simulation time (ms) at which the current schedule started
+	int			CurrScheduleNextEntry;	//!< the next entry of the current schedule to be applied
 	int			CurrTimeSlice; //!< timeSlice is used by the Poisson generators in order to note generate too many or too few spikes within a window of time
 	int			NewTimeSlice;
 	uint32_t 	SliceUpdateTime;
@@ -340,6 +358,19 @@ typedef struct group_info_s {
 
 } group_info_t;
 
+/*!
+ * \brief STDP curve sampled at integer spike-time differences
+ *
+ * Spike times are integer ms, so every STDP curve can be tabulated once per group instead of evaluating exp() for
+ * every pre/post pairing. val[t] holds the signed increment that is added to wtChange for a spike-time difference of
+ * t ms. The curve is zero for t >= cutoff. Curves with very long time constants are only tabulated up to
+ * MAX_STDP_LUT_SIZE entries, beyond which the curve is evaluated directly (see CpuSNN::getSTDPCurveValue).
+ */
+typedef struct stdp_lut_s {
+	int					cutoff;	//!< smallest spike-time difference (ms) for which the curve is zero
+	std::vector<double>	val;	//!< wtChange increment for tDiff=0..min(cutoff,MAX_STDP_LUT_SIZE)-1
+} stdp_lut_t;
+
 /*!
  * this group need not be shared with the GPU
  * separate group which has unique properties of
@@ -381,6 +412,24 @@ typedef struct group_info2_s {
 	int			maxPreConn;
 	int			sumPostConn;
 	int			sumPreConn;
+
+	//! STDP lookup tables (CPU mode only), built in CpuSNN::setESTDP and CpuSNN::setISTDP
+	stdp_lut_t	lutLTPExc;	//!< E-STDP, pre-before-post (EXP_CURVE or TIMING_BASED_CURVE)
+	stdp_lut_t	lutLTDExc;	//!< E-STDP, post-before-pre
+	stdp_lut_t	lutLTPInb;	//!< I-STDP, pre-before-post (EXP_CURVE only)
+	stdp_lut_t	lutLTDInb;	//!< I-STDP, post-before-pre (EXP_CURVE only)
+
+	//! eligibility traces for DA-modulated STDP (CPU mode only), see CpuSNN::setEligibilityTrace
+	bool		withEligTrace;
+	float		tauElig;			//!< decay time constant of the eligibility trace (ms)
+	int			eligEpochLen;		//!< max number of ms integrated before all traces are synced
+	uint32_t	eligEpochStart;		//!< first ms of the current epoch
+	std::vector<double>	eligDAIntegral;	//!< eligDAIntegral[k] = sum_{s<k} decayElig^s * DA(eligEpochStart+s)
+	std::vector<double>	eligDecayPow;	//!< eligDecayPow[k] = decayElig^k
+
+	//! index of the group's first neuron in the compact STP buffers (stpu, stpx, stpLastSpikeTime), or -1 if the
+	//! group has no STP. Only groups with STP get a slot in these buffers.
+	int			stpNeurOffset;
 } group_info2_t;
 
 #endif
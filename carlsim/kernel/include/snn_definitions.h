@@ -97,13 +97,14 @@ inline bool isInhibitoryNeuron (unsigned int& nid, unsigned int& numNInhPois, un
 //    only once for each pre-neuron (in neuron parallelism)
 // 2) non-zero delays. as a post-neuron you want the spike to be weighted by what the utility and resource
 //    variables were when pre spiked, not from the time at which the spike arrived at post.
-// the macro is slightly faster than an inline function, but we should consider changing it anyway because
-// it's unsafe
-//#define STP_BUF_SIZE 32
-// \FIXME D is the CpuSNN member variable for the max delay in the network, give it a better name dammit!!
-// we actually need D+1 entries. Say D=1ms. Then to update the current we need u^+ (right after the pre-spike, so
-// at t) and x^- (right before the spike, so at t-1).
-#define STP_BUF_POS(nid,t) ( nid*(maxDelay_+1) + ((t)%(maxDelay_+1)) )
+// Only neurons of groups with STP have a slot in the (CPU) buffers: STP_NEUR_ID maps a neuron id to its compact
+// STP index. Each slot is a ring of stpBufLen_ entries, which is the smallest power of two >= maxDelay_+1, so that
+// the ring position is a bitmask instead of a modulo. We need at least D+1 entries. Say D=1ms. Then to update the
+// current we need u^+ (right after the pre-spike, so at t) and x^- (right before the spike, so at t-1).
+// On the CPU, the ring is only written when the neuron spikes (see CpuSNN::firingUpdateSTP), so only entries at
+// spike times t and t-1 are valid; these are exactly the ones read in CpuSNN::generatePostSpike.
+#define STP_NEUR_ID(nid,grpId) ( grp_Info2[grpId].stpNeurOffset + (nid) - grp_Info[grpId].StartN )
+#define STP_BUF_POS(stpId,t) ( (stpId)*stpBufLen_ + ((t)&(stpBufLen_-1)) )
 
 
 // use these macros for logging / error printing
@@ -126,19 +127,37 @@ inline bool isInhibitoryNeuron (unsigned int& nid, unsigned int& numNInhPois, un
 #define KERNEL_INFO_PRINT(fp, formatc, ...) fprintf((FILE*)fp,formatc "\n",##__VA_ARGS__)
 #define KERNEL_DEBUG_PRINT(fp, type, formatc, ...) fprintf((FILE*)fp,"[" type " %s:%d] " formatc "\n",__FILE__,__LINE__,##__VA_ARGS__)
 
-#define MAX_SynapticDelay 20
+// maximum axonal delay (ms). Delays are stored as uint8_t, and the CPU only keeps state for the delays that are
+// actually in use. On the GPU, the timing tables are sized at compile time, which limits delays to
+// MAX_SynapticDelayGPU. Delays of user-defined connections are only known once the ConnectionGenerator is called
+// (after the spike tables have been sized), so these connections are limited to MAX_SynapticDelayUserDefined.
+#define MAX_SynapticDelay 255
+#define MAX_SynapticDelayGPU 20
+#define MAX_SynapticDelayUserDefined 20
 
 // increasing the following numbers will increase the load on constant memory
 // until a hard limit is reached, which is given by the datatype of the variable
 #define MAX_nConnections 256	// hard limit: 2^16
 #define MAX_GRP_PER_SNN 128		// hard limit: 2^16
 
+// the firing tables, spike/group monitors, and neuromodulator buffers are organized in epochs of this length (ms),
+// at the end of which the monitors are updated and the firing tables are cleared (see CpuSNN::setEpochLength)
+#define DEFAULT_EPOCH_LENGTH_MS 1000
+#define MAX_EPOCH_LENGTH_MS 60000
+
 #define UNKNOWN_NEURON_MAX_FIRING_RATE    	25
 #define INHIBITORY_NEURON_MAX_FIRING_RATE 	1000
 #define EXCITATORY_NEURON_MAX_FIRING_RATE 	1000
 #define POISSON_MAX_FIRING_RATE 	  		1000
+#define POISSON_RNG_LANES					8 // number of independent xorshift streams used for Bernoulli Poisson input
+
+// in CPU mode the firing tables start out sized for this rate (Hz) and grow on demand, so that no spikes are lost
+// and memory is not spent on worst-case bursts (see CpuSNN::growFiringTable)
+#define FIRING_TABLE_INIT_RATE				25
 
 #define STDP(t,a,b)       ((a)*exp(-(t)*(b))) // consider to use __expf(), which is accelerated by GPU hardware
+#define STDP_CUTOFF       25    // exponential STDP curves are treated as zero for tDiff*tauInv >= STDP_CUTOFF
+#define MAX_STDP_LUT_SIZE 4096  // max number of entries (ms) of a tabulated STDP curve (see stdp_lut_t)
 
 #define PROPAGATED_BUFFER_SIZE  (1023)
 #define MAX_SIMULATION_TIME     ((uint32_t)(0x7fffffff))
@@ -148,6 +167,9 @@ inline bool isInhibitoryNeuron (unsigned int& nid, unsigned int& numNInhPois, un
 #define MAX_SPIKE_MON_BUFFER_SIZE 52428800 // about 50 MB. size is in bytes. Max size of reduced AER vector in spikeMonitorCore objects.
 #define LONG_SPIKE_MON_DURATION 600000 // about 10 minutes
 #define LARGE_SPIKE_MON_GRP_SIZE 5000 // about 10 minutes
+#define SPIKE_MON_AER_BLOCK_SIZE 65536 // size (bytes) of the blocks in which a SpikeMonitor stores its encoded AER data
+#define SPIKE_MON_STATS_BIN_MS 100 // size (ms) of the time bins over which a SpikeMonitor computes spike count statistics
+#define SPIKE_FILE_BUFFER_SIZE 65536 // number of (time,nid) records a SpikeMonitor collects before writing them to file
 
 // This flag is used when having a common poisson generator for both CPU and GPU simulation
 // We basically use the CPU poisson generator. Evaluate if there is any firing due to the
@@ -132,6 +132,30 @@ void PropagatedSpikeBuffer::scheduleSpikeTargetGroup(spikegroupid_t stg, delayst
     }    
 }
 
+void PropagatedSpikeBuffer::cancelSpikeTargetGroups(spikegroupid_t stgFirst, spikegroupid_t stgLast)
+{
+    for(size_t i=0; i<ringBufferFront.size(); i++) {
+        StgNode *prev = NULL;
+        StgNode *n = ringBufferFront[i];
+        while( n != NULL ) {
+            StgNode *next = n->next;
+            if( n->stg >= stgFirst && n->stg <= stgLast ) {
+                // unlink the node and recycle it
+                if( prev == NULL )
+                    ringBufferFront[i] = next;
+                else
+                    prev->next = next;
+                n->next = recycledNodes;
+                recycledNodes = n;
+            } else {
+                prev = n;
+            }
+            n = next;
+        }
+        ringBufferBack[i] = prev;
+    }
+}
+
 void PropagatedSpikeBuffer::nextTimeStep()
 {
     // move the solts of currIdx to recycled slots
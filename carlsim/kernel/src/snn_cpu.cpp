@@ -43,6 +43,7 @@
 	#include <Windows.h>
 #else
 	#include <sys/stat.h>		// mkdir
+	#include <time.h>			// clock_gettime, nanosleep
 #endif
 
 #include <math.h> 		// fabs
@@ -50,6 +51,7 @@
 #include <stdlib.h> 	// abs, drand48
 #include <algorithm> 	// std::min, std::max
 #include <limits.h> 	// UINT_MAX
+#include <new>			// std::nothrow
 
 #include <connection_monitor.h>
 #include <connection_monitor_core.h>
@@ -68,6 +70,71 @@
 #define SETPRE_INFO(name, nid, sid, val)  name[cumulativePre[nid]+sid]=val;
 
 
+// helpers for real-time pacing (see CpuSNN::setRealTimeFactor)
+namespace {
+	// the last part of a wait is spent spinning, because sleeping alone is not precise enough
+#if defined(WIN32) || defined(WIN64)
+	const uint64_t RT_SPIN_NS = 2000000;
+#else
+	const uint64_t RT_SPIN_NS = 200000;
+#endif
+
+	// compute times are kept in a log-linear histogram: exact below 2*RT_HIST_SUB ns, then RT_HIST_SUB buckets per
+	// power of two
+	const int RT_HIST_SUB = 16;
+	const int RT_HIST_SIZE = 2*RT_HIST_SUB + 64*RT_HIST_SUB;
+
+	// monotonic wall-clock time (ns)
+	uint64_t getWallTimeNs() {
+#if defined(WIN32) || defined(WIN64)
+		LARGE_INTEGER cnt, freq;
+		QueryPerformanceCounter(&cnt);
+		QueryPerformanceFrequency(&freq);
+		return (uint64_t)(cnt.QuadPart * (1e9/freq.QuadPart));
+#else
+		struct timespec ts;
+		clock_gettime(CLOCK_MONOTONIC, &ts);
+		return (uint64_t)ts.tv_sec*1000000000ULL + ts.tv_nsec;
+#endif
+	}
+
+	// sleeps for most of the remaining time, then spins until the deadline
+	void waitUntilNs(uint64_t deadlineNs) {
+		uint64_t nowNs = getWallTimeNs();
+		if (nowNs + RT_SPIN_NS < deadlineNs) {
+			uint64_t sleepNs = deadlineNs - nowNs - RT_SPIN_NS;
+#if defined(WIN32) || defined(WIN64)
+			Sleep((DWORD)(sleepNs/1000000));
+#else
+			struct timespec ts;
+			ts.tv_sec = sleepNs/1000000000;
+			ts.tv_nsec = sleepNs%1000000000;
+			nanosleep(&ts, NULL);
+#endif
+		}
+		while (getWallTimeNs() < deadlineNs) {}
+	}
+
+	int rtBucket(uint64_t ns) {
+		if (ns < 2*RT_HIST_SUB)
+			return (int)ns;
+		int e = 1;
+		while ((ns >> e) >= 2*RT_HIST_SUB)
+			e++;
+		return 2*RT_HIST_SUB + (e-1)*RT_HIST_SUB + (int)((ns >> e) - RT_HIST_SUB);
+	}
+
+	// midpoint of a histogram bucket (ns)
+	double rtBucketValue(int idx) {
+		if (idx < 2*RT_HIST_SUB)
+			return idx;
+		int e = (idx - 2*RT_HIST_SUB)/RT_HIST_SUB + 1;
+		uint64_t sub = (idx - 2*RT_HIST_SUB)%RT_HIST_SUB + RT_HIST_SUB;
+		return ((sub << e) + ((sub+1) << e)) / 2.0;
+	}
+}
+
+
 
 /// **************************************************************************************************************** ///
 /// CONSTRUCTOR / DESTRUCTOR
@@ -211,7 +278,7 @@ short int CpuSNN::connect(int grpId1, int grpId2, ConnectionGeneratorCore* conn,
 	newInfo->grpDest  = grpId2;
 	newInfo->initWt	  = 1;
 	newInfo->maxWt	  = 1;
-	newInfo->maxDelay = MAX_SynapticDelay;
+	newInfo->maxDelay = MAX_SynapticDelayUserDefined;
 	newInfo->minDelay = 1;
 	newInfo->mulSynFast = _mulSynFast;
 	newInfo->mulSynSlow = _mulSynSlow;
@@ -311,6 +378,8 @@ int CpuSNN::createGroup(const std::string& grpName, const Grid3D& grid, int neur
 	grp_Info2[numGrp].baseFiringSD      = 0.0f;
 
 	grp_Info2[numGrp].Name              = grpName;
+	grp_Info2[numGrp].withEligTrace     = false;
+	grp_Info2[numGrp].stpNeurOffset     = -1;
 	finishedPoissonGroup				= true;
 
 	// update number of neuron counters
@@ -346,6 +415,8 @@ int CpuSNN::createSpikeGeneratorGroup(const std::string& grpName, const Grid3D&
 	grp_Info[numGrp].MaxFiringRate 	= POISSON_MAX_FIRING_RATE;
 
 	grp_Info2[numGrp].Name          = grpName;
+	grp_Info2[numGrp].withEligTrace = false;
+	grp_Info2[numGrp].stpNeurOffset = -1;
 
 	if ( (neurType&TARGET_GABAa) || (neurType&TARGET_GABAb))
 		numNInhPois += grid.N; // inh poisson group
@@ -585,6 +656,9 @@ void CpuSNN::setESTDP(int grpId, bool isSet, stdpType_t type, stdpCurve_t curve,
 		grp_Info[grpId].WithSTDP		|= grp_Info[grpId].WithESTDP;
 		sim_with_stdp					|= grp_Info[grpId].WithSTDP;
 
+		// tabulate the curves for findFiring and generatePostSpike
+		buildSTDPLookupTables(grpId);
+
 		KERNEL_INFO("E-STDP %s for %s(%d)", isSet?"enabled":"disabled", grp_Info2[grpId].Name.c_str(), grpId);
 	}
 }
@@ -631,10 +705,34 @@ void CpuSNN::setISTDP(int grpId, bool isSet, stdpType_t type, stdpCurve_t curve,
 		grp_Info[grpId].WithSTDP		|= grp_Info[grpId].WithISTDP;
 		sim_with_stdp					|= grp_Info[grpId].WithSTDP;
 
+		// tabulate the curves for findFiring and generatePostSpike
+		buildSTDPLookupTables(grpId);
+
 		KERNEL_INFO("I-STDP %s for %s(%d)", isSet?"enabled":"disabled", grp_Info2[grpId].Name.c_str(), grpId);
 	}
 }
 
+// set eligibility trace params for DA-modulated STDP
+void CpuSNN::setEligibilityTrace(int grpId, bool isSet, float tauElig) {
+	assert(grpId>=-1);
+	if (isSet) {
+		assert(tauElig>0.0f);
+	}
+
+	if (grpId==ALL) { // shortcut for all groups
+		for(int grpId1=0; grpId1 < numGrp; grpId1++) {
+			setEligibilityTrace(grpId1, isSet, tauElig);
+		}
+	} else {
+		grp_Info2[grpId].withEligTrace	= isSet;
+		grp_Info2[grpId].tauElig		= tauElig;
+		sim_with_elig_trace				|= isSet;
+
+		KERNEL_INFO("Eligibility trace %s for %s(%d): tauElig=%.2f", isSet?"enabled":"disabled",
+			grp_Info2[grpId].Name.c_str(), grpId, tauElig);
+	}
+}
+
 // set STP params
 void CpuSNN::setSTP(int grpId, bool isSet, float STP_U, float STP_tau_u, float STP_tau_x) {
 	assert(grpId>=-1);
@@ -703,6 +801,21 @@ void CpuSNN::setWeightAndWeightChangeUpdate(updateInterval_t wtANDwtChangeUpdate
 	KERNEL_INFO("STDP scale factor = %1.3f, wtChangeDecay = %1.3f", stdpScaleFactor_, wtChangeDecay_);
 }
 
+// set the length of the epoch after which monitors are updated and the firing tables are cleared
+void CpuSNN::setEpochLength(int epochMs) {
+	assert(epochMs > 0 && epochMs <= MAX_EPOCH_LENGTH_MS);
+	assert(!doneReorganization); // buffers are sized in setupNetwork
+
+	// the GPU kernels are hard-wired to a time table of 1000 ms
+	if (simMode_ == GPU_MODE && epochMs != DEFAULT_EPOCH_LENGTH_MS) {
+		KERNEL_ERROR("Epoch length must be %d ms in GPU mode", DEFAULT_EPOCH_LENGTH_MS);
+		exitSimulation(1);
+	}
+
+	epochLengthMs_ = epochMs;
+	KERNEL_INFO("Update monitors and firing tables every %d ms", epochLengthMs_);
+}
+
 
 /// ************************************************************************************************************ ///
 /// PUBLIC METHODS: RUNNING A SIMULATION
@@ -764,9 +877,23 @@ int CpuSNN::runNetwork(int _nsec, int _nmsec, bool printRunSummary, bool copySta
 	CUDA_START_TIMER(timer);
 #endif
 
+	// real-time pacing: time step i must not finish before rtRunStartNs + (i+1)*rtStepNs; after a missed deadline,
+	// the following time steps do not wait until the simulation has caught up
+	double rtStepNs = 0.0;
+	uint64_t rtRunStartNs = 0, rtStepStartNs = 0;
+	if (realTimeFactor_ > 0.0f) {
+		rtStepNs = 1e6/realTimeFactor_;
+		rtRunStartNs = getWallTimeNs();
+		rtLastStepLate_ = false;
+	}
+
 	// if nsec=0, simTimeMs=10, we need to run the simulator for 10 timeStep;
 	// if nsec=1, simTimeMs=10, we need to run the simulator for 1*1000+10, time Step;
 	for(int i=0; i<runDurationMs; i++) {
+		if (realTimeFactor_ > 0.0f) {
+			rtStepStartNs = getWallTimeNs();
+		}
+
 		if(simMode_ == CPU_MODE) {
 			doSnnSim();
 #ifndef __NO_CUDA__
@@ -792,16 +919,13 @@ int CpuSNN::runNetwork(int _nsec, int _nmsec, bool printRunSummary, bool copySta
 
 		// Note: updateTime() advance simTime, simTimeMs, and simTimeSec accordingly
 		if (updateTime()) {
-			// finished one sec of simulation...
+			// finished one epoch of simulation...
 			if (numSpikeMonitor) {
 				updateSpikeMonitor();
 			}
 			if (numGroupMonitor) {
 				updateGroupMonitor();
 			}
-			if (numConnectionMonitor) {
-				updateConnectionMonitor();
-			}
 
 			if(simMode_ == CPU_MODE) {
 				updateFiringTable();
@@ -812,11 +936,31 @@ int CpuSNN::runNetwork(int _nsec, int _nmsec, bool printRunSummary, bool copySta
 			}
 		}
 
+		// weight snapshots are taken once every second, no matter the epoch length
+		if (numConnectionMonitor && simTimeMs==0) {
+			updateConnectionMonitor();
+		}
+
 #ifndef __NO_CUDA__
 		if(simMode_ == GPU_MODE) {
 			copyFiringStateFromGPU();
 		}
 #endif
+
+		if (realTimeFactor_ > 0.0f) {
+			uint64_t nowNs = getWallTimeNs();
+			uint64_t deadlineNs = rtRunStartNs + (uint64_t)((i+1)*rtStepNs);
+			recordRealTimeStep(nowNs - rtStepStartNs, (int64_t)(nowNs - deadlineNs));
+			if (nowNs < deadlineNs) {
+				waitUntilNs(deadlineNs);
+			}
+		}
+	}
+
+	// spike files are written in large blocks: make sure everything recorded so far is on disk when we return to
+	// the user
+	for (unsigned int monId=0; monId<numSpikeMonitor; monId++) {
+		spikeMonCoreList[monId]->flushSpikeFile();
 	}
 
 #ifndef __NO_CUDA__
@@ -873,6 +1017,7 @@ int CpuSNN::runNetwork(int _nsec, int _nmsec, bool printRunSummary, bool copySta
 // adds a bias to every weight in the connection
 void CpuSNN::biasWeights(short int connId, float bias, bool updateWeightRange) {
 	assert(connId>=0 && connId<numConnections);
+	wtChangeDirtyAll = true; // weights need to be clamped again in the next updateWeights
 
 	grpConnectInfo_t* connInfo = getConnectInfo(connId);
 
@@ -979,6 +1124,7 @@ void CpuSNN::resetSpikeCounter(int grpId) {
 void CpuSNN::scaleWeights(short int connId, float scale, bool updateWeightRange) {
 	assert(connId>=0 && connId<numConnections);
 	assert(scale>=0.0f);
+	wtChangeDirtyAll = true; // weights need to be clamped again in the next updateWeights
 
 	grpConnectInfo_t* connInfo = getConnectInfo(connId);
 
@@ -1141,6 +1287,9 @@ void CpuSNN::setExternalCurrent(int grpId, const std::vector<float>& current) {
 	// 	grp_Info[grpId].WithCurrentInjection = false;
 	// }
 
+	// a current set by hand replaces any schedule
+	grp_Info[grpId].CurrSchedule = NULL;
+
 	// store external current in array
 	for (int i=grp_Info[grpId].StartN, j=0; i<=grp_Info[grpId].EndN; i++, j++) {
 		extCurrent[i] = current[j];
@@ -1155,6 +1304,22 @@ void CpuSNN::setExternalCurrent(int grpId, const std::vector<float>& current) {
 #endif
 }
 
+// applies the entries of a CurrentSchedule at the right time steps (see updateCurrentSchedules)
+void CpuSNN::setExternalCurrentSchedule(int grpId, CurrentSchedule* schedule) {
+	assert(grpId>=0 && grpId<numGrp);
+	assert(!isPoissonGroup(grpId));
+	assert(schedule);
+	assert(schedule->getNumNeurons()==grp_Info[grpId].SizeN);
+
+	// the first entries will be applied by updateCurrentSchedules in the next time step
+	grp_Info[grpId].CurrSchedule = schedule;
+	grp_Info[grpId].CurrScheduleStart = simTime;
+	grp_Info[grpId].CurrScheduleNextEntry = 0;
+
+	KERNEL_INFO("CurrentSchedule set for group %d(%s): %d entries, %d ms", grpId,
+		grp_Info2[grpId].Name.c_str(), schedule->getNumEntries(), schedule->getLengthMs());
+}
+
 // sets up a spike generator
 void CpuSNN::setSpikeGenerator(int grpId, SpikeGeneratorCore* spikeGen) {
 	assert(!doneReorganization); // must be called before setupNetwork to work on GPU
@@ -1235,13 +1400,124 @@ void CpuSNN::setSpikeRate(int grpId, PoissonRate* ratePtr, int refPeriod) {
 
 	grp_Info[grpId].RatePtr = ratePtr;
 	grp_Info[grpId].RefractPeriod   = refPeriod;
+	grp_Info[grpId].RateSchedule = NULL; // a rate set by hand replaces any schedule
 	spikeRateUpdated = true;
 }
 
+void CpuSNN::setSpikeRateSchedule(int grpId, PoissonRateSchedule* schedule, int refPeriod) {
+	assert(grpId>=0 && grpId<numGrp);
+	assert(schedule);
+	assert(schedule->getNumNeurons()==grp_Info[grpId].SizeN);
+
+	// the rates of the active segment are copied into a kernel-owned PoissonRate object, which the group uses just
+	// like a PoissonRate set via setSpikeRate
+	if (grp_Info[grpId].RateScheduleRates == NULL)
+		grp_Info[grpId].RateScheduleRates = new PoissonRate(grp_Info[grpId].SizeN);
+	setSpikeRate(grpId, grp_Info[grpId].RateScheduleRates, refPeriod);
+
+	// the first segment will be activated by updateRateSchedules in the next time step
+	grp_Info[grpId].RateSchedule = schedule;
+	grp_Info[grpId].RateScheduleStart = simTime;
+	grp_Info[grpId].RateScheduleNextMs = simTime;
+	grp_Info[grpId].RateScheduleLastSwitch = MAX_SIMULATION_TIME;
+
+	KERNEL_INFO("PoissonRateSchedule set for group %d(%s): %d segments, %d ms", grpId,
+		grp_Info2[grpId].Name.c_str(), schedule->getNumSegments(), schedule->getLengthMs());
+}
+
+void CpuSNN::setRealTimeFactor(float factor) {
+	assert(factor>=0.0f);
+	realTimeFactor_ = factor;
+	if (factor > 0.0f) {
+		KERNEL_INFO("Real-time pacing enabled: %.2f ms of simulation per ms of wall-clock time", factor);
+	} else {
+		KERNEL_INFO("Real-time pacing disabled");
+	}
+}
+
+void CpuSNN::setSpikeInjectionQueue(SpikeInjectionQueue* queue) {
+	spikeInjectionQueue = queue;
+	spikeInjectionDeferred.clear();
+	if (queue != NULL) {
+		queue->setSimTime(simTime);
+		KERNEL_INFO("SpikeInjectionQueue set: %d events", queue->getCapacity());
+	}
+}
+
+void CpuSNN::setSpikeStream(int grpId, const std::string& streamName, int capacity, bool replaceExisting) {
+	assert(grpId>=0 && grpId<numGrp);
+	assert(!streamName.empty());
+	assert(capacity>0 && capacity<=SPIKE_STREAM_MAX_CAPACITY);
+
+	// groups that are streamed under the same name share a writer
+	std::string shmName = SpikeStreamWriter::getShmName(streamName);
+	int streamId = -1;
+	for (unsigned int i=0; i<spikeStreams.size(); i++) {
+		if (spikeStreams[i]->getName() == shmName) {
+			streamId = i;
+			break;
+		}
+	}
+
+	if (streamId < 0) {
+		SpikeStreamWriter* writer = new SpikeStreamWriter(shmName, capacity, replaceExisting);
+		if (!writer->isOpen()) {
+			KERNEL_ERROR("Could not create shared-memory spike stream \"%s\" for group %d (%s). If a stream of that "
+				"name is left over from a crashed run, set replaceExisting to replace it.", shmName.c_str(), grpId,
+				grp_Info2[grpId].Name.c_str());
+			delete writer;
+			exitSimulation(1);
+		}
+		streamId = spikeStreams.size();
+		spikeStreams.push_back(writer);
+	}
+
+	if (grp_Info[grpId].SpikeStreamId >= 0 && grp_Info[grpId].SpikeStreamId != streamId) {
+		KERNEL_WARN("Spike stream of group %d (%s) is redirected from \"%s\" to \"%s\"", grpId,
+			grp_Info2[grpId].Name.c_str(), spikeStreams[grp_Info[grpId].SpikeStreamId]->getName().c_str(),
+			shmName.c_str());
+	}
+	grp_Info[grpId].SpikeStreamId = streamId;
+
+	KERNEL_INFO("SpikeStream set for group %d (%s): \"%s\", %d slots", grpId, grp_Info2[grpId].Name.c_str(),
+		shmName.c_str(), spikeStreams[streamId]->getCapacity());
+}
+
+void CpuSNN::setPoissonMode(int grpId, poissonMode_t mode) {
+	assert(grpId>=0 && grpId<numGrp);
+	assert(grp_Info[grpId].isSpikeGenerator);
+
+	// ISI mode schedules the spikes of a whole time slice ahead: drop the ones that are still pending, or the group
+	// would fire both from the buffer and from its Bernoulli draws (going back to ISI mode needs no special care,
+	// because spikes are scheduled again at the start of the next runNetwork call)
+	if (grp_Info[grpId].PoissonMode == POISSON_ISI && mode == POISSON_BERNOULLI && grp_Info[grpId].spikeGen == NULL) {
+		// pending spikes have already been counted by the SpikeCounter
+		if (grp_Info[grpId].withSpikeCounter) {
+			int bufPos = grp_Info[grpId].spkCntBufPos;
+			PropagatedSpikeBuffer::const_iterator srg_iter;
+			PropagatedSpikeBuffer::const_iterator srg_iter_end = pbuf->endSpikeTargetGroups();
+			for (size_t offset=0; offset<pbuf->length(); offset++) {
+				for (srg_iter=pbuf->beginSpikeTargetGroups(offset); srg_iter!=srg_iter_end; ++srg_iter) {
+					int nid = srg_iter->stg;
+					if (nid >= grp_Info[grpId].StartN && nid <= grp_Info[grpId].EndN
+							&& spkCntBuf[bufPos][nid-grp_Info[grpId].StartN] > 0)
+						spkCntBuf[bufPos][nid-grp_Info[grpId].StartN]--;
+				}
+			}
+		}
+		pbuf->cancelSpikeTargetGroups(grp_Info[grpId].StartN, grp_Info[grpId].EndN);
+	}
+
+	grp_Info[grpId].PoissonMode = mode;
+	KERNEL_INFO("Poisson spike generation of group %d(%s) set to %s", grpId, grp_Info2[grpId].Name.c_str(),
+		poissonMode_string[mode]);
+}
+
 // sets the weight value of a specific synapse
 void CpuSNN::setWeight(short int connId, int neurIdPre, int neurIdPost, float weight, bool updateWeightRange) {
 	assert(connId>=0 && connId<getNumConnections());
 	assert(weight>=0.0f);
+	wtChangeDirtyAll = true; // weights need to be clamped again in the next updateWeights
 
 	grpConnectInfo_t* connInfo = getConnectInfo(connId);
 	assert(neurIdPre>=0  && neurIdPre<getGroupNumNeurons(connInfo->grpSrc));
@@ -1383,17 +1659,13 @@ void CpuSNN::saveSimulation(FILE* fid, bool saveSynapseInfo) {
 			unsigned int offset = cumulativePost[i];
 
 			unsigned int count = 0;
-			for (int t=0;t<maxDelay_;t++) {
-				delay_info_t dPar = postDelayInfo[i*(maxDelay_+1)+t];
-
-				for(int idx_d=dPar.delay_index_start; idx_d<(dPar.delay_index_start+dPar.delay_length); idx_d++)
-					count++;
-			}
+			for (unsigned int r=cumulativeDelayRuns[i]; r<cumulativeDelayRuns[i+1]; r++)
+				count += postDelayInfo[r].delay_length;
 
 			if (!fwrite(&count,sizeof(int),1,fid)) KERNEL_ERROR("saveSimulation fwrite error");
 
-			for (int t=0;t<maxDelay_;t++) {
-				delay_info_t dPar = postDelayInfo[i*(maxDelay_+1)+t];
+			for (unsigned int r=cumulativeDelayRuns[i]; r<cumulativeDelayRuns[i+1]; r++) {
+				delay_info_t dPar = postDelayInfo[r];
 
 				for(int idx_d=dPar.delay_index_start; idx_d<(dPar.delay_index_start+dPar.delay_length); idx_d++) {
 					// get synaptic info...
@@ -1412,7 +1684,7 @@ void CpuSNN::saveSimulation(FILE* fid, bool saveSynapseInfo) {
 					// get the cumulative position for quick access...
 					unsigned int pos_i = cumulativePre[p_i] + s_i;
 
-					uint8_t delay = t+1;
+					uint8_t delay = dPar.delay;
 					uint8_t plastic = s_i < Npre_plastic[p_i]; // plastic or fixed.
 
 					if (!fwrite(&i,sizeof(int),1,fid)) KERNEL_ERROR("saveSimulation fwrite error");
@@ -1678,8 +1950,8 @@ uint8_t* CpuSNN::getDelays(int gIDpre, int gIDpost, int& Npre, int& Npost, uint8
 	for (int i=grp_Info[gIDpre].StartN;i<grp_Info[gIDpre].EndN;i++) {
 		unsigned int offset = cumulativePost[i];
 
-		for (int t=0;t<maxDelay_;t++) {
-			delay_info_t dPar = postDelayInfo[i*(maxDelay_+1)+t];
+		for (unsigned int r=cumulativeDelayRuns[i]; r<cumulativeDelayRuns[i+1]; r++) {
+			delay_info_t dPar = postDelayInfo[r];
 
 			for(int idx_d=dPar.delay_index_start; idx_d<(dPar.delay_index_start+dPar.delay_length); idx_d++) {
 				// get synaptic info...
@@ -1697,7 +1969,7 @@ uint8_t* CpuSNN::getDelays(int gIDpre, int gIDpost, int& Npre, int& Npost, uint8
 					// get the cumulative position for quick access...
 //					unsigned int pos_i = cumulativePre[p_i] + s_i;
 
-					delays[i+Npre*(p_i-grp_Info[gIDpost].StartN)] = t+1;
+					delays[i+Npre*(p_i-grp_Info[gIDpost].StartN)] = dPar.delay;
 				}
 			}
 		}
@@ -1762,6 +2034,44 @@ GroupSTDPInfo_t CpuSNN::getGroupSTDPInfo(int grpId) {
 	return gInfo;
 }
 
+RealTimeStats_t CpuSNN::getRealTimeStats() {
+	RealTimeStats_t rt;
+	rt.factor = realTimeFactor_;
+	rt.numSteps = rtNumSteps_;
+	rt.numDeadlineMisses = rtNumMisses_;
+	rt.numStalls = rtNumStalls_;
+	rt.computeMaxUs = rtMaxComputeNs_/1000.0f;
+	rt.maxLatenessUs = (std::max)((int64_t)0, rtMaxLatenessNs_)/1000.0f;
+
+	// percentiles from the histogram, never larger than the actual maximum
+	float* percentile[2] = {&rt.computeP50Us, &rt.computeP99Us};
+	double fraction[2] = {0.5, 0.99};
+	for (int p=0; p<2; p++) {
+		*percentile[p] = 0.0f;
+		uint64_t rank = (uint64_t)ceil(fraction[p]*rtNumSteps_);
+		uint64_t cnt = 0;
+		for (int i=0; i<RT_HIST_SIZE && rank>0; i++) {
+			cnt += rtHistogram_[i];
+			if (cnt >= rank) {
+				*percentile[p] = (std::min)(rtBucketValue(i), (double)rtMaxComputeNs_)/1000.0f;
+				break;
+			}
+		}
+	}
+
+	return rt;
+}
+
+void CpuSNN::resetRealTimeStats() {
+	rtHistogram_.assign(RT_HIST_SIZE, 0);
+	rtNumSteps_ = 0;
+	rtNumMisses_ = 0;
+	rtNumStalls_ = 0;
+	rtLastStepLate_ = false;
+	rtMaxComputeNs_ = 0;
+	rtMaxLatenessNs_ = 0;
+}
+
 GroupNeuromodulatorInfo_t CpuSNN::getGroupNeuromodulatorInfo(int grpId) {
 	GroupNeuromodulatorInfo_t gInfo;
 
@@ -2004,6 +2314,18 @@ void CpuSNN::CpuSNNinit() {
 
 	// init random seed
 	srand48(randSeed_);
+
+	// seed the random number streams of Bernoulli Poisson input (splitmix32 scrambling of the seed)
+	uint32_t rngSeed = (uint32_t)randSeed_;
+	for (int l=0; l<POISSON_RNG_LANES; l++) {
+		uint32_t* state[4] = {&poissonRngX[l], &poissonRngY[l], &poissonRngZ[l], &poissonRngW[l]};
+		for (int k=0; k<4; k++) {
+			uint32_t z = (rngSeed += 0x9E3779B9);
+			z = (z ^ (z >> 16)) * 0x85EBCA6B;
+			z = (z ^ (z >> 13)) * 0xC2B2AE35;
+			*state[k] = (z ^ (z >> 16)) | (k==3); // w must not be zero
+		}
+	}
 	//getRand.seed(randSeed_*2);
 	//getRandClosed.seed(randSeed_*3);
 
@@ -2014,6 +2336,7 @@ void CpuSNN::CpuSNNinit() {
 	simTimeRunStart     = 0;    simTimeRunStop      = 0;
 	simTimeLastRunSummary = 0;
 	simTimeMs	 		= 0;    simTimeSec          = 0;    simTime = 0;
+	simTimeEpochMs		= 0;
 	spikeCountAll1secHost	= 0;    secD1fireCntHost    = 0;    secD2fireCntHost  = 0;
 	spikeCountAllHost 		= 0;    spikeCountD2Host    = 0;    spikeCountD1Host = 0;
 	nPoissonSpikes 		= 0;
@@ -2037,7 +2360,11 @@ void CpuSNN::CpuSNNinit() {
 	gpuExecutionTime = 0.0;
 
 	spikeRateUpdated = false;
+	wtChangeDirtyAll = true;
 	numSpikeMonitor = 0;
+	spikeInjectionQueue = NULL;
+	realTimeFactor_ = 0.0f;
+	resetRealTimeStats();
 	numGroupMonitor = 0;
 	numConnectionMonitor = 0;
 	numSpkCnt = 0;
@@ -2049,9 +2376,11 @@ void CpuSNN::CpuSNNinit() {
 	sim_with_modulated_stdp = false;
 	sim_with_homeostasis = false;
 	sim_with_stp = false;
+	sim_with_elig_trace = false;
 	sim_in_testing = false;
 
 	maxSpikesD2 = maxSpikesD1 = 0;
+	numSpikesDropped = 0;
 	loadSimFID = NULL;
 
 	numN = 0;
@@ -2059,6 +2388,8 @@ void CpuSNN::CpuSNNinit() {
 	numNExcPois = 0;
 	numNInhPois = 0;
 	numNReg = 0;
+	numNSTP = 0;
+	stpBufLen_ = 1;
 	numComp = 0;
 	numNExcReg = 0;
 	numNInhReg = 0;
@@ -2124,6 +2455,16 @@ void CpuSNN::CpuSNNinit() {
 		// if any incoming  connections are plastic
 		grp_Info[i].isSpikeGenerator = false;
 		grp_Info[i].RatePtr = NULL;
+		grp_Info[i].PoissonMode = POISSON_ISI;
+		grp_Info[i].RateSchedule = NULL;
+		grp_Info[i].RateScheduleRates = NULL;
+		grp_Info[i].RateScheduleStart = 0;
+		grp_Info[i].RateScheduleNextMs = MAX_SIMULATION_TIME;
+		grp_Info[i].RateScheduleLastSwitch = MAX_SIMULATION_TIME;
+		grp_Info[i].CurrSchedule = NULL;
+		grp_Info[i].CurrScheduleStart = 0;
+		grp_Info[i].CurrScheduleNextEntry = 0;
+		grp_Info[i].SpikeStreamId = -1;
 
 		grp_Info[i].homeoId = -1;
 		grp_Info[i].avgTimeScale  = 10000.0;
@@ -2176,6 +2517,9 @@ void CpuSNN::CpuSNNinit() {
 	stdpScaleFactor_ = 1.0f;
 	wtChangeDecay_ = 0.0f;
 
+	// default bookkeeping window of firing tables and monitors
+	epochLengthMs_ = DEFAULT_EPOCH_LENGTH_MS;
+
 #ifndef __NO_CUDA__
 	if (simMode_ == GPU_MODE) {
 		configGPUDevice();
@@ -2249,10 +2593,10 @@ void CpuSNN::buildNetworkInit() {
 
 	// init neuromodulators and their assistive buffers
 	for (int i = 0; i < numGrp; i++) {
-		grpDABuffer[i] = new float[1000]; // 1 second DA buffer
-		grp5HTBuffer[i] = new float[1000];
-		grpAChBuffer[i] = new float[1000];
-		grpNEBuffer[i] = new float[1000];
+		grpDABuffer[i] = new float[epochLengthMs_]; // one epoch of DA
+		grp5HTBuffer[i] = new float[epochLengthMs_];
+		grpAChBuffer[i] = new float[epochLengthMs_];
+		grpNEBuffer[i] = new float[epochLengthMs_];
 	}
 
 	resetCurrent();
@@ -2276,16 +2620,32 @@ void CpuSNN::buildNetworkInit() {
 	cpuSnnSz.neuronInfoSize += (sizeof(int)*numN*2+sizeof(bool)*numN);
 	#endif
 
-	// STP can be applied to spike generators, too -> numN
+	// STP can be applied to spike generators, too, but only groups with STP get a slot in the STP buffers
 	if (sim_with_stp) {
-		// \TODO: The size of these data structures could be reduced to the max synaptic delay of all
-		// connections with STP. That number might not be the same as maxDelay_.
-		stpu = new float[numN*(maxDelay_+1)];
-		stpx = new float[numN*(maxDelay_+1)];
-		memset(stpu, 0, sizeof(float)*numN*(maxDelay_+1)); // memset works for 0.0
-		for (int i=0; i < numN*(maxDelay_+1); i++)
+		numNSTP = 0;
+		for (int g=0; g<numGrp; g++) {
+			if (grp_Info[g].WithSTP) {
+				grp_Info2[g].stpNeurOffset = numNSTP;
+				numNSTP += grp_Info[g].SizeN;
+			} else {
+				grp_Info2[g].stpNeurOffset = -1;
+			}
+		}
+
+		// \TODO: The ring length could be reduced to the max synaptic delay of all connections with STP.
+		// That number might not be the same as maxDelay_.
+		stpBufLen_ = 1;
+		while (stpBufLen_ < maxDelay_+1)
+			stpBufLen_ <<= 1;
+
+		stpu = new float[numNSTP*stpBufLen_];
+		stpx = new float[numNSTP*stpBufLen_];
+		stpLastSpikeTime = new unsigned int[numNSTP];
+		memset(stpu, 0, sizeof(float)*numNSTP*stpBufLen_); // memset works for 0.0
+		for (int i=0; i < numNSTP*stpBufLen_; i++)
 			stpx[i] = 1.0f; // but memset doesn't work for 1.0
-		cpuSnnSz.synapticInfoSize += (2*sizeof(float)*numN*(maxDelay_+1));
+		memset(stpLastSpikeTime, 0, sizeof(unsigned int)*numNSTP);
+		cpuSnnSz.synapticInfoSize += ((2*sizeof(float)*stpBufLen_+sizeof(unsigned int))*numNSTP);
 	}
 
 	Npre 		   = new unsigned short[numN];
@@ -2307,8 +2667,8 @@ void CpuSNN::buildNetworkInit() {
 	assert(postSynCnt/numN <= (unsigned int)numPostSynapses_); // divide by numN to prevent INT overflow
 	postSynapticIds		= new post_info_t[postSynCnt+100];
 	tmp_SynapticDelay	= new uint8_t[postSynCnt+100];	//!< Temporary array to store the delays of each connection
-	postDelayInfo		= new delay_info_t[numN*(maxDelay_+1)];	//!< Possible delay values are 0....maxDelay_ (inclusive of maxDelay_)
-	cpuSnnSz.networkInfoSize += ((sizeof(post_info_t)+sizeof(uint8_t))*postSynCnt+100)+(sizeof(delay_info_t)*numN*(maxDelay_+1));
+	cumulativeDelayRuns	= new unsigned int[numN+1];	//!< postDelayInfo itself is allocated in reorganizeDelay
+	cpuSnnSz.networkInfoSize += ((sizeof(post_info_t)+sizeof(uint8_t))*postSynCnt+100)+(sizeof(int)*(numN+1));
 	assert(preSynCnt/numN <= (unsigned int)numPreSynapses_); // divide by numN to prevent INT overflow
 
 	wt  			= new float[preSynCnt+100];
@@ -2323,10 +2683,17 @@ void CpuSNN::buildNetworkInit() {
 	// size due to weights and maximum weights
 	cpuSnnSz.synapticInfoSize += ((sizeof(int) + 2 * sizeof(float) + sizeof(post_info_t)) * (preSynCnt + 100));
 
-	timeTableD2  = new unsigned int[1000 + maxDelay_ + 1];
-	timeTableD1  = new unsigned int[1000 + maxDelay_ + 1];
+	timeTableD2  = new unsigned int[epochLengthMs_ + maxDelay_ + 1];
+	timeTableD1  = new unsigned int[epochLengthMs_ + maxDelay_ + 1];
 	resetTimingTable();
-	cpuSnnSz.spikingInfoSize += sizeof(int) * 2 * (1000 + maxDelay_ + 1);
+	cpuSnnSz.spikingInfoSize += sizeof(int) * 2 * (epochLengthMs_ + maxDelay_ + 1);
+
+	// a spike fired at t is delivered at t+delay-1, so the wheel needs at least maxDelay_ slots
+	int wheelLen = 1;
+	while (wheelLen < maxDelay_)
+		wheelLen <<= 1;
+	spikeWheel.clear();
+	spikeWheel.resize(wheelLen);
 
 	// poisson Firing Rate
 	cpuSnnSz.neuronInfoSize += (sizeof(int) * numNPois);
@@ -2334,7 +2701,6 @@ void CpuSNN::buildNetworkInit() {
 
 
 int CpuSNN::addSpikeToTable(int nid, int g) {
-	int spikeBufferFull = 0;
 	lastSpikeTime[nid] = simTime;
 	nSpikeCnt[nid]++;
 	if (sim_with_homeostasis)
@@ -2349,38 +2715,70 @@ int CpuSNN::addSpikeToTable(int nid, int g) {
 #endif
 
 	if (grp_Info[g].WithSTP) {
-		// update the spike-dependent part of du/dt and dx/dt
-		// we need to retrieve the STP values from the right buffer position (right before vs. right after the spike)
-		int ind_plus = STP_BUF_POS(nid,simTime); // index of right after the spike, such as in u^+
-	    int ind_minus = STP_BUF_POS(nid,(simTime-1)); // index of right before the spike, such as in u^-
-
-		// du/dt = -u/tau_F + U * (1-u^-) * \delta(t-t_{spk})
-		stpu[ind_plus] += grp_Info[g].STP_U*(1.0-stpu[ind_minus]);
-
-		// dx/dt = (1-x)/tau_D - u^+ * x^- * \delta(t-t_{spk})
-		stpx[ind_plus] -= stpu[ind_plus]*stpx[ind_minus];
+		firingUpdateSTP(nid, g);
 	}
 
 	if (grp_Info[g].MaxDelay == 1) {
 		assert(nid < numN);
+		if (secD1fireCntHost >= maxSpikesD1 && !growFiringTable(&firingTableD1, &maxSpikesD1, secD1fireCntHost)) {
+			numSpikesDropped++;
+			return 2;
+		}
 		firingTableD1[secD1fireCntHost] = nid;
 		secD1fireCntHost++;
 		grp_Info[g].FiringCount1sec++;
-		if (secD1fireCntHost >= maxSpikesD1) {
-			spikeBufferFull = 2;
-			secD1fireCntHost = maxSpikesD1-1;
-		}
 	} else {
 		assert(nid < numN);
+		if (secD2fireCntHost >= maxSpikesD2 && !growFiringTable(&firingTableD2, &maxSpikesD2, secD2fireCntHost)) {
+			numSpikesDropped++;
+			return 1;
+		}
 		firingTableD2[secD2fireCntHost] = nid;
 		grp_Info[g].FiringCount1sec++;
 		secD2fireCntHost++;
-		if (secD2fireCntHost >= maxSpikesD2) {
-			spikeBufferFull = 1;
-			secD2fireCntHost = maxSpikesD2-1;
-		}
+		scheduleSpikeDelivery(nid);
+	}
+	return 0;
+}
+
+/*!
+ * \brief doubles the capacity of a CPU firing table, keeping its first fireCnt entries
+ *
+ * Growing geometrically keeps the amortized cost per spike constant. Once the network has run through its busiest
+ * second the tables no longer change size.
+ * \return false if the larger table could not be allocated, in which case the old table is left untouched
+ */
+bool CpuSNN::growFiringTable(unsigned int** table, unsigned int* maxSpikes, unsigned int fireCnt) {
+	assert(simMode_ == CPU_MODE);
+	assert(fireCnt <= *maxSpikes);
+
+	unsigned int newMaxSpikes = (*maxSpikes < 1024) ? 2048 : 2 * (*maxSpikes);
+	if (newMaxSpikes <= *maxSpikes) // capacity of unsigned int exhausted
+		return false;
+
+	unsigned int* newTable = new (std::nothrow) unsigned int[newMaxSpikes];
+	if (newTable == NULL) {
+		if (numSpikesDropped == 0)
+			KERNEL_WARN("Could not grow firing table to %u spikes, further spikes will be dropped", newMaxSpikes);
+		return false;
 	}
-	return spikeBufferFull;
+
+	KERNEL_DEBUG("Firing table %s grown from %u to %u spikes at t=%u ms", (*table==firingTableD1)?"D1":"D2",
+		*maxSpikes, newMaxSpikes, simTime);
+	if (fireCnt > 0)
+		memcpy(newTable, *table, sizeof(unsigned int) * fireCnt);
+	if (*table != NULL)
+		delete[] *table;
+
+	cpuSnnSz.spikingInfoSize += sizeof(int) * (newMaxSpikes - *maxSpikes);
+	*table = newTable;
+	*maxSpikes = newMaxSpikes;
+
+	// keep the CPU pointer struct in sync
+	cpuNetPtrs.firingTableD1 = firingTableD1;
+	cpuNetPtrs.firingTableD2 = firingTableD2;
+
+	return true;
 }
 
 
@@ -2498,6 +2896,7 @@ void CpuSNN::buildNetwork() {
 		KERNEL_DEBUG("loadSimulation_internal() error number:%d", loadError);
 		loadError = loadSimulation_internal(false); // read the fixed synapses second
 		KERNEL_DEBUG("loadSimulation_internal() error number:%d", loadError);
+		wtChangeDirtyAll = true; // loaded weights are clamped in the next updateWeights
 		for(int con = 0; con < 2; con++) {
 			newInfo = connectBegin;
 			while(newInfo) {
@@ -2625,6 +3024,45 @@ void CpuSNN::buildPoissonGroup(int grpId) {
 	assert(allocatedPre  <= preSynCnt);
 }
 
+void CpuSNN::buildSTDPLookupTables(int grpId) {
+	group_info2_t* grp = &grp_Info2[grpId];
+
+	// tables with cutoff=0 are never accessed
+	grp->lutLTPExc.cutoff = grp->lutLTDExc.cutoff = grp->lutLTPInb.cutoff = grp->lutLTDInb.cutoff = 0;
+	grp->lutLTPExc.val.clear(); grp->lutLTDExc.val.clear();
+	grp->lutLTPInb.val.clear(); grp->lutLTDInb.val.clear();
+
+	if (grp_Info[grpId].WithESTDP) {
+		buildSTDPLookupTable(&grp->lutLTPExc, grpId, true, true, grp_Info[grpId].TAU_PLUS_INV_EXC);
+		buildSTDPLookupTable(&grp->lutLTDExc, grpId, true, false, grp_Info[grpId].TAU_MINUS_INV_EXC);
+	}
+
+	// the pulse curve is cheap to evaluate and does not need a table
+	if (grp_Info[grpId].WithISTDP && grp_Info[grpId].WithISTDPcurve == EXP_CURVE) {
+		buildSTDPLookupTable(&grp->lutLTPInb, grpId, false, true, grp_Info[grpId].TAU_PLUS_INV_INB);
+		buildSTDPLookupTable(&grp->lutLTDInb, grpId, false, false, grp_Info[grpId].TAU_MINUS_INV_INB);
+	}
+}
+
+void CpuSNN::buildSTDPLookupTable(stdp_lut_t* lut, int grpId, bool isExc, bool isLTP, float tauInv) {
+	assert(tauInv > 0.0f);
+
+	// The curve is evaluated only for tDiff*tauInv < STDP_CUTOFF (computed in float, as in the original check).
+	// Since tDiff*tauInv is monotonic in tDiff, the valid range is [0,cutoff). Start from the analytical solution and
+	// correct for rounding in both directions.
+	double cutoffD = ceil(STDP_CUTOFF/tauInv);
+	int cutoff = (cutoffD > MAX_SIMULATION_TIME) ? MAX_SIMULATION_TIME : (int)cutoffD;
+	while (cutoff > 0 && (cutoff-1)*tauInv >= STDP_CUTOFF)
+		cutoff--;
+	while (cutoff < (int)MAX_SIMULATION_TIME && cutoff*tauInv < STDP_CUTOFF)
+		cutoff++;
+
+	lut->cutoff = cutoff;
+	lut->val.resize((std::min)(cutoff, MAX_STDP_LUT_SIZE));
+	for (unsigned int t=0; t<lut->val.size(); t++)
+		lut->val[t] = getSTDPCurveValue(grpId, isExc, isLTP, t);
+}
+
 /*!
  * \brief check whether Spike Counters need to be reset
  *
@@ -2819,6 +3257,9 @@ void CpuSNN::connectGaussian(grpConnectInfo_t* info) {
 	Grid3D grid_j = getGroupGrid3D(grpDest);
 	Point3D scalePre = Point3D(grid_j.x, grid_j.y, grid_j.z) / Point3D(grid_i.x, grid_i.y, grid_i.z);
 
+	// largest rfDist for which the Gaussian weight is still >= 0.1 times the max weight (see below)
+	const double rfDistMax = log(10.0)/2.3026;
+
 	for(int i = grp_Info[grpSrc].StartN; i <= grp_Info[grpSrc].EndN; i++)  {
 		Point3D loc_i = getNeuronLocation3D(i)*scalePre; // i: adjusted 3D coordinates
 
@@ -2836,11 +3277,13 @@ void CpuSNN::connectGaussian(grpConnectInfo_t* info) {
 			// and rfDist=1 corresponds to 0.1 times max Gaussian weight
 			// so we're looking at gauss = exp(-a*rfDist), where a such that exp(-a)=0.1
 			// solving for a, we find that a = 2.3026
-			double gauss = exp(-2.3026*rfDist);
-			if (gauss < 0.1)
+			// gauss < 0.1 is equivalent to rfDist > log(10)/a, so the cut-off does not need exp; the weight itself is
+			// only evaluated for pairs that actually get connected
+			if (rfDist > rfDistMax)
 				continue;
 
 			if (drand48() < info->p) {
+				double gauss = exp(-2.3026*rfDist);
 				uint8_t dVal = info->minDelay + rand() % (info->maxDelay - info->minDelay + 1);
 				assert((dVal >= info->minDelay) && (dVal <= info->maxDelay));
 				float synWt = gauss * info->initWt; // scale weight according to gauss distance
@@ -2924,7 +3367,12 @@ void CpuSNN::connectUserDefined (grpConnectInfo_t* info) {
 				info->maxWt = maxWt;
 
 				assert(delay >= 1);
-				assert(delay <= MAX_SynapticDelay);
+				if (delay > MAX_SynapticDelayUserDefined) {
+					KERNEL_ERROR("connect(%s,%s): delay (%d) of user-defined connection is larger than "
+						"MAX_SynapticDelayUserDefined (%d)", grp_Info2[grpSrc].Name.c_str(),
+						grp_Info2[grpDest].Name.c_str(), (int)delay, MAX_SynapticDelayUserDefined);
+					exitSimulation(1);
+				}
 				assert(fabs(weight) <= fabs(maxWt));
 
 				// adjust the sign of the weight based on inh/exc connection
@@ -2960,12 +3408,24 @@ void CpuSNN::printSimSummary() {
 	KERNEL_INFO("Random Seed:\t\t%d", randSeed_);
 	KERNEL_INFO("Timing:\t\t\tModel Simulation Time = %llu sec", (unsigned long long)simTimeSec);
 	KERNEL_INFO("\t\t\tActual Execution Time = %4.2f sec", executionTimeMs/1000.0);
+	if (rtNumSteps_ > 0) {
+		RealTimeStats_t rt = getRealTimeStats();
+		KERNEL_INFO("Real-Time Pacing:\tDeadline Misses = %d of %d steps in %d stalls (factor %.2f)",
+			rt.numDeadlineMisses, rt.numSteps, rt.numStalls, rt.factor);
+		KERNEL_INFO("\t\t\tCompute Time per Step = %.1f us (p50), %.1f us (p99), %.1f us (max)", rt.computeP50Us,
+			rt.computeP99Us, rt.computeMaxUs);
+	}
 	KERNEL_INFO("Average Firing Rate:\t2+ms delay = %3.3f Hz", spikeCountD2Host/(1.0*simTimeSec*numNExcReg));
 	KERNEL_INFO("\t\t\t1ms delay = %3.3f Hz", spikeCountD1Host/(1.0*simTimeSec*numNInhReg));
 	KERNEL_INFO("\t\t\tOverall = %3.3f Hz", spikeCountAllHost/(1.0*simTimeSec*numN));
 	KERNEL_INFO("Overall Firing Count:\t2+ms delay = %d", spikeCountD2Host);
 	KERNEL_INFO("\t\t\t1ms delay = %d", spikeCountD1Host);
 	KERNEL_INFO("\t\t\tTotal = %d", spikeCountAllHost);
+	if (simMode_ == CPU_MODE) {
+		KERNEL_INFO("Firing Table Size:\t2+ms delay = %u", maxSpikesD2);
+		KERNEL_INFO("\t\t\t1ms delay = %u", maxSpikesD1);
+		KERNEL_INFO("\t\t\tDropped spikes = %llu", numSpikesDropped);
+	}
 	KERNEL_INFO("*********************************************************************************\n");
 }
 
@@ -3004,6 +3464,19 @@ void CpuSNN::deleteObjects() {
 			fclose(fpLog_);
 	}
 
+	// unlink shared-memory spike streams (consumers that have mapped them can still read what has been published)
+	for (unsigned int i=0; i<spikeStreams.size(); i++)
+		delete spikeStreams[i];
+	spikeStreams.clear();
+
+	// delete the rates of PoissonRateSchedules
+	for (int g=0; g<numGrp; g++) {
+		if (grp_Info[g].RateScheduleRates != NULL) {
+			delete grp_Info[g].RateScheduleRates;
+			grp_Info[g].RateScheduleRates = NULL;
+		}
+	}
+
 	resetPointers(true); // deallocate pointers
 
 #ifndef __NO_CUDA__
@@ -3016,57 +3489,137 @@ void CpuSNN::deleteObjects() {
 
 
 
+void CpuSNN::recordRealTimeStep(uint64_t computeNs, int64_t latenessNs) {
+	rtHistogram_[(std::min)(rtBucket(computeNs), RT_HIST_SIZE-1)]++;
+	rtNumSteps_++;
+	if (latenessNs > 0) {
+		rtNumMisses_++;
+		if (!rtLastStepLate_)
+			rtNumStalls_++;
+	}
+	rtLastStepLate_ = latenessNs > 0;
+	rtMaxComputeNs_ = (std::max)(rtMaxComputeNs_, computeNs);
+	rtMaxLatenessNs_ = (std::max)(rtMaxLatenessNs_, latenessNs);
+}
+
+// Drains the spike injection queue at the beginning of a time step. Injected spikes are put into the same spike buffer
+// as the spikes of the spike generators, so they are generated (and monitored) like any other input spike. Spikes that
+// are due further in the future than the spike buffer can hold are kept aside until they fit.
+void CpuSNN::drainSpikeInjectionQueue() {
+	// deferred spikes first, so that spikes of the same neuron are scheduled in the order they were pushed
+	unsigned int nDeferred = 0;
+	for (unsigned int i=0; i<spikeInjectionDeferred.size(); i++) {
+		injection_event_t& ev = spikeInjectionDeferred[i];
+		if (ev.timeMs - simTime < PROPAGATED_BUFFER_SIZE) {
+			pbuf->scheduleSpikeTargetGroup(grp_Info[ev.grpId].StartN + ev.neurId, ev.timeMs - simTime);
+			if (grp_Info[ev.grpId].withSpikeCounter)
+				spkCntBuf[grp_Info[ev.grpId].spkCntBufPos][ev.neurId]++;
+		} else {
+			spikeInjectionDeferred[nDeferred++] = ev;
+		}
+	}
+	spikeInjectionDeferred.resize(nDeferred);
+
+	injection_event_t ev;
+	while (spikeInjectionQueue->pop(ev)) {
+		if (ev.grpId<0 || ev.grpId>=numGrp || ev.neurId<0 || ev.neurId>=grp_Info[ev.grpId].SizeN) {
+			KERNEL_ERROR("SpikeInjectionQueue: invalid neuron %d of group %d", ev.neurId, ev.grpId);
+			exitSimulation(1);
+		}
+
+		if (ev.type == INJECT_SPIKE) {
+			if (!grp_Info[ev.grpId].isSpikeGenerator) {
+				KERNEL_ERROR("SpikeInjectionQueue: spikes can only be injected into spike generator groups, but group "
+					"%d (%s) is not one", ev.grpId, grp_Info2[ev.grpId].Name.c_str());
+				exitSimulation(1);
+			}
+
+			// spikes that are already due fire in the current time step
+			if (ev.timeMs < simTime)
+				ev.timeMs = simTime;
+			if (ev.timeMs - simTime < PROPAGATED_BUFFER_SIZE) {
+				pbuf->scheduleSpikeTargetGroup(grp_Info[ev.grpId].StartN + ev.neurId, ev.timeMs - simTime);
+				if (grp_Info[ev.grpId].withSpikeCounter)
+					spkCntBuf[grp_Info[ev.grpId].spkCntBufPos][ev.neurId]++;
+			} else {
+				spikeInjectionDeferred.push_back(ev);
+			}
+		} else {
+			if (grp_Info[ev.grpId].isSpikeGenerator) {
+				KERNEL_ERROR("SpikeInjectionQueue: currents cannot be injected into spike generator group %d (%s)",
+					ev.grpId, grp_Info2[ev.grpId].Name.c_str());
+				exitSimulation(1);
+			}
+			extCurrent[grp_Info[ev.grpId].StartN + ev.neurId] = ev.current;
+		}
+	}
+
+	spikeInjectionQueue->setSimTime(simTime);
+}
+
+// Publishes all spikes of the current time step to the spike streams of their groups. Spikes are written once per
+// time step, and the time step is published even if there were no spikes, so that consumers can keep track of time.
+void CpuSNN::publishSpikeStreams() {
+	// D2 spikes before D1 spikes, same order as in updateSpikeMonitor
+	for (int k=0; k<2; k++) {
+		unsigned int* timeTablePtr = (k==0)?timeTableD2:timeTableD1;
+		unsigned int* fireTablePtr = (k==0)?firingTableD2:firingTableD1;
+		unsigned int fireCnt = (k==0)?secD2fireCntHost:secD1fireCntHost;
+		for (unsigned int i=timeTablePtr[simTimeEpochMs+maxDelay_]; i<fireCnt; i++) {
+			int nid = fireTablePtr[i];
+			assert(nid < numN);
+			int g = grpIds[nid];
+			if (grp_Info[g].SpikeStreamId >= 0)
+				spikeStreams[grp_Info[g].SpikeStreamId]->addSpike(simTime, g, nid - grp_Info[g].StartN);
+		}
+	}
+
+	for (unsigned int i=0; i<spikeStreams.size(); i++)
+		spikeStreams[i]->publish(simTime);
+}
+
 // This method loops through all spikes that are generated by neurons with a delay of 1ms
 // and delivers the spikes to the appropriate post-synaptic neuron
 void CpuSNN::doD1CurrentUpdate() {
 	int k     = secD1fireCntHost-1;
-	int k_end = timeTableD1[simTimeMs+maxDelay_];
+	int k_end = timeTableD1[simTimeEpochMs+maxDelay_];
 
 	while((k>=k_end) && (k>=0)) {
 
 		int neuron_id      = firingTableD1[k];
 		assert(neuron_id<numN);
 
-		delay_info_t dPar = postDelayInfo[neuron_id*(maxDelay_+1)];
+		// D1 neurons have at most one delay run (delay=1)
+		if (cumulativeDelayRuns[neuron_id] < cumulativeDelayRuns[neuron_id+1]) {
+			delay_info_t dPar = postDelayInfo[cumulativeDelayRuns[neuron_id]];
+			assert(dPar.delay == 1);
 
-		unsigned int  offset = cumulativePost[neuron_id];
+			unsigned int  offset = cumulativePost[neuron_id];
 
-		for(int idx_d = dPar.delay_index_start;
-			idx_d < (dPar.delay_index_start + dPar.delay_length);
-			idx_d = idx_d+1) {
-				generatePostSpike( neuron_id, idx_d, offset, 0);
+			for(int idx_d = dPar.delay_index_start;
+				idx_d < (dPar.delay_index_start + dPar.delay_length);
+				idx_d = idx_d+1) {
+					generatePostSpike( neuron_id, idx_d, offset, 0);
+			}
 		}
 		k=k-1;
 	}
 }
 
-// This method loops through all spikes that are generated by neurons with a delay of 2+ms
-// and delivers the spikes to the appropriate post-synaptic neuron
+// This method delivers all spikes of neurons with a delay of 2+ms that are due at the current time step.
+// Spikes were put on the spike wheel by scheduleSpikeDelivery when they were fired (once per delay run), so the work
+// per time step only depends on the spikes that actually arrive, not on maxDelay_.
 void CpuSNN::doD2CurrentUpdate() {
-	int k = secD2fireCntHost-1;
-	int k_end = timeTableD2[simTimeMs+1];
-	int t_pos = simTimeMs;
-
-	while((k>=k_end)&& (k >=0)) {
-
-		// get the neuron id from the index k
-		int i  = firingTableD2[k];
+	std::vector<delayed_spike_t>& due = spikeWheel[simTime & (spikeWheel.size()-1)];
 
-		// find the time of firing from the timeTable using index k
-		while (!(((unsigned int)k >= timeTableD2[t_pos+maxDelay_]) 
-			&& ((unsigned int)k < timeTableD2[t_pos+maxDelay_+1]))) {
-			t_pos = t_pos - 1;
-			assert((t_pos+maxDelay_-1)>=0);
-		}
-
-		// \TODO: Instead of using the complex timeTable, can neuronFiringTime value...???
-		// Calculate the time difference between time of firing of neuron and the current time...
-		int tD = simTimeMs - t_pos;
-
-		assert((tD<maxDelay_)&&(tD>=0));
+	// deliver most recent spikes first
+	for (int k=(int)due.size()-1; k>=0; k--) {
+		int i = due[k].nid;
 		assert(i<numN);
 
-		delay_info_t dPar = postDelayInfo[i*(maxDelay_+1)+tD];
+		delay_info_t dPar = postDelayInfo[due[k].runIdx];
+		int tD = dPar.delay-1;
+		assert((tD<maxDelay_)&&(tD>=0));
 
 		unsigned int offset = cumulativePost[i];
 
@@ -3076,9 +3629,9 @@ void CpuSNN::doD2CurrentUpdate() {
 			idx_d = idx_d+1) {
 			generatePostSpike( i, idx_d, offset, tD);
 		}
-
-		k=k-1;
 	}
+
+	due.clear();
 }
 
 void CpuSNN::doSnnSim() {
@@ -3090,22 +3643,39 @@ void CpuSNN::doSnnSim() {
 	// decay STP vars and conductances
 	globalStateDecay();
 
+	// switch rates of PoissonRateSchedules (before the spike generators are updated)
+	updateRateSchedules();
+
+	// apply the current changes of CurrentSchedules that are due in this time step
+	updateCurrentSchedules();
+
 	updateSpikeGenerators();
 
+	// closed-loop input: schedule the spikes that were injected since the last time step
+	if (spikeInjectionQueue != NULL)
+		drainSpikeInjectionQueue();
+
 	//generate all the scheduled spikes from the spikeBuffer..
 	generateSpikes();
 
 	// find the neurons that has fired..
 	findFiring();
 
-	timeTableD2[simTimeMs+maxDelay_+1] = secD2fireCntHost;
-	timeTableD1[simTimeMs+maxDelay_+1] = secD1fireCntHost;
+	timeTableD2[simTimeEpochMs+maxDelay_+1] = secD2fireCntHost;
+	timeTableD1[simTimeEpochMs+maxDelay_+1] = secD1fireCntHost;
+
+	if (!spikeStreams.empty())
+		publishSpikeStreams();
 
 	doD2CurrentUpdate();
 	doD1CurrentUpdate();
 
 	globalStateUpdate();
 
+	if (sim_with_elig_trace) {
+		integrateEligibilityTraces();
+	}
+
 	return;
 }
 
@@ -3124,15 +3694,8 @@ void CpuSNN::globalStateDecay() {
 			}
 		}
 
-		// decay the STP variables before adding new spikes.
-		if (grp_Info[grpId].WithSTP) {
-			for(int i=grp_Info[grpId].StartN; i<=grp_Info[grpId].EndN; i++) {
-				int ind_plus  = STP_BUF_POS(i,simTime);
-				int ind_minus = STP_BUF_POS(i,(simTime-1));
-				stpu[ind_plus] = stpu[ind_minus]*(1.0-grp_Info[grpId].STP_tau_u_inv);
-				stpx[ind_plus] = stpx[ind_minus] + (1.0-stpx[ind_minus])*grp_Info[grpId].STP_tau_x_inv;
-			}
-		}
+		// the STP variables are no longer decayed here: firingUpdateSTP catches up on the decay of a neuron
+		// whenever it spikes, which is the only time the values are ever read
 
 		if (grp_Info[grpId].Type&POISSON_NEURON)
 			continue;
@@ -3204,27 +3767,29 @@ void CpuSNN::findFiring() {
 
 				// STDP calculation: the post-synaptic neuron fires after the arrival of a pre-synaptic spike
 				if (!sim_in_testing && grp_Info[g].WithSTDP) {
+					setWtChangeDirty(i);
+					// with eligibility traces, STDP increments go to the trace instead of wtChange
+					bool withEligTrace = grp_Info2[g].withEligTrace;
+					float* stdpChange = withEligTrace ? eligTrace : wtChange;
 					unsigned int pos_ij = cumulativePre[i]; // the index of pre-synaptic neuron
 					for(int j=0; j < Npre_plastic[i]; pos_ij++, j++) {
 						int stdp_tDiff = (simTime-synSpikeTime[pos_ij]);
 						assert(!((stdp_tDiff < 0) && (synSpikeTime[pos_ij] != MAX_SIMULATION_TIME)));
 
 						if (stdp_tDiff > 0) {
+							if (withEligTrace)
+								syncEligibilityTrace(pos_ij, g, simTime);
+
 							// check this is an excitatory or inhibitory synapse
 							if (grp_Info[g].WithESTDP && maxSynWt[pos_ij] >= 0) { // excitatory synapse
 								// Handle E-STDP curve
+								// both curves are tabulated at integer tDiff (see buildSTDPLookupTables)
 								switch (grp_Info[g].WithESTDPcurve) {
 								case EXP_CURVE: // exponential curve
-									if (stdp_tDiff * grp_Info[g].TAU_PLUS_INV_EXC < 25)
-										wtChange[pos_ij] += STDP(stdp_tDiff, grp_Info[g].ALPHA_PLUS_EXC, grp_Info[g].TAU_PLUS_INV_EXC);
-									break;
 								case TIMING_BASED_CURVE: // sc curve
-									if (stdp_tDiff * grp_Info[g].TAU_PLUS_INV_EXC < 25) {
-										if (stdp_tDiff <= grp_Info[g].GAMMA)
-											wtChange[pos_ij] += grp_Info[g].OMEGA + grp_Info[g].KAPPA * STDP(stdp_tDiff, grp_Info[g].ALPHA_PLUS_EXC, grp_Info[g].TAU_PLUS_INV_EXC);
-										else // stdp_tDiff > GAMMA
-											wtChange[pos_ij] -= STDP(stdp_tDiff, grp_Info[g].ALPHA_PLUS_EXC, grp_Info[g].TAU_PLUS_INV_EXC);
-									}
+									if (stdp_tDiff < grp_Info2[g].lutLTPExc.cutoff)
+										stdpChange[pos_ij] += (stdp_tDiff < MAX_STDP_LUT_SIZE) ? grp_Info2[g].lutLTPExc.val[stdp_tDiff]
+											: getSTDPCurveValue(g, true, true, stdp_tDiff);
 									break;
 								default:
 									KERNEL_ERROR("Invalid E-STDP curve!");
@@ -3234,16 +3799,17 @@ void CpuSNN::findFiring() {
 								// Handle I-STDP curve
 								switch (grp_Info[g].WithISTDPcurve) {
 								case EXP_CURVE: // exponential curve
-									if (stdp_tDiff * grp_Info[g].TAU_PLUS_INV_INB < 25) { // LTP of inhibitory synapse, which decreases synapse weight
-										wtChange[pos_ij] -= STDP(stdp_tDiff, grp_Info[g].ALPHA_PLUS_INB, grp_Info[g].TAU_PLUS_INV_INB);
-									}
+									// LTP of inhibitory synapse, which decreases synapse weight (table holds negative values)
+									if (stdp_tDiff < grp_Info2[g].lutLTPInb.cutoff)
+										stdpChange[pos_ij] += (stdp_tDiff < MAX_STDP_LUT_SIZE) ? grp_Info2[g].lutLTPInb.val[stdp_tDiff]
+											: getSTDPCurveValue(g, false, true, stdp_tDiff);
 									break;
 								case PULSE_CURVE: // pulse curve
 									if (stdp_tDiff <= grp_Info[g].LAMBDA) { // LTP of inhibitory synapse, which decreases synapse weight
-										wtChange[pos_ij] -= grp_Info[g].BETA_LTP;
+										stdpChange[pos_ij] -= grp_Info[g].BETA_LTP;
 										//printf("I-STDP LTP\n");
 									} else if (stdp_tDiff <= grp_Info[g].DELTA) { // LTD of inhibitory syanpse, which increase sysnapse weight
-										wtChange[pos_ij] -= grp_Info[g].BETA_LTD;
+										stdpChange[pos_ij] -= grp_Info[g].BETA_LTD;
 										//printf("I-STDP LTD\n");
 									} else { /*do nothing*/}
 									break;
@@ -3288,6 +3854,63 @@ void CpuSNN::findMaxNumSynapses(int* numPostSynapses, int* numPreSynapses) {
 	}
 }
 
+void CpuSNN::firingUpdateSTP(int nid, int grpId) {
+	assert(grp_Info[grpId].WithSTP);
+	int stpId = STP_NEUR_ID(nid, grpId);
+	assert(stpId>=0 && stpId<numNSTP);
+
+	// state at the last spike, right after the spike-update
+	unsigned int lastT = stpLastSpikeTime[stpId];
+	float u = stpu[STP_BUF_POS(stpId,lastT)];
+	float x = stpx[STP_BUF_POS(stpId,lastT)];
+
+	// the neuron has been silent since lastT, so u and x just decayed: apply all steps up to simTime-1 at once
+	// u(t+1) = u(t)*(1-1/tau_F), (1-x(t+1)) = (1-x(t))*(1-1/tau_D)
+	if (simTime > lastT+1) {
+		int numSteps = simTime-1-lastT;
+		u *= pow(1.0-grp_Info[grpId].STP_tau_u_inv, numSteps);
+		x = 1.0 - (1.0-x)*pow(1.0-grp_Info[grpId].STP_tau_x_inv, numSteps);
+	}
+
+	// we need to store the STP values right before vs. right after the spike (u^- and u^+), because
+	// generatePostSpike will read them once the spike is delivered
+	int ind_plus = STP_BUF_POS(stpId,simTime); // index of right after the spike, such as in u^+
+	int ind_minus = STP_BUF_POS(stpId,(simTime-1)); // index of right before the spike, such as in u^-
+	stpu[ind_minus] = u;
+	stpx[ind_minus] = x;
+
+	// decay from simTime-1 to simTime
+	stpu[ind_plus] = u*(1.0-grp_Info[grpId].STP_tau_u_inv);
+	stpx[ind_plus] = x + (1.0-x)*grp_Info[grpId].STP_tau_x_inv;
+
+	// du/dt = -u/tau_F + U * (1-u^-) * \delta(t-t_{spk})
+	stpu[ind_plus] += grp_Info[grpId].STP_U*(1.0-stpu[ind_minus]);
+
+	// dx/dt = (1-x)/tau_D - u^+ * x^- * \delta(t-t_{spk})
+	stpx[ind_plus] -= stpu[ind_plus]*stpx[ind_minus];
+
+	stpLastSpikeTime[stpId] = simTime;
+}
+
+void CpuSNN::flushEligibilityTraces(int grpId) {
+	assert(grp_Info2[grpId].withEligTrace);
+	uint32_t untilTime = simTime+1; // all ms up to and including simTime have been integrated
+
+	// all synapses with non-zero traces belong to post-neurons in the dirty list (see updateWeights)
+	for (size_t k=0; k<wtChangeDirtyList.size(); k++) {
+		int i = wtChangeDirtyList[k];
+		if (grpIds[i] != grpId)
+			continue;
+
+		unsigned int offset = cumulativePre[i];
+		for (int j=0; j<Npre_plastic[i]; j++)
+			syncEligibilityTrace(offset+j, grpId, untilTime);
+	}
+
+	// start a new epoch
+	grp_Info2[grpId].eligEpochStart = untilTime;
+}
+
 void CpuSNN::generatePostSpike(unsigned int pre_i, unsigned int idx_d, unsigned int offset, unsigned int tD) {
 	// get synaptic info...
 	post_info_t post_info = postSynapticIds[offset + idx_d];
@@ -3329,8 +3952,9 @@ void CpuSNN::generatePostSpike(unsigned int pre_i, unsigned int idx_d, unsigned
 
 		// dI/dt = -I/tau_S + A * u^+ * x^- * \delta(t-t_{spk})
 		// I noticed that for connect(.., RangeDelay(1), ..) tD will be 0
-		int ind_minus = STP_BUF_POS(pre_i,(simTime-tD-1));
-		int ind_plus  = STP_BUF_POS(pre_i,(simTime-tD));
+		int stpId = STP_NEUR_ID(pre_i, pre_grpId);
+		int ind_minus = STP_BUF_POS(stpId,(simTime-tD-1));
+		int ind_plus  = STP_BUF_POS(stpId,(simTime-tD));
 
 		change *= grp_Info[pre_grpId].STP_A*stpu[ind_plus]*stpx[ind_minus];
 
@@ -3379,19 +4003,30 @@ void CpuSNN::generatePostSpike(unsigned int pre_i, unsigned int idx_d, unsigned
 		int stdp_tDiff = (simTime-lastSpikeTime[post_i]);
 
 		if (stdp_tDiff >= 0) {
+			setWtChangeDirty(post_i);
+
+			// with eligibility traces, STDP increments go to the trace instead of wtChange
+			// (fixed synapses have no trace, and their wtChange is never applied)
+			float* stdpChange = wtChange;
+			if (grp_Info2[post_grpId].withEligTrace && s_i < Npre_plastic[post_i]) {
+				syncEligibilityTrace(pos_i, post_grpId, simTime);
+				stdpChange = eligTrace;
+			}
+
 			if (grp_Info[post_grpId].WithISTDP && ((pre_type & TARGET_GABAa) || (pre_type & TARGET_GABAb))) { // inhibitory syanpse
 				// Handle I-STDP curve
 				switch (grp_Info[post_grpId].WithISTDPcurve) {
 				case EXP_CURVE: // exponential curve
-					if ((stdp_tDiff*grp_Info[post_grpId].TAU_MINUS_INV_INB)<25) { // LTD of inhibitory syanpse, which increase synapse weight
-						wtChange[pos_i] -= STDP(stdp_tDiff, grp_Info[post_grpId].ALPHA_MINUS_INB, grp_Info[post_grpId].TAU_MINUS_INV_INB);
-					}
+					// LTD of inhibitory syanpse, which increase synapse weight (table holds negative values)
+					if (stdp_tDiff < grp_Info2[post_grpId].lutLTDInb.cutoff)
+						stdpChange[pos_i] += (stdp_tDiff < MAX_STDP_LUT_SIZE) ? grp_Info2[post_grpId].lutLTDInb.val[stdp_tDiff]
+							: getSTDPCurveValue(post_grpId, false, false, stdp_tDiff);
 					break;
 				case PULSE_CURVE: // pulse curve
 					if (stdp_tDiff <= grp_Info[post_grpId].LAMBDA) { // LTP of inhibitory synapse, which decreases synapse weight
-						wtChange[pos_i] -= grp_Info[post_grpId].BETA_LTP;
+						stdpChange[pos_i] -= grp_Info[post_grpId].BETA_LTP;
 					} else if (stdp_tDiff <= grp_Info[post_grpId].DELTA) { // LTD of inhibitory syanpse, which increase synapse weight
-						wtChange[pos_i] -= grp_Info[post_grpId].BETA_LTD;
+						stdpChange[pos_i] -= grp_Info[post_grpId].BETA_LTD;
 					} else { /*do nothing*/ }
 					break;
 				default:
@@ -3403,8 +4038,9 @@ void CpuSNN::generatePostSpike(unsigned int pre_i, unsigned int idx_d, unsigned
 				switch (grp_Info[post_grpId].WithESTDPcurve) {
 				case EXP_CURVE: // exponential curve
 				case TIMING_BASED_CURVE: // sc curve
-					if (stdp_tDiff * grp_Info[post_grpId].TAU_MINUS_INV_EXC < 25)
-						wtChange[pos_i] += STDP(stdp_tDiff, grp_Info[post_grpId].ALPHA_MINUS_EXC, grp_Info[post_grpId].TAU_MINUS_INV_EXC);
+					if (stdp_tDiff < grp_Info2[post_grpId].lutLTDExc.cutoff)
+						stdpChange[pos_i] += (stdp_tDiff < MAX_STDP_LUT_SIZE) ? grp_Info2[post_grpId].lutLTDExc.val[stdp_tDiff]
+							: getSTDPCurveValue(post_grpId, true, false, stdp_tDiff);
 					break;
 				default:
 					KERNEL_ERROR("Invalid E-STDP curve");
@@ -3443,15 +4079,58 @@ void CpuSNN::generateSpikesFromFuncPtr(int grpId) {
 	int timeSlice = grp_Info[grpId].CurrTimeSlice;
 	unsigned int currTime = simTime;
 	int spikeCnt = 0;
-	for(int i = grp_Info[grpId].StartN; i <= grp_Info[grpId].EndN; i++) {
-		// start the time from the last time it spiked, that way we can ensure that the refractory period is maintained
-		unsigned int nextTime = lastSpikeTime[i];
-		if (nextTime == MAX_SIMULATION_TIME)
-			nextTime = 0;
 
-		// the end of the valid time window is either the length of the scheduling time slice from now (because that
-		// is the max of the allowed propagated buffer size) or simply the end of the simulation
-		unsigned int endOfTimeWindow = (std::min)(currTime+timeSlice,simTimeRunStop);
+	// the end of the valid time window is either the length of the scheduling time slice from now (because that
+	// is the max of the allowed propagated buffer size) or simply the end of the simulation
+	unsigned int endOfTimeWindow = (std::min)(currTime+timeSlice,simTimeRunStop);
+
+	// start the time from the last time it spiked, that way we can ensure that the refractory period is maintained
+	int numN = grp_Info[grpId].SizeN;
+	spkGenLastTimes.resize(numN);
+	for (int nid=0; nid<numN; nid++) {
+		unsigned int lastTime = lastSpikeTime[grp_Info[grpId].StartN + nid];
+		spkGenLastTimes[nid] = (lastTime == MAX_SIMULATION_TIME) ? 0 : lastTime;
+	}
+
+	// try the batch interface first: a single callback fills the spike events of the whole group and time slice
+	spkGenNeurIds.clear();
+	spkGenTimes.clear();
+	if (spikeGen->nextSpikeTimes(this, grpId, currTime, endOfTimeWindow, spkGenLastTimes, spkGenNeurIds,
+			spkGenTimes)) {
+		if (spkGenNeurIds.size() != spkGenTimes.size()) {
+			KERNEL_ERROR("SpikeGenerator::nextSpikeTimes for group %s(%d) returned %lu neuron IDs but %lu spike times",
+				grp_Info2[grpId].Name.c_str(), grpId, spkGenNeurIds.size(), spkGenTimes.size());
+			exitSimulation(1);
+		}
+
+		for (unsigned int k=0; k<spkGenNeurIds.size(); k++) {
+			int nid = spkGenNeurIds[k];
+			unsigned int nextSchedTime = spkGenTimes[k];
+			if (nid<0 || nid>=numN) {
+				KERNEL_ERROR("SpikeGenerator::nextSpikeTimes for group %s(%d) returned invalid neuron ID %d",
+					grp_Info2[grpId].Name.c_str(), grpId, nid);
+				exitSimulation(1);
+			}
+
+			// same rules as for the per-neuron callback below
+			if ((nextSchedTime==0 || nextSchedTime>spkGenLastTimes[nid]) && (nextSchedTime<endOfTimeWindow)
+				&& (nextSchedTime>=currTime)) {
+				spkGenLastTimes[nid] = nextSchedTime;
+				pbuf->scheduleSpikeTargetGroup(grp_Info[grpId].StartN + nid, nextSchedTime - currTime);
+				spikeCnt++;
+
+				// update number of spikes if SpikeCounter set
+				if (grp_Info[grpId].withSpikeCounter) {
+					int bufPos = grp_Info[grpId].spkCntBufPos; // retrieve buf pos
+					spkCntBuf[bufPos][nid]++;
+				}
+			}
+		}
+		return;
+	}
+
+	for(int i = grp_Info[grpId].StartN; i <= grp_Info[grpId].EndN; i++) {
+		unsigned int nextTime = spkGenLastTimes[i - grp_Info[grpId].StartN];
 
 		done = false;
 		while (!done) {
@@ -3487,6 +4166,52 @@ void CpuSNN::generateSpikesFromFuncPtr(int grpId) {
 	}
 }
 
+void CpuSNN::generateSpikesFromRateBernoulli(int grpId) {
+	PoissonRate* rate = grp_Info[grpId].RatePtr;
+	int refPeriod = grp_Info[grpId].RefractPeriod;
+	int startN = grp_Info[grpId].StartN;
+
+	if (rate == NULL)
+		return;
+
+	if (rate->isOnGPU()) {
+		KERNEL_ERROR("Specifying rates on the GPU but using the CPU SNN is not supported.");
+		exitSimulation(1);
+	}
+
+	const int nNeur = rate->getNumNeurons();
+	if (nNeur != grp_Info[grpId].SizeN) {
+		KERNEL_ERROR("Length of PoissonRate array (%d) did not match number of neurons (%d) for group %d(%s).",
+			nNeur, grp_Info[grpId].SizeN, grpId, getGroupName(grpId).c_str());
+		exitSimulation(1);
+	}
+
+	// one Bernoulli trial per neuron: fire with probability rate/1000 in this millisecond
+	generatePoissonRandNums(nNeur);
+	const float* frate = rate->getRatePtrCPU();
+	const uint32_t* randNum = &poissonRandBuf[0];
+	const float randScale = 1.0f/4294967296.0f; // maps the random numbers to [0,1)
+	for (int neurId=0; neurId<nNeur; neurId++) {
+		if (randNum[neurId]*randScale >= frate[neurId]/1000.0f)
+			continue;
+
+		// honor the refractory period
+		unsigned int lastTime = lastSpikeTime[startN + neurId];
+		if (lastTime != MAX_SIMULATION_TIME && simTime - lastTime < (unsigned int)refPeriod)
+			continue;
+
+		addSpikeToTable(startN + neurId, grpId);
+		spikeCountAll1secHost++;
+		nPoissonSpikes++;
+
+		// update number of spikes if SpikeCounter set
+		if (grp_Info[grpId].withSpikeCounter) {
+			int bufPos = grp_Info[grpId].spkCntBufPos; // retrieve buf pos
+			spkCntBuf[bufPos][neurId]++;
+		}
+	}
+}
+
 void CpuSNN::generateSpikesFromRate(int grpId) {
 	bool done;
 	PoissonRate* rate = grp_Info[grpId].RatePtr;
@@ -3510,6 +4235,12 @@ void CpuSNN::generateSpikesFromRate(int grpId) {
 		exitSimulation(1);
 	}
 
+	// spikes must not be scheduled beyond the end of the active PoissonRateSchedule segment, because the rates
+	// change from then on (updateSpikeGenerators will schedule the next segment when it starts)
+	unsigned int endOfTimeWindow = currTime + timeSlice;
+	if (grp_Info[grpId].RateSchedule != NULL && grp_Info[grpId].RateScheduleNextMs < endOfTimeWindow)
+		endOfTimeWindow = grp_Info[grpId].RateScheduleNextMs;
+
 	for (int neurId=0; neurId<nNeur; neurId++) {
 		float frate = rate->getRate(neurId);
 
@@ -3522,7 +4253,7 @@ void CpuSNN::generateSpikesFromRate(int grpId) {
 		while (!done && frate>0) {
 			nextTime = poissonSpike(nextTime, frate/1000.0, refPeriod);
 			// found a valid timeSlice
-			if (nextTime < (currTime+timeSlice)) {
+			if (nextTime < endOfTimeWindow) {
 				if (nextTime >= currTime) {
 //					int nid = grp_Info[grpId].StartN+cnt;
 					pbuf->scheduleSpikeTargetGroup(grp_Info[grpId].StartN + neurId, nextTime-currTime);
@@ -3550,6 +4281,29 @@ inline int CpuSNN::getPoissNeuronPos(int nid) {
 	return nPos;
 }
 
+// returns the wtChange increment of an exponential STDP curve at spike-time difference tDiff
+// NOTE: these are the expressions findFiring and generatePostSpike used to evaluate per pairing; keep them
+// bit-for-bit identical so that the lookup tables reproduce the exact same weight changes
+double CpuSNN::getSTDPCurveValue(int grpId, bool isExc, bool isLTP, int tDiff) {
+	if (isExc) {
+		if (isLTP) {
+			if (grp_Info[grpId].WithESTDPcurve == TIMING_BASED_CURVE) {
+				if (tDiff <= grp_Info[grpId].GAMMA)
+					return grp_Info[grpId].OMEGA + grp_Info[grpId].KAPPA * STDP(tDiff, grp_Info[grpId].ALPHA_PLUS_EXC, grp_Info[grpId].TAU_PLUS_INV_EXC);
+				else // tDiff > GAMMA
+					return -STDP(tDiff, grp_Info[grpId].ALPHA_PLUS_EXC, grp_Info[grpId].TAU_PLUS_INV_EXC);
+			}
+			return STDP(tDiff, grp_Info[grpId].ALPHA_PLUS_EXC, grp_Info[grpId].TAU_PLUS_INV_EXC);
+		}
+		return STDP(tDiff, grp_Info[grpId].ALPHA_MINUS_EXC, grp_Info[grpId].TAU_MINUS_INV_EXC);
+	}
+
+	// I-STDP exp curve decreases the weight for both LTP and LTD (inhibitory weights are negative)
+	if (isLTP)
+		return -STDP(tDiff, grp_Info[grpId].ALPHA_PLUS_INB, grp_Info[grpId].TAU_PLUS_INV_INB);
+	return -STDP(tDiff, grp_Info[grpId].ALPHA_MINUS_INB, grp_Info[grpId].TAU_MINUS_INV_INB);
+}
+
 //We need pass the neuron id (nid) and the grpId just for the case when we want to
 //ramp up/down the weights.  In that case we need to set the weights of each synapse
 //depending on their nid (their position with respect to one another). -- KDC
@@ -3625,7 +4379,7 @@ void  CpuSNN::globalStateUpdate() {
 			}
 
 			// update group dopamine
-			cpuNetPtrs.grpDABuffer[g][simTimeMs] = cpuNetPtrs.grpDA[g];
+			cpuNetPtrs.grpDABuffer[g][simTimeEpochMs] = cpuNetPtrs.grpDA[g];
 
 			for (int i=grp_Info[g].StartN; i<=grp_Info[g].EndN; i++) {
 				// pre-load izhikevich variables to avoid unnecessary memory accesses + unclutter the code.
@@ -3794,11 +4548,55 @@ void CpuSNN::initSynapticWeights() {
 	// Initialize the network wtChange, wt, synaptic firing time
 	wtChange         = new float[preSynCnt];
 	synSpikeTime     = new uint32_t[preSynCnt];
+	wtChangeDirty    = new bool[numNReg];
 	cpuSnnSz.synapticInfoSize = sizeof(float)*(preSynCnt*2);
 
+	if (sim_with_elig_trace) {
+		eligTrace     = new float[preSynCnt];
+		eligTraceTime = new uint32_t[preSynCnt];
+		cpuSnnSz.synapticInfoSize += (sizeof(float)+sizeof(uint32_t))*preSynCnt;
+
+		for (int g=0; g<numGrp; g++) {
+			if (!grp_Info2[g].withEligTrace)
+				continue;
+
+			// The running sum eligDAIntegral weighs the DA concentration with decayElig^k, which gets divided out again
+			// in syncEligibilityTrace. Limit the epoch to decayElig^len >= 1e-6 so that the difference of two sums
+			// does not lose more than 6 of the ~16 significant digits of a double.
+			double decayElig = exp(-1.0/grp_Info2[g].tauElig);
+			int maxLen = (int)(grp_Info2[g].tauElig*log(1e6));
+			grp_Info2[g].eligEpochLen = (std::max)(1, (std::min)(wtANDwtChangeUpdateInterval_, maxLen));
+			grp_Info2[g].eligEpochStart = simTime;
+			grp_Info2[g].eligDAIntegral.assign(grp_Info2[g].eligEpochLen+1, 0.0);
+			grp_Info2[g].eligDecayPow.resize(grp_Info2[g].eligEpochLen+1);
+			grp_Info2[g].eligDecayPow[0] = 1.0;
+			for (int k=1; k<=grp_Info2[g].eligEpochLen; k++)
+				grp_Info2[g].eligDecayPow[k] = grp_Info2[g].eligDecayPow[k-1]*decayElig;
+		}
+	}
+
 	resetSynapticConnections(false);
 }
 
+void CpuSNN::integrateEligibilityTraces() {
+	for (int g=0; g<numGrp; g++) {
+		if (!grp_Info2[g].withEligTrace)
+			continue;
+
+		group_info2_t* gInfo = &grp_Info2[g];
+		int k = simTime - gInfo->eligEpochStart;
+		assert(k>=0 && k<gInfo->eligEpochLen);
+
+		// no weight change accumulates while in testing mode, but the traces keep decaying
+		double DA = sim_in_testing ? 0.0 : cpuNetPtrs.grpDA[g];
+		gInfo->eligDAIntegral[k+1] = gInfo->eligDAIntegral[k] + gInfo->eligDecayPow[k]*DA;
+
+		// epoch is full: sync all traces and start over
+		if (k+1 == gInfo->eligEpochLen)
+			flushEligibilityTraces(g);
+	}
+}
+
 // checks whether a connection ID contains plastic synapses O(#connections)
 bool CpuSNN::isConnectionPlastic(short int connId) {
 	assert(connId!=ALL);
@@ -3878,6 +4676,19 @@ void CpuSNN::verifySTDP() {
 				exitSimulation(1);
 			}
 		}
+
+		if (grp_Info2[grpId].withEligTrace) {
+			if (grp_Info[grpId].WithESTDPtype!=DA_MOD && grp_Info[grpId].WithISTDPtype!=DA_MOD) {
+				KERNEL_ERROR("Eligibility traces on group %d (%s) require DA-modulated STDP (DA_MOD).",
+					grpId, grp_Info2[grpId].Name.c_str());
+				exitSimulation(1);
+			}
+			if (simMode_==GPU_MODE) {
+				KERNEL_ERROR("Eligibility traces (group %d, %s) are only supported in CPU_MODE.",
+					grpId, grp_Info2[grpId].Name.c_str());
+				exitSimulation(1);
+			}
+		}
 	}
 }
 
@@ -4060,6 +4871,24 @@ void CpuSNN::makePtrInfo() {
 	cpuNetPtrs.stpx				= stpx;
 }
 
+void CpuSNN::generatePoissonRandNums(int n) {
+	int nRounded = (n + POISSON_RNG_LANES - 1) / POISSON_RNG_LANES * POISSON_RNG_LANES;
+	if (poissonRandBuf.size() < (size_t)nRounded)
+		poissonRandBuf.resize(nRounded);
+
+	uint32_t* buf = &poissonRandBuf[0];
+	for (int k=0; k<nRounded; k+=POISSON_RNG_LANES) {
+		for (int l=0; l<POISSON_RNG_LANES; l++) {
+			uint32_t t = poissonRngX[l] ^ (poissonRngX[l] << 11);
+			poissonRngX[l] = poissonRngY[l];
+			poissonRngY[l] = poissonRngZ[l];
+			poissonRngZ[l] = poissonRngW[l];
+			poissonRngW[l] = poissonRngW[l] ^ (poissonRngW[l] >> 19) ^ t ^ (t >> 8);
+			buf[k+l] = poissonRngW[l];
+		}
+	}
+}
+
 // will be used in generateSpikesFromRate
 // The time between each pair of consecutive events has an exponential distribution with parameter \lambda and
 // each of these ISI values is assumed to be independent of other ISI values.
@@ -4322,53 +5151,81 @@ int CpuSNN::loadSimulation_internal(bool onlyPlastic) {
 // and generation of spike at the post-synaptic side.
 // We also create the delay_info array has the delay_start and delay_length parameter
 void CpuSNN::reorganizeDelay() {
-	int tdMax = maxDelay_ > 1 ? maxDelay_ : 1;
-	for (int grpId=0; grpId < numGrp; grpId++) {
-		for (int nid=grp_Info[grpId].StartN; nid <= grp_Info[grpId].EndN; nid++) {
-			unsigned int jPos=0;					// this points to the top of the delay queue
-			unsigned int cumN=cumulativePost[nid];	// cumulativePost[] is unsigned int
-			unsigned int cumDelayStart=0; 			// Npost[] is unsigned short
-
-			// in a network without connections, where maxDelay_==0, we still need to enter the loop in order
-			// to set the appropriate postDelayInfo entries to zero
-			// otherwise the simulation might segfault because delay_length and delay_index_start are not
-			// correctly initialized
-			for (int td = 0; td < tdMax; td++) {
-				unsigned int j=jPos;				// start searching from top of the queue until the end
-				unsigned int cnt=0;					// store the number of nodes with a delay of td;
-				while (j < Npost[nid]) {
-					// found a node j with delay=td and we put
-					// the delay value = 1 at array location td=0;
-					if (td == (tmp_SynapticDelay[cumN+j]-1)) {
-						assert(jPos<Npost[nid]);
-						swapConnections(nid, j, jPos);
-
-						jPos++;
-						cnt++;
-					}
-					j++;
-				}
+	// only delays that are actually used by a neuron get a run in postDelayInfo, so count them first
+	bool* hasDelay = new bool[MAX_SynapticDelay+1];
+	numDelayRuns = 0;
+	for (int nid=0; nid<numN; nid++) {
+		memset(hasDelay, 0, sizeof(bool)*(MAX_SynapticDelay+1));
+		unsigned int cumN=cumulativePost[nid];
+		for (unsigned int j=0; j<Npost[nid]; j++) {
+			if (!hasDelay[tmp_SynapticDelay[cumN+j]]) {
+				hasDelay[tmp_SynapticDelay[cumN+j]] = true;
+				numDelayRuns++;
+			}
+		}
+	}
+
+	assert(postDelayInfo==NULL);
+	postDelayInfo = new delay_info_t[numDelayRuns];
+	cpuSnnSz.networkInfoSize += sizeof(delay_info_t)*numDelayRuns;
+
+	// neuron ids are not ordered by group, but the runs of neuron nid must end where the ones of nid+1 start
+	unsigned int runIdx = 0;
+	for (int nid=0; nid < numN; nid++) {
+		unsigned int jPos=0;					// this points to the top of the delay queue
+		unsigned int cumN=cumulativePost[nid];	// cumulativePost[] is unsigned int
+		unsigned int cumDelayStart=0; 			// Npost[] is unsigned short
+
+		// find the delays used by this neuron. other delays would result in empty runs, so we skip them
+		memset(hasDelay, 0, sizeof(bool)*(MAX_SynapticDelay+1));
+		for (unsigned int j=0; j < Npost[nid]; j++)
+			hasDelay[tmp_SynapticDelay[cumN+j]] = true;
+
+		cumulativeDelayRuns[nid] = runIdx;
+		for (int delay=1; delay<=MAX_SynapticDelay; delay++) {
+			if (!hasDelay[delay])
+				continue;
 
-				// update the delay_length and start values...
-				postDelayInfo[nid*(maxDelay_+1)+td].delay_length	     = cnt;
-				postDelayInfo[nid*(maxDelay_+1)+td].delay_index_start  = cumDelayStart;
-				cumDelayStart += cnt;
+			unsigned int j=jPos;				// start searching from top of the queue until the end
+			unsigned int cnt=0;					// store the number of nodes with this delay
+			while (j < Npost[nid]) {
+				// found a node j with the current delay and we put it to the top of the queue
+				if (delay == tmp_SynapticDelay[cumN+j]) {
+					assert(jPos<Npost[nid]);
+					swapConnections(nid, j, jPos);
 
-				assert(cumDelayStart <= Npost[nid]);
+					jPos++;
+					cnt++;
+				}
+				j++;
 			}
 
-			// total cumulative delay should be equal to number of post-synaptic connections at the end of the loop
-			assert(cumDelayStart == Npost[nid]);
-			for (unsigned int j=1; j < Npost[nid]; j++) {
-				unsigned int cumN=cumulativePost[nid]; // cumulativePost[] is unsigned int
-				if (tmp_SynapticDelay[cumN+j] < tmp_SynapticDelay[cumN+j-1]) {
+			// update the delay_length and start values...
+			assert(runIdx < numDelayRuns);
+			postDelayInfo[runIdx].delay_length	     = cnt;
+			postDelayInfo[runIdx].delay_index_start  = cumDelayStart;
+			postDelayInfo[runIdx].delay              = delay;
+			runIdx++;
+			cumDelayStart += cnt;
+
+			assert(cumDelayStart <= Npost[nid]);
+		}
+		cumulativeDelayRuns[nid+1] = runIdx;
+
+		// total cumulative delay should be equal to number of post-synaptic connections at the end of the loop
+		assert(cumDelayStart == Npost[nid]);
+		for (unsigned int j=1; j < Npost[nid]; j++) {
+			unsigned int cumN=cumulativePost[nid]; // cumulativePost[] is unsigned int
+			if (tmp_SynapticDelay[cumN+j] < tmp_SynapticDelay[cumN+j-1]) {
 	  				KERNEL_ERROR("Post-synaptic delays not sorted correctly... id=%d, delay[%d]=%d, delay[%d]=%d",
-						nid, j, tmp_SynapticDelay[cumN+j], j-1, tmp_SynapticDelay[cumN+j-1]);
-					assert( tmp_SynapticDelay[cumN+j] >= tmp_SynapticDelay[cumN+j-1]);
-				}
+					nid, j, tmp_SynapticDelay[cumN+j], j-1, tmp_SynapticDelay[cumN+j-1]);
+				assert( tmp_SynapticDelay[cumN+j] >= tmp_SynapticDelay[cumN+j-1]);
 			}
 		}
 	}
+	assert(runIdx == numDelayRuns);
+
+	delete[] hasDelay;
 }
 
 // after all the initalization. Its time to create the synaptic weights, weight change and also
@@ -4469,6 +5326,7 @@ void CpuSNN::resetFiringInformation() {
 
 	// reset various times...
 	simTimeMs  = 0;
+	simTimeEpochMs = 0;
 	simTimeSec = 0;
 	simTime    = 0;
 
@@ -4476,6 +5334,10 @@ void CpuSNN::resetFiringInformation() {
 	resetPropogationBuffer();
 	// reset Timing  Table..
 	resetTimingTable();
+
+	// drop all spikes that are still scheduled for delivery
+	for (unsigned int i=0; i<spikeWheel.size(); i++)
+		spikeWheel[i].clear();
 }
 
 #ifndef __NO_CUDA__
@@ -4559,11 +5421,13 @@ void CpuSNN::resetNeuron(unsigned int neurId, int grpId) {
 	lastSpikeTime[neurId]  = MAX_SIMULATION_TIME;
 
 	if(grp_Info[grpId].WithSTP) {
-		for (int j=0; j<=maxDelay_; j++) { // is of size maxDelay_+1
-			int ind = STP_BUF_POS(neurId,j);
+		int stpId = STP_NEUR_ID(neurId, grpId);
+		for (int j=0; j<stpBufLen_; j++) { // is of size stpBufLen_ >= maxDelay_+1
+			int ind = STP_BUF_POS(stpId,j);
 			stpu[ind] = 0.0f;
 			stpx[ind] = 1.0f;
 		}
+		stpLastSpikeTime[stpId] = 0;
 	}
 }
 
@@ -4702,7 +5566,8 @@ void CpuSNN::resetPointers(bool deallocate) {
 
 	if (stpu!=NULL && deallocate) delete[] stpu;
 	if (stpx!=NULL && deallocate) delete[] stpx;
-	stpu=NULL; stpx=NULL;
+	if (stpLastSpikeTime!=NULL && deallocate) delete[] stpLastSpikeTime;
+	stpu=NULL; stpx=NULL; stpLastSpikeTime=NULL;
 
 	if (avgFiring!=NULL && deallocate) delete[] avgFiring;
 	if (baseFiring!=NULL && deallocate) delete[] baseFiring;
@@ -4714,14 +5579,21 @@ void CpuSNN::resetPointers(bool deallocate) {
 	lastSpikeTime=NULL; synSpikeTime=NULL; nSpikeCnt=NULL;
 
 	if (postDelayInfo!=NULL && deallocate) delete[] postDelayInfo;
+	if (cumulativeDelayRuns!=NULL && deallocate) delete[] cumulativeDelayRuns;
 	if (preSynapticIds!=NULL && deallocate) delete[] preSynapticIds;
 	if (postSynapticIds!=NULL && deallocate) delete[] postSynapticIds;
-	postDelayInfo=NULL; preSynapticIds=NULL; postSynapticIds=NULL;
+	postDelayInfo=NULL; cumulativeDelayRuns=NULL; preSynapticIds=NULL; postSynapticIds=NULL;
 
 	if (wt!=NULL && deallocate) delete[] wt;
 	if (maxSynWt!=NULL && deallocate) delete[] maxSynWt;
 	if (wtChange !=NULL && deallocate) delete[] wtChange;
-	wt=NULL; maxSynWt=NULL; wtChange=NULL;
+	if (wtChangeDirty!=NULL && deallocate) delete[] wtChangeDirty;
+	wt=NULL; maxSynWt=NULL; wtChange=NULL; wtChangeDirty=NULL;
+	wtChangeDirtyList.clear();
+
+	if (eligTrace!=NULL && deallocate) delete[] eligTrace;
+	if (eligTraceTime!=NULL && deallocate) delete[] eligTraceTime;
+	eligTrace=NULL; eligTraceTime=NULL;
 
 	if (mulSynFast!=NULL && deallocate) delete[] mulSynFast;
 	if (mulSynSlow!=NULL && deallocate) delete[] mulSynSlow;
@@ -4752,11 +5624,13 @@ void CpuSNN::resetPoissonNeuron(unsigned int nid, int grpId) {
 		avgFiring[nid]      = 0.0;
 
 	if(grp_Info[grpId].WithSTP) {
-		for (int j=0; j<=maxDelay_; j++) { // is of size maxDelay_+1
-			int ind = STP_BUF_POS(nid,j);
+		int stpId = STP_NEUR_ID(nid, grpId);
+		for (int j=0; j<stpBufLen_; j++) { // is of size stpBufLen_ >= maxDelay_+1
+			int ind = STP_BUF_POS(stpId,j);
 			stpu[ind] = 0.0f;
 			stpx[ind] = 1.0f;
 		}
+		stpLastSpikeTime[stpId] = 0;
 	}
 }
 
@@ -4793,6 +5667,15 @@ void CpuSNN::resetSpikeCnt(int grpId) {
 //are but we should be able to change them to plastic or fixed synapses. -- KDC
 void CpuSNN::resetSynapticConnections(bool changeWeights) {
 	int j;
+	// no pending weight changes, but the (new) weights are clamped once in the next updateWeights
+	wtChangeDirtyList.clear();
+	memset(wtChangeDirty, 0, sizeof(bool)*numNReg);
+	wtChangeDirtyAll = true;
+	if (sim_with_elig_trace) {
+		memset(eligTrace, 0, sizeof(float)*preSynCnt);
+		memset(eligTraceTime, 0, sizeof(uint32_t)*preSynCnt);
+	}
+
 	// Reset wt,wtChange,pre-firingtime values to default values...
 	for(int destGrp=0; destGrp < numGrp; destGrp++) {
 		const char* updateStr = (grp_Info[destGrp].newUpdates == true)?"(**)":"";
@@ -4863,9 +5746,20 @@ void CpuSNN::resetSynapticConnections(bool changeWeights) {
 	}
 }
 
+void CpuSNN::scheduleSpikeDelivery(int nid) {
+	// a spike fired at simTime reaches the synapses of a run at simTime+delay, which is handled in
+	// doD2CurrentUpdate at simTime+delay-1 (same as tD=delay-1 in generatePostSpike)
+	for (unsigned int r=cumulativeDelayRuns[nid]; r<cumulativeDelayRuns[nid+1]; r++) {
+		delayed_spike_t spk;
+		spk.nid = nid;
+		spk.runIdx = r;
+		spikeWheel[(simTime+postDelayInfo[r].delay-1) & (spikeWheel.size()-1)].push_back(spk);
+	}
+}
+
 void CpuSNN::resetTimingTable() {
-		memset(timeTableD2, 0, sizeof(int) * (1000 + maxDelay_ + 1));
-		memset(timeTableD1, 0, sizeof(int) * (1000 + maxDelay_ + 1));
+		memset(timeTableD2, 0, sizeof(int) * (epochLengthMs_ + maxDelay_ + 1));
+		memset(timeTableD1, 0, sizeof(int) * (epochLengthMs_ + maxDelay_ + 1));
 }
 
 
@@ -5184,8 +6078,9 @@ void CpuSNN::updateGroupMonitor(int grpId) {
 		if (getSimTime() - lastUpdate <=0)
 			return;
 
-		if (getSimTime() - lastUpdate > 1000)
-			KERNEL_ERROR("updateGroupMonitor(grpId=%d) must be called at least once every second",grpId);
+		if (getSimTime() - lastUpdate > (unsigned int)epochLengthMs_)
+			KERNEL_ERROR("updateGroupMonitor(grpId=%d) must be called at least once every epoch (%d ms)",grpId,
+				epochLengthMs_);
 
 #ifndef __NO_CUDA__
 		if (simMode_ == GPU_MODE) {
@@ -5195,21 +6090,16 @@ void CpuSNN::updateGroupMonitor(int grpId) {
 #endif
 
 		// find the time interval in which to update group status
-		// usually, we call updateGroupMonitor once every second, so the time interval is [0,1000)
-		// however, updateGroupMonitor can be called at any time t \in [0,1000)... so we can have the cases
-		// [0,t), [t,1000), and even [t1, t2)
-		int numMsMin = lastUpdate%1000; // lower bound is given by last time we called update
-		int numMsMax = getSimTimeMs(); // upper bound is given by current time
-		if (numMsMax == 0)
-			numMsMax = 1000; // special case: full second
+		// usually, we call updateGroupMonitor once every epoch, so the time interval is [0,epochLengthMs_)
+		// however, updateGroupMonitor can be called at any time t \in [0,epochLengthMs_)... so we can have the cases
+		// [0,t), [t,epochLengthMs_), and even [t1, t2)
+		// the buffer holds the current epoch, except right after an epoch completed (!simTimeEpochMs): here we look
+		// one epoch back
+		int epochStartTime = getSimTime() - (simTimeEpochMs ? simTimeEpochMs : epochLengthMs_);
+		int numMsMin = std::max(lastUpdate - epochStartTime, 0); // lower bound is given by last time we called update
+		int numMsMax = getSimTime() - epochStartTime; // upper bound is given by current time
 		assert(numMsMin < numMsMax);
 
-		// current time is last completed second in milliseconds (plus t to be added below)
-		// special case is after each completed second where !getSimTimeMs(): here we look 1s back
-		int currentTimeSec = getSimTimeSec();
-		if (!getSimTimeMs())
-			currentTimeSec--;
-
 		// save current time as last update time
 		grpMonObj->setLastUpdated(getSimTime());
 
@@ -5225,8 +6115,8 @@ void CpuSNN::updateGroupMonitor(int grpId) {
 			// fetch group status data, support dopamine concentration currently
 			data = grpDABuffer[grpId][t];
 
-			// current time is last completed second plus whatever is leftover in t
-			int time = currentTimeSec*1000 + t;
+			// current time is start of the epoch plus whatever is leftover in t
+			int time = epochStartTime + t;
 
 			if (writeGroupToFile) {
 				// TODO: write to group status file
@@ -5274,18 +6164,87 @@ void CpuSNN::updateSpikesFromGrp(int grpId) {
 void CpuSNN::updateSpikeGenerators() {
 	for(int g=0; g<numGrp; g++) {
 		if (grp_Info[g].isSpikeGenerator) {
+			// Bernoulli Poisson groups draw their spikes every millisecond instead of once per time slice
+			// (in GPU mode, the GPU takes care of Poisson generators)
+			if (grp_Info[g].spikeGen == NULL && grp_Info[g].PoissonMode == POISSON_BERNOULLI) {
+				if (simMode_ == CPU_MODE)
+					generateSpikesFromRateBernoulli(g);
+				continue;
+			}
+
 			// This evaluation is done to check if its time to get new set of spikes..
 			// check whether simTime has advance more than the current time slice, in which case we need to schedule
 			// spikes for the next time slice
 			// we always have to run this the first millisecond of a new runNetwork call; that is,
 			// when simTime==simTimeRunStart
-			if(((simTime-grp_Info[g].SliceUpdateTime) >= (unsigned) grp_Info[g].CurrTimeSlice || simTime == simTimeRunStart)) {
+			// the same goes for the first millisecond of a new PoissonRateSchedule segment
+			if(((simTime-grp_Info[g].SliceUpdateTime) >= (unsigned) grp_Info[g].CurrTimeSlice || simTime == simTimeRunStart)
+				|| simTime == grp_Info[g].RateScheduleLastSwitch) {
 				updateSpikesFromGrp(g);
 			}
 		}
 	}
 }
 
+void CpuSNN::updateRateSchedules() {
+	for (int g=0; g<numGrp; g++) {
+		PoissonRateSchedule* schedule = grp_Info[g].RateSchedule;
+		if (schedule == NULL || simTime < grp_Info[g].RateScheduleNextMs)
+			continue;
+
+		// copy the rates of the now active segment, or stop firing once the schedule has run out
+		PoissonRate* rates = grp_Info[g].RateScheduleRates;
+		int segId = schedule->getSegmentId(simTime - grp_Info[g].RateScheduleStart);
+		if (segId < 0) {
+			memset(rates->getRatePtrCPU(), 0, sizeof(float)*grp_Info[g].SizeN);
+			grp_Info[g].RateScheduleNextMs = MAX_SIMULATION_TIME;
+		} else {
+			memcpy(rates->getRatePtrCPU(), schedule->getSegmentRatePtr(segId), sizeof(float)*grp_Info[g].SizeN);
+			grp_Info[g].RateScheduleNextMs = grp_Info[g].RateScheduleStart + schedule->getSegmentStartMs(segId)
+				+ schedule->getSegmentDurationMs(segId);
+		}
+		grp_Info[g].RateScheduleLastSwitch = simTime;
+		spikeRateUpdated = true;
+	}
+}
+
+void CpuSNN::updateCurrentSchedules() {
+	for (int g=0; g<numGrp; g++) {
+		CurrentSchedule* schedule = grp_Info[g].CurrSchedule;
+		if (schedule == NULL)
+			continue;
+
+		// only the entries that are due are visited, so the cost is proportional to the number of changes
+		int timeMs = simTime - grp_Info[g].CurrScheduleStart;
+		int numEntries = schedule->getNumEntries();
+		int entryId = grp_Info[g].CurrScheduleNextEntry;
+		if (entryId >= numEntries || schedule->getEntryTimeMs(entryId) > timeMs)
+			continue;
+
+		for (; entryId<numEntries && schedule->getEntryTimeMs(entryId)<=timeMs; entryId++) {
+			int neurId = schedule->getEntryNeurId(entryId);
+			float current = schedule->getEntryCurrent(entryId);
+			if (neurId == ALL) {
+				for (int i=grp_Info[g].StartN; i<=grp_Info[g].EndN; i++)
+					extCurrent[i] = current;
+			} else {
+				extCurrent[grp_Info[g].StartN + neurId] = current;
+			}
+		}
+		grp_Info[g].CurrScheduleNextEntry = entryId;
+
+#ifndef __NO_CUDA__
+		if (simMode_==GPU_MODE) {
+			copyExternalCurrent(&cpu_gpuNetPtrs, &cpuNetPtrs, false, g);
+		}
+#endif
+
+		// once all entries have been applied, the last currents are held and the schedule is no longer needed
+		if (entryId >= numEntries)
+			grp_Info[g].CurrSchedule = NULL;
+	}
+}
+
 void CpuSNN::updateSpikeGeneratorsInit() {
 	unsigned int cnt=0;
 	for(int g=0; (g < numGrp); g++) {
@@ -5340,11 +6299,17 @@ int CpuSNN::updateSpikeTables() {
 		newInfo = newInfo->next;
 	}
 
+	// the GPU tables are fixed in size and must hold the worst case. The CPU tables start small and grow in
+	// addSpikeToTable as needed
 	for(int g = 0; g < numGrp; g++) {
+		int rate = grp_Info[g].MaxFiringRate;
+		if (simMode_ == CPU_MODE)
+			rate = std::min(rate, FIRING_TABLE_INIT_RATE);
+
 		if (grp_Info[g].MaxDelay == 1)
-			maxSpikesD1 += (grp_Info[g].SizeN * grp_Info[g].MaxFiringRate);
+			maxSpikesD1 += (grp_Info[g].SizeN * rate);
 		else
-			maxSpikesD2 += (grp_Info[g].SizeN * grp_Info[g].MaxFiringRate);
+			maxSpikesD2 += (grp_Info[g].SizeN * rate);
 	}
 
 	if ((maxSpikesD1 + maxSpikesD2) < (unsigned int) (numNExcReg + numNInhReg + numNPois)
@@ -5355,22 +6320,25 @@ int CpuSNN::updateSpikeTables() {
 
 	firingTableD2 = new unsigned int[maxSpikesD2];
 	firingTableD1 = new unsigned int[maxSpikesD1];
-	cpuSnnSz.spikingInfoSize += sizeof(int) * ((maxSpikesD2 + maxSpikesD1) + 2* (1000 + maxDelay_ + 1));
+	cpuSnnSz.spikingInfoSize += sizeof(int) * ((maxSpikesD2 + maxSpikesD1) + 2* (epochLengthMs_ + maxDelay_ + 1));
 
 	return curD;
 }
 
-// This function is called every second by simulator...
+// This function is called at the end of every epoch by simulator...
 // This function updates the firingTable by removing older firing values...
 void CpuSNN::updateFiringTable() {
-	// Read the neuron ids that fired in the last maxDelay_ seconds
+	// Read the neuron ids that fired in the last maxDelay_ ms
 	// and put it to the beginning of the firing table...
-	for(unsigned int p=timeTableD2[999],k=0;p<timeTableD2[999+maxDelay_+1];p++,k++) {
+	// timeTableD2[epochLengthMs_] marks the first spike of the last maxDelay_ ms, which is where the shifted time
+	// table below starts counting from (an epoch shorter than maxDelay_ overwrites that entry while shifting)
+	unsigned int firstCarriedSpike = timeTableD2[epochLengthMs_];
+	for(unsigned int p=firstCarriedSpike,k=0;p<timeTableD2[epochLengthMs_+maxDelay_];p++,k++) {
 		firingTableD2[k]=firingTableD2[p];
 	}
 
 	for(int i=0; i < maxDelay_; i++) {
-		timeTableD2[i+1] = timeTableD2[1000+i+1]-timeTableD2[1000];
+		timeTableD2[i+1] = timeTableD2[epochLengthMs_+i+1]-firstCarriedSpike;
 	}
 
 	timeTableD1[maxDelay_] = 0;
@@ -5390,16 +6358,20 @@ void CpuSNN::updateFiringTable() {
 	}
 }
 
-// updates simTime, returns true when new second started
+// updates simTime, returns true when new epoch started
 bool CpuSNN::updateTime() {
-	bool finishedOneSec = false;
+	bool finishedEpoch = false;
 
-	// done one second worth of simulation
-	// update relevant parameters...now
 	if(++simTimeMs == 1000) {
 		simTimeMs = 0;
 		simTimeSec++;
-		finishedOneSec = true;
+	}
+
+	// done one epoch worth of simulation
+	// update relevant parameters...now
+	if(++simTimeEpochMs == (unsigned int)epochLengthMs_) {
+		simTimeEpochMs = 0;
+		finishedEpoch = true;
 	}
 
 	simTime++;
@@ -5408,7 +6380,7 @@ bool CpuSNN::updateTime() {
         KERNEL_WARN("Maximum Simulation Time Reached...Resetting simulation time");
 	}
 
-	return finishedOneSec;
+	return finishedEpoch;
 }
 
 
@@ -5417,113 +6389,122 @@ void CpuSNN::updateSpikeMonitor(int grpId) {
 	if (!numSpikeMonitor)
 		return;
 
-	if (grpId==ALL) {
-		for (int g=0; g<numGrp; g++)
-			updateSpikeMonitor(g);
-	} else {
-		// update spike monitor of a specific group
-
-		// find index in spike monitor arrays
-		int monitorId = grp_Info[grpId].SpikeMonitorId;
-
-		// don't continue if no spike monitor enabled for this group
-		if (monitorId<0)
-			return;
+	// The firing tables are scanned only once, no matter how many groups are monitored: Every spike is routed to the
+	// monitor of its group (if any). Since every monitor remembers when it was last updated, each of them has its
+	// own time window [numMsMin,numMsMax), which all end at the current time.
+	bool isMonActive[MAX_GRP_PER_SNN];
+	int monNumMsMin[MAX_GRP_PER_SNN];
+	FILE* monFileId[MAX_GRP_PER_SNN];
+	bool monWriteToArray[MAX_GRP_PER_SNN];
+
+	// the firing tables hold the current epoch, except right after an epoch completed (!simTimeEpochMs): here we
+	// look one epoch back
+	int64_t epochStartTime = (int64_t)getSimTime() - (simTimeEpochMs ? simTimeEpochMs : epochLengthMs_);
+	int numMsMax = (int)((int64_t)getSimTime() - epochStartTime); // upper bound is given by current time
+	int numMsMinAll = numMsMax; // lower bound of the time window over all active monitors
+	int numActive = 0;
+
+	for (unsigned int monitorId=0; monitorId<numSpikeMonitor; monitorId++) {
+		isMonActive[monitorId] = false;
+
+		// find the group of this monitor
+		SpikeMonitorCore* spkMonObj = spikeMonCoreList[monitorId];
+		int g = spkMonObj->getGrpId();
+		if (grpId!=ALL && g!=grpId)
+			continue;
 
 		// find last update time for this group
-		SpikeMonitorCore* spkMonObj = spikeMonCoreList[monitorId];
 		int64_t lastUpdate = spkMonObj->getLastUpdated();
 
 		// don't continue if time interval is zero (nothing to update)
 		if ( ((int64_t)getSimTime()) - lastUpdate <=0)
-			return;
+			continue;
 
-		if ( ((int64_t)getSimTime()) - lastUpdate > 1000)
-			KERNEL_ERROR("updateSpikeMonitor(grpId=%d) must be called at least once every second",grpId);
+		if ( ((int64_t)getSimTime()) - lastUpdate > epochLengthMs_)
+			KERNEL_ERROR("updateSpikeMonitor(grpId=%d) must be called at least once every epoch (%d ms)",g,
+				epochLengthMs_);
 
         // AER buffer max size warning here.
         // Because of C++ short-circuit evaluation, the last condition should not be evaluated
         // if the previous conditions are false.
         if (spkMonObj->getAccumTime() > LONG_SPIKE_MON_DURATION \
-                && this->getGroupNumNeurons(grpId) > LARGE_SPIKE_MON_GRP_SIZE \
+                && this->getGroupNumNeurons(g) > LARGE_SPIKE_MON_GRP_SIZE \
                 && spkMonObj->isBufferBig()){
             // change this warning message to correct message
-            KERNEL_WARN("updateSpikeMonitor(grpId=%d) is becoming very large. (>%ld MB)",grpId,(int64_t) MAX_SPIKE_MON_BUFFER_SIZE/1024 );// make this better
-            KERNEL_WARN("Reduce the cumulative recording time (currently %lu minutes) or the group size (currently %d) to avoid this.",spkMonObj->getAccumTime()/(1000*60),this->getGroupNumNeurons(grpId));
+            KERNEL_WARN("updateSpikeMonitor(grpId=%d) is becoming very large. (>%ld MB)",g,(int64_t) MAX_SPIKE_MON_BUFFER_SIZE/1024 );// make this better
+            KERNEL_WARN("Reduce the cumulative recording time (currently %lu minutes) or the group size (currently %d) to avoid this.",spkMonObj->getAccumTime()/(1000*60),this->getGroupNumNeurons(g));
 		}
-#ifndef __NO_CUDA__
-		if (simMode_ == GPU_MODE) {
-			// copy the neuron firing information from the GPU to the CPU..
-			copyFiringInfo_GPU();
-		}
-#endif
 
 		// find the time interval in which to update spikes
-		// usually, we call updateSpikeMonitor once every second, so the time interval is [0,1000)
-		// however, updateSpikeMonitor can be called at any time t \in [0,1000)... so we can have the cases
-		// [0,t), [t,1000), and even [t1, t2)
-		int numMsMin = lastUpdate%1000; // lower bound is given by last time we called update
-		int numMsMax = getSimTimeMs(); // upper bound is given by current time
-		if (numMsMax==0)
-			numMsMax = 1000; // special case: full second
-		assert(numMsMin<numMsMax);
-
-		// current time is last completed second in milliseconds (plus t to be added below)
-		// special case is after each completed second where !getSimTimeMs(): here we look 1s back
-		int currentTimeSec = getSimTimeSec();
-		if (!getSimTimeMs())
-			currentTimeSec--;
+		// usually, we call updateSpikeMonitor once every epoch, so the time interval is [0,epochLengthMs_)
+		// however, updateSpikeMonitor can be called at any time t \in [0,epochLengthMs_)... so we can have the cases
+		// [0,t), [t,epochLengthMs_), and even [t1, t2)
+		monNumMsMin[monitorId] = (int)std::max(lastUpdate - epochStartTime, (int64_t)0);
+		assert(monNumMsMin[monitorId]<numMsMax);
+		numMsMinAll = std::min(numMsMinAll, monNumMsMin[monitorId]);
 
 		// save current time as last update time
 		spkMonObj->setLastUpdated( (int64_t)getSimTime() );
 
 		// prepare fast access
-		FILE* spkFileId = spikeMonCoreList[monitorId]->getSpikeFileId();
-		bool writeSpikesToFile = spkFileId!=NULL;
-		bool writeSpikesToArray = spkMonObj->getMode()==AER && spkMonObj->isRecording();
-
-		// Read one spike at a time from the buffer and put the spikes to an appopriate monitor buffer. Later the user
-		// may need need to dump these spikes to an output file
-		for (int k=0; k < 2; k++) {
-			unsigned int* timeTablePtr = (k==0)?timeTableD2:timeTableD1;
-			unsigned int* fireTablePtr = (k==0)?firingTableD2:firingTableD1;
-			for(int t=numMsMin; t<numMsMax; t++) {
-				for(unsigned int i=timeTablePtr[t+maxDelay_]; i<timeTablePtr[t+maxDelay_+1];i++) {
-					// retrieve the neuron id
-					int nid   = fireTablePtr[i];
-					if (simMode_ == GPU_MODE)
-						nid = GET_FIRING_TABLE_NID(nid);
-					assert(nid < numN);
-
-					// make sure neuron belongs to currently relevant group
-					int this_grpId = grpIds[nid];
-					if (this_grpId != grpId)
-						continue;
+		monFileId[monitorId] = spkMonObj->getSpikeFileId();
+		monWriteToArray[monitorId] = spkMonObj->isRecording(); // COUNT mode only updates the spike statistics
+		isMonActive[monitorId] = monFileId[monitorId]!=NULL || monWriteToArray[monitorId];
+		if (isMonActive[monitorId])
+			numActive++;
+	}
+
+	// don't continue if no monitor has anything to record
+	if (!numActive)
+		return;
 
-					// adjust nid to be 0-indexed for each group
-					// this way, if a group has 10 neurons, their IDs in the spike file and spike monitor will be
-					// indexed from 0..9, no matter what their real nid is
-					nid -= grp_Info[grpId].StartN;
-					assert(nid>=0);
+#ifndef __NO_CUDA__
+	if (simMode_ == GPU_MODE) {
+		// copy the neuron firing information from the GPU to the CPU..
+		copyFiringInfo_GPU();
+	}
+#endif
 
-					// current time is last completed second plus whatever is leftover in t
-					int time = currentTimeSec*1000 + t;
+	// Read one spike at a time from the buffer and put the spikes to an appopriate monitor buffer. Later the user
+	// may need need to dump these spikes to an output file
+	// D2 spikes of a group are stored before its D1 spikes, same as if each monitor had scanned the tables itself
+	for (int k=0; k < 2; k++) {
+		unsigned int* timeTablePtr = (k==0)?timeTableD2:timeTableD1;
+		unsigned int* fireTablePtr = (k==0)?firingTableD2:firingTableD1;
+		for(int t=numMsMinAll; t<numMsMax; t++) {
+			// current time is start of the epoch plus whatever is leftover in t
+			int time = (int)epochStartTime + t;
+
+			for(unsigned int i=timeTablePtr[t+maxDelay_]; i<timeTablePtr[t+maxDelay_+1];i++) {
+				// retrieve the neuron id
+				int nid   = fireTablePtr[i];
+				if (simMode_ == GPU_MODE)
+					nid = GET_FIRING_TABLE_NID(nid);
+				assert(nid < numN);
+
+				// route the spike to the monitor of its group, if that one is due for this time step
+				int this_grpId = grpIds[nid];
+				int monitorId = grp_Info[this_grpId].SpikeMonitorId;
+				if (monitorId<0 || !isMonActive[monitorId] || t<monNumMsMin[monitorId])
+					continue;
 
-					if (writeSpikesToFile) {
-						int cnt;
-						cnt = fwrite(&time, sizeof(int), 1, spkFileId); assert(cnt==1);
-						cnt = fwrite(&nid,  sizeof(int), 1, spkFileId); assert(cnt==1);
-					}
+				// adjust nid to be 0-indexed for each group
+				// this way, if a group has 10 neurons, their IDs in the spike file and spike monitor will be
+				// indexed from 0..9, no matter what their real nid is
+				nid -= grp_Info[this_grpId].StartN;
+				assert(nid>=0);
 
-					if (writeSpikesToArray) {
-						spkMonObj->pushAER(time,nid);
-					}
+				// spikes are collected in large blocks before they are written to file (see
+				// SpikeMonitorCore::flushSpikeFile)
+				if (monFileId[monitorId]!=NULL) {
+					spikeMonCoreList[monitorId]->writeSpikeToFile(time,nid);
+				}
+
+				if (monWriteToArray[monitorId]) {
+					spikeMonCoreList[monitorId]->pushAER(time,nid);
 				}
 			}
 		}
-
-		if (spkFileId!=NULL) // flush spike file
-			fflush(spkFileId);
 	}
 }
 
@@ -5533,99 +6514,141 @@ void CpuSNN::updateWeights() {
 	assert(sim_in_testing==false);
 	assert(sim_with_fixedwts==false);
 
-	// update synaptic weights here for all the neurons..
+	// The weight update of a synapse consists of one pass for the E-STDP type and one pass for the I-STDP type
+	// (if set), each of the form wt += (wt*homeoWtScale + passScale*wtChange)*homeoFactor.
+	// Without homeostasis, homeoWtScale=0 and homeoFactor=1, which reduces to wt += passScale*wtChange.
+	// Everything but the homeostasis factors is constant within a group, so it is resolved here once and the
+	// synapse loop does not need to branch on STDP type, homeostasis, or DA modulation.
+	// FIXME: check WithESTDPtype and WithISTDPtype per synapse and only apply the matching pass
+	float passScale[MAX_GRP_PER_SNN][2];
+	int numPasses[MAX_GRP_PER_SNN];
 	for(int g = 0; g < numGrp; g++) {
-		// no changable weights so continue without changing..
-		if(grp_Info[g].FixedInputWts || !(grp_Info[g].WithSTDP))
-			continue;
-
-		for(int i = grp_Info[g].StartN; i <= grp_Info[g].EndN; i++) {
-			assert(i < numNReg);
-			unsigned int offset = cumulativePre[i];
-			float diff_firing = 0.0;
-			float homeostasisScale = 1.0;
-
-			if(grp_Info[g].WithHomeostasis) {
-				assert(baseFiring[i]>0);
-				diff_firing = 1-avgFiring[i]/baseFiring[i];
-				homeostasisScale = grp_Info[g].homeostasisScale;
+		stdpType_t passType[2] = {grp_Info[g].WithESTDPtype, grp_Info[g].WithISTDPtype};
+		float effScale = stdpScaleFactor_; // scales wtChange to the effective weight change
+		numPasses[g] = 0;
+		for (int p=0; p<2; p++) {
+			// with eligibility traces, DA has already been integrated into wtChange
+			if (grp_Info2[g].withEligTrace && passType[p]==DA_MOD)
+				passType[p] = STANDARD;
+
+			switch (passType[p]) {
+			case STANDARD:
+				// homeostatic weight update uses the unscaled wtChange
+				passScale[g][numPasses[g]++] = grp_Info[g].WithHomeostasis ? 1.0f : effScale;
+				break;
+			case DA_MOD:
+				passScale[g][numPasses[g]++] = cpuNetPtrs.grpDA[g] * effScale;
+				// with homeostasis, the effective weight change stays DA-modulated for the following pass
+				if (grp_Info[g].WithHomeostasis)
+					effScale = cpuNetPtrs.grpDA[g] * effScale;
+				break;
+			case UNKNOWN_STDP:
+			default:
+				// we shouldn't even be in here if !WithSTDP
+				break;
 			}
+		}
 
-			if (i==grp_Info[g].StartN)
-				KERNEL_DEBUG("Weights, Change at %lu (diff_firing: %f)", simTimeSec, diff_firing);
-
-			for(int j = 0; j < Npre_plastic[i]; j++) {
-				//	if (i==grp_Info[g].StartN)
-				//		KERNEL_DEBUG("%1.2f %1.2f \t", wt[offset+j]*10, wtChange[offset+j]*10);
-				float effectiveWtChange = stdpScaleFactor_ * wtChange[offset + j];
-//				if (wtChange[offset+j])
-//					printf("connId=%d, wtChange[%d]=%f\n",cumConnIdPre[offset+j],offset+j,wtChange[offset+j]);
-
-				// homeostatic weight update
-				// FIXME: check WithESTDPtype and WithISTDPtype first and then do weight change update
-				switch (grp_Info[g].WithESTDPtype) {
-				case STANDARD:
-					if (grp_Info[g].WithHomeostasis) {
-						wt[offset+j] += (diff_firing*wt[offset+j]*homeostasisScale + wtChange[offset+j])*baseFiring[i]/grp_Info[g].avgTimeScale/(1+fabs(diff_firing)*50);
-					} else {
-						// just STDP weight update
-						wt[offset+j] += effectiveWtChange;
-					}
-					break;
-				case DA_MOD:
-					if (grp_Info[g].WithHomeostasis) {
-						effectiveWtChange = cpuNetPtrs.grpDA[g] * effectiveWtChange;
-						wt[offset+j] += (diff_firing*wt[offset+j]*homeostasisScale + effectiveWtChange)*baseFiring[i]/grp_Info[g].avgTimeScale/(1+fabs(diff_firing)*50);
-					} else {
-						wt[offset+j] += cpuNetPtrs.grpDA[g] * effectiveWtChange;
-					}
-					break;
-				case UNKNOWN_STDP:
-				default:
-					// we shouldn't even be in here if !WithSTDP
-					break;
-				}
-
-				switch (grp_Info[g].WithISTDPtype) {
-				case STANDARD:
-					if (grp_Info[g].WithHomeostasis) {
-						wt[offset+j] += (diff_firing*wt[offset+j]*homeostasisScale + wtChange[offset+j])*baseFiring[i]/grp_Info[g].avgTimeScale/(1+fabs(diff_firing)*50);
-					} else {
-						// just STDP weight update
-						wt[offset+j] += effectiveWtChange;
-					}
-					break;
-				case DA_MOD:
-					if (grp_Info[g].WithHomeostasis) {
-						effectiveWtChange = cpuNetPtrs.grpDA[g] * effectiveWtChange;
-						wt[offset+j] += (diff_firing*wt[offset+j]*homeostasisScale + effectiveWtChange)*baseFiring[i]/grp_Info[g].avgTimeScale/(1+fabs(diff_firing)*50);
-					} else {
-						wt[offset+j] += cpuNetPtrs.grpDA[g] * effectiveWtChange;
-					}
-					break;
-				case UNKNOWN_STDP:
-				default:
-					// we shouldn't even be in here if !WithSTDP
-					break;
-				}
+		if (!grp_Info[g].FixedInputWts && grp_Info[g].WithSTDP) {
+			int i = grp_Info[g].StartN;
+			float diff_firing = grp_Info[g].WithHomeostasis ? 1-avgFiring[i]/baseFiring[i] : 0.0f;
+			KERNEL_DEBUG("Weights, Change at %lu (diff_firing: %f)", simTimeSec, diff_firing);
+		}
+	}
 
-				// It is users' choice to decay weight change or not
-				// see setWeightAndWeightChangeUpdate()
-				wtChange[offset+j] *= wtChangeDecay_;
+	// after weights were written by setWeight, scaleWeights, etc., all plastic synapses are visited (and clamped)
+	// once, just like the ones with pending weight changes
+	if (wtChangeDirtyAll) {
+		for(int g = 0; g < numGrp; g++) {
+			if (grp_Info[g].FixedInputWts || !grp_Info[g].WithSTDP || grp_Info[g].WithHomeostasis)
+				continue;
+			for(int i = grp_Info[g].StartN; i <= grp_Info[g].EndN; i++)
+				setWtChangeDirty(i);
+		}
+		wtChangeDirtyAll = false;
+	}
 
-				// if this is an excitatory or inhibitory synapse
-				if (maxSynWt[offset + j] >= 0) {
-					if (wt[offset + j] >= maxSynWt[offset + j])
-						wt[offset + j] = maxSynWt[offset + j];
-					if (wt[offset + j] < 0)
-						wt[offset + j] = 0.0;
-				} else {
-					if (wt[offset + j] <= maxSynWt[offset + j])
-						wt[offset + j] = maxSynWt[offset + j];
-					if (wt[offset+j] > 0)
-						wt[offset+j] = 0.0;
-				}
-			}
+	// bring wtChange of all synapses with eligibility traces up to date
+	if (sim_with_elig_trace) {
+		for(int g = 0; g < numGrp; g++) {
+			if (grp_Info2[g].withEligTrace)
+				flushEligibilityTraces(g);
 		}
 	}
+
+	// homeostasis changes every plastic weight, whether there is a pending wtChange or not
+	for(int g = 0; g < numGrp; g++) {
+		// no changable weights so continue without changing..
+		if(grp_Info[g].FixedInputWts || !(grp_Info[g].WithSTDP) || !grp_Info[g].WithHomeostasis)
+			continue;
+
+		for(int i = grp_Info[g].StartN; i <= grp_Info[g].EndN; i++)
+			updateWeightsOfNeuron(i, numPasses[g], passScale[g]);
+	}
+
+	// in all other groups, a synapse with wtChange==0 keeps its weight, which has been clamped when the neuron was
+	// last visited, so only the post-neurons that got an STDP update since they were last cleared (or all of them,
+	// see wtChangeDirtyAll) need to be visited. A neuron stays in the list as long as its decayed wtChange is
+	// non-zero, which preserves the semantics of wtChangeDecay_.
+	size_t numDirty = 0;
+	for (size_t k=0; k<wtChangeDirtyList.size(); k++) {
+		int i = wtChangeDirtyList[k];
+		int g = grpIds[i];
+		bool stillDirty = false;
+		if (!grp_Info[g].FixedInputWts && grp_Info[g].WithSTDP && !grp_Info[g].WithHomeostasis)
+			stillDirty = updateWeightsOfNeuron(i, numPasses[g], passScale[g]);
+
+		// a neuron with non-zero eligibility traces will keep changing its weights
+		if (grp_Info2[g].withEligTrace) {
+			for (int j=0; j<Npre_plastic[i] && !stillDirty; j++)
+				stillDirty = eligTrace[cumulativePre[i]+j] != 0.0f;
+		}
+
+		if (stillDirty)
+			wtChangeDirtyList[numDirty++] = i;
+		else
+			wtChangeDirty[i] = false;
+	}
+	wtChangeDirtyList.resize(numDirty);
+}
+
+bool CpuSNN::updateWeightsOfNeuron(int nid, int numPasses, const float* passScale) {
+	assert(nid < numNReg);
+	int g = grpIds[nid];
+	unsigned int offset = cumulativePre[nid];
+	float diff_firing = 0.0f;
+	float homeoWtScale = 0.0f;
+	float homeoFactor = 1.0f;
+
+	if(grp_Info[g].WithHomeostasis) {
+		assert(baseFiring[nid]>0);
+		diff_firing = 1-avgFiring[nid]/baseFiring[nid];
+		homeoWtScale = diff_firing*grp_Info[g].homeostasisScale;
+		homeoFactor = baseFiring[nid]/grp_Info[g].avgTimeScale/(1+fabs(diff_firing)*50);
+	}
+
+	float* wtPtr = &wt[offset];
+	float* wtChangePtr = &wtChange[offset];
+	const float* maxSynWtPtr = &maxSynWt[offset];
+	int numPending = 0;
+	for(int j = 0; j < Npre_plastic[nid]; j++) {
+		float w = wtPtr[j];
+		float dw = wtChangePtr[j];
+		if (numPasses > 0)
+			w += (w*homeoWtScale + passScale[0]*dw)*homeoFactor;
+		if (numPasses > 1)
+			w += (w*homeoWtScale + passScale[1]*dw)*homeoFactor;
+
+		// It is users' choice to decay weight change or not
+		// see setWeightAndWeightChangeUpdate()
+		dw *= wtChangeDecay_;
+		wtChangePtr[j] = dw;
+		numPending += (dw != 0.0f);
+
+		// clamp to [0,maxSynWt] for excitatory and to [maxSynWt,0] for inhibitory synapses
+		float maxWt = maxSynWtPtr[j];
+		wtPtr[j] = fminf(fmaxf(w, fminf(maxWt, 0.0f)), fmaxf(maxWt, 0.0f));
+	}
+
+	return numPending > 0;
 }
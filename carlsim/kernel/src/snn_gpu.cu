@@ -42,7 +42,7 @@
 #include <error_code.h>
 #include <cuda_runtime.h>
 
-#define ROUNDED_TIMING_COUNT  (((1000+MAX_SynapticDelay+1)+127) & ~(127))  // (1000+maxDelay_) rounded to multiple 128
+#define ROUNDED_TIMING_COUNT  (((1000+MAX_SynapticDelayGPU+1)+127) & ~(127))  // (1000+maxDelay_) rounded to multiple 128
 
 #define  FIRE_CHUNK_CNT    (512)
 
@@ -1754,9 +1754,30 @@ void CpuSNN::copyPostConnectionInfo(network_ptr_t* dest, bool allocateMem) {
 	CUDA_CHECK_ERRORS(cudaMemcpy( dest->Npost, Npost, sizeof(Npost[0]) * numN, cudaMemcpyHostToDevice));
 
 	// static specific mapping and actual post-synaptic delay metric
+	// the CPU only stores the delay runs that are in use, but the kernels expect a dense table of maxDelay_+1
+	// entries per neuron (entry td holds the connections with delay td+1)
+	// \FIXME this expansion has not been built with nvcc or run on a GPU yet
+	delay_info_t* tmp_postDelayInfo = new delay_info_t[numN * (maxDelay_ + 1)];
+	memset(tmp_postDelayInfo, 0, sizeof(delay_info_t) * numN * (maxDelay_ + 1));
+	for (int nid=0; nid<numN; nid++) {
+		unsigned int r = cumulativeDelayRuns[nid];
+		short cumDelayStart = 0;
+		for (int td=0; td<maxDelay_; td++) {
+			delay_info_t* dPar = &tmp_postDelayInfo[nid*(maxDelay_+1)+td];
+			dPar->delay = td+1;
+			dPar->delay_index_start = cumDelayStart;
+			if (r < cumulativeDelayRuns[nid+1] && postDelayInfo[r].delay == td+1) {
+				dPar->delay_length = postDelayInfo[r].delay_length;
+				cumDelayStart += postDelayInfo[r].delay_length;
+				r++;
+			}
+		}
+		assert(r == cumulativeDelayRuns[nid+1]);
+	}
 	if(allocateMem)
 		CUDA_CHECK_ERRORS(cudaMalloc((void**)&dest->postDelayInfo, sizeof(postDelayInfo[0]) * numN * (maxDelay_ + 1)));
-	CUDA_CHECK_ERRORS(cudaMemcpy(dest->postDelayInfo, postDelayInfo, sizeof(postDelayInfo[0]) * numN * (maxDelay_ + 1), cudaMemcpyHostToDevice));
+	CUDA_CHECK_ERRORS(cudaMemcpy(dest->postDelayInfo, tmp_postDelayInfo, sizeof(postDelayInfo[0]) * numN * (maxDelay_ + 1), cudaMemcpyHostToDevice));
+	delete[] tmp_postDelayInfo;
 
 	// actual post synaptic connection information...
 	if(allocateMem)
@@ -2278,28 +2299,53 @@ void CpuSNN::copySTPState(network_ptr_t* dest, network_ptr_t* src, cudaMemcpyKin
 
 	float* tmp_stp = new float[net_Info.numN];
 	// copy the already generated values of stpx and stpu to the GPU
+	// on the CPU, only neurons of groups with STP have a (compact) slot, and the ring is only written at spike
+	// times. the GPU keeps a dense ring for all neurons that is decayed every ms. Since this copy only happens
+	// before the first ms is simulated, all values are still at their initial state (u=0, x=1).
+	// \FIXME the conversion from/to the compact CPU layout has not been built with nvcc or run on a GPU yet
 	for(int t=0; t<net_Info.maxDelay+1; t++) {
 		if (kind==cudaMemcpyHostToDevice) {
 			// stpu in the CPU might be mapped in a specific way. we want to change the format
 			// to something that is okay with the GPU STP_U and STP_X variable implementation..
 			for (int n=0; n < net_Info.numN; n++) {
-				tmp_stp[n]=stpu[STP_BUF_POS(n,t)];
+				int g = grpIds[n];
+				tmp_stp[n] = grp_Info[g].WithSTP ? stpu[STP_BUF_POS(STP_NEUR_ID(n,g),t)] : 0.0f;
 				assert(tmp_stp[n] == 0.0f);
 			}
 			CUDA_CHECK_ERRORS( cudaMemcpy( &dest->stpu[t*net_Info.STP_Pitch], tmp_stp, sizeof(float)*net_Info.numN, cudaMemcpyHostToDevice));
 			for (int n=0; n < net_Info.numN; n++) {
-				tmp_stp[n]=stpx[STP_BUF_POS(n,t)];
+				int g = grpIds[n];
+				tmp_stp[n] = grp_Info[g].WithSTP ? stpx[STP_BUF_POS(STP_NEUR_ID(n,g),t)] : 1.0f;
 				assert(tmp_stp[n] == 1.0f);
 			}
 			CUDA_CHECK_ERRORS( cudaMemcpy( &dest->stpx[t*net_Info.STP_Pitch], tmp_stp, sizeof(float)*net_Info.numN, cudaMemcpyHostToDevice));
 		}
 		else {
+			// the GPU ring row t holds the values of the most recent ms tau < simTime with tau % (maxDelay+1) == t.
+			// store these as if every neuron had spiked at the most recent ms, so that the CPU buffers reflect
+			// the current state of the device
+			int lastT = (int)simTime-1;
+			int tau = lastT - ((lastT-t)%(net_Info.maxDelay+1) + net_Info.maxDelay+1)%(net_Info.maxDelay+1);
+			if (tau < 0)
+				continue;
+
 			CUDA_CHECK_ERRORS( cudaMemcpy( tmp_stp, &dest->stpu[t*net_Info.STP_Pitch], sizeof(float)*net_Info.numN, cudaMemcpyDeviceToHost));
-			for (int n=0; n < net_Info.numN; n++)
-				stpu[STP_BUF_POS(n,t)]=tmp_stp[n];
+			for (int g=0; g < numGrp; g++) {
+				if (!grp_Info[g].WithSTP)
+					continue;
+				for (int n=grp_Info[g].StartN; n <= grp_Info[g].EndN; n++)
+					stpu[STP_BUF_POS(STP_NEUR_ID(n,g),tau)]=tmp_stp[n];
+			}
 			CUDA_CHECK_ERRORS( cudaMemcpy( tmp_stp, &dest->stpx[t*net_Info.STP_Pitch], sizeof(float)*net_Info.numN, cudaMemcpyDeviceToHost));
-			for (int n=0; n < net_Info.numN; n++)
-				stpx[STP_BUF_POS(n,t)]=tmp_stp[n];
+			for (int g=0; g < numGrp; g++) {
+				if (!grp_Info[g].WithSTP)
+					continue;
+				for (int n=grp_Info[g].StartN; n <= grp_Info[g].EndN; n++) {
+					stpx[STP_BUF_POS(STP_NEUR_ID(n,g),tau)]=tmp_stp[n];
+					if (tau == lastT)
+						stpLastSpikeTime[STP_NEUR_ID(n,g)] = lastT;
+				}
+			}
 		}
 	}
 	delete [] tmp_stp;
@@ -2716,6 +2762,12 @@ void CpuSNN::doGPUSim() {
 
 	globalStateDecay_GPU(gridSize, blkSize);
 
+	// switch rates of PoissonRateSchedules, so that the new rates are copied to the GPU below
+	updateRateSchedules();
+
+	// apply the current changes of CurrentSchedules (copies the changed currents to the GPU)
+	updateCurrentSchedules();
+
 	// \TODO this should probably be in spikeGeneratorUpdate_GPU
 	if (spikeRateUpdated) {
 		assignPoissonFiringRate_GPU();
@@ -2943,8 +2995,9 @@ void CpuSNN::copyWeightsGPU(unsigned int nid, int src_grp) {
 void CpuSNN::allocateSNN_GPU() {
 	checkAndSetGPUDevice();
 	// \FIXME why is this even here? shouldn't this be checked way earlier? and then in CPU_MODE, too...
-	if (maxDelay_ > MAX_SynapticDelay) {
-		KERNEL_ERROR("You are using a synaptic delay (%d) greater than MAX_SynapticDelay defined in config.h",maxDelay_);
+	if (maxDelay_ > MAX_SynapticDelayGPU) {
+		KERNEL_ERROR("You are using a synaptic delay (%d) greater than MAX_SynapticDelayGPU defined in "
+			"snn_definitions.h",maxDelay_);
 		exitSimulation(1);
 	}
 
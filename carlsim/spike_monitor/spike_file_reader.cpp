@@ -0,0 +1,330 @@
+#include <spike_file_reader.h>
+
+#include <user_errors.h>		// fancy user error messages
+
+#include <algorithm>			// std::lower_bound
+#include <stdio.h>				// fopen, fread, fclose
+#include <string.h>				// memcpy
+
+#if defined(WIN32) || defined(WIN64)
+	// no mmap: the file is read into memory
+#else
+	#include <sys/mman.h>		// mmap, munmap
+	#include <sys/stat.h>		// fstat
+	#include <fcntl.h>			// open
+	#include <unistd.h>			// close
+#endif
+
+// header section: signature, version, grid dimensions
+#define SPIKE_FILE_HEADER_SIZE (4*sizeof(int)+sizeof(float))
+
+// header of a block in an indexed file: numSpikes, firstTime, lastTime, numBytes
+#define SPIKE_FILE_BLOCK_HEADER_SIZE (4*sizeof(int))
+
+// index entry of a block: fileOffset, firstTime, lastTime, numSpikes
+#define SPIKE_FILE_INDEX_ENTRY_SIZE (sizeof(int64_t)+3*sizeof(int))
+
+// end of an indexed file: indexOffset, numBlocks, signature
+#define SPIKE_FILE_TRAILER_SIZE (sizeof(int64_t)+2*sizeof(int))
+
+namespace {
+	const int spikeFileSignature = 206661989;
+
+	// the file is not necessarily aligned: read a value byte by byte
+	template <typename T> T readValue(const uint8_t* pos) {
+		T val;
+		memcpy(&val, pos, sizeof(T));
+		return val;
+	}
+
+	// decode a varint (7 bits per byte, MSB set on all but the last byte), returns false if the varint is longer
+	// than 5 bytes or does not end before end
+	inline bool readVarint(const uint8_t*& pos, const uint8_t* end, uint32_t& val) {
+		val = 0;
+		int shift = 0;
+		do {
+			if (pos>=end || shift>28)
+				return false;
+			val |= (uint32_t)(*pos & 0x7F) << shift;
+			shift += 7;
+		} while (*pos++ & 0x80);
+		return true;
+	}
+}
+
+// we aren't using namespace std so pay attention!
+SpikeFileReader::SpikeFileReader(const std::string& fileName) {
+	fileName_ = fileName;
+	version_ = -1.0f;
+	indexed_ = false;
+	gridX_ = gridY_ = gridZ_ = 0;
+	data_ = NULL;
+	size_ = 0;
+	isMapped_ = false;
+	bitmaps_ = NULL;
+	bitmapBytes_ = 0;
+
+	// move unsafe operations out of constructor
+	openFile();
+	readIndex();
+}
+
+SpikeFileReader::~SpikeFileReader() {
+#if !defined(WIN32) && !defined(WIN64)
+	if (isMapped_)
+		munmap((void*)data_, size_);
+#endif
+	data_ = NULL;
+}
+
+int64_t SpikeFileReader::getNumSpikes() {
+	int64_t numSpikes = 0;
+	for (size_t b=0; b<blocks_.size(); b++)
+		numSpikes += blocks_[b].numSpikes;
+	return numSpikes;
+}
+
+int SpikeFileReader::getLastSpikeTime() {
+	for (int b=(int)blocks_.size()-1; b>=0; b--) {
+		if (blocks_[b].numSpikes)
+			return blocks_[b].lastTime;
+	}
+	return -1;
+}
+
+void SpikeFileReader::readSpikes(int startTimeMs, int endTimeMs, std::vector<int>& spkTimes,
+		std::vector<int>& spkNeurIds) {
+	readSpikesImpl(startTimeMs, endTimeMs, std::vector<int>(), spkTimes, spkNeurIds);
+}
+
+void SpikeFileReader::readSpikes(int startTimeMs, int endTimeMs, const std::vector<int>& neurIds,
+		std::vector<int>& spkTimes, std::vector<int>& spkNeurIds) {
+	std::string funcName = "readSpikes()";
+	UserErrors::assertTrue(!neurIds.empty(), UserErrors::CANNOT_BE_ZERO, funcName, "neurIds.size()");
+	for (size_t i=0; i<neurIds.size(); i++)
+		UserErrors::assertTrue(neurIds[i]>=0 && neurIds[i]<getNumNeurons(), UserErrors::MUST_BE_IN_RANGE, funcName,
+			"neurIds", "[0,numNeurons-1].");
+
+	readSpikesImpl(startTimeMs, endTimeMs, neurIds, spkTimes, spkNeurIds);
+}
+
+
+// +++++ PRIVATE METHODS: +++++++++++++++++++++++++++++++++++++++++++++++//
+
+void SpikeFileReader::openFile() {
+	std::string funcName = "openFile(" + fileName_ + ")";
+
+#if defined(WIN32) || defined(WIN64)
+	FILE* fp = fopen(fileName_.c_str(), "rb");
+	UserErrors::assertTrue(fp!=NULL, UserErrors::FILE_CANNOT_OPEN, funcName, fileName_);
+	// ftell returns a 32-bit long on Windows
+	_fseeki64(fp, 0, SEEK_END);
+	size_ = _ftelli64(fp);
+	_fseeki64(fp, 0, SEEK_SET);
+	fileBuffer_.resize(size_ ? size_ : 1);
+	size_t result = fread(&fileBuffer_[0], 1, size_, fp);
+	fclose(fp);
+	UserErrors::assertTrue(result==(size_t)size_, UserErrors::UNKNOWN, funcName, "", "Could not read file.");
+	data_ = &fileBuffer_[0];
+#else
+	int fd = open(fileName_.c_str(), O_RDONLY);
+	UserErrors::assertTrue(fd>=0, UserErrors::FILE_CANNOT_OPEN, funcName, fileName_);
+	struct stat st;
+	fstat(fd, &st);
+	size_ = st.st_size;
+	if (size_ > 0) {
+		void* addr = mmap(NULL, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+		if (addr != MAP_FAILED) {
+			data_ = (const uint8_t*)addr;
+			isMapped_ = true;
+		}
+	}
+	close(fd);
+
+	if (!isMapped_) {
+		// empty file or mmap failed: fall back to reading the file
+		FILE* fp = fopen(fileName_.c_str(), "rb");
+		UserErrors::assertTrue(fp!=NULL, UserErrors::FILE_CANNOT_OPEN, funcName, fileName_);
+		fileBuffer_.resize(size_ ? size_ : 1);
+		size_t result = fread(&fileBuffer_[0], 1, size_, fp);
+		fclose(fp);
+		UserErrors::assertTrue(result==(size_t)size_, UserErrors::UNKNOWN, funcName, "", "Could not read file.");
+		data_ = &fileBuffer_[0];
+	}
+#endif
+
+	// read header section
+	UserErrors::assertTrue(size_>=(int64_t)SPIKE_FILE_HEADER_SIZE, UserErrors::UNKNOWN, funcName, "",
+		"File is too small to be a spike file.");
+	UserErrors::assertTrue(readValue<int>(data_)==spikeFileSignature, UserErrors::UNKNOWN, funcName, "",
+		"Unknown file signature. Make sure the file was created by a SpikeMonitor.");
+	version_ = readValue<float>(data_+sizeof(int));
+	indexed_ = (int)version_==2;
+	UserErrors::assertTrue(indexed_ || (int)version_==0, UserErrors::UNKNOWN, funcName, "",
+		"Unsupported spike file version.");
+	gridX_ = readValue<int>(data_+sizeof(int)+sizeof(float));
+	gridY_ = readValue<int>(data_+2*sizeof(int)+sizeof(float));
+	gridZ_ = readValue<int>(data_+3*sizeof(int)+sizeof(float));
+	UserErrors::assertTrue(gridX_>0 && gridY_>0 && gridZ_>0, UserErrors::UNKNOWN, funcName, "",
+		"Invalid grid dimensions.");
+}
+
+void SpikeFileReader::readIndex() {
+	blocks_.clear();
+	bitmaps_ = NULL;
+	bitmapBytes_ = 0;
+
+	if (!indexed_) {
+		// flat file: treat the (time,neurId) stream as a single block
+		BlockInfo blk;
+		blk.offset = SPIKE_FILE_HEADER_SIZE;
+		blk.numSpikes = (size_-SPIKE_FILE_HEADER_SIZE)/(2*sizeof(int));
+		blk.firstTime = blk.numSpikes ? readValue<int>(data_+blk.offset) : 0;
+		blk.lastTime = blk.numSpikes ? readValue<int>(data_+blk.offset+(blk.numSpikes-1)*2*sizeof(int)) : -1;
+		blocks_.push_back(blk);
+		return;
+	}
+
+	// try the index at the end of the file first
+	if (size_ >= (int64_t)(SPIKE_FILE_HEADER_SIZE+SPIKE_FILE_TRAILER_SIZE)) {
+		const uint8_t* trailer = data_+size_-SPIKE_FILE_TRAILER_SIZE;
+		int64_t indexOffset = readValue<int64_t>(trailer);
+		uint32_t numBlocks = readValue<uint32_t>(trailer+sizeof(int64_t));
+		int signature = readValue<int>(trailer+sizeof(int64_t)+sizeof(int));
+		int64_t bitmapPos = indexOffset + (int64_t)numBlocks*SPIKE_FILE_INDEX_ENTRY_SIZE;
+		if (signature==spikeFileSignature && indexOffset>=(int64_t)SPIKE_FILE_HEADER_SIZE && indexOffset<=size_
+				&& bitmapPos+(int64_t)sizeof(uint32_t) <= size_-(int64_t)SPIKE_FILE_TRAILER_SIZE) {
+			const uint8_t* pos = data_+indexOffset;
+			bool isIndexValid = true;
+			for (uint32_t b=0; b<numBlocks && isIndexValid; b++) {
+				BlockInfo blk;
+				blk.offset = readValue<int64_t>(pos);
+				blk.firstTime = readValue<int>(pos+sizeof(int64_t));
+				blk.lastTime = readValue<int>(pos+sizeof(int64_t)+sizeof(int));
+				blk.numSpikes = readValue<uint32_t>(pos+sizeof(int64_t)+2*sizeof(int));
+				isIndexValid = getBlockNumBytes(blk.offset, indexOffset)>=0;
+				blocks_.push_back(blk);
+				pos += SPIKE_FILE_INDEX_ENTRY_SIZE;
+			}
+
+			if (isIndexValid) {
+				int64_t bitmapBytes = readValue<uint32_t>(pos);
+				pos += sizeof(uint32_t);
+				if (bitmapBytes && bitmapBytes*numBlocks <= data_+size_-SPIKE_FILE_TRAILER_SIZE-pos) {
+					bitmaps_ = pos;
+					bitmapBytes_ = (uint32_t)bitmapBytes;
+				}
+				return;
+			}
+
+			// a block lies outside the data section: treat the index as missing
+			blocks_.clear();
+		}
+	}
+
+	// no index (the file was not closed properly): scan the block headers, ignoring an incomplete last block
+	int64_t offset = SPIKE_FILE_HEADER_SIZE;
+	int64_t numBytes;
+	while ((numBytes = getBlockNumBytes(offset, size_)) >= 0) {
+		const uint8_t* pos = data_+offset;
+		BlockInfo blk;
+		blk.offset = offset;
+		blk.numSpikes = readValue<uint32_t>(pos);
+		blk.firstTime = readValue<int>(pos+sizeof(int));
+		blk.lastTime = readValue<int>(pos+2*sizeof(int));
+		blocks_.push_back(blk);
+		offset += SPIKE_FILE_BLOCK_HEADER_SIZE+numBytes;
+	}
+}
+
+int64_t SpikeFileReader::getBlockNumBytes(int64_t offset, int64_t endOffset) {
+	if (offset<(int64_t)SPIKE_FILE_HEADER_SIZE || offset>endOffset-(int64_t)SPIKE_FILE_BLOCK_HEADER_SIZE)
+		return -1;
+
+	int64_t numBytes = readValue<uint32_t>(data_+offset+3*sizeof(int));
+	if (numBytes > endOffset-offset-(int64_t)SPIKE_FILE_BLOCK_HEADER_SIZE)
+		return -1;
+
+	return numBytes;
+}
+
+bool SpikeFileReader::blockHasNeurons(int blockId, const std::vector<int>& neurIds) {
+	if (bitmaps_==NULL)
+		return true; // no bitmap: have to look inside the block
+
+	const uint8_t* bitmap = bitmaps_+(int64_t)blockId*bitmapBytes_;
+	for (size_t i=0; i<neurIds.size(); i++) {
+		if ((uint32_t)neurIds[i]/8 < bitmapBytes_ && (bitmap[neurIds[i]/8] >> (neurIds[i]%8) & 1))
+			return true;
+	}
+	return false;
+}
+
+void SpikeFileReader::readSpikesImpl(int startTimeMs, int endTimeMs, const std::vector<int>& neurIds,
+		std::vector<int>& spkTimes, std::vector<int>& spkNeurIds) {
+	// prepare fast lookup of the requested neurons
+	std::vector<bool> neurMask;
+	if (!neurIds.empty()) {
+		neurMask.assign(getNumNeurons(), false);
+		for (size_t i=0; i<neurIds.size(); i++)
+			neurMask[neurIds[i]] = true;
+	}
+
+	if (!indexed_) {
+		// spikes are written in temporal order, so binary search for the first spike of the time window
+		const uint8_t* records = data_+SPIKE_FILE_HEADER_SIZE;
+		int64_t numSpikes = blocks_[0].numSpikes;
+		int64_t lo = 0, hi = numSpikes;
+		while (lo < hi) {
+			int64_t mid = lo+(hi-lo)/2;
+			if (readValue<int>(records+mid*2*sizeof(int)) < startTimeMs)
+				lo = mid+1;
+			else
+				hi = mid;
+		}
+		for (int64_t i=lo; i<numSpikes; i++) {
+			int time = readValue<int>(records+i*2*sizeof(int));
+			if (time >= endTimeMs)
+				break;
+			int nid = readValue<int>(records+i*2*sizeof(int)+sizeof(int));
+			if (neurMask.empty() || (nid>=0 && nid<(int)neurMask.size() && neurMask[nid])) {
+				spkTimes.push_back(time);
+				spkNeurIds.push_back(nid);
+			}
+		}
+		return;
+	}
+
+	// skip all blocks that end before the time window
+	int lo = 0, hi = (int)blocks_.size();
+	while (lo < hi) {
+		int mid = lo+(hi-lo)/2;
+		if (blocks_[mid].lastTime < startTimeMs)
+			lo = mid+1;
+		else
+			hi = mid;
+	}
+
+	for (int b=lo; b<(int)blocks_.size() && blocks_[b].firstTime<endTimeMs; b++) {
+		if (!neurIds.empty() && !blockHasNeurons(b, neurIds))
+			continue;
+
+		int64_t numBytes = getBlockNumBytes(blocks_[b].offset, size_);
+		if (numBytes<0)
+			continue;
+
+		const uint8_t* pos = data_+blocks_[b].offset+SPIKE_FILE_BLOCK_HEADER_SIZE;
+		const uint8_t* end = pos+numBytes;
+		int time = blocks_[b].firstTime;
+		uint32_t dt, nid;
+		while (readVarint(pos, end, dt) && readVarint(pos, end, nid)) {
+			time += (int)(dt >> 1) ^ -(int)(dt & 1);
+			if (time<startTimeMs || time>=endTimeMs || nid>=(uint32_t)getNumNeurons())
+				continue;
+			if (neurMask.empty() || neurMask[nid]) {
+				spkTimes.push_back(time);
+				spkNeurIds.push_back(nid);
+			}
+		}
+	}
+}
@@ -0,0 +1,192 @@
+/*
+ * Copyright (c) 2014 Regents of the University of California. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * 3. The names of its contributors may not be used to endorse or promote
+ *    products derived from this software without specific prior written
+ *    permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * *************************************************************************
+ * CARLsim
+ * created by: 		(MDR) Micah Richert, (JN) Jayram M. Nageswaran
+ * maintained by:	(MA) Mike Avery <averym@uci.edu>, (MB) Michael Beyeler <mbeyeler@uci.edu>,
+ *					(KDC) Kristofor Carlson <kdcarlso@uci.edu>
+ *					(TSC) Ting-Shuo Chou <tingshuc@uci.edu>
+ *
+ * CARLsim available from http://socsci.uci.edu/~jkrichma/CARLsim/
+ * Ver 11/12/2014
+ */
+
+#ifndef _SPIKE_FILE_READER_H_
+#define _SPIKE_FILE_READER_H_
+
+#include <carlsim_datastructures.h>	// Grid3D
+#include <stdint.h>					// int64_t, uint8_t
+#include <string>					// std::string
+#include <vector>					// std::vector
+
+
+/*!
+ * \brief Class SpikeFileReader
+ *
+ * The SpikeFileReader class gives random access to the spike file binaries written by a SpikeMonitor. Spikes can be
+ * read for an arbitrary time window, optionally restricted to a subset of neurons.
+ *
+ * Two file formats are supported:
+ * - Version 0.x (default): A header section (signature, version, grid dimensions) followed by a flat stream of
+ *   (int time, int neurId) pairs. Since there is no index, the reader has to binary-search the stream.
+ * - Version 2.x (indexed, see SpikeMonitor::setLogFileIndexed): The same header section followed by a sequence of
+ *   compressed blocks and an index. Every block starts with (uint32 numSpikes, int32 firstTime, int32 lastTime,
+ *   uint32 numBytes), followed by numBytes of (zigzag-encoded time difference to the previous spike, neurId)
+ *   varint pairs (7 bits per byte, the time difference of the first spike is relative to firstTime).
+ *   The index at the end of the file lists (int64 fileOffset, int32 firstTime, int32 lastTime, uint32 numSpikes) for
+ *   every block, followed by (uint32 numBytes) and a bitmap of numBytes per block that marks all neurons with a spike
+ *   in the block (numBytes may be zero if there are no bitmaps). The file ends with (int64 indexOffset,
+ *   uint32 numBlocks, int32 signature).
+ *   If the index is missing (e.g., because the simulation did not finish), the reader scans the block headers
+ *   instead.
+ *
+ * The file is memory-mapped (where available), so only the parts of the file that are actually needed are read
+ * from disk.
+ *
+ * Example usage:
+ * \code
+ * SpikeFileReader reader("results/spk_output.dat");
+ * std::vector<int> spkTimes, spkNeurIds;
+ * // get all spikes of neurons 3 and 7 between t=1000ms and t=1500ms
+ * std::vector<int> neurIds;
+ * neurIds.push_back(3); neurIds.push_back(7);
+ * reader.readSpikes(1000, 1500, neurIds, spkTimes, spkNeurIds);
+ * \endcode
+ *
+ * \since v3.1
+ */
+class SpikeFileReader {
+public:
+	/*!
+	 * \brief SpikeFileReader constructor
+	 *
+	 * Opens a spike file and reads its header section and index.
+	 * \param[in] fileName path to the spike file
+	 */
+	SpikeFileReader(const std::string& fileName);
+
+	//! destructor, unmaps and closes the file
+	~SpikeFileReader();
+
+	//! returns the grid dimensions of the group that was recorded
+	Grid3D getGrid3D() { return Grid3D(gridX_, gridY_, gridZ_); }
+
+	//! returns the number of neurons in the group that was recorded
+	int getNumNeurons() { return gridX_*gridY_*gridZ_; }
+
+	//! returns the number of blocks (1 for flat files)
+	int getNumBlocks() { return (int)blocks_.size(); }
+
+	//! returns the total number of spikes in the file
+	int64_t getNumSpikes();
+
+	//! returns the time (ms) of the last spike in the file, or -1 if the file is empty
+	int getLastSpikeTime();
+
+	//! returns the file version number
+	float getVersion() { return version_; }
+
+	//! returns true if the file has the indexed block format (version 2.x)
+	bool isIndexed() { return indexed_; }
+
+	/*!
+	 * \brief Reads all spikes in a time window
+	 *
+	 * Appends all spikes with startTimeMs <= time < endTimeMs to the output vectors, in the order in which they
+	 * were recorded.
+	 * \param[in] startTimeMs beginning of the time window (inclusive)
+	 * \param[in] endTimeMs end of the time window (exclusive)
+	 * \param[out] spkTimes vector to which the spike times are appended
+	 * \param[out] spkNeurIds vector to which the neuron IDs are appended
+	 */
+	void readSpikes(int startTimeMs, int endTimeMs, std::vector<int>& spkTimes, std::vector<int>& spkNeurIds);
+
+	/*!
+	 * \brief Reads all spikes of a subset of neurons in a time window
+	 *
+	 * Same as above, but only spikes of the neurons listed in neurIds are returned. In an indexed file, blocks
+	 * without spikes of these neurons are skipped.
+	 * \param[in] startTimeMs beginning of the time window (inclusive)
+	 * \param[in] endTimeMs end of the time window (exclusive)
+	 * \param[in] neurIds list of neuron IDs
+	 * \param[out] spkTimes vector to which the spike times are appended
+	 * \param[out] spkNeurIds vector to which the neuron IDs are appended
+	 */
+	void readSpikes(int startTimeMs, int endTimeMs, const std::vector<int>& neurIds, std::vector<int>& spkTimes,
+		std::vector<int>& spkNeurIds);
+
+private:
+	// the file mapping or buffer is owned by this object, so it cannot be copied
+	SpikeFileReader(const SpikeFileReader&);
+	SpikeFileReader& operator=(const SpikeFileReader&);
+
+	//! location of a block in the file
+	struct BlockInfo {
+		int64_t offset;		//!< file offset of the block (header)
+		int firstTime;		//!< time (ms) of the first spike in the block
+		int lastTime;		//!< time (ms) of the last spike in the block
+		uint32_t numSpikes;	//!< number of spikes in the block
+	};
+
+	//! maps the file into memory (or reads it, where mmap is not available)
+	void openFile();
+
+	//! reads the index at the end of the file, or scans the block headers if there is none
+	void readIndex();
+
+	//! returns the number of data bytes of the block at offset, or -1 if the block does not end before endOffset
+	int64_t getBlockNumBytes(int64_t offset, int64_t endOffset);
+
+	//! returns true if the bitmap of a block has any of the neurons in neurIds
+	bool blockHasNeurons(int blockId, const std::vector<int>& neurIds);
+
+	//! implementation of readSpikes; an empty neurIds means all neurons
+	void readSpikesImpl(int startTimeMs, int endTimeMs, const std::vector<int>& neurIds, std::vector<int>& spkTimes,
+		std::vector<int>& spkNeurIds);
+
+	std::string fileName_;	//!< path to the spike file
+	float version_;			//!< file version number
+	bool indexed_;			//!< whether the file has the indexed block format
+	int gridX_;				//!< grid dimensions of the recorded group
+	int gridY_;
+	int gridZ_;
+
+	const uint8_t* data_;	//!< the entire file content (mapped or read into fileBuffer_)
+	int64_t size_;			//!< file size in bytes
+	std::vector<uint8_t> fileBuffer_; //!< file content, if the file could not be mapped
+	bool isMapped_;			//!< whether data_ is a memory mapping
+
+	std::vector<BlockInfo> blocks_;	//!< all blocks in the file, sorted by time
+	const uint8_t* bitmaps_;		//!< per-block neuron bitmaps (part of the index), or NULL
+	uint32_t bitmapBytes_;			//!< size of a per-block neuron bitmap in bytes
+};
+
+#endif
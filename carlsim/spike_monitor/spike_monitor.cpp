@@ -28,53 +28,64 @@ void SpikeMonitor::clear(){
 
 float SpikeMonitor::getPopMeanFiringRate() {
 	std::string funcName = "getPopMeanFiringRate()";
-	UserErrors::assertTrue(!isRecording(), UserErrors::CANNOT_BE_ON, funcName, "Recording");
+	UserErrors::assertTrue(!isRecording() || getMode()==COUNT, UserErrors::CANNOT_BE_ON, funcName,
+		"Recording in AER mode");
 
 	return spikeMonitorCorePtr_->getPopMeanFiringRate();
 }
 
 float SpikeMonitor::getPopStdFiringRate() {
 	std::string funcName = "getPopStdFiringRate()";
-	UserErrors::assertTrue(!isRecording(), UserErrors::CANNOT_BE_ON, funcName, "Recording");
+	UserErrors::assertTrue(!isRecording() || getMode()==COUNT, UserErrors::CANNOT_BE_ON, funcName,
+		"Recording in AER mode");
 
 	return spikeMonitorCorePtr_->getPopStdFiringRate();
 }
 
-int SpikeMonitor::getPopNumSpikes() {
-	std::string funcName = "getPopNumSpikes()";
-	UserErrors::assertTrue(!isRecording(), UserErrors::CANNOT_BE_ON, funcName, "Recording");
+std::vector<float> SpikeMonitor::getPopPSTH() {
+	std::string funcName = "getPopPSTH()";
+	UserErrors::assertTrue(spikeMonitorCorePtr_->isPSTHEnabled(), UserErrors::MUST_BE_CALLED, funcName, "setPSTHBins",
+		"first.");
 
-	// \TODO
-	UserErrors::assertTrue(getMode()==AER, UserErrors::UNKNOWN, funcName, "",
-		"This function is not yet supported in this mode.");
+	return spikeMonitorCorePtr_->getPopPSTH();
+}
+
+int64_t SpikeMonitor::getPopNumSpikes() {
+	std::string funcName = "getPopNumSpikes()";
+	UserErrors::assertTrue(!isRecording() || getMode()==COUNT, UserErrors::CANNOT_BE_ON, funcName,
+		"Recording in AER mode");
 
 	return spikeMonitorCorePtr_->getPopNumSpikes();	
 }
 
 float SpikeMonitor::getMaxFiringRate(){
 	std::string funcName = "getMaxFiringRate()";
-	UserErrors::assertTrue(!isRecording(), UserErrors::CANNOT_BE_ON, funcName, "Recording");
+	UserErrors::assertTrue(!isRecording() || getMode()==COUNT, UserErrors::CANNOT_BE_ON, funcName,
+		"Recording in AER mode");
 
 	return spikeMonitorCorePtr_->getMaxFiringRate();
 }
 
 float SpikeMonitor::getMinFiringRate(){
 	std::string funcName = "getMinFiringRate()";
-	UserErrors::assertTrue(!isRecording(), UserErrors::CANNOT_BE_ON, funcName, "Recording");
+	UserErrors::assertTrue(!isRecording() || getMode()==COUNT, UserErrors::CANNOT_BE_ON, funcName,
+		"Recording in AER mode");
 
 	return spikeMonitorCorePtr_->getMinFiringRate();
 }
 
 std::vector<float> SpikeMonitor::getAllFiringRates(){
 	std::string funcName = "getAllFiringRates()";
-	UserErrors::assertTrue(!isRecording(), UserErrors::CANNOT_BE_ON, funcName, "Recording");
+	UserErrors::assertTrue(!isRecording() || getMode()==COUNT, UserErrors::CANNOT_BE_ON, funcName,
+		"Recording in AER mode");
 
 	return spikeMonitorCorePtr_->getAllFiringRates();
 }
 
 float SpikeMonitor::getNeuronMeanFiringRate(int neurId) {
 	std::string funcName = "getNeuronMeanFiringRate()";
-	UserErrors::assertTrue(!isRecording(), UserErrors::CANNOT_BE_ON, funcName, "Recording");
+	UserErrors::assertTrue(!isRecording() || getMode()==COUNT, UserErrors::CANNOT_BE_ON, funcName,
+		"Recording in AER mode");
 
 	return spikeMonitorCorePtr_->getNeuronMeanFiringRate(neurId);
 
@@ -82,19 +93,69 @@ float SpikeMonitor::getNeuronMeanFiringRate(int neurId) {
 
 int SpikeMonitor::getNeuronNumSpikes(int neurId) {
 	std::string funcName = "getNeuronNumSpikes()";
-	UserErrors::assertTrue(!isRecording(), UserErrors::CANNOT_BE_ON, funcName, "Recording");
-
-	// \TODO
-	UserErrors::assertTrue(getMode()==AER, UserErrors::UNKNOWN, funcName, "",
-		"This function is not yet supported in this mode.");
+	UserErrors::assertTrue(!isRecording() || getMode()==COUNT, UserErrors::CANNOT_BE_ON, funcName,
+		"Recording in AER mode");
 
 	return spikeMonitorCorePtr_->getNeuronNumSpikes(neurId);
 }
 
+std::vector<float> SpikeMonitor::getNeuronPSTH(int neurId) {
+	std::string funcName = "getNeuronPSTH()";
+	UserErrors::assertTrue(spikeMonitorCorePtr_->isPSTHEnabled(), UserErrors::MUST_BE_CALLED, funcName, "setPSTHBins",
+		"first.");
+	UserErrors::assertTrue(neurId>=0 && neurId<spikeMonitorCorePtr_->getGrpNumNeurons(), UserErrors::MUST_BE_IN_RANGE,
+		funcName, "neurId", "[0,numNeurons-1].");
+
+	return spikeMonitorCorePtr_->getNeuronPSTH(neurId);
+}
+
+int SpikeMonitor::getNumTrials() {
+	return spikeMonitorCorePtr_->getNumTrials();
+}
+
+float SpikeMonitor::getNeuronMeanISI(int neurId) {
+	std::string funcName = "getNeuronMeanISI()";
+	UserErrors::assertTrue(!isRecording() || getMode()==COUNT, UserErrors::CANNOT_BE_ON, funcName,
+		"Recording in AER mode");
+	UserErrors::assertTrue(neurId>=0 && neurId<spikeMonitorCorePtr_->getGrpNumNeurons(), UserErrors::MUST_BE_IN_RANGE,
+		funcName, "neurId", "[0,numNeurons-1].");
+
+	return spikeMonitorCorePtr_->getNeuronMeanISI(neurId);
+}
+
+float SpikeMonitor::getNeuronISICV(int neurId) {
+	std::string funcName = "getNeuronISICV()";
+	UserErrors::assertTrue(!isRecording() || getMode()==COUNT, UserErrors::CANNOT_BE_ON, funcName,
+		"Recording in AER mode");
+	UserErrors::assertTrue(neurId>=0 && neurId<spikeMonitorCorePtr_->getGrpNumNeurons(), UserErrors::MUST_BE_IN_RANGE,
+		funcName, "neurId", "[0,numNeurons-1].");
+
+	return spikeMonitorCorePtr_->getNeuronISICV(neurId);
+}
+
+float SpikeMonitor::getNeuronFanoFactor(int neurId) {
+	std::string funcName = "getNeuronFanoFactor()";
+	UserErrors::assertTrue(!isRecording() || getMode()==COUNT, UserErrors::CANNOT_BE_ON, funcName,
+		"Recording in AER mode");
+	UserErrors::assertTrue(neurId>=0 && neurId<spikeMonitorCorePtr_->getGrpNumNeurons(), UserErrors::MUST_BE_IN_RANGE,
+		funcName, "neurId", "[0,numNeurons-1].");
+
+	return spikeMonitorCorePtr_->getNeuronFanoFactor(neurId);
+}
+
+float SpikeMonitor::getPopFiringRateStdOverTime() {
+	std::string funcName = "getPopFiringRateStdOverTime()";
+	UserErrors::assertTrue(!isRecording() || getMode()==COUNT, UserErrors::CANNOT_BE_ON, funcName,
+		"Recording in AER mode");
+
+	return spikeMonitorCorePtr_->getPopFiringRateStdOverTime();
+}
+
 // need to do error check here and maybe throw CARLsim errors.
 int SpikeMonitor::getNumNeuronsWithFiringRate(float min, float max){
 	std::string funcName = "getNumNeuronsWithFiringRate()";
-	UserErrors::assertTrue(!isRecording(), UserErrors::CANNOT_BE_ON, funcName, "Recording");
+	UserErrors::assertTrue(!isRecording() || getMode()==COUNT, UserErrors::CANNOT_BE_ON, funcName,
+		"Recording in AER mode");
 
 	return spikeMonitorCorePtr_->getNumNeuronsWithFiringRate(min,max);
 }
@@ -102,7 +163,8 @@ int SpikeMonitor::getNumNeuronsWithFiringRate(float min, float max){
 // need to do error check here and maybe throw CARLsim errors.
 float SpikeMonitor::getPercentNeuronsWithFiringRate(float min, float max) {
 	std::stringstream funcName; funcName << "getPercentNeuronsWithFiringRate(" << min << "," << max << ")";
-	UserErrors::assertTrue(!isRecording(), UserErrors::CANNOT_BE_ON, funcName.str(), "Recording");
+	UserErrors::assertTrue(!isRecording() || getMode()==COUNT, UserErrors::CANNOT_BE_ON, funcName.str(),
+		"Recording in AER mode");
 	UserErrors::assertTrue(min>=0.0f, UserErrors::CANNOT_BE_NEGATIVE, funcName.str(), "min");
 	UserErrors::assertTrue(max>=0.0f, UserErrors::CANNOT_BE_NEGATIVE, funcName.str(), "max");
 	UserErrors::assertTrue(max>=min, UserErrors::CANNOT_BE_LARGER, funcName.str(), "min", "max");
@@ -112,14 +174,16 @@ float SpikeMonitor::getPercentNeuronsWithFiringRate(float min, float max) {
 
 int SpikeMonitor::getNumSilentNeurons(){
 	std::string funcName = "getNumSilentNeurons()";
-	UserErrors::assertTrue(!isRecording(), UserErrors::CANNOT_BE_ON, funcName, "Recording");
+	UserErrors::assertTrue(!isRecording() || getMode()==COUNT, UserErrors::CANNOT_BE_ON, funcName,
+		"Recording in AER mode");
 
 	return spikeMonitorCorePtr_->getNumSilentNeurons();
 }
 
 float SpikeMonitor::getPercentSilentNeurons(){
 	std::string funcName = "getPercentSilentNeurons()";
-	UserErrors::assertTrue(!isRecording(), UserErrors::CANNOT_BE_ON, funcName, "Recording");
+	UserErrors::assertTrue(!isRecording() || getMode()==COUNT, UserErrors::CANNOT_BE_ON, funcName,
+		"Recording in AER mode");
 
 	return spikeMonitorCorePtr_->getPercentSilentNeurons();
 }
@@ -134,7 +198,8 @@ std::vector<std::vector<int> > SpikeMonitor::getSpikeVector2D() {
 
 std::vector<float> SpikeMonitor::getAllFiringRatesSorted(){
 	std::string funcName = "getAllFiringRatesSorted()";
-	UserErrors::assertTrue(!isRecording(), UserErrors::CANNOT_BE_ON, funcName, "Recording");
+	UserErrors::assertTrue(!isRecording() || getMode()==COUNT, UserErrors::CANNOT_BE_ON, funcName,
+		"Recording in AER mode");
 
 	return spikeMonitorCorePtr_->getAllFiringRatesSorted();
 }
@@ -164,9 +229,18 @@ void SpikeMonitor::stopRecording(){
 	spikeMonitorCorePtr_->stopRecording();
 }
 
+void SpikeMonitor::startTrial() {
+	std::string funcName = "startTrial()";
+	UserErrors::assertTrue(spikeMonitorCorePtr_->isPSTHEnabled(), UserErrors::MUST_BE_CALLED, funcName, "setPSTHBins",
+		"first.");
+
+	spikeMonitorCorePtr_->startTrial();
+}
+
 int64_t SpikeMonitor::getRecordingTotalTime() {
 	std::string funcName = "getRecordingTotalTime()";
-	UserErrors::assertTrue(!isRecording(), UserErrors::CANNOT_BE_ON, funcName, "Recording");
+	UserErrors::assertTrue(!isRecording() || getMode()==COUNT, UserErrors::CANNOT_BE_ON, funcName,
+		"Recording in AER mode");
 
 	return spikeMonitorCorePtr_->getRecordingTotalTime();
 }
@@ -200,18 +274,46 @@ void SpikeMonitor::setPersistentData(bool persistentData) {
 	spikeMonitorCorePtr_->setPersistentData(persistentData);
 }
 
+void SpikeMonitor::setMemoryBudgetMB(int budgetMB) {
+	std::string funcName = "setMemoryBudgetMB()";
+	UserErrors::assertTrue(budgetMB>=0 || budgetMB==-1, UserErrors::MUST_BE_POSITIVE, funcName, "budgetMB",
+		"or -1.");
+
+	spikeMonitorCorePtr_->setMemoryBudget(budgetMB<0 ? -1 : (int64_t)budgetMB*1024*1024);
+}
+
+int64_t SpikeMonitor::getMemoryUsageBytes() {
+	return spikeMonitorCorePtr_->getBufferSize();
+}
+
+void SpikeMonitor::setPSTHBins(int binSizeMs, int numBins) {
+	std::string funcName = "setPSTHBins()";
+	UserErrors::assertTrue(!isRecording(), UserErrors::CANNOT_BE_ON, funcName, "Recording");
+	UserErrors::assertTrue(binSizeMs>0, UserErrors::MUST_BE_POSITIVE, funcName, "binSizeMs");
+	UserErrors::assertTrue(numBins>0, UserErrors::MUST_BE_POSITIVE, funcName, "numBins");
+
+	spikeMonitorCorePtr_->setPSTHBins(binSizeMs, numBins);
+}
+
 spikeMonMode_t SpikeMonitor::getMode() {
 	return spikeMonitorCorePtr_->getMode();
 }
 
 void SpikeMonitor::setMode(spikeMonMode_t mode) {
-	// \TODO
-	UserErrors::assertTrue(false, UserErrors::UNKNOWN, "setMode()", "",
-		"This function call is not yet supported.");
+	std::string funcName = "setMode()";
+	UserErrors::assertTrue(!isRecording(), UserErrors::CANNOT_BE_ON, funcName, "Recording");
 
 	spikeMonitorCorePtr_->setMode(mode);
 }
 
+void SpikeMonitor::setLogFileIndexed(bool indexed) {
+	std::string funcName = "setLogFileIndexed()";
+	UserErrors::assertTrue(spikeMonitorCorePtr_->isSpikeFileEmpty(), UserErrors::UNKNOWN, funcName, "",
+		"The spike file format cannot be changed once spikes have been written to file. Call setLogFile first.");
+
+	spikeMonitorCorePtr_->setSpikeFileIndexed(indexed);
+}
+
 void SpikeMonitor::setLogFile(const std::string& fileName) {
 	std::string funcName = "setLogFile";
 
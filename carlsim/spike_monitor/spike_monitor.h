@@ -68,11 +68,16 @@ class SpikeMonitorCore; // forward declaration of implementation
  * - COUNT:	SpikeCount mode will only collect spike count information, such as the number of spikes per neuron. This
  *          mode cannot retrieve exact spike times. Thus it is not possible to calculate some of the more elaborate
  *          metrics, such as spike-time correlations.
+ *          Instead, the monitor keeps a set of streaming statistics that need a fixed amount of memory per neuron
+ *          (getNeuronMeanISI, getNeuronISICV, getNeuronFanoFactor, and getPopFiringRateStdOverTime). These
+ *          statistics are maintained online, so they are available in both modes, and in COUNT mode they can also
+ *          be retrieved while recording.
  *
  * Spike data will not be recorded until the SpikeMonitor member function startRecording() is called.
- * Before any metrics can be computed, the user must call stopRecording(). In general, a new recording period
- * (the time period between startRecording and stopRecording calls) can be started at any point in time, and can
- * last any number of milliseconds. The SpikeMonitor has a PersistentMode, which is off by default. When
+ * In AER mode, the user must call stopRecording() before any metrics can be computed. In COUNT mode, metrics can also
+ * be retrieved while recording; they then cover the recording time up to the current simulation time. In general, a new
+ * recording period (the time period between startRecording and stopRecording calls) can be started at any point in
+ * time, and can last any number of milliseconds. The SpikeMonitor has a PersistentMode, which is off by default. When
  * PersistentMode is off, only the last recording period will be considered. When PersistentMode is on, all the
  * recording periods will be considered. By default, PersistentMode can be switched on/off by calling
  * setPersistentData(bool). The total time over which the metric is calculated can be retrieved by calling
@@ -190,6 +195,55 @@ class SpikeMonitor {
 	 */
 	float getMinFiringRate();
 
+	/*!
+	 * \brief returns the firing rate histogram (PSTH) of a specific neuron in the group
+	 *
+	 * This function returns the peri-stimulus time histogram of a specific neuron in the group: the firing rate
+	 * (Hz) in each time bin set up by setPSTHBins, averaged over all trials (see startTrial). Bins are accumulated
+	 * while spikes are recorded, so this function can be called at any time, even while recording.
+	 * \param[in] neurId the neuron ID (0-indexed, must be smaller than the number of neurons in the group)
+	 * \returns a vector of firing rates (Hz), one per PSTH bin
+	 * \since v3.1
+	 */
+	std::vector<float> getNeuronPSTH(int neurId);
+
+	/*!
+	 * \brief returns the mean inter-spike interval of a specific neuron in the group
+	 *
+	 * This function returns the mean inter-spike interval (ISI) of a specific neuron in the group in ms. Intervals
+	 * are only measured between spikes of the same recording period. If the neuron fired less than twice, the
+	 * function returns 0.
+	 * \param[in] neurId the neuron ID (0-indexed, must be smaller than the number of neurons in the group)
+	 * \returns mean ISI (ms)
+	 * \since v3.1
+	 */
+	float getNeuronMeanISI(int neurId);
+
+	/*!
+	 * \brief returns the coefficient of variation of the inter-spike intervals of a specific neuron in the group
+	 *
+	 * This function returns the coefficient of variation (CV; standard deviation divided by mean) of the
+	 * inter-spike intervals of a specific neuron in the group. A perfectly regular spike train has CV=0, a Poisson
+	 * spike train has CV=1. If the neuron has less than two ISIs, the function returns 0.
+	 * \param[in] neurId the neuron ID (0-indexed, must be smaller than the number of neurons in the group)
+	 * \returns the ISI CV
+	 * \since v3.1
+	 */
+	float getNeuronISICV(int neurId);
+
+	/*!
+	 * \brief returns the Fano factor of the spike counts of a specific neuron in the group
+	 *
+	 * This function returns the Fano factor (variance divided by mean) of the spike counts of a specific neuron in
+	 * the group, where spikes are counted in consecutive 100 ms time bins, starting at each startRecording. Only
+	 * complete bins are considered. If there are less than two bins, or the neuron did not fire, the function
+	 * returns 0.
+	 * \param[in] neurId the neuron ID (0-indexed, must be smaller than the number of neurons in the group)
+	 * \returns the Fano factor of the spike counts
+	 * \since v3.1
+	 */
+	float getNeuronFanoFactor(int neurId);
+
 	/*!
 	 * \brief returns the mean firing rate of a specific neuron in the group
 	 *
@@ -200,7 +254,7 @@ class SpikeMonitor {
 	 * setPersistentData(bool). The total time over which the metric is calculated can be retrieved by calling
 	 * getRecordingTotalTime().
 	 * Use getPopMeanFiringRate to find the population mean firing rate.
-	 * \param[in] neurId the neuron ID (0-indexed, must be smaller than getNumNeurons)
+	 * \param[in] neurId the neuron ID (0-indexed, must be smaller than the number of neurons in the group)
 	 */
 	float getNeuronMeanFiringRate(int neurId);
 
@@ -214,7 +268,7 @@ class SpikeMonitor {
 	 * setPersistentData(bool). The total time over which the metric is calculated can be retrieved by calling
 	 * getRecordingTotalTime().
 	 * Use getGroupNumSpikes to find the number of spikes of all the neurons in the group.
-	 * \param[in] neurId the neuron ID (0-indexed, must be smaller than getNumNeurons)
+	 * \param[in] neurId the neuron ID (0-indexed, must be smaller than the number of neurons in the group)
 	 */
 	int getNeuronNumSpikes(int neurId);
 
@@ -278,6 +332,26 @@ class SpikeMonitor {
 	 */
 	float getPopMeanFiringRate();
 
+	/*!
+	 * \brief Returns the firing rate histogram (PSTH) of the entire neuronal population
+	 *
+	 * This function returns the peri-stimulus time histogram of the group: the mean firing rate of all neurons
+	 * (Hz) in each time bin set up by setPSTHBins, averaged over all trials (see startTrial). Bins are accumulated
+	 * while spikes are recorded, so this function can be called at any time, even while recording.
+	 * A bin that has not been recorded in any trial (yet) has rate zero.
+	 * \returns a vector of firing rates (Hz), one per PSTH bin
+	 * \since v3.1
+	 */
+	std::vector<float> getPopPSTH();
+
+	/*!
+	 * \brief Returns the number of trials that contributed to the PSTHs
+	 *
+	 * \returns the number of trials (see startTrial)
+	 * \since v3.1
+	 */
+	int getNumTrials();
+
 	/*!
 	 * \brief Returns the standard deviation of firing rates in the entire neuronal population
 	 *
@@ -291,6 +365,18 @@ class SpikeMonitor {
 	 */
 	float getPopStdFiringRate();
 
+	/*!
+	 * \brief Returns the standard deviation of the population firing rate over time
+	 *
+	 * This function computes the population firing rate (spikes/sec per neuron) in consecutive 100 ms time bins,
+	 * starting at each startRecording, and returns its standard deviation across the bins (in Hz). Only complete
+	 * bins are considered. The mean of these rates is given by getPopMeanFiringRate. If there are less than two
+	 * bins, the function returns 0.
+	 * \returns the standard deviation of the population firing rate over time
+	 * \since v3.1
+	 */
+	float getPopFiringRateStdOverTime();
+
 	/*!
 	 * \brief Returns the total number of spikes in the group
 	 *
@@ -302,7 +388,7 @@ class SpikeMonitor {
 	 * getRecordingTotalTime().
 	 * Use getNeuronNumSpikes to find the number of spikes of a specific neuron in the group.
 	 */
-	int getPopNumSpikes();
+	int64_t getPopNumSpikes();
 
 	/*!
 	 *\brief returns the 2D spike vector
@@ -349,6 +435,16 @@ class SpikeMonitor {
 	 */
 	void startRecording();
 
+	/*!
+	 * \brief Starts a new trial at the current simulation time
+	 *
+	 * This function marks the current simulation time as the beginning of a new trial (e.g., the onset of a
+	 * stimulus). From now on, recorded spikes are added to the PSTH bins relative to this point in time. It can be
+	 * called while recording. setPSTHBins must be called first.
+	 * \since v3.1
+	 */
+	void startTrial();
+
 	/*!
 	 * \brief Ends a recording period
 	 *
@@ -423,6 +519,47 @@ class SpikeMonitor {
 	 */
 	void setPersistentData(bool persistentData);
 
+	/*!
+	 * \brief Sets up the time bins of the peri-stimulus time histograms (PSTHs)
+	 *
+	 * This function enables accumulation of firing rate histograms, per neuron and for the entire group, while
+	 * spikes are recorded. Histograms consist of numBins bins of binSizeMs each, aligned to the beginning of a trial.
+	 * A trial is started by calling startTrial(). If no trial was started when recording begins, the recording start
+	 * is taken as the beginning of the first trial. Spikes that occur later than numBins*binSizeMs after the
+	 * beginning of the current trial are not counted.
+	 * Memory usage is bounded by the number of neurons times numBins, no matter how long the recording is.
+	 * Histograms are cleared together with all other spike data (see clear()); in particular, if PersistentMode is
+	 * off, startRecording() discards all previous trials.
+	 * This function cannot be called while recording.
+	 * \param[in] binSizeMs size of a bin (ms)
+	 * \param[in] numBins number of bins per trial
+	 * \since v3.1
+	 */
+	void setPSTHBins(int binSizeMs, int numBins);
+
+	/*!
+	 * \brief Caps the amount of memory used to store spike times (AER mode)
+	 *
+	 * Long recordings (especially in PersistentMode) can accumulate more spike data than fits into memory. With a
+	 * memory budget set, spike data that exceeds the budget is moved to a temporary file, which is deleted
+	 * automatically when the data is cleared or the monitor is deallocated. All metrics (such as
+	 * getNeuronNumSpikes or getAllFiringRates) are computed without touching that file; only getSpikeVector2D and
+	 * print(true) read it back.
+	 * By default, there is no budget (all spike data is kept in memory).
+	 * \param[in] budgetMB memory budget (MB), or -1 to keep all spike data in memory.
+	 * \since v3.1
+	 */
+	void setMemoryBudgetMB(int budgetMB);
+
+	/*!
+	 * \brief Returns the number of bytes of spike data currently held in memory (AER mode)
+	 *
+	 * This is the size of the encoded spike times. It does not include spike data that was moved to file because of
+	 * a memory budget (see setMemoryBudgetMB), or the 2D spike vector built by getSpikeVector2D.
+	 * \since v3.1
+	 */
+	int64_t getMemoryUsageBytes();
+
 	/*!
 	 * \brief Returns the current SpikeMonitor mode
 	 *
@@ -438,12 +575,14 @@ class SpikeMonitor {
 	/*!
 	 * \brief Sets the current SpikeMonitor mode
 	 *
-	 * This function returns the current SpikeMonitor mode.
+	 * This function sets the current SpikeMonitor mode.
 	 * COUNT:	Will collect only spike count information (such as number of spikes per neuron),
 	 *          not the explicit spike times. COUNT mode cannot retrieve exact spike times per
 	 *          neuron, and is thus not capable of computing spike train correlation etc.
+	 *          However, all metrics can be retrieved while recording.
 	 * AER:     Will collect spike information in AER format (will collect both neuron IDs and
 	 *          spike times).
+	 * The mode cannot be changed while recording. Changing the mode discards all recorded data.
 	 */
 	void setMode(spikeMonMode_t mode=AER);
 
@@ -465,6 +604,23 @@ class SpikeMonitor {
 	 */
 	void setLogFile(const std::string& logFileName);
 
+	/*!
+	 * \brief Sets the spike file format to the indexed block format (version 2)
+	 *
+	 * By default, spike files consist of a flat stream of (time,neurId) pairs, which has to be read in full to
+	 * access any part of it. In the indexed format, spikes are written in compressed blocks, and an index at the end
+	 * of the file records the time range (and the neurons) of every block. A SpikeFileReader can then read an
+	 * arbitrary time window or a subset of neurons without reading the whole file.
+	 * Indexed files are written in blocks of 65536 spikes; the last block and the index are written when the file is
+	 * closed (i.e., when the SpikeMonitor is deallocated or setLogFile is called).
+	 * The format applies to the current spike file and all files set by setLogFile. It can only be changed as long
+	 * as no spikes have been written to the current file (e.g., before the first runNetwork call, or right after
+	 * setLogFile).
+	 * \param[in] indexed whether to write the indexed block format (true) or the flat format (false)
+	 * \since v3.1
+	 */
+	void setLogFileIndexed(bool indexed);
+
  private:
   //! This is a pointer to the actual implementation of the class. The user should never directly instantiate it.
   SpikeMonitorCore* spikeMonitorCorePtr_;
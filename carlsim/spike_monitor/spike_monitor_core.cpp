@@ -14,6 +14,10 @@ SpikeMonitorCore::SpikeMonitorCore(CpuSNN* snn, int monitorId, int grpId) {
 	monitorId_ = monitorId;
 	nNeurons_ = -1;
 	spikeFileId_ = NULL;
+	spillFileId_ = NULL;
+	memBudgetBytes_ = -1;
+	psthBinSizeMs_ = 0;
+	psthNumBins_ = 0;
 	recordSet_ = false;
 	spkMonLastUpdated_ = 0;
 
@@ -23,6 +27,18 @@ SpikeMonitorCore::SpikeMonitorCore(CpuSNN* snn, int monitorId, int grpId) {
 	needToWriteFileHeader_ = true;
 	spikeFileSignature_ = 206661989;
 	spikeFileVersion_ = 0.2f;
+	spikeFileIndexed_ = false;
+	spikeFileBytes_ = 0;
+	writerRunning_ = false;
+	writerBusy_ = false;
+	writerQuit_ = false;
+#if defined(WIN32) || defined(WIN64)
+	InitializeCriticalSection(&writerLock_);
+	InitializeConditionVariable(&writerCond_);
+#else
+	pthread_mutex_init(&writerLock_, NULL);
+	pthread_cond_init(&writerCond_, NULL);
+#endif
 
 	// defer all unsafe operations to init function
 	init();
@@ -32,10 +48,9 @@ void SpikeMonitorCore::init() {
 	nNeurons_ = snn_->getGroupNumNeurons(grpId_);
 	assert(nNeurons_>0);
 
-	// spike vector will be a 2D structure that holds a list of spike times for each neuron in the group
-	// so the first dimension is neuron ID, and each spkVector_[i] holds the list of spike times of that neuron
-	// fix the first dimension of spike vector
-	spkVector_.resize(nNeurons_);
+	// spikes are stored in compact AER blocks, from which the 2D spike vector (a list of spike times for each neuron
+	// in the group) is built on demand
+	spkCnt_.resize(nNeurons_);
 
 	clear();
 
@@ -47,10 +62,19 @@ void SpikeMonitorCore::init() {
 }
 
 SpikeMonitorCore::~SpikeMonitorCore() {
-	if (spikeFileId_!=NULL) {
-		fclose(spikeFileId_);
-		spikeFileId_ = NULL;
+	if (spillFileId_!=NULL) {
+		fclose(spillFileId_); // temporary file is removed automatically
+		spillFileId_ = NULL;
 	}
+	if (spikeFileId_!=NULL)
+		closeSpikeFile();
+
+#if defined(WIN32) || defined(WIN64)
+	DeleteCriticalSection(&writerLock_);
+#else
+	pthread_mutex_destroy(&writerLock_);
+	pthread_cond_destroy(&writerCond_);
+#endif
 }
 
 // +++++ PUBLIC METHODS: +++++++++++++++++++++++++++++++++++++++++++++++//
@@ -65,8 +89,33 @@ void SpikeMonitorCore::clear() {
 	accumTime_ = 0;
 	totalTime_ = -1;
 
-	for (int i=0; i<nNeurons_; i++)
-		spkVector_[i].clear();
+	aerBlocks_.clear();
+	lastAERTime_ = 0;
+	aerSizeBytes_ = 0;
+	if (spillFileId_!=NULL) {
+		fclose(spillFileId_); // temporary file is removed automatically
+		spillFileId_ = NULL;
+	}
+	spilledBytes_ = 0;
+	spkCnt_.assign(nNeurons_,0);
+	popSpkCnt_ = 0;
+
+	lastSpkTime_.assign(nNeurons_,-1);
+	isiCnt_.assign(nNeurons_,0);
+	isiMean_.assign(nNeurons_,0.0);
+	isiM2_.assign(nNeurons_,0.0);
+	binSpkCnt_.assign(nNeurons_,0);
+	binSpkSum_.assign(nNeurons_,0.0);
+	binSpkSumSq_.assign(nNeurons_,0.0);
+	popBinSpkCnt_ = 0;
+	popBinRateSum_ = 0.0;
+	popBinRateSumSq_ = 0.0;
+	numBins_ = 0;
+	binStartTime_ = 0;
+
+	resetPSTH();
+	std::vector<std::vector<int> >().swap(spkVector_);
+	needToBuildSpikeVector_ = true;
 
 	needToCalculateFiringRates_ = true;
 	needToSortFiringRates_ = true;
@@ -77,7 +126,7 @@ void SpikeMonitorCore::clear() {
 }
 
 float SpikeMonitorCore::getPopMeanFiringRate() {
-	assert(!isRecording());
+	syncRecording();
 
 	if (totalTime_==0)
 		return 0.0f;
@@ -86,7 +135,7 @@ float SpikeMonitorCore::getPopMeanFiringRate() {
 }
 
 float SpikeMonitorCore::getPopStdFiringRate() {
-	assert(!isRecording());
+	syncRecording();
 
 	if (totalTime_==0)
 		return 0.0f;
@@ -103,18 +152,44 @@ float SpikeMonitorCore::getPopStdFiringRate() {
 	return std;
 }
 
-int SpikeMonitorCore::getPopNumSpikes() {
-	assert(!isRecording());
+float SpikeMonitorCore::getPopFiringRateStdOverTime() {
+	syncRecording();
 
-	int nSpk = 0;
-	for (int i=0; i<nNeurons_; i++)
-		nSpk += getNeuronNumSpikes(i);
+	if (numBins_<2)
+		return 0.0f;
 
-	return nSpk;
+	double mean = popBinRateSum_/numBins_;
+	double var = (popBinRateSumSq_ - numBins_*mean*mean)/(numBins_-1);
+	return sqrt(std::max(var,0.0));
+}
+
+std::vector<float> SpikeMonitorCore::getPopPSTH() {
+	assert(isPSTHEnabled());
+	syncPSTH();
+
+	std::vector<float> rates(psthNumBins_, 0.0f);
+	for (int b=0; b<psthNumBins_; b++) {
+		if (psthCoveredMs_[b]>0)
+			rates[b] = psthPopCnt_[b]*1000.0/(psthCoveredMs_[b]*nNeurons_);
+	}
+
+	return rates;
+}
+
+int64_t SpikeMonitorCore::getPopNumSpikes() {
+	syncRecording();
+
+	return popSpkCnt_;
+}
+
+int64_t SpikeMonitorCore::getRecordingTotalTime() {
+	syncRecording();
+
+	return totalTime_;
 }
 
 std::vector<float> SpikeMonitorCore::getAllFiringRates() {
-	assert(!isRecording());
+	syncRecording();
 
 	// if necessary, get data structures up-to-date
 	calculateFiringRates();
@@ -123,7 +198,7 @@ std::vector<float> SpikeMonitorCore::getAllFiringRates() {
 }
 
 float SpikeMonitorCore::getMaxFiringRate() {
-	assert(!isRecording());
+	syncRecording();
 
 	std::vector<float> rates = getAllFiringRatesSorted();
 
@@ -131,7 +206,7 @@ float SpikeMonitorCore::getMaxFiringRate() {
 }
 
 float SpikeMonitorCore::getMinFiringRate(){
-	assert(!isRecording());
+	syncRecording();
 
 	std::vector<float> rates = getAllFiringRatesSorted();
 
@@ -139,22 +214,69 @@ float SpikeMonitorCore::getMinFiringRate(){
 }
 
 float SpikeMonitorCore::getNeuronMeanFiringRate(int neurId) {
-	assert(!isRecording());
+	syncRecording();
 	assert(neurId>=0 && neurId<nNeurons_);
 
+	if (totalTime_==0)
+		return 0.0f;
+
 	return getNeuronNumSpikes(neurId)*1000.0/getRecordingTotalTime();
 }
 
+std::vector<float> SpikeMonitorCore::getNeuronPSTH(int neurId) {
+	assert(isPSTHEnabled());
+	assert(neurId>=0 && neurId<nNeurons_);
+	syncPSTH();
+
+	std::vector<float> rates(psthNumBins_, 0.0f);
+	const int* cnt = &psthNeurCnt_[neurId*psthNumBins_];
+	for (int b=0; b<psthNumBins_; b++) {
+		if (psthCoveredMs_[b]>0)
+			rates[b] = cnt[b]*1000.0/psthCoveredMs_[b];
+	}
+
+	return rates;
+}
+
+float SpikeMonitorCore::getNeuronMeanISI(int neurId) {
+	syncRecording();
+	assert(neurId>=0 && neurId<nNeurons_);
+
+	return isiMean_[neurId];
+}
+
+float SpikeMonitorCore::getNeuronISICV(int neurId) {
+	syncRecording();
+	assert(neurId>=0 && neurId<nNeurons_);
+
+	// need at least two intervals for the sample standard deviation
+	if (isiCnt_[neurId]<2 || isiMean_[neurId]<=0.0)
+		return 0.0f;
+
+	return sqrt(isiM2_[neurId]/(isiCnt_[neurId]-1)) / isiMean_[neurId];
+}
+
+float SpikeMonitorCore::getNeuronFanoFactor(int neurId) {
+	syncRecording();
+	assert(neurId>=0 && neurId<nNeurons_);
+
+	if (numBins_<2 || binSpkSum_[neurId]==0.0)
+		return 0.0f;
+
+	double mean = binSpkSum_[neurId]/numBins_;
+	double var = (binSpkSumSq_[neurId] - numBins_*mean*mean)/(numBins_-1);
+	return std::max(var,0.0)/mean;
+}
+
 int SpikeMonitorCore::getNeuronNumSpikes(int neurId) {
-	assert(!isRecording());
+	syncRecording();
 	assert(neurId>=0 && neurId<nNeurons_);
-	assert(getMode()==AER);
 
-	return spkVector_[neurId].size();
+	return spkCnt_[neurId];
 }
 
 std::vector<float> SpikeMonitorCore::getAllFiringRatesSorted() {
-	assert(!isRecording());
+	syncRecording();
 
 	// if necessary, get data structures up-to-date
 	sortFiringRates();
@@ -163,7 +285,7 @@ std::vector<float> SpikeMonitorCore::getAllFiringRatesSorted() {
 }
 
 int SpikeMonitorCore::getNumNeuronsWithFiringRate(float min, float max){
-	assert(!isRecording());
+	syncRecording();
 	assert(min>=0.0f && max>=0.0f);
 	assert(max>=min);
 
@@ -182,20 +304,20 @@ int SpikeMonitorCore::getNumNeuronsWithFiringRate(float min, float max){
 }
 
 int SpikeMonitorCore::getNumSilentNeurons() {
-	assert(!isRecording());
+	syncRecording();
 
 	return getNumNeuronsWithFiringRate(0.0f, 0.0f);
 }
 
 // \TODO need to do error check on interface
 float SpikeMonitorCore::getPercentNeuronsWithFiringRate(float min, float max) {
-	assert(!isRecording());
+	syncRecording();
 
 	return getNumNeuronsWithFiringRate(min,max)*100.0/nNeurons_;
 }
 
 float SpikeMonitorCore::getPercentSilentNeurons(){
-	assert(!isRecording());
+	syncRecording();
 
 	return getNumNeuronsWithFiringRate(0,0)*100.0/nNeurons_;
 }
@@ -204,6 +326,9 @@ std::vector<std::vector<int> > SpikeMonitorCore::getSpikeVector2D(){
 	assert(!isRecording());
 	assert(mode_==AER);
 
+	// if necessary, get data structures up-to-date
+	buildSpikeVector2D();
+
 	return spkVector_;
 }
 
@@ -213,17 +338,18 @@ void SpikeMonitorCore::print(bool printSpikeTimes) {
 	// how many spike times to display per row
 	int dispSpkTimPerRow = 7;
 
-	KERNEL_INFO("(t=%.3fs) SpikeMonitor for group %s(%d) has %d spikes in %ld ms (%.2f +/- %.2f Hz)",
+	KERNEL_INFO("(t=%.3fs) SpikeMonitor for group %s(%d) has %lld spikes in %ld ms (%.2f +/- %.2f Hz)",
 		(float)(snn_->getSimTime()/1000.0),
 		snn_->getGroupName(grpId_).c_str(),
 		grpId_,
-		getPopNumSpikes(),
+		(long long)getPopNumSpikes(),
 		getRecordingTotalTime(),
 		getPopMeanFiringRate(),
 		getPopStdFiringRate());
 
 	if (printSpikeTimes && mode_==AER) {
 		// spike times only available in AER mode
+		buildSpikeVector2D();
 		KERNEL_INFO("| Neur ID | Rate (Hz) | Spike Times (ms)");
 		KERNEL_INFO("|- - - - -|- - - - - -|- - - - - - - - - - - - - - - - -- - - - - - - - - - - - -")
 
@@ -255,9 +381,56 @@ void SpikeMonitorCore::print(bool printSpikeTimes) {
 
 void SpikeMonitorCore::pushAER(int time, int neurId) {
 	assert(isRecording());
-	assert(getMode()==AER);
 
-	spkVector_[neurId].push_back(time);
+	spkCnt_[neurId]++;
+	popSpkCnt_++;
+
+	// update the streaming statistics: spikes of a group are pushed in temporal order
+	closeStatsBins(time);
+	binSpkCnt_[neurId]++;
+	popBinSpkCnt_++;
+	if (lastSpkTime_[neurId]>=0) {
+		// Welford's online algorithm for the ISI mean and variance
+		double isi = time - lastSpkTime_[neurId];
+		double delta = isi - isiMean_[neurId];
+		isiMean_[neurId] += delta/(++isiCnt_[neurId]);
+		isiM2_[neurId] += delta*(isi - isiMean_[neurId]);
+	}
+	lastSpkTime_[neurId] = time;
+
+	// accumulate the PSTHs of the current trial
+	if (psthNumBins_ && trialStartTime_>=0 && time>=trialStartTime_) {
+		int64_t bin = (time-trialStartTime_)/psthBinSizeMs_;
+		if (bin<psthNumBins_) {
+			psthNeurCnt_[neurId*psthNumBins_+bin]++;
+			psthPopCnt_[bin]++;
+		}
+	}
+
+	// COUNT mode does not store spike times
+	if (mode_!=AER)
+		return;
+
+	// store time relative to the previous spike (zigzag-encoded, because the D1 and D2 spikes of an update are not
+	// interleaved in time), which usually fits in a single byte
+	int dt = time - lastAERTime_;
+	lastAERTime_ = time;
+
+	// start a new block if the current one cannot hold another record (two varints of at most 5 bytes each)
+	if (aerBlocks_.empty() || aerBlocks_.back().size()+10 > SPIKE_MON_AER_BLOCK_SIZE) {
+		// all blocks so far are sealed now: make room if they exceed the memory budget
+		if (memBudgetBytes_>=0 && (int64_t)aerBlocks_.size()*SPIKE_MON_AER_BLOCK_SIZE > memBudgetBytes_)
+			spillAERBlocks();
+		aerBlocks_.push_back(std::vector<uint8_t>());
+		aerBlocks_.back().reserve(SPIKE_MON_AER_BLOCK_SIZE);
+	}
+	std::vector<uint8_t>& block = aerBlocks_.back();
+	size_t blockSize = block.size();
+	appendVarint(block, ((uint32_t)dt << 1) ^ (uint32_t)(dt >> 31));
+	appendVarint(block, (uint32_t)neurId);
+	aerSizeBytes_ += block.size()-blockSize;
+
+	needToBuildSpikeVector_ = true;
 }
 
 void SpikeMonitorCore::startRecording() {
@@ -275,6 +448,10 @@ void SpikeMonitorCore::startRecording() {
 	needToCalculateFiringRates_ = true;
 	needToSortFiringRates_ = true;
 	recordSet_ = true;
+
+	// the decoded spike vector would be outdated by the upcoming spikes anyway, so don't keep it around
+	std::vector<std::vector<int> >().swap(spkVector_);
+	needToBuildSpikeVector_ = true;
 	int64_t currentTime = snn_->getSimTimeSec()*1000+snn_->getSimTimeMs();
 
 	if (persistentData_) {
@@ -283,6 +460,9 @@ void SpikeMonitorCore::startRecording() {
 		startTime_ = (startTime_<0) ? currentTime : startTime_;
 		startTimeLast_ = currentTime;
 		accumTime_ = (totalTime_>0) ? totalTime_ : 0;
+
+		// there are no inter-spike intervals across recording periods
+		lastSpkTime_.assign(nNeurons_,-1);
 	}
 	else {
 		// persistent mode off: we only care about the last probe
@@ -290,6 +470,16 @@ void SpikeMonitorCore::startRecording() {
 		startTimeLast_ = currentTime;
 		accumTime_ = 0;
 	}
+
+	// time bins of the spike count statistics are aligned to the start of the recording period
+	binStartTime_ = currentTime;
+
+	// PSTH bins are aligned to the first recording period, unless the user marks trials explicitly
+	psthCoveredUntil_ = currentTime;
+	if (psthNumBins_ && trialStartTime_<0) {
+		trialStartTime_ = currentTime;
+		numTrials_ = 1;
+	}
 }
 
 void SpikeMonitorCore::stopRecording() {
@@ -300,26 +490,62 @@ void SpikeMonitorCore::stopRecording() {
 	// Caution: must be called before recordSet_ is set to false!
 	snn_->updateSpikeMonitor(grpId_);
 
+	stopTime_ = snn_->getSimTimeSec()*1000+snn_->getSimTimeMs();
+	updatePSTHCoverage(stopTime_);
+
 	recordSet_ = false;
     userHasBeenWarned_ = false;
-	stopTime_ = snn_->getSimTimeSec()*1000+snn_->getSimTimeMs();
+
+	// make the spike file complete up to this point
+	flushSpikeFile();
+
+	// fold all complete time bins into the statistics, drop the incomplete one
+	closeStatsBins(stopTime_);
+	if (popBinSpkCnt_>0) {
+		binSpkCnt_.assign(nNeurons_,0);
+		popBinSpkCnt_ = 0;
+	}
 
 	// total time is the amount of time of the last probe plus all accumulated time from previous probes
 	totalTime_ = stopTime_-startTimeLast_ + accumTime_;
 	assert(totalTime_>=0);
 }
 
+void SpikeMonitorCore::startTrial() {
+	assert(isPSTHEnabled());
+	int64_t currentTime = snn_->getSimTimeSec()*1000+snn_->getSimTimeMs();
+
+	// all spikes so far belong to the previous trial
+	syncPSTH();
+
+	// a trial that started at this very moment is simply re-marked (e.g., the implicit trial of startRecording)
+	if (trialStartTime_==currentTime)
+		return;
+
+	trialStartTime_ = currentTime;
+	psthCoveredUntil_ = currentTime;
+	numTrials_++;
+}
+
 void SpikeMonitorCore::setSpikeFileId(FILE* spikeFileId) {
 	assert(!isRecording());
 
 	// close previous file pointer if exists
-	if (spikeFileId_!=NULL) {
-		fclose(spikeFileId_);
-		spikeFileId_ = NULL;
-	}
+	if (spikeFileId_!=NULL)
+		closeSpikeFile();
 
 	// set it to new file id
 	spikeFileId_=spikeFileId;
+	spikeFileBytes_ = 0;
+	spikeFileBlockOffsets_.clear();
+	spikeFileBlockTimes_.clear();
+	spikeFileBlockNumSpikes_.clear();
+	spikeFileNeurBitmaps_.clear();
+	if (spikeFileId_!=NULL) {
+		// the two buffers are swapped by handOffSpikeFileBuffer, so both need the full capacity
+		spikeFileBuffer_.reserve(2*SPIKE_FILE_BUFFER_SIZE);
+		spikeFileWriteBuffer_.reserve(2*SPIKE_FILE_BUFFER_SIZE);
+	}
 
 	if (spikeFileId_==NULL)
 		needToWriteFileHeader_ = false;
@@ -327,6 +553,455 @@ void SpikeMonitorCore::setSpikeFileId(FILE* spikeFileId) {
 		// file pointer has changed, so we need to write header (again)
 		needToWriteFileHeader_ = true;
 		writeSpikeFileHeader();
+		startSpikeFileWriter();
+	}
+}
+
+// in a flat spike file, make all spikes so far visible to readers
+// an indexed file is only complete once it is closed, so there is no need to write incomplete blocks
+void SpikeMonitorCore::flushSpikeFile() {
+	if (spikeFileId_==NULL || spikeFileIndexed_)
+		return;
+
+	// the writer thread might still be busy with an earlier block, even if the buffer is empty
+	handOffSpikeFileBuffer();
+	waitForSpikeFileWriter();
+	fflush(spikeFileId_);
+}
+
+bool SpikeMonitorCore::isSpikeFileEmpty() {
+	// only the header section has been written so far
+	waitForSpikeFileWriter();
+	return spikeFileId_==NULL || spikeFileBytes_ <= (int64_t)(4*sizeof(int)+sizeof(float));
+}
+
+void SpikeMonitorCore::setSpikeFileIndexed(bool indexed) {
+	assert(isSpikeFileEmpty());
+
+	spikeFileIndexed_ = indexed;
+	spikeFileVersion_ = indexed ? 2.0f : 0.2f;
+
+	// the header section of the current file has the wrong version number: overwrite it
+	if (spikeFileId_!=NULL) {
+		fseek(spikeFileId_, 0, SEEK_SET);
+		spikeFileBytes_ = 0;
+		needToWriteFileHeader_ = true;
+		writeSpikeFileHeader();
+	}
+}
+
+// write (time,nid) records with one large sequential write (called by the writer thread)
+// In an indexed file, the records are encoded the same way as the AER blocks (zigzag-encoded time difference to the
+// previous spike, neuron ID), and the block is recorded in the index that is written by closeSpikeFile
+void SpikeMonitorCore::writeSpikeFileBlock(const std::vector<int>& records) {
+	if (spikeFileId_==NULL || records.empty())
+		return;
+
+	if (!spikeFileIndexed_) {
+		size_t cnt = fwrite(&records[0], sizeof(int), records.size(), spikeFileId_);
+		if (cnt != records.size())
+			KERNEL_ERROR("SpikeMonitorCore: writeSpikeFileBlock has fwrite error");
+		spikeFileBytes_ += cnt*sizeof(int);
+		return;
+	}
+
+	int numBitmapBytes = (nNeurons_+7)/8;
+	size_t bitmapPos = spikeFileNeurBitmaps_.size();
+	spikeFileNeurBitmaps_.resize(bitmapPos+numBitmapBytes, 0);
+
+	spikeFileBlock_.clear();
+	int header[4]; // numSpikes, firstTime, lastTime, numBytes
+	header[0] = records.size()/2;
+	header[1] = records[0];
+	header[2] = records[0];
+	int lastTime = records[0];
+	for (size_t i=0; i<records.size(); i+=2) {
+		int dt = records[i] - lastTime;
+		lastTime = records[i];
+		header[2] = std::max(header[2], lastTime);
+		appendVarint(spikeFileBlock_, ((uint32_t)dt << 1) ^ (uint32_t)(dt >> 31));
+		appendVarint(spikeFileBlock_, (uint32_t)records[i+1]);
+		spikeFileNeurBitmaps_[bitmapPos + records[i+1]/8] |= 1 << (records[i+1]%8);
+	}
+	header[3] = spikeFileBlock_.size();
+
+	spikeFileBlockOffsets_.push_back(spikeFileBytes_);
+	spikeFileBlockTimes_.push_back(header[1]);
+	spikeFileBlockTimes_.push_back(header[2]);
+	spikeFileBlockNumSpikes_.push_back(header[0]);
+
+	if (fwrite(header, sizeof(int), 4, spikeFileId_) != 4
+			|| fwrite(&spikeFileBlock_[0], 1, spikeFileBlock_.size(), spikeFileId_) != spikeFileBlock_.size())
+		KERNEL_ERROR("SpikeMonitorCore: writeSpikeFileBlock has fwrite error");
+	spikeFileBytes_ += 4*sizeof(int) + spikeFileBlock_.size();
+}
+
+// write the block index and the trailer that points to it
+void SpikeMonitorCore::writeSpikeFileIndex() {
+	int64_t indexOffset = spikeFileBytes_;
+	uint32_t numBlocks = spikeFileBlockOffsets_.size();
+	bool ok = true;
+	for (uint32_t b=0; b<numBlocks; b++) {
+		ok &= fwrite(&spikeFileBlockOffsets_[b], sizeof(int64_t), 1, spikeFileId_)==1;
+		ok &= fwrite(&spikeFileBlockTimes_[2*b], sizeof(int), 2, spikeFileId_)==2;
+		ok &= fwrite(&spikeFileBlockNumSpikes_[b], sizeof(uint32_t), 1, spikeFileId_)==1;
+	}
+
+	uint32_t numBitmapBytes = numBlocks ? (nNeurons_+7)/8 : 0;
+	ok &= fwrite(&numBitmapBytes, sizeof(uint32_t), 1, spikeFileId_)==1;
+	if (numBlocks)
+		ok &= fwrite(&spikeFileNeurBitmaps_[0], 1, spikeFileNeurBitmaps_.size(), spikeFileId_)
+			== spikeFileNeurBitmaps_.size();
+
+	ok &= fwrite(&indexOffset, sizeof(int64_t), 1, spikeFileId_)==1;
+	ok &= fwrite(&numBlocks, sizeof(uint32_t), 1, spikeFileId_)==1;
+	ok &= fwrite(&spikeFileSignature_, sizeof(int), 1, spikeFileId_)==1;
+	if (!ok)
+		KERNEL_ERROR("SpikeMonitorCore: writeSpikeFileIndex has fwrite error");
+}
+
+void SpikeMonitorCore::closeSpikeFile() {
+	assert(spikeFileId_!=NULL);
+
+	handOffSpikeFileBuffer();
+	stopSpikeFileWriter();
+	if (spikeFileIndexed_)
+		writeSpikeFileIndex();
+	fclose(spikeFileId_);
+	spikeFileId_ = NULL;
+}
+
+void SpikeMonitorCore::startSpikeFileWriter() {
+	assert(!writerRunning_);
+	writerBusy_ = false;
+	writerQuit_ = false;
+#if defined(WIN32) || defined(WIN64)
+	writerThread_ = CreateThread(NULL, 0, spikeFileWriterThread, this, 0, NULL);
+	writerRunning_ = writerThread_ != NULL;
+#else
+	writerRunning_ = pthread_create(&writerThread_, NULL, spikeFileWriterThread, this) == 0;
+#endif
+
+	// without a writer thread, handed-off buffers are simply written in place
+	if (!writerRunning_)
+		KERNEL_WARN("SpikeMonitorCore: could not start spike file writer thread, writing synchronously");
+}
+
+void SpikeMonitorCore::stopSpikeFileWriter() {
+	if (!writerRunning_)
+		return;
+
+#if defined(WIN32) || defined(WIN64)
+	EnterCriticalSection(&writerLock_);
+	writerQuit_ = true;
+	WakeAllConditionVariable(&writerCond_);
+	LeaveCriticalSection(&writerLock_);
+	WaitForSingleObject(writerThread_, INFINITE);
+	CloseHandle(writerThread_);
+#else
+	pthread_mutex_lock(&writerLock_);
+	writerQuit_ = true;
+	pthread_cond_broadcast(&writerCond_);
+	pthread_mutex_unlock(&writerLock_);
+	pthread_join(writerThread_, NULL);
+#endif
+	writerRunning_ = false;
+}
+
+void SpikeMonitorCore::waitForSpikeFileWriter() {
+	if (!writerRunning_)
+		return;
+
+#if defined(WIN32) || defined(WIN64)
+	EnterCriticalSection(&writerLock_);
+	while (writerBusy_)
+		SleepConditionVariableCS(&writerCond_, &writerLock_, INFINITE);
+	LeaveCriticalSection(&writerLock_);
+#else
+	pthread_mutex_lock(&writerLock_);
+	while (writerBusy_)
+		pthread_cond_wait(&writerCond_, &writerLock_);
+	pthread_mutex_unlock(&writerLock_);
+#endif
+}
+
+void SpikeMonitorCore::handOffSpikeFileBuffer() {
+	if (spikeFileBuffer_.empty())
+		return;
+
+	if (!writerRunning_) {
+		writeSpikeFileBlock(spikeFileBuffer_);
+		spikeFileBuffer_.clear();
+		return;
+	}
+
+	// the writer thread can only take one buffer at a time: if it is still busy with the previous one, the disk
+	// cannot keep up and we have to wait
+	waitForSpikeFileWriter();
+	spikeFileBuffer_.swap(spikeFileWriteBuffer_);
+
+#if defined(WIN32) || defined(WIN64)
+	EnterCriticalSection(&writerLock_);
+	writerBusy_ = true;
+	WakeAllConditionVariable(&writerCond_);
+	LeaveCriticalSection(&writerLock_);
+#else
+	pthread_mutex_lock(&writerLock_);
+	writerBusy_ = true;
+	pthread_cond_broadcast(&writerCond_);
+	pthread_mutex_unlock(&writerLock_);
+#endif
+}
+
+void SpikeMonitorCore::runSpikeFileWriter() {
+#if defined(WIN32) || defined(WIN64)
+	EnterCriticalSection(&writerLock_);
+	while (true) {
+		while (!writerBusy_ && !writerQuit_)
+			SleepConditionVariableCS(&writerCond_, &writerLock_, INFINITE);
+		if (!writerBusy_)
+			break;
+		LeaveCriticalSection(&writerLock_);
+
+		writeSpikeFileBlock(spikeFileWriteBuffer_);
+		spikeFileWriteBuffer_.clear();
+
+		EnterCriticalSection(&writerLock_);
+		writerBusy_ = false;
+		WakeAllConditionVariable(&writerCond_);
+	}
+	LeaveCriticalSection(&writerLock_);
+#else
+	pthread_mutex_lock(&writerLock_);
+	while (true) {
+		while (!writerBusy_ && !writerQuit_)
+			pthread_cond_wait(&writerCond_, &writerLock_);
+		if (!writerBusy_)
+			break;
+		pthread_mutex_unlock(&writerLock_);
+
+		writeSpikeFileBlock(spikeFileWriteBuffer_);
+		spikeFileWriteBuffer_.clear();
+
+		pthread_mutex_lock(&writerLock_);
+		writerBusy_ = false;
+		pthread_cond_broadcast(&writerCond_);
+	}
+	pthread_mutex_unlock(&writerLock_);
+#endif
+}
+
+#if defined(WIN32) || defined(WIN64)
+DWORD WINAPI SpikeMonitorCore::spikeFileWriterThread(LPVOID core) {
+	((SpikeMonitorCore*)core)->runSpikeFileWriter();
+	return 0;
+}
+#else
+void* SpikeMonitorCore::spikeFileWriterThread(void* core) {
+	((SpikeMonitorCore*)core)->runSpikeFileWriter();
+	return NULL;
+}
+#endif
+
+// append a varint (7 bits per byte, MSB set on all but the last byte) to a byte buffer
+void SpikeMonitorCore::appendVarint(std::vector<uint8_t>& buf, uint32_t val) {
+	while (val >= 0x80) {
+		buf.push_back((uint8_t)(val | 0x80));
+		val >>= 7;
+	}
+	buf.push_back((uint8_t)val);
+}
+
+// decode the AER blocks into a list of spike times for each neuron if we haven't done so already
+void SpikeMonitorCore::buildSpikeVector2D() {
+	// only update if we have to
+	if (!needToBuildSpikeVector_)
+		return;
+
+	spkVector_.assign(nNeurons_, std::vector<int>());
+	for (int i=0; i<nNeurons_; i++)
+		spkVector_[i].reserve(spkCnt_[i]);
+
+	int time = 0;
+
+	// the oldest blocks may have been spilled to file: stream them back one by one
+	if (spillFileId_!=NULL) {
+		std::vector<uint8_t> block(SPIKE_MON_AER_BLOCK_SIZE);
+		uint32_t blockSize;
+		int64_t readBytes = 0;
+		rewind(spillFileId_);
+		while (readBytes < spilledBytes_) {
+			if (fread(&blockSize, sizeof(uint32_t), 1, spillFileId_)!=1 || blockSize > SPIKE_MON_AER_BLOCK_SIZE
+					|| fread(&block[0], 1, blockSize, spillFileId_)!=blockSize) {
+				KERNEL_ERROR("SpikeMonitorCore: buildSpikeVector2D could not read spill file");
+				break;
+			}
+			decodeAERBlock(&block[0], &block[0]+blockSize, time);
+			readBytes += blockSize;
+		}
+
+		// further blocks are appended right after the last complete one, which is where reading stopped (an
+		// incomplete record from a failed spill is overwritten); switching from reading to writing needs a seek
+		fseek(spillFileId_, 0, SEEK_CUR);
+	}
+
+	for (size_t b=0; b<aerBlocks_.size(); b++) {
+		if (!aerBlocks_[b].empty())
+			decodeAERBlock(&aerBlocks_[b][0], &aerBlocks_[b][0]+aerBlocks_[b].size(), time);
+	}
+
+	needToBuildSpikeVector_ = false;
+}
+
+// decode (time,neurId) varint pairs; time is the running spike time, carried over from block to block
+void SpikeMonitorCore::decodeAERBlock(const uint8_t* pos, const uint8_t* end, int& time) {
+	while (pos < end) {
+		uint32_t val[2];
+		for (int k=0; k<2; k++) {
+			val[k] = 0;
+			int shift = 0;
+			do {
+				val[k] |= (uint32_t)(*pos & 0x7F) << shift;
+				shift += 7;
+			} while (*pos++ & 0x80);
+		}
+		time += (int)(val[0] >> 1) ^ -(int)(val[0] & 1);
+		assert(val[1] < (uint32_t)nNeurons_);
+		spkVector_[val[1]].push_back(time);
+	}
+}
+
+// append all sealed AER blocks to the spill file and free their memory
+void SpikeMonitorCore::spillAERBlocks() {
+	if (spillFileId_==NULL) {
+		spillFileId_ = tmpfile();
+		if (spillFileId_==NULL) {
+			KERNEL_WARN("SpikeMonitorCore: could not create spill file for group %d, keeping all spikes in memory",
+				grpId_);
+			memBudgetBytes_ = -1;
+			return;
+		}
+	}
+
+	size_t numSpilled = 0;
+	for (; numSpilled<aerBlocks_.size(); numSpilled++) {
+		uint32_t blockSize = aerBlocks_[numSpilled].size();
+		long recordBytes = fwrite(&blockSize, sizeof(uint32_t), 1, spillFileId_)*sizeof(uint32_t);
+		if (recordBytes==sizeof(uint32_t))
+			recordBytes += fwrite(&aerBlocks_[numSpilled][0], 1, blockSize, spillFileId_);
+
+		if (recordBytes!=(long)(sizeof(uint32_t)+blockSize)) {
+			// move back to the start of the incomplete record, so that it is overwritten by the next spill (reading
+			// stops after spilledBytes_ anyway); this block and all later ones stay in memory
+			KERNEL_ERROR("SpikeMonitorCore: spillAERBlocks has fwrite error, keeping the remaining spikes of group %d "
+				"in memory", grpId_);
+			clearerr(spillFileId_);
+			fseek(spillFileId_, -recordBytes, SEEK_CUR);
+			memBudgetBytes_ = -1;
+			break;
+		}
+		spilledBytes_ += blockSize;
+	}
+
+	// blocks that made it to the file must not be spilled again
+	aerBlocks_.erase(aerBlocks_.begin(), aerBlocks_.begin()+numSpilled);
+}
+
+void SpikeMonitorCore::setMode(spikeMonMode_t mode) {
+	assert(!isRecording());
+
+	// data recorded in one mode is incomplete in the other
+	if (mode!=mode_) {
+		mode_ = mode;
+		clear();
+	}
+}
+
+void SpikeMonitorCore::setPSTHBins(int binSizeMs, int numBins) {
+	assert(!isRecording());
+	assert(binSizeMs>0 && numBins>0);
+
+	psthBinSizeMs_ = binSizeMs;
+	psthNumBins_ = numBins;
+	resetPSTH();
+}
+
+// PSTHs are accumulated while spikes are pushed: while recording, pull in all spikes up to the current time
+void SpikeMonitorCore::syncPSTH() {
+	if (!isRecording())
+		return;
+
+	snn_->updateSpikeMonitor(grpId_);
+	updatePSTHCoverage(snn_->getSimTimeSec()*1000+snn_->getSimTimeMs());
+}
+
+// credit the recording time [psthCoveredUntil_,time) to the bins of the current trial it falls into
+void SpikeMonitorCore::updatePSTHCoverage(int64_t time) {
+	if (!psthNumBins_ || trialStartTime_<0 || !isRecording())
+		return;
+
+	int64_t from = std::max(psthCoveredUntil_, trialStartTime_) - trialStartTime_;
+	int64_t to = std::min(time-trialStartTime_, (int64_t)psthBinSizeMs_*psthNumBins_);
+	while (from < to) {
+		int bin = from/psthBinSizeMs_;
+		int64_t binEnd = std::min((int64_t)(bin+1)*psthBinSizeMs_, to);
+		psthCoveredMs_[bin] += binEnd-from;
+		from = binEnd;
+	}
+	psthCoveredUntil_ = std::max(psthCoveredUntil_, time);
+}
+
+void SpikeMonitorCore::resetPSTH() {
+	psthNeurCnt_.assign((size_t)nNeurons_*psthNumBins_, 0);
+	psthPopCnt_.assign(psthNumBins_, 0);
+	psthCoveredMs_.assign(psthNumBins_, 0);
+	numTrials_ = 0;
+	trialStartTime_ = -1;
+	psthCoveredUntil_ = -1;
+}
+
+// in COUNT mode, metrics can be retrieved while recording: this pulls in all spikes up to the current time and
+// treats the current time as the end of the recording period (without actually stopping the recording)
+void SpikeMonitorCore::syncRecording() {
+	if (!isRecording())
+		return;
+	assert(mode_==COUNT);
+
+	snn_->updateSpikeMonitor(grpId_);
+
+	int64_t currentTime = snn_->getSimTimeSec()*1000+snn_->getSimTimeMs();
+	closeStatsBins(currentTime);
+	if (totalTime_ != currentTime-startTimeLast_+accumTime_) {
+		totalTime_ = currentTime-startTimeLast_+accumTime_;
+		needToCalculateFiringRates_ = true;
+		needToSortFiringRates_ = true;
+	}
+}
+
+// a time bin [binStartTime_, binStartTime_+SPIKE_MON_STATS_BIN_MS) is complete once time has reached its end
+void SpikeMonitorCore::closeStatsBins(int64_t time) {
+	while (binStartTime_+SPIKE_MON_STATS_BIN_MS <= time) {
+		if (!popBinSpkCnt_) {
+			// all spike counts are zero: skip all complete bins at once
+			int64_t numEmpty = (time-binStartTime_)/SPIKE_MON_STATS_BIN_MS;
+			numBins_ += numEmpty;
+			binStartTime_ += numEmpty*SPIKE_MON_STATS_BIN_MS;
+			break;
+		}
+
+		for (int i=0; i<nNeurons_; i++) {
+			binSpkSum_[i] += binSpkCnt_[i];
+			binSpkSumSq_[i] += (double)binSpkCnt_[i]*binSpkCnt_[i];
+		}
+		binSpkCnt_.assign(nNeurons_,0);
+
+		double rate = popBinSpkCnt_*1000.0/(SPIKE_MON_STATS_BIN_MS*nNeurons_);
+		popBinRateSum_ += rate;
+		popBinRateSumSq_ += rate*rate;
+		popBinSpkCnt_ = 0;
+
+		numBins_++;
+		binStartTime_ += SPIKE_MON_STATS_BIN_MS;
 	}
 }
 
@@ -336,8 +1011,6 @@ void SpikeMonitorCore::calculateFiringRates() {
 	if (!needToCalculateFiringRates_)
 		return;
 
-	assert(getMode()==AER);
-
 	// clear, so we get the same answer every time.
 	firingRates_.assign(nNeurons_,0);
 	firingRatesSorted_.assign(nNeurons_,0);
@@ -351,7 +1024,7 @@ void SpikeMonitorCore::calculateFiringRates() {
 	// compute firing rate
 	assert(totalTime_>0); // avoid division by zero
 	for(int i=0;i<nNeurons_;i++) {
-		firingRates_[i]=spkVector_[i].size()*1000.0f/totalTime_;
+		firingRates_[i]=spkCnt_[i]*1000.0f/totalTime_;
 	}
 
 	needToCalculateFiringRates_ = false;
@@ -400,19 +1073,15 @@ void SpikeMonitorCore::writeSpikeFileHeader() {
 	if (!fwrite(&tmpInt,sizeof(int),1,spikeFileId_))
 		KERNEL_ERROR("SpikeMonitorCore: writeSpikeFileHeader has fwrite error");
 
-
+	spikeFileBytes_ += 4*sizeof(int)+sizeof(float);
 	needToWriteFileHeader_ = false;
 }
 
-// Iterate through 2D spike vector and approximate size in memory.
-// This is not exact, we are not counting the buffer overhead, only
-// the size each subvector is memory.
+// Size of the encoded AER data in memory (spilled blocks don't count).
+// This is not exact, we are not counting the unused tail of the last block or
+// the 2D spike vector, which is only built on demand.
 int64_t SpikeMonitorCore::getBufferSize(){
-    int64_t bufferSize=0; // in bytes
-    for(int i=0; i<spkVector_.size();i++){
-        bufferSize+=spkVector_[i].size()*sizeof(int);
-    }
-    return bufferSize;
+    return aerSizeBytes_-spilledBytes_;
 }
 
 // check if the spike vector is getting large. If it is, return true once until
@@ -46,6 +46,13 @@
 #include <stdio.h>					// FILE
 #include <stdint.h>					// int64_t
 #include <vector>					// std::vector
+#include <deque>					// std::deque
+
+#if defined(WIN32) || defined(WIN64)
+	#include <Windows.h>			// background spike file writer
+#else
+	#include <pthread.h>			// background spike file writer
+#endif
 
 class CpuSNN; // forward declaration of CpuSNN class
 
@@ -96,6 +103,21 @@ public:
 	//! returns the SpikeMonitor ID
 	int getMonitorId() { return monitorId_; }
 
+	//! returns the firing rate histogram (PSTH) of a specific neuron, averaged over trials
+	std::vector<float> getNeuronPSTH(int neurId);
+
+	//! returns the number of trials that have contributed to the PSTHs
+	int getNumTrials() { return numTrials_; }
+
+	//! returns the coefficient of variation of the inter-spike intervals of a specific neuron
+	float getNeuronISICV(int neurId);
+
+	//! returns the Fano factor of the spike counts of a specific neuron (over bins of SPIKE_MON_STATS_BIN_MS)
+	float getNeuronFanoFactor(int neurId);
+
+	//! returns the mean inter-spike interval (ms) of a specific neuron
+	float getNeuronMeanISI(int neurId);
+
 	//! returns the recorded mean firing rate for a specific neuron
 	float getNeuronMeanFiringRate(int neurId);
 
@@ -117,17 +139,23 @@ public:
 	//! returns status of PersistentData mode
 	bool getPersistentData() { return persistentData_; }
 
+	//! returns the standard deviation of the population firing rate over time (bins of SPIKE_MON_STATS_BIN_MS)
+	float getPopFiringRateStdOverTime();
+
 	//! returns the recorded mean firing rate of the group
 	float getPopMeanFiringRate();
 
+	//! returns the population firing rate histogram (PSTH), averaged over trials
+	std::vector<float> getPopPSTH();
+
 	//! returns the total number of recorded spikes in the group
-	int getPopNumSpikes();
+	int64_t getPopNumSpikes();
 
 	//! computes the standard deviation of firing rates in the group
 	float getPopStdFiringRate();
 
 	//! returns the total recorded time in ms
-	int64_t getRecordingTotalTime() { return totalTime_; }
+	int64_t getRecordingTotalTime();
 
 	//! retunrs the timestamp of the first startRecording in ms
 	int64_t getRecordingStartTime() { return startTime_; }
@@ -141,6 +169,9 @@ public:
 	//! returns the 2D AER vector
 	std::vector<std::vector<int> > getSpikeVector2D();
 
+	//! returns whether PSTH accumulation has been set up (see setPSTHBins)
+	bool isPSTHEnabled() { return psthNumBins_>0; }
+
 	//! returns recording status
 	bool isRecording() { return recordSet_; }
 
@@ -150,18 +181,27 @@ public:
 	//! inserts a (time,neurId) tupel into the 2D spike vector
 	void pushAER(int time, int neurId);
 
-	//! sets recording mode
-	void setMode(spikeMonMode_t mode) { mode_ = mode; }
+	//! sets recording mode (discards all recorded data if the mode changes)
+	void setMode(spikeMonMode_t mode);
+
+	//! enables PSTH accumulation with numBins bins of binSizeMs (discards all accumulated histograms)
+	void setPSTHBins(int binSizeMs, int numBins);
 
 	//! sets status of PersistentData mode
 	void setPersistentData(bool persistentData) { persistentData_ = persistentData; }
 
+	//! sets the number of bytes of AER data kept in memory before sealed blocks are spilled to file (-1: no limit)
+	void setMemoryBudget(int64_t budgetBytes) { memBudgetBytes_ = budgetBytes; }
+
 	//! starts recording AER data
 	void startRecording();
 
 	//! stops recording AER data
 	void stopRecording();
 
+	//! marks the current time as the start of a new trial, to which the PSTH bins are aligned
+	void startTrial();
+
 
 	// +++++ PUBLIC METHODS THAT SHOULD NOT BE EXPOSED TO INTERFACE +++++++++//
 
@@ -174,6 +214,28 @@ public:
 	//! sets pointer to spike file
 	void setSpikeFileId(FILE* spikeFileId);
 
+	//! returns true if no spikes have been written to the spike file yet (not counting the buffer)
+	bool isSpikeFileEmpty();
+
+	//! returns whether spike files are written in the indexed block format (version 2.x)
+	bool isSpikeFileIndexed() { return spikeFileIndexed_; }
+
+	//! switches between flat and indexed spike file format (current file must be empty)
+	void setSpikeFileIndexed(bool indexed);
+
+	//! appends a (time,neurId) record to the spike file buffer, which is handed to the writer thread once it is full
+	void writeSpikeToFile(int time, int neurId) {
+		// the buffer capacity is reserved in setSpikeFileId
+		if (spikeFileBuffer_.size()+2 > spikeFileBuffer_.capacity())
+			handOffSpikeFileBuffer();
+		spikeFileBuffer_.push_back(time);
+		spikeFileBuffer_.push_back(neurId);
+	}
+
+	//! writes all buffered spikes to a flat spike file and flushes the file, waiting for the writer thread to finish
+	//! (indexed files are only written once a block is full, or when the file is closed)
+	void flushSpikeFile();
+
 	//! returns timestamp of last SpikeMonitor update
 	int64_t getLastUpdated() { return spkMonLastUpdated_; }
 
@@ -193,6 +255,21 @@ private:
 	//! initialization method
 	void init();
 
+	//! in COUNT mode, brings spike counts, statistics, and recording time up-to-date while recording
+	void syncRecording();
+
+	//! folds the spike counts of all time bins that end at or before time into the spike count statistics
+	void closeStatsBins(int64_t time);
+
+	//! brings the PSTHs up-to-date while recording
+	void syncPSTH();
+
+	//! credits the recording time up to time to the PSTH bins of the current trial
+	void updatePSTHCoverage(int64_t time);
+
+	//! discards all accumulated PSTHs and trials
+	void resetPSTH();
+
 	//! reads AER vector and updates firing rate member var
 	void calculateFiringRates();
 
@@ -202,6 +279,52 @@ private:
 	//! writes the header section (file signature, version number) of a spike file
 	void writeSpikeFileHeader();
 
+	//! writes (time,nid) records to the spike file, as a compressed block if the file is indexed
+	void writeSpikeFileBlock(const std::vector<int>& records);
+
+	//! starts the thread that writes full spike file buffers in the background
+	void startSpikeFileWriter();
+
+	//! waits for the writer thread to finish its current block and stops it
+	void stopSpikeFileWriter();
+
+	//! waits until the writer thread has finished writing its current block
+	void waitForSpikeFileWriter();
+
+	//! hands all buffered spikes to the writer thread and continues with an empty buffer
+	void handOffSpikeFileBuffer();
+
+	//! main loop of the writer thread: writes every handed-off buffer until told to quit
+	void runSpikeFileWriter();
+
+	//! entry point of the writer thread
+#if defined(WIN32) || defined(WIN64)
+	static DWORD WINAPI spikeFileWriterThread(LPVOID core);
+#else
+	static void* spikeFileWriterThread(void* core);
+#endif
+
+	//! writes the block index at the end of an indexed spike file
+	void writeSpikeFileIndex();
+
+	//! writes all remaining data (and the index) to the spike file and closes it
+	void closeSpikeFile();
+
+	//! decodes the AER blocks into the per-neuron spike vector if we haven't done so already
+	void buildSpikeVector2D();
+
+	//! appends an unsigned integer to a byte buffer using a variable-length (7 bits per byte) encoding
+	static void appendVarint(std::vector<uint8_t>& buf, uint32_t val);
+
+	//! decodes the (time,neurId) records of an AER block and appends them to the 2D spike vector
+	void decodeAERBlock(const uint8_t* pos, const uint8_t* end, int& time);
+
+	//! moves all sealed AER blocks from memory to the spill file
+	void spillAERBlocks();
+
+	//! whether we have to perform buildSpikeVector2D()
+	bool needToBuildSpikeVector_;
+
 	//! whether we have to perform calculateFiringRates()
 	bool needToCalculateFiringRates_;
 
@@ -217,10 +340,76 @@ private:
 	int nNeurons_;	//!< number of neurons in the group
 
 	FILE* spikeFileId_;	//!< file pointer to the spike file or NULL
+	std::vector<int> spikeFileBuffer_; //!< (time,nid) records that have not been written to the spike file yet
+
+	// Full buffers are written by a background thread, so that the simulation does not wait for the disk. The
+	// buffers are swapped when the thread is idle; everything below is owned by the thread while writerBusy_ is set.
+	std::vector<int> spikeFileWriteBuffer_;	//!< (time,nid) records the writer thread is currently writing
+	bool writerRunning_;					//!< whether the writer thread has been started
+	bool writerBusy_;						//!< whether the writer thread owns spikeFileWriteBuffer_
+	bool writerQuit_;						//!< tells the writer thread to exit
+#if defined(WIN32) || defined(WIN64)
+	HANDLE writerThread_;
+	CRITICAL_SECTION writerLock_;
+	CONDITION_VARIABLE writerCond_;
+#else
+	pthread_t writerThread_;
+	pthread_mutex_t writerLock_;
+	pthread_cond_t writerCond_;
+#endif
 	int spikeFileSignature_; //!< int signature of spike file
 	float spikeFileVersion_; //!< version number of spike file
-
-	//! Used to analyzed the spike information
+	int64_t spikeFileBytes_; //!< number of bytes written to the spike file (ftell returns a 32-bit long on Windows)
+
+	// indexed spike file format (see SpikeFileReader for a description)
+	bool spikeFileIndexed_;						//!< whether the spike file is written in indexed block format
+	std::vector<uint8_t> spikeFileBlock_;		//!< encoding buffer for the next block
+	std::vector<int64_t> spikeFileBlockOffsets_;//!< file offsets of all blocks written so far
+	std::vector<int> spikeFileBlockTimes_;		//!< (firstTime,lastTime) of all blocks written so far
+	std::vector<uint32_t> spikeFileBlockNumSpikes_; //!< number of spikes of all blocks written so far
+	std::vector<uint8_t> spikeFileNeurBitmaps_;	//!< per block, a bitmap of all neurons that spiked in it
+
+	//! Recorded spikes in the order they were pushed, encoded as a stream of (zigzag-encoded time difference to the
+	//! previous spike, neuron ID) varint pairs. The stream is split into blocks of SPIKE_MON_AER_BLOCK_SIZE bytes,
+	//! so that recording never has to move data that is already stored. A deque is used because growing it does not
+	//! copy the blocks it already holds (unlike a vector of vectors in C++03).
+	std::deque<std::vector<uint8_t> > aerBlocks_;
+	int lastAERTime_;			//!< time (ms) of the last spike pushed to the AER blocks
+	int64_t aerSizeBytes_;		//!< number of bytes used in the AER blocks
+	std::vector<int> spkCnt_;	//!< number of recorded spikes per neuron
+	int64_t memBudgetBytes_;	//!< max number of bytes in aerBlocks_ before they are spilled, or -1 (no limit)
+	FILE* spillFileId_;			//!< temporary file holding the oldest AER blocks (length-prefixed), or NULL
+	int64_t spilledBytes_;		//!< number of AER bytes in the spill file
+	int64_t popSpkCnt_;			//!< number of recorded spikes in the group
+
+	// Streaming spike statistics, which are updated in both modes. Spike counts are collected in time bins of
+	// SPIKE_MON_STATS_BIN_MS (aligned to the last startRecording); only complete bins enter the statistics.
+	std::vector<int> lastSpkTime_;		//!< time (ms) of the last recorded spike per neuron, or -1
+	std::vector<int> isiCnt_;			//!< number of recorded inter-spike intervals per neuron
+	std::vector<double> isiMean_;		//!< running mean of the inter-spike intervals (ms) per neuron
+	std::vector<double> isiM2_;			//!< running sum of squared ISI deviations per neuron (Welford)
+	std::vector<int> binSpkCnt_;		//!< number of spikes per neuron in the current time bin
+	std::vector<double> binSpkSum_;		//!< sum of the spike counts of all complete time bins per neuron
+	std::vector<double> binSpkSumSq_;	//!< sum of the squared spike counts of all complete time bins per neuron
+	int popBinSpkCnt_;					//!< number of spikes in the group in the current time bin
+	double popBinRateSum_;				//!< sum of the population firing rates (Hz) of all complete time bins
+	double popBinRateSumSq_;			//!< sum of the squared population firing rates of all complete time bins
+	int64_t numBins_;					//!< number of complete time bins
+	int64_t binStartTime_;				//!< time (ms) at which the current time bin started
+
+	// Peri-stimulus time histograms: spikes are counted in psthNumBins_ bins of psthBinSizeMs_, aligned to the start
+	// of the current trial. Because a trial may end early (or recording may be paused), every bin also keeps track
+	// of the amount of recording time it has covered, summed over all trials.
+	int psthBinSizeMs_;					//!< size of a PSTH bin (ms)
+	int psthNumBins_;					//!< number of PSTH bins per trial, or 0 (PSTH off)
+	std::vector<int> psthNeurCnt_;		//!< spike counts per neuron and bin (neuron-major), summed over trials
+	std::vector<int> psthPopCnt_;		//!< spike counts of the group per bin, summed over trials
+	std::vector<int64_t> psthCoveredMs_;//!< recording time (ms) covered by each bin, summed over trials
+	int numTrials_;						//!< number of trials so far
+	int64_t trialStartTime_;			//!< time (ms) at which the current trial started, or -1
+	int64_t psthCoveredUntil_;			//!< time (ms) up to which the recording time has been credited to the bins
+
+	//! per-neuron spike times, decoded from the AER blocks on demand (see buildSpikeVector2D)
 	std::vector<std::vector<int> > spkVector_;
 
 	std::vector<float> firingRates_;
@@ -0,0 +1,225 @@
+#include <spike_stream.h>
+
+#include <errno.h>				// errno, EEXIST
+#include <string.h>				// memcpy, memset
+
+#if defined(WIN32) || defined(WIN64)
+	// shared-memory spike streams are not supported on Windows
+#else
+	#include <sys/mman.h>		// shm_open, shm_unlink, mmap, munmap
+	#include <sys/stat.h>		// fstat
+	#include <fcntl.h>			// O_* constants
+	#include <unistd.h>			// ftruncate, close
+#endif
+
+namespace {
+	// total size of a stream with the given number of slots
+	size_t streamSize(uint32_t capacity) {
+		return sizeof(SpikeStreamHeader) + (size_t)capacity*sizeof(SpikeStreamSlot);
+	}
+}
+
+// ******************************************************************************************************************** //
+// SPIKE STREAM WRITER
+// ******************************************************************************************************************** //
+
+SpikeStreamWriter::SpikeStreamWriter(const std::string& name, int capacity, bool replaceExisting)
+	: name_(getShmName(name)), capacity_(1), size_(0), header_(NULL), slots_(NULL), writeIdx_(0)
+{
+	while (capacity_ < capacity && capacity_ < SPIKE_STREAM_MAX_CAPACITY)
+		capacity_ <<= 1;
+
+#if defined(WIN32) || defined(WIN64)
+	// not supported, isOpen() returns false
+#else
+	size_t size = streamSize(capacity_);
+
+	// an existing stream might belong to another simulation that is still running, so it is only replaced if asked to
+	int fd = shm_open(name_.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+	if (fd < 0 && errno == EEXIST && replaceExisting) {
+		shm_unlink(name_.c_str());
+		fd = shm_open(name_.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+	}
+	if (fd < 0)
+		return;
+	if (ftruncate(fd, size) != 0) {
+		close(fd);
+		shm_unlink(name_.c_str());
+		return;
+	}
+	void* addr = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	close(fd);
+	if (addr == MAP_FAILED) {
+		shm_unlink(name_.c_str());
+		return;
+	}
+
+	size_ = size;
+	slots_ = (SpikeStreamSlot*)((char*)addr + sizeof(SpikeStreamHeader));
+
+	// the object is zero-filled by ftruncate, fill in the header and publish it last
+	SpikeStreamHeader* header = (SpikeStreamHeader*)addr;
+	header->version = SPIKE_STREAM_VERSION;
+	header->capacity = capacity_;
+	header->slotSize = sizeof(SpikeStreamSlot);
+	header->claimIdx = 0;
+	header->writeIdx = 0;
+	header->lastTimeMs = -1;
+	__atomic_store_n(&header->signature, (uint32_t)SPIKE_STREAM_SIGNATURE, __ATOMIC_RELEASE);
+	header_ = header;
+#endif
+}
+
+std::string SpikeStreamWriter::getShmName(const std::string& name) {
+	return (!name.empty() && name[0]=='/') ? name : "/" + name;
+}
+
+SpikeStreamWriter::~SpikeStreamWriter() {
+#if !(defined(WIN32) || defined(WIN64))
+	if (header_ != NULL) {
+		munmap(header_, size_);
+		shm_unlink(name_.c_str());
+	}
+#endif
+}
+
+void SpikeStreamWriter::publish(int timeMs) {
+	if (header_ == NULL)
+		return;
+
+#if !(defined(WIN32) || defined(WIN64))
+	uint64_t n = pending_.size();
+	if (n) {
+		// announce which slots are about to be overwritten before touching them
+		__atomic_store_n(&header_->claimIdx, writeIdx_+n, __ATOMIC_RELAXED);
+		__atomic_thread_fence(__ATOMIC_RELEASE);
+
+		// copy in at most two chunks (the second one if the ring buffer wraps around); if there are more spikes than
+		// slots, only the last capacity spikes survive
+		uint64_t mask = capacity_-1;
+		size_t skip = (n > (uint64_t)capacity_) ? n-capacity_ : 0;
+		uint64_t idx = writeIdx_ + skip;
+		size_t left = n - skip;
+		const SpikeStreamSlot* src = &pending_[skip];
+		while (left) {
+			size_t pos = idx & mask;
+			size_t chunk = capacity_ - pos;
+			if (chunk > left)
+				chunk = left;
+			memcpy(slots_+pos, src, chunk*sizeof(SpikeStreamSlot));
+			src += chunk;
+			idx += chunk;
+			left -= chunk;
+		}
+
+		writeIdx_ += n;
+		__atomic_store_n(&header_->writeIdx, writeIdx_, __ATOMIC_RELEASE);
+		pending_.clear();
+	}
+	__atomic_store_n(&header_->lastTimeMs, (int64_t)timeMs, __ATOMIC_RELEASE);
+#endif
+}
+
+// ******************************************************************************************************************** //
+// SPIKE STREAM READER
+// ******************************************************************************************************************** //
+
+SpikeStreamReader::SpikeStreamReader(const std::string& name) : size_(0), header_(NULL), slots_(NULL), readIdx_(0),
+	numSpikesLost_(0)
+{
+#if defined(WIN32) || defined(WIN64)
+	// not supported, isOpen() returns false
+#else
+	std::string fileName = SpikeStreamWriter::getShmName(name);
+	int fd = shm_open(fileName.c_str(), O_RDONLY, 0);
+	if (fd < 0)
+		return;
+
+	struct stat sb;
+	if (fstat(fd, &sb) != 0 || (size_t)sb.st_size < sizeof(SpikeStreamHeader)) {
+		close(fd);
+		return;
+	}
+	void* addr = mmap(NULL, sb.st_size, PROT_READ, MAP_SHARED, fd, 0);
+	close(fd);
+	if (addr == MAP_FAILED)
+		return;
+
+	SpikeStreamHeader* header = (SpikeStreamHeader*)addr;
+	if (__atomic_load_n(&header->signature, __ATOMIC_ACQUIRE) != SPIKE_STREAM_SIGNATURE
+			|| header->version != SPIKE_STREAM_VERSION || header->slotSize != sizeof(SpikeStreamSlot)
+			|| header->capacity == 0 || (header->capacity & (header->capacity-1))
+			|| (size_t)sb.st_size < streamSize(header->capacity)) {
+		munmap(addr, sb.st_size);
+		return;
+	}
+
+	size_ = sb.st_size;
+	header_ = header;
+	slots_ = (SpikeStreamSlot*)((char*)addr + sizeof(SpikeStreamHeader));
+	readIdx_ = __atomic_load_n(&header_->writeIdx, __ATOMIC_ACQUIRE);
+#endif
+}
+
+SpikeStreamReader::~SpikeStreamReader() {
+#if !(defined(WIN32) || defined(WIN64))
+	if (header_ != NULL)
+		munmap(header_, size_);
+#endif
+}
+
+int SpikeStreamReader::readSpikes(std::vector<int>& times, std::vector<int>& grpIds, std::vector<int>& neurIds) {
+	if (header_ == NULL)
+		return 0;
+
+#if defined(WIN32) || defined(WIN64)
+	return 0;
+#else
+	uint64_t capacity = header_->capacity;
+	uint64_t mask = capacity-1;
+	uint64_t writeIdx = __atomic_load_n(&header_->writeIdx, __ATOMIC_ACQUIRE);
+	if (writeIdx <= readIdx_)
+		return 0;
+
+	// spikes that were already overwritten before we got here
+	if (writeIdx - readIdx_ > capacity) {
+		numSpikesLost_ += writeIdx - capacity - readIdx_;
+		readIdx_ = writeIdx - capacity;
+	}
+
+	// copy first, then check whether the writer has claimed any of the slots we just copied
+	buf_.resize(writeIdx - readIdx_);
+	for (uint64_t i=readIdx_; i<writeIdx; i++)
+		buf_[i-readIdx_] = slots_[i & mask];
+	__atomic_thread_fence(__ATOMIC_ACQUIRE);
+	uint64_t claimIdx = __atomic_load_n(&header_->claimIdx, __ATOMIC_RELAXED);
+
+	uint64_t firstValid = readIdx_;
+	if (claimIdx > capacity && claimIdx - capacity > firstValid)
+		firstValid = claimIdx - capacity;
+	if (firstValid > writeIdx)
+		firstValid = writeIdx;
+	numSpikesLost_ += firstValid - readIdx_;
+
+	int nRead = 0;
+	for (uint64_t i=firstValid; i<writeIdx; i++) {
+		const SpikeStreamSlot& slot = buf_[i-readIdx_];
+		times.push_back(slot.timeMs);
+		grpIds.push_back(slot.grpId);
+		neurIds.push_back(slot.neurId);
+		nRead++;
+	}
+	readIdx_ = writeIdx;
+	return nRead;
+#endif
+}
+
+int SpikeStreamReader::getLastTime() {
+	if (header_ == NULL)
+		return -1;
+#if defined(WIN32) || defined(WIN64)
+	return -1;
+#else
+	return (int)__atomic_load_n(&header_->lastTimeMs, __ATOMIC_ACQUIRE);
+#endif
+}
@@ -0,0 +1,202 @@
+/*
+ * Copyright (c) 2014 Regents of the University of California. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * 3. The names of its contributors may not be used to endorse or promote
+ *    products derived from this software without specific prior written
+ *    permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * *************************************************************************
+ * CARLsim
+ * created by: 		(MDR) Micah Richert, (JN) Jayram M. Nageswaran
+ * maintained by:	(MA) Mike Avery <averym@uci.edu>, (MB) Michael Beyeler <mbeyeler@uci.edu>,
+ *					(KDC) Kristofor Carlson <kdcarlso@uci.edu>
+ *					(TSC) Ting-Shuo Chou <tingshuc@uci.edu>
+ *
+ * CARLsim available from http://socsci.uci.edu/~jkrichma/CARLsim/
+ * Ver 11/12/2014
+ */
+
+#ifndef _SPIKE_STREAM_H_
+#define _SPIKE_STREAM_H_
+
+#include <stdint.h>					// int32_t, uint32_t, int64_t, uint64_t
+#include <string>					// std::string
+#include <vector>					// std::vector
+
+#define SPIKE_STREAM_SIGNATURE 0x53504B53	// "SPKS"
+#define SPIKE_STREAM_VERSION 1
+#define SPIKE_STREAM_DEFAULT_CAPACITY (1<<20)	// default number of spike slots in the ring buffer
+#define SPIKE_STREAM_MAX_CAPACITY (1<<30)		// max number of spike slots (the largest power of two in an int)
+
+/*!
+ * \brief header section of a shared-memory spike stream
+ *
+ * A spike stream is a POSIX shared-memory object (shm_open) with the following layout:
+ * - offset 0: SpikeStreamHeader (64 bytes)
+ * - offset 64: a ring buffer of capacity SpikeStreamSlot entries (16 bytes each)
+ *
+ * There is a single writer (the simulation) and any number of readers, which never write to the stream. Spike i
+ * (counting from 0 since the stream was created) lives in slot i & (capacity-1). At every time step, the writer
+ * first announces the number of spikes it is about to write (claimIdx), then writes the slots, then publishes them
+ * (writeIdx), and finally publishes the time step itself (lastTimeMs). Readers copy the slots in [readIdx, writeIdx),
+ * and then check claimIdx to find out whether the writer has overwritten some of them in the meantime (in which case
+ * the reader has fallen behind by more than capacity spikes, and the spikes are lost).
+ * All indices are 64-bit and only ever increase.
+ */
+struct SpikeStreamHeader {
+	uint32_t signature;		//!< SPIKE_STREAM_SIGNATURE
+	uint32_t version;		//!< SPIKE_STREAM_VERSION
+	uint32_t capacity;		//!< number of slots in the ring buffer (a power of two)
+	uint32_t slotSize;		//!< size of a slot (bytes)
+	uint64_t claimIdx;		//!< number of spikes that have been (or are being) written
+	uint64_t writeIdx;		//!< number of spikes that have been published
+	int64_t lastTimeMs;		//!< last time step (ms) whose spikes have all been published, -1 if none
+	uint8_t reserved[24];	//!< pads the header to 64 bytes
+};
+
+//! a spike in the ring buffer of a spike stream
+struct SpikeStreamSlot {
+	int32_t timeMs;			//!< spike time (ms)
+	int32_t grpId;			//!< group ID
+	int32_t neurId;			//!< neuron ID (0-indexed, relative to the group)
+	int32_t reserved;		//!< pads the slot to 16 bytes
+};
+
+/*!
+ * \brief publishes spikes into a shared-memory spike stream (used by the CARLsim kernel)
+ *
+ * \see CARLsim::setSpikeStream
+ * \since v3.1
+ */
+class SpikeStreamWriter {
+public:
+	/*!
+	 * \brief creates the shared-memory object
+	 *
+	 * If a shared-memory object of that name already exists, it is only replaced if replaceExisting is set, because
+	 * it may belong to another simulation that is still running. Otherwise, isOpen() returns false.
+	 * \param[in] name             name of the shared-memory object (see getShmName)
+	 * \param[in] capacity         number of slots in the ring buffer (rounded up to the next power of two, at most
+	 *                             SPIKE_STREAM_MAX_CAPACITY)
+	 * \param[in] replaceExisting  whether to unlink an existing shared-memory object of the same name (e.g., one that
+	 *                             was left behind by a crashed run)
+	 */
+	SpikeStreamWriter(const std::string& name, int capacity, bool replaceExisting=false);
+
+	//! unmaps and unlinks the shared-memory object (readers that have mapped it can keep on reading)
+	~SpikeStreamWriter();
+
+	//! returns true if the shared-memory object could be created
+	bool isOpen() { return header_ != NULL; }
+
+	//! returns the name of the shared-memory object
+	const std::string& getName() { return name_; }
+
+	//! turns a stream name into a valid POSIX shared-memory name by adding a leading '/' if it is missing
+	static std::string getShmName(const std::string& name);
+
+	//! returns the number of slots in the ring buffer
+	int getCapacity() { return capacity_; }
+
+	//! adds a spike to the current time step (not visible to readers until publish is called)
+	void addSpike(int timeMs, int grpId, int neurId) {
+		SpikeStreamSlot slot = {timeMs, grpId, neurId, 0};
+		pending_.push_back(slot);
+	}
+
+	//! writes all spikes of the current time step to the ring buffer and publishes them along with the time step
+	void publish(int timeMs);
+
+private:
+	std::string name_;					//!< name of the shared-memory object
+	int capacity_;						//!< number of slots
+	size_t size_;						//!< size of the mapping (bytes)
+	SpikeStreamHeader* header_;			//!< start of the mapping
+	SpikeStreamSlot* slots_;			//!< ring buffer
+	uint64_t writeIdx_;					//!< local copy of header_->writeIdx
+	std::vector<SpikeStreamSlot> pending_;	//!< spikes of the current time step
+};
+
+/*!
+ * \brief reads spikes from a shared-memory spike stream (used by the consumer process)
+ *
+ * SpikeStreamReader is the consumer side of CARLsim::setSpikeStream. It only depends on spike_stream.h and
+ * spike_stream.cpp, which can be compiled into the consumer process without the rest of CARLsim.
+ *
+ * Example usage:
+ * \code
+ * SpikeStreamReader reader("carlsim_spikes");
+ * std::vector<int> times, grpIds, neurIds;
+ * while (running) {
+ *     reader.readSpikes(times, grpIds, neurIds); // all spikes published since the last call
+ *     // ... process spikes up to reader.getLastTime() ...
+ * }
+ * \endcode
+ *
+ * \since v3.1
+ */
+class SpikeStreamReader {
+public:
+	/*!
+	 * \brief maps an existing spike stream
+	 *
+	 * Reading starts with the spikes that are published after the reader was created.
+	 * \param[in] name name of the shared-memory object, as passed to CARLsim::setSpikeStream
+	 */
+	SpikeStreamReader(const std::string& name);
+
+	//! unmaps the shared-memory object
+	~SpikeStreamReader();
+
+	//! returns true if the stream could be mapped
+	bool isOpen() { return header_ != NULL; }
+
+	/*!
+	 * \brief appends all spikes published since the last call to the given vectors
+	 *
+	 * \param[out] times    spike times (ms)
+	 * \param[out] grpIds   group IDs
+	 * \param[out] neurIds  neuron IDs (relative to the group)
+	 * \returns the number of spikes read
+	 */
+	int readSpikes(std::vector<int>& times, std::vector<int>& grpIds, std::vector<int>& neurIds);
+
+	//! returns the last time step (ms) that has been fully published, or -1 if none
+	int getLastTime();
+
+	//! returns the number of spikes that were overwritten before they could be read
+	uint64_t getNumSpikesLost() { return numSpikesLost_; }
+
+private:
+	size_t size_;						//!< size of the mapping (bytes)
+	SpikeStreamHeader* header_;			//!< start of the mapping
+	SpikeStreamSlot* slots_;			//!< ring buffer
+	uint64_t readIdx_;					//!< index of the next spike to read
+	uint64_t numSpikesLost_;			//!< number of spikes lost due to overruns
+	std::vector<SpikeStreamSlot> buf_;	//!< slots copied from the ring buffer
+};
+
+#endif
@@ -6,6 +6,7 @@
 
 #if defined(WIN32) || defined(WIN64)
 #include <periodic_spikegen.h>
+#include <stopwatch.h>
 #endif
 
 /// **************************************************************************************************************** ///
@@ -186,6 +187,93 @@ TEST(CORE, setExternalCurrent) {
 	}
 }
 
+TEST(CORE, setExternalCurrentSchedule) {
+	::testing::FLAGS_gtest_death_test_style = "threadsafe";
+
+	int nNeur = 10;
+	CurrentSchedule sched(nNeur);
+	sched.addPulse(100, 300, 0, 7.0f);
+	std::vector<float> wave(400);
+	for (int t=0; t<400; t++)
+		wave[t] = (t/50)%2 ? 12.0f : 2.0f;
+	sched.addWaveform(50, 1, wave);
+	sched.addCurrent(600, ALL, 5.0f);
+	std::vector<float> dense(nNeur);
+	for (int i=0; i<nNeur; i++)
+		dense[i] = i*1.5f;
+	sched.addCurrent(800, dense);
+	sched.addCurrent(0, 9, 8.0f); // out of order, must be sorted
+	EXPECT_EQ(sched.getNumEntries(), 2+8+1+nNeur+1);
+	EXPECT_EQ(sched.getLengthMs(), 801);
+	EXPECT_EQ(sched.getEntryTimeMs(0), 0);
+	EXPECT_EQ(sched.getEntryNeurId(0), 9);
+	EXPECT_FLOAT_EQ(sched.getEntryCurrent(0), 8.0f);
+	for (int e=1; e<sched.getNumEntries(); e++)
+		EXPECT_LE(sched.getEntryTimeMs(e-1), sched.getEntryTimeMs(e));
+
+	// entries with the same time must stay in the order they were added, even after sorting
+	CurrentSchedule ties(2);
+	ties.addCurrent(5, 0, 1.0f);
+	ties.addCurrent(0, 1, 2.0f);
+	ties.addCurrent(5, 0, 3.0f);
+	EXPECT_EQ(ties.getEntryTimeMs(0), 0);
+	EXPECT_FLOAT_EQ(ties.getEntryCurrent(1), 1.0f);
+	EXPECT_FLOAT_EQ(ties.getEntryCurrent(2), 3.0f);
+	EXPECT_EQ(ties.getLengthMs(), 6);
+
+	EXPECT_DEATH({sched.addCurrent(0, nNeur, 1.0f);},"");
+	EXPECT_DEATH({sched.addCurrent(-1, 0, 1.0f);},"");
+	EXPECT_DEATH({sched.addPulse(0, 0, 0, 1.0f);},"");
+
+	// applying the schedule inside the simulation loop must give the same spikes as calling setExternalCurrent
+	// and runNetwork once per millisecond
+	std::vector<std::vector<int> > spkVec[2];
+	for (int useSchedule=0; useSchedule<=1; useSchedule++) {
+		CARLsim* sim = new CARLsim("CORE.setExternalCurrentSchedule", CPU_MODE, SILENT, 0, 42);
+		int g1 = sim->createGroup("excit1", nNeur, EXCITATORY_NEURON);
+		sim->setNeuronParameters(g1, 0.02f, 0.2f, -65.0f, 8.0f);
+		int g0 = sim->createSpikeGeneratorGroup("input0", nNeur, EXCITATORY_NEURON);
+		sim->connect(g0, g1, "full", RangeWeight(0.1), 1.0f, RangeDelay(1));
+		sim->setConductances(true);
+		sim->setupNetwork();
+		SpikeMonitor* SM = sim->setSpikeMonitor(g1, "NULL");
+
+		EXPECT_DEATH({sim->setExternalCurrentSchedule(g0, &sched);},"");
+		CurrentSchedule wrongSize(nNeur+1);
+		EXPECT_DEATH({sim->setExternalCurrentSchedule(g1, &wrongSize);},"");
+
+		SM->startRecording();
+		if (useSchedule) {
+			sim->setExternalCurrentSchedule(g1, &sched);
+			sim->runNetwork(1,0,false);
+		} else {
+			std::vector<float> current(nNeur, 0.0f);
+			for (int t=0, e=0; t<1000; t++) {
+				for (; e<sched.getNumEntries() && sched.getEntryTimeMs(e)==t; e++) {
+					if (sched.getEntryNeurId(e) == ALL)
+						current.assign(nNeur, sched.getEntryCurrent(e));
+					else
+						current[sched.getEntryNeurId(e)] = sched.getEntryCurrent(e);
+				}
+				sim->setExternalCurrent(g1, current);
+				sim->runNetwork(0,1,false);
+			}
+		}
+
+		// the last currents are held after the schedule has run out, until replaced by setExternalCurrent
+		sim->runNetwork(0,500,false);
+		sim->setExternalCurrent(g1, 0.0f);
+		sim->runNetwork(0,500,false);
+		SM->stopRecording();
+
+		spkVec[useSchedule] = SM->getSpikeVector2D();
+		EXPECT_GT(SM->getNeuronNumSpikes(0), 0);
+		EXPECT_GT(SM->getNeuronNumSpikes(1), 0);
+		delete sim;
+	}
+	EXPECT_TRUE(spkVec[0] == spkVec[1]);
+}
+
 TEST(CORE, biasWeights) {
 	::testing::FLAGS_gtest_death_test_style = "threadsafe";
 
@@ -351,6 +439,41 @@ TEST(CORE, setWeight) {
 	delete[] nSpkHighWt;
 }
 
+//! spikes that are still in flight at the end of a second must reach the right post-neurons in the next second
+TEST(CORE, firingTableCarryOver) {
+	// gA fires 21 ms before the end of the first second, gB fires 5 ms before it; with a delay of 20 ms, only the
+	// spike of gB is still in flight at the second boundary
+	int spkTimesA[1] = {979};
+	int spkTimesB[1] = {995};
+	SpikeGeneratorFromVector spkGenA(std::vector<int>(&spkTimesA[0], &spkTimesA[0]+1));
+	SpikeGeneratorFromVector spkGenB(std::vector<int>(&spkTimesB[0], &spkTimesB[0]+1));
+
+	CARLsim sim("CORE.firingTableCarryOver",CPU_MODE,SILENT,0,42);
+	int gA=sim.createSpikeGeneratorGroup("inputA", 1, EXCITATORY_NEURON);
+	int gB=sim.createSpikeGeneratorGroup("inputB", 1, EXCITATORY_NEURON);
+	int gOutA=sim.createGroup("outA", 1, EXCITATORY_NEURON);
+	int gOutB=sim.createGroup("outB", 1, EXCITATORY_NEURON);
+	sim.setNeuronParameters(gOutA, 0.02f, 0.2f, -65.0f, 8.0f);
+	sim.setNeuronParameters(gOutB, 0.02f, 0.2f, -65.0f, 8.0f);
+	sim.setSpikeGenerator(gA, &spkGenA);
+	sim.setSpikeGenerator(gB, &spkGenB);
+	sim.connect(gA, gOutA, "one-to-one", RangeWeight(100.0f), 1.0f, RangeDelay(20));
+	sim.connect(gB, gOutB, "one-to-one", RangeWeight(100.0f), 1.0f, RangeDelay(20));
+	sim.setConductances(false);
+	sim.setupNetwork();
+
+	SpikeMonitor* spkMonA = sim.setSpikeMonitor(gOutA, "NULL");
+	SpikeMonitor* spkMonB = sim.setSpikeMonitor(gOutB, "NULL");
+	spkMonA->startRecording();
+	spkMonB->startRecording();
+	sim.runNetwork(2,0);
+	spkMonA->stopRecording();
+	spkMonB->stopRecording();
+
+	EXPECT_EQ(spkMonA->getPopNumSpikes(), 1);
+	EXPECT_EQ(spkMonB->getPopNumSpikes(), 1);
+}
+
 TEST(CORE, getDelayRange) {
 	CARLsim* sim;
 	int nNeur = 10;
@@ -393,6 +516,83 @@ TEST(CORE, getDelayRange) {
 	}
 }
 
+//! delays beyond the old 20 ms limit must be delivered exactly delay-1 ms later than with a delay of 1 ms, also
+//! when the spike is still in flight at the end of a second
+TEST(CORE, longAxonalDelays) {
+	int spkTimesArr[5] = {13, 420, 890, 990, 1950};
+	std::vector<int> spkTimes(&spkTimesArr[0], &spkTimesArr[0]+5);
+	int delays[3] = {1, 150, 255}; // delays are stored as uint8_t
+	std::vector<int> spkTimesPost[3];
+
+	for (int d=0; d<3; d++) {
+		CARLsim sim("CORE.longAxonalDelays",CPU_MODE,SILENT,0,42);
+		int g1=sim.createGroup("excit", 1, EXCITATORY_NEURON);
+		sim.setNeuronParameters(g1, 0.02f, 0.2f, -65.0f, 8.0f);
+		int g0=sim.createSpikeGeneratorGroup("input", 1, EXCITATORY_NEURON);
+		SpikeGeneratorFromVector spkGen(spkTimes);
+		sim.setSpikeGenerator(g0, &spkGen);
+
+		// a second, short connection makes sure that delays of different length are handled side by side
+		int g2=sim.createGroup("short", 1, EXCITATORY_NEURON);
+		sim.setNeuronParameters(g2, 0.02f, 0.2f, -65.0f, 8.0f);
+		sim.connect(g0, g1, "one-to-one", RangeWeight(100.0f), 1.0f, RangeDelay(delays[d]));
+		sim.connect(g0, g2, "one-to-one", RangeWeight(100.0f), 1.0f, RangeDelay(2));
+		sim.setConductances(false);
+		sim.setupNetwork();
+
+		SpikeMonitor* spkMon = sim.setSpikeMonitor(g1, "NULL");
+		spkMon->startRecording();
+		sim.runNetwork(3,0);
+		spkMon->stopRecording();
+
+		spkTimesPost[d] = spkMon->getSpikeVector2D()[0];
+		ASSERT_EQ(spkTimesPost[d].size(), spkTimes.size());
+	}
+
+	for (int d=1; d<3; d++) {
+		for (int i=0; i<spkTimes.size(); i++) {
+			EXPECT_EQ(spkTimesPost[d][i], spkTimesPost[0][i] + delays[d]-1);
+		}
+	}
+}
+
+//! firing tables start out small in CPU mode and have to grow during the run: no spike may get lost on the way,
+//! neither in the table for 1ms delays (D1) nor in the one for longer delays (D2)
+TEST(CORE, firingTableGrowth) {
+	int numNeur = 500;
+	float rateHz = 100.0f; // well above the rate the firing tables are initially sized for
+	int runTimeSec = 3;
+	int delays[2] = {1, 10};
+
+	for (int d=0; d<2; d++) {
+		CARLsim sim("CORE.firingTableGrowth",CPU_MODE,SILENT,0,42);
+		int g0=sim.createSpikeGeneratorGroup("input", numNeur, EXCITATORY_NEURON);
+		int g1=sim.createGroup("excit", numNeur, EXCITATORY_NEURON);
+		sim.setNeuronParameters(g1, 0.02f, 0.2f, -65.0f, 8.0f);
+		sim.connect(g0, g1, "one-to-one", RangeWeight(100.0f), 1.0f, RangeDelay(delays[d]));
+		sim.setConductances(false);
+
+		PeriodicSpikeGenerator spkGen(true);
+		spkGen.setRates(rateHz);
+		sim.setSpikeGenerator(g0, &spkGen);
+		sim.setupNetwork();
+
+		SpikeMonitor* spkMonIn = sim.setSpikeMonitor(g0, "NULL");
+		SpikeMonitor* spkMonOut = sim.setSpikeMonitor(g1, "NULL");
+		spkMonIn->startRecording();
+		spkMonOut->startRecording();
+		sim.runNetwork(runTimeSec,0);
+		spkMonIn->stopRecording();
+		spkMonOut->stopRecording();
+
+		EXPECT_EQ(spkMonIn->getPopNumSpikes(), numNeur*runTimeSec*(int)rateHz);
+
+		// every input spike makes its post-neuron fire, except for those still in flight at the end of the run
+		int numInFlight = (delays[d]>1) ? numNeur : 0;
+		EXPECT_EQ(spkMonOut->getPopNumSpikes(), spkMonIn->getPopNumSpikes()-numInFlight);
+	}
+}
+
 TEST(CORE, getWeightRange) {
 	CARLsim* sim;
 	int nNeur = 10;
@@ -797,3 +997,137 @@ TEST(CORE, setNeuronParameters) {
 		}
 	}
 }
+
+TEST(CORE, realTimePacing) {
+	::testing::FLAGS_gtest_death_test_style = "threadsafe";
+
+	CARLsim* sim = new CARLsim("CORE.realTimePacing", CPU_MODE, SILENT, 0, 42);
+	int g0 = sim->createSpikeGeneratorGroup("input", 10, EXCITATORY_NEURON);
+	int g1 = sim->createGroup("excit", 10, EXCITATORY_NEURON);
+	sim->setNeuronParameters(g1, 0.02f, 0.2f, -65.0f, 8.0f);
+	sim->connect(g0, g1, "full", RangeWeight(0.1f), 1.0f);
+	sim->setConductances(true);
+	EXPECT_DEATH({sim->setRealTimeFactor(-1.0f);},"");
+	sim->setupNetwork();
+	PoissonRate in(10);
+	in.setRates(20.0f);
+	sim->setSpikeRate(g0, &in);
+
+	// no pacing: no statistics
+	sim->runNetwork(0,100,false);
+	RealTimeStats_t rt = sim->getRealTimeStats();
+	EXPECT_FLOAT_EQ(rt.factor, 0.0f);
+	EXPECT_EQ(rt.numSteps, 0);
+
+	// 400 ms of simulation at four times real time must take (at least) 100 ms
+	sim->setRealTimeFactor(4.0f);
+	Stopwatch watch;
+	sim->runNetwork(0,400,false);
+	uint64_t elapsedMs = watch.stop(false);
+	EXPECT_GE(elapsedMs, 99);
+
+	rt = sim->getRealTimeStats();
+	EXPECT_FLOAT_EQ(rt.factor, 4.0f);
+	EXPECT_EQ(rt.numSteps, 400);
+	EXPECT_GT(rt.computeMaxUs, 0.0f);
+	EXPECT_LE(rt.computeP50Us, rt.computeP99Us);
+	EXPECT_LE(rt.computeP99Us, rt.computeMaxUs);
+
+	// at a tenth of real time, every time step of this tiny network has 10 ms to spare: no deadline is missed
+	sim->resetRealTimeStats();
+	sim->setRealTimeFactor(0.1f);
+	Stopwatch watchSlow;
+	sim->runNetwork(0,20,false);
+	elapsedMs = watchSlow.stop(false);
+	EXPECT_GE(elapsedMs, 199);
+	rt = sim->getRealTimeStats();
+	EXPECT_EQ(rt.numSteps, 20);
+	EXPECT_EQ(rt.numDeadlineMisses, 0);
+	EXPECT_EQ(rt.numStalls, 0);
+
+	// no machine can simulate a millisecond in a nanosecond: every time step misses its deadline
+	sim->resetRealTimeStats();
+	sim->setRealTimeFactor(1e6f);
+	sim->runNetwork(0,50,false);
+	rt = sim->getRealTimeStats();
+	EXPECT_EQ(rt.numSteps, 50);
+	EXPECT_EQ(rt.numDeadlineMisses, 50);
+	EXPECT_EQ(rt.numStalls, 1); // the simulation never catches up
+	EXPECT_GT(rt.maxLatenessUs, 0.0f);
+
+	// deadlines start over with every runNetwork call, and so does the stall
+	sim->runNetwork(0,50,false);
+	rt = sim->getRealTimeStats();
+	EXPECT_EQ(rt.numDeadlineMisses, 100);
+	EXPECT_EQ(rt.numStalls, 2);
+
+	// pacing off again
+	sim->resetRealTimeStats();
+	sim->setRealTimeFactor(0.0f);
+	sim->runNetwork(0,10,false);
+	EXPECT_EQ(sim->getRealTimeStats().numSteps, 0);
+
+	delete sim;
+}
+
+TEST(CORE, runNetworkAsync) {
+	::testing::FLAGS_gtest_death_test_style = "threadsafe";
+
+	// the same trial sequence (two stimuli, then an external current) once with runNetwork and once with
+	// runNetworkAsync, where the next stimulus is set while the network is still running
+	std::vector<std::vector<int> > spkVec[2][2];
+	for (int isAsync=0; isAsync<=1; isAsync++) {
+		CARLsim* sim = new CARLsim("CORE.runNetworkAsync", CPU_MODE, SILENT, 0, 42);
+		int g0 = sim->createSpikeGeneratorGroup("input", 10, EXCITATORY_NEURON);
+		int g1 = sim->createGroup("excit", 10, EXCITATORY_NEURON);
+		sim->setNeuronParameters(g1, 0.02f, 0.2f, -65.0f, 8.0f);
+		sim->connect(g0, g1, "one-to-one", RangeWeight(0.5f), 1.0f);
+		sim->setConductances(true);
+		sim->setupNetwork();
+		SpikeMonitor* SM[2] = {sim->setSpikeMonitor(g0, "NULL"), sim->setSpikeMonitor(g1, "NULL")};
+		SM[0]->startRecording();
+		SM[1]->startRecording();
+
+		PoissonRate in1(10), in2(10);
+		in1.setRates(10.0f);
+		in2.setRates(50.0f);
+		sim->setSpikeRate(g0, &in1);
+		if (isAsync) {
+			// real-time pacing makes sure the stimuli are set while the network is running
+			sim->setRealTimeFactor(10.0f);
+			RunFuture future = sim->runNetworkAsync(0,500,false);
+			EXPECT_TRUE(future.isValid());
+			EXPECT_FALSE(future.isReady());
+			EXPECT_TRUE(sim->isRunningAsync());
+			EXPECT_DEATH({sim->runNetwork(0,1,false);},"");
+			EXPECT_DEATH({sim->setWeight(0, 0, 0, 0.1f);},"");
+			EXPECT_DEATH({sim->getSpikeMonitor(g0);},"");
+			EXPECT_DEATH({sim->getSimTime();},"");
+			sim->setSpikeRate(g0, &in2);
+			EXPECT_EQ(future.wait(), 0);
+			EXPECT_TRUE(future.isReady());
+			EXPECT_FALSE(sim->isRunningAsync());
+
+			future = sim->runNetworkAsync(0,500,false);
+			sim->setExternalCurrent(g1, 7.0f);
+			EXPECT_EQ(future.wait(), 0);
+			sim->runNetworkAsync(0,500,false).wait();
+		} else {
+			sim->runNetwork(0,500,false);
+			sim->setSpikeRate(g0, &in2);
+			sim->runNetwork(0,500,false);
+			sim->setExternalCurrent(g1, 7.0f);
+			sim->runNetwork(0,500,false);
+		}
+
+		SM[0]->stopRecording();
+		SM[1]->stopRecording();
+		for (int g=0; g<2; g++)
+			spkVec[isAsync][g] = SM[g]->getSpikeVector2D();
+		EXPECT_GT(SM[1]->getPopNumSpikes(), 0);
+		delete sim;
+	}
+
+	for (int g=0; g<2; g++)
+		EXPECT_TRUE(spkVec[0][g] == spkVec[1][g]);
+}
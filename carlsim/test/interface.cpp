@@ -37,6 +37,7 @@ TEST(Interface, connectDeath) {
 	EXPECT_DEATH(sim->connect(g1,g2,"one-to-one",RangeWeight(0.1f),0.1f,RangeDelay(1),RadiusRF(3,0,0)),""); // rad>0
 	EXPECT_DEATH(sim->connect(g1,g2,"random",RangeWeight(0.1f),0.1f,RangeDelay(1),RadiusRF(-1),SYN_FIXED,-1.0f,0.0f),""); // mulSynFast<0
 	EXPECT_DEATH(sim->connect(g1,g2,"random",RangeWeight(0.1f),0.1f,RangeDelay(1),RadiusRF(-1),SYN_FIXED,0.0f,-1.0f),""); // mulSynSlow<0
+	EXPECT_DEATH(sim->connect(g1,g2,"random",RangeWeight(0.1f),0.1f,RangeDelay(1,256)),""); // delay>255
 
 	// custom ConnectionGenerator
 	ConnectionGenerator* CGNULL = NULL;
@@ -700,6 +701,25 @@ TEST(Interface, CARLsimState) {
 	delete sim;
 }
 
+TEST(Interface, setEpochLengthDeath) {
+	::testing::FLAGS_gtest_death_test_style = "threadsafe";
+
+	CARLsim* sim = new CARLsim("Interface.setEpochLengthDeath",CPU_MODE,SILENT,0,42);
+	int g1=sim->createGroup("excit", 10, EXCITATORY_NEURON);
+	sim->setNeuronParameters(g1, 0.02f, 0.2f, -65.0f, 8.0f);
+	sim->connect(g1, g1, "random", RangeWeight(0.01f), 0.1f);
+	sim->setConductances(true);
+
+	EXPECT_DEATH({sim->setEpochLength(0);},"");
+	EXPECT_DEATH({sim->setEpochLength(-100);},"");
+	EXPECT_DEATH({sim->setEpochLength(60001);},"");
+
+	sim->setupNetwork();
+	EXPECT_DEATH({sim->setEpochLength(100);},"");
+
+	delete sim;
+}
+
 TEST(Interface, setDefaultSTDPparamsDeath) {
 	::testing::FLAGS_gtest_death_test_style = "threadsafe";
 
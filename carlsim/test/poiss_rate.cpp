@@ -186,4 +186,188 @@ TEST(PoissRate, setRateNeurId) {
 TEST(PoissRate, runSim) {
 	// \TODO test CARLsim integration
 	// \TODO use cuRAND
-}
\ No newline at end of file
+}
+
+// tests per-millisecond Bernoulli Poisson input: mean rate, refractory period, and spike counts of a SpikeCounter
+TEST(PoissRate, bernoulliMode) {
+	const int nNeur = 1000;
+	CARLsim* sim = new CARLsim("PoissRate.bernoulliMode",CPU_MODE,SILENT,0,42);
+	int g1 = sim->createGroup("g1", 1, EXCITATORY_NEURON);
+	sim->setNeuronParameters(g1, 0.02, 0.2, -65.0, 8.0);
+	int gLow = sim->createSpikeGeneratorGroup("low", nNeur, EXCITATORY_NEURON);
+	int gHigh = sim->createSpikeGeneratorGroup("high", nNeur, EXCITATORY_NEURON);
+	sim->connect(gLow, g1, "full", RangeWeight(0.0f), 1.0f);
+	sim->connect(gHigh, g1, "full", RangeWeight(0.0f), 1.0f);
+	sim->setConductances(false);
+	sim->setPoissonMode(gLow, POISSON_BERNOULLI);
+	sim->setPoissonMode(gHigh, POISSON_BERNOULLI);
+	sim->setSpikeCounter(gLow, -1);
+	sim->setupNetwork();
+
+	PoissonRate rateLow(nNeur), rateHigh(nNeur);
+	rateLow.setRates(20.0f);
+	rateHigh.setRates(500.0f);
+	sim->setSpikeRate(gLow, &rateLow);
+	sim->setSpikeRate(gHigh, &rateHigh, 10);
+
+	SpikeMonitor* SMlow = sim->setSpikeMonitor(gLow, "NULL");
+	SpikeMonitor* SMhigh = sim->setSpikeMonitor(gHigh, "NULL");
+	SMlow->startRecording();
+	SMhigh->startRecording();
+	sim->runNetwork(5,0,false);
+	SMlow->stopRecording();
+	SMhigh->stopRecording();
+
+	// 100k spikes expected at 20 Hz: the population rate is accurate to within a few percent
+	EXPECT_NEAR(SMlow->getPopMeanFiringRate(), 20.0f, 1.0f);
+
+	// spike counter must see every spike
+	int* spkCnt = sim->getSpikeCounter(gLow);
+	int numSpikes = 0;
+	for (int neurId=0; neurId<nNeur; neurId++)
+		numSpikes += spkCnt[neurId];
+	EXPECT_EQ(numSpikes, SMlow->getPopNumSpikes());
+
+	// at 500 Hz, the refractory period of 10 ms is hit all the time: ISIs must still be >= 10 ms, and the rate must
+	// stay below 100 Hz
+	std::vector<std::vector<int> > spkVec = SMhigh->getSpikeVector2D();
+	for (int neurId=0; neurId<nNeur; neurId++) {
+		for (size_t spk=1; spk<spkVec[neurId].size(); spk++)
+			EXPECT_GE(spkVec[neurId][spk]-spkVec[neurId][spk-1], 10);
+	}
+	EXPECT_GT(SMhigh->getPopMeanFiringRate(), 50.0f);
+	EXPECT_LE(SMhigh->getPopMeanFiringRate(), 100.0f);
+
+	delete sim;
+}
+
+// switching from ISI to Bernoulli mode between two runNetwork calls must drop the spikes that ISI mode had already
+// scheduled for the rest of its time slice: otherwise neurons would fire both from the buffer and from their Bernoulli
+// draws, and violate their refractory period
+TEST(PoissRate, bernoulliModeSwitch) {
+	const int nNeur = 1000;
+	const int refPeriod = 10;
+	CARLsim* sim = new CARLsim("PoissRate.bernoulliModeSwitch",CPU_MODE,SILENT,0,42);
+	int g1 = sim->createGroup("g1", 1, EXCITATORY_NEURON);
+	sim->setNeuronParameters(g1, 0.02, 0.2, -65.0, 8.0);
+	int g0 = sim->createSpikeGeneratorGroup("g0", nNeur, EXCITATORY_NEURON);
+	sim->connect(g0, g1, "full", RangeWeight(0.0f), 1.0f);
+	sim->setConductances(false);
+	sim->setSpikeCounter(g0, -1);
+	sim->setupNetwork();
+
+	PoissonRate rate(nNeur);
+	rate.setRates(500.0f);
+	sim->setSpikeRate(g0, &rate, refPeriod);
+
+	SpikeMonitor* SM = sim->setSpikeMonitor(g0, "NULL");
+	SM->startRecording();
+	sim->runNetwork(1,500,false); // the last time slice (1022 ms) reaches past the end of the run
+	sim->setPoissonMode(g0, POISSON_BERNOULLI);
+	sim->runNetwork(1,0,false);
+	SM->stopRecording();
+
+	std::vector<std::vector<int> > spkVec = SM->getSpikeVector2D();
+	for (int neurId=0; neurId<nNeur; neurId++) {
+		for (size_t spk=1; spk<spkVec[neurId].size(); spk++)
+			EXPECT_GE(spkVec[neurId][spk]-spkVec[neurId][spk-1], refPeriod);
+	}
+	EXPECT_LE(SM->getPopMeanFiringRate(), 1000.0f/refPeriod);
+
+	// the SpikeCounter must not count the dropped spikes
+	int* spkCnt = sim->getSpikeCounter(g0);
+	int numSpikes = 0;
+	for (int neurId=0; neurId<nNeur; neurId++)
+		numSpikes += spkCnt[neurId];
+	EXPECT_EQ(numSpikes, SM->getPopNumSpikes());
+
+	delete sim;
+}
+
+TEST(PoissRate, bernoulliModeDeath) {
+	::testing::FLAGS_gtest_death_test_style = "threadsafe";
+	CARLsim* sim = new CARLsim("PoissRate.bernoulliModeDeath",CPU_MODE,SILENT,0,42);
+	int g1 = sim->createGroup("g1", 1, EXCITATORY_NEURON);
+	sim->setNeuronParameters(g1, 0.02, 0.2, -65.0, 8.0);
+	EXPECT_DEATH({sim->setPoissonMode(g1, POISSON_BERNOULLI);},"");
+	delete sim;
+}
+
+TEST(PoissRate, scheduleSegments) {
+	const int nNeur = 3;
+	PoissonRateSchedule sched(nNeur);
+	EXPECT_EQ(sched.getNumNeurons(), nNeur);
+	EXPECT_EQ(sched.getNumSegments(), 0);
+	EXPECT_EQ(sched.getSegmentId(0), -1);
+
+	std::vector<float> rates(nNeur);
+	rates[0] = 1.0f; rates[1] = 2.0f; rates[2] = 3.0f;
+	sched.addSegment(10, 5.0f);
+	sched.addSegment(20, rates);
+	std::vector<float> frames(2*nNeur, 7.0f);
+	sched.addFrames(5, frames);
+
+	EXPECT_EQ(sched.getNumSegments(), 4);
+	EXPECT_EQ(sched.getLengthMs(), 40);
+	EXPECT_EQ(sched.getSegmentId(-1), -1);
+	EXPECT_EQ(sched.getSegmentId(0), 0);
+	EXPECT_EQ(sched.getSegmentId(9), 0);
+	EXPECT_EQ(sched.getSegmentId(10), 1);
+	EXPECT_EQ(sched.getSegmentId(29), 1);
+	EXPECT_EQ(sched.getSegmentId(30), 2);
+	EXPECT_EQ(sched.getSegmentId(35), 3);
+	EXPECT_EQ(sched.getSegmentId(40), -1);
+	EXPECT_EQ(sched.getSegmentStartMs(3), 35);
+	EXPECT_EQ(sched.getSegmentDurationMs(1), 20);
+	EXPECT_TRUE(sched.getSegmentRates(0) == std::vector<float>(nNeur, 5.0f));
+	EXPECT_TRUE(sched.getSegmentRates(1) == rates);
+	EXPECT_TRUE(sched.getSegmentRates(3) == std::vector<float>(nNeur, 7.0f));
+
+	sched.clear();
+	EXPECT_EQ(sched.getNumSegments(), 0);
+	EXPECT_EQ(sched.getLengthMs(), 0);
+}
+
+// a schedule that alternates between silence and high rates must be followed to the millisecond in a single
+// runNetwork call, in both Poisson modes
+TEST(PoissRate, scheduleRunSim) {
+	const int nNeur = 100;
+	const int segMs = 100, numSeg = 10;
+
+	for (int mode=POISSON_ISI; mode<=POISSON_BERNOULLI; mode++) {
+		CARLsim* sim = new CARLsim("PoissRate.scheduleRunSim",CPU_MODE,SILENT,0,42);
+		int g1 = sim->createGroup("g1", 1, EXCITATORY_NEURON);
+		sim->setNeuronParameters(g1, 0.02, 0.2, -65.0, 8.0);
+		int g0 = sim->createSpikeGeneratorGroup("g0", nNeur, EXCITATORY_NEURON);
+		sim->connect(g0, g1, "full", RangeWeight(0.0f), 1.0f);
+		sim->setConductances(false);
+		sim->setPoissonMode(g0, (poissonMode_t)mode);
+		sim->setupNetwork();
+
+		PoissonRateSchedule sched(nNeur);
+		for (int seg=0; seg<numSeg; seg++)
+			sched.addSegment(segMs, (seg%2) ? 200.0f : 0.0f);
+		sim->setSpikeRateSchedule(g0, &sched);
+
+		SpikeMonitor* SM = sim->setSpikeMonitor(g0, "NULL");
+		SM->startRecording();
+		sim->runNetwork(1,500,false); // the schedule runs out after 1 s
+		SM->stopRecording();
+
+		int numSpikesOn = 0;
+		std::vector<std::vector<int> > spkVec = SM->getSpikeVector2D();
+		for (int neurId=0; neurId<nNeur; neurId++) {
+			for (size_t spk=0; spk<spkVec[neurId].size(); spk++) {
+				int t = spkVec[neurId][spk];
+				EXPECT_LT(t, segMs*numSeg);
+				EXPECT_EQ((t/segMs)%2, 1);
+				numSpikesOn++;
+			}
+		}
+
+		// 5 segments of 100 ms at 200 Hz: expect about 100 spikes per neuron
+		EXPECT_NEAR(numSpikesOn*1.0f/nNeur, 100.0f, 10.0f);
+
+		delete sim;
+	}
+}
@@ -49,6 +49,7 @@
 #include <periodic_spikegen.h>
 #include <spikegen_from_file.h>
 #include <spikegen_from_vector.h>
+#include <pre_post_group_spikegen.h>
 #endif
 
 // tests whether the binary file created by setSpikeMonitor matches the specifications of PeriodicSpikeGenerator
@@ -197,6 +198,64 @@ TEST(SpikeGen, SpikeGeneratorFromFile) {
 	}
 }
 
+// replays a multi-second recording (flat and indexed spike file) that has to be streamed in several chunks, then
+// rewinds and replays it once more with an offset
+TEST(SpikeGen, SpikeGeneratorFromFileStreaming) {
+	const int nNeur = 200;
+	const int runTimeSec = 5;
+	std::string fileName = "results/spk_stream.dat";
+
+	for (int indexed=0; indexed<=1; indexed++) {
+		// record ground truth from a Poisson group
+		CARLsim* sim = new CARLsim("SpikeGeneratorFromFileStreaming",CPU_MODE,SILENT,0,42);
+		int g1 = sim->createGroup("g1", 1, EXCITATORY_NEURON);
+		sim->setNeuronParameters(g1, 0.02, 0.2, -65.0, 8.0);
+		int g0 = sim->createSpikeGeneratorGroup("g0",nNeur,EXCITATORY_NEURON);
+		sim->connect(g0,g1,"random",RangeWeight(0.0f), 0.5f);
+		sim->setConductances(false);
+		sim->setupNetwork();
+		PoissonRate poiss(nNeur);
+		poiss.setRates(20.0f);
+		sim->setSpikeRate(g0, &poiss);
+		SpikeMonitor* SM0 = sim->setSpikeMonitor(g0, fileName);
+		SM0->setLogFileIndexed(indexed);
+		SM0->startRecording();
+		sim->runNetwork(runTimeSec,0,false);
+		SM0->stopRecording();
+		std::vector< std::vector<int> > spkVec0 = SM0->getSpikeVector2D();
+		delete sim; // closes the spike file
+
+		// replay the file twice
+		sim = new CARLsim("SpikeGeneratorFromFileStreaming",CPU_MODE,SILENT,0,42);
+		g1 = sim->createGroup("g1", 1, EXCITATORY_NEURON);
+		sim->setNeuronParameters(g1, 0.02, 0.2, -65.0, 8.0);
+		g0 = sim->createSpikeGeneratorGroup("g0",nNeur,EXCITATORY_NEURON);
+		SpikeGeneratorFromFile sgf(fileName);
+		sim->setSpikeGenerator(g0, &sgf);
+		sim->connect(g0,g1,"random",RangeWeight(0.0f), 0.5f);
+		sim->setConductances(false);
+		sim->setupNetwork();
+		SpikeMonitor* SM1 = sim->setSpikeMonitor(g0, "NULL");
+		SM1->startRecording();
+		sim->runNetwork(runTimeSec,0,false);
+		sgf.rewind(runTimeSec*1000);
+		sim->runNetwork(runTimeSec,0,false);
+		SM1->stopRecording();
+		std::vector< std::vector<int> > spkVec1 = SM1->getSpikeVector2D();
+		delete sim;
+
+		int numSpikes = 0;
+		for (int neurId=0; neurId<nNeur; neurId++) {
+			std::vector<int> spkExp = spkVec0[neurId];
+			for (size_t spk=0; spk<spkVec0[neurId].size(); spk++)
+				spkExp.push_back(spkVec0[neurId][spk] + runTimeSec*1000);
+			EXPECT_TRUE(spkVec1[neurId] == spkExp);
+			numSpikes += spkVec0[neurId].size();
+		}
+		EXPECT_GT(numSpikes, nNeur*runTimeSec*10);
+	}
+}
+
 TEST(SpikeGen, SpikeGeneratorFromFileLoadFile) {
 	int nNeur = 1;
 	PoissonRate* poiss = NULL;
@@ -364,4 +423,228 @@ TEST(SpikeGen, SpikeGeneratorFromVectorDeath) {
 
 	EXPECT_DEATH({SpikeGeneratorFromVector spkGen(emptyVec);},"");
 	EXPECT_DEATH({SpikeGeneratorFromVector spkGen(negativeVec);},"");
-}
\ No newline at end of file
+}
+
+// relays the per-neuron callback only, so that CARLsim has to fall back from the batch interface
+class PerNeuronSpikeGenerator : public SpikeGenerator {
+public:
+	PerNeuronSpikeGenerator(SpikeGenerator* spikeGen) : spikeGen_(spikeGen) {}
+
+	unsigned int nextSpikeTime(CARLsim* sim, int grpId, int nid, unsigned int currentTime,
+		unsigned int lastScheduledSpikeTime, unsigned int endOfTimeSlice) {
+		return spikeGen_->nextSpikeTime(sim, grpId, nid, currentTime, lastScheduledSpikeTime, endOfTimeSlice);
+	}
+
+private:
+	SpikeGenerator* spikeGen_;
+};
+
+// tests whether the batch interface schedules exactly the same spikes as the per-neuron nextSpikeTime callback
+TEST(SpikeGen, BatchVsPerNeuron) {
+	const int nNeur = 50;
+	CARLsim* sim = new CARLsim("SpikeGen.BatchVsPerNeuron",CPU_MODE,SILENT,0,42);
+	int g1 = sim->createGroup("g1", 1, EXCITATORY_NEURON);
+	sim->setNeuronParameters(g1, 0.02, 0.2, -65.0, 8.0);
+
+	// pairs of groups: the first group of each pair uses the batch interface, the second the per-neuron callback
+	int gPer[2], gVec[2], gPre[2], gPost[2];
+	for (int i=0; i<2; i++) {
+		gPer[i] = sim->createSpikeGeneratorGroup(i?"per1":"per0", nNeur, EXCITATORY_NEURON);
+		gVec[i] = sim->createSpikeGeneratorGroup(i?"vec1":"vec0", 1, EXCITATORY_NEURON);
+		gPre[i] = sim->createSpikeGeneratorGroup(i?"pre1":"pre0", nNeur, EXCITATORY_NEURON);
+		gPost[i] = sim->createSpikeGeneratorGroup(i?"post1":"post0", nNeur, EXCITATORY_NEURON);
+	}
+
+	std::vector<float> rates;
+	for (int neurId=0; neurId<nNeur; neurId++)
+		rates.push_back(1.0f + neurId%40);
+	std::vector<int> spkTimes;
+	for (int t=5; t<2500; t+=37)
+		spkTimes.push_back(t);
+
+	PeriodicSpikeGenerator per0(true), per1(true);
+	per0.setRates(rates);
+	per1.setRates(rates);
+	SpikeGeneratorFromVector vec0(spkTimes), vec1(spkTimes);
+	PrePostGroupSpikeGenerator pp0(40, 7, gPre[0], gPost[0]), pp1(40, 7, gPre[1], gPost[1]);
+	PerNeuronSpikeGenerator perWrap(&per1), vecWrap(&vec1), ppWrap(&pp1);
+
+	sim->setSpikeGenerator(gPer[0], &per0);
+	sim->setSpikeGenerator(gPer[1], &perWrap);
+	sim->setSpikeGenerator(gVec[0], &vec0);
+	sim->setSpikeGenerator(gVec[1], &vecWrap);
+	sim->setSpikeGenerator(gPre[0], &pp0);
+	sim->setSpikeGenerator(gPost[0], &pp0);
+	sim->setSpikeGenerator(gPre[1], &ppWrap);
+	sim->setSpikeGenerator(gPost[1], &ppWrap);
+	for (int i=0; i<2; i++) {
+		sim->connect(gPer[i], g1, "full", RangeWeight(0.0f), 1.0f);
+		sim->connect(gVec[i], g1, "full", RangeWeight(0.0f), 1.0f);
+		sim->connect(gPre[i], g1, "full", RangeWeight(0.0f), 1.0f);
+		sim->connect(gPost[i], g1, "full", RangeWeight(0.0f), 1.0f);
+	}
+	sim->setConductances(false);
+	sim->setupNetwork();
+
+	int grps[4][2] = { {gPer[0], gPer[1]}, {gVec[0], gVec[1]}, {gPre[0], gPre[1]}, {gPost[0], gPost[1]} };
+	SpikeMonitor* SM[4][2];
+	for (int g=0; g<4; g++) {
+		for (int i=0; i<2; i++) {
+			SM[g][i] = sim->setSpikeMonitor(grps[g][i], "NULL");
+			SM[g][i]->startRecording();
+		}
+	}
+	sim->runNetwork(1,500,false);
+	sim->runNetwork(1,0,false);
+
+	for (int g=0; g<4; g++) {
+		SM[g][0]->stopRecording();
+		SM[g][1]->stopRecording();
+		EXPECT_GT(SM[g][0]->getPopNumSpikes(), 0);
+		EXPECT_TRUE(SM[g][0]->getSpikeVector2D() == SM[g][1]->getSpikeVector2D());
+	}
+
+	delete sim;
+}
+
+TEST(SpikeGen, SpikeInjectionQueue) {
+	const int nNeur = 10;
+	CARLsim* sim = new CARLsim("SpikeGen.SpikeInjectionQueue",CPU_MODE,SILENT,0,42);
+	int gIn = sim->createSpikeGeneratorGroup("input", nNeur, EXCITATORY_NEURON);
+	int gOut = sim->createGroup("output", nNeur, EXCITATORY_NEURON);
+	sim->setNeuronParameters(gOut, 0.02f, 0.2f, -65.0f, 8.0f);
+	sim->connect(gIn, gOut, "one-to-one", RangeWeight(0.0f), 1.0f);
+	sim->setConductances(false);
+	sim->setupNetwork();
+
+	SpikeInjectionQueue queue(10);
+	EXPECT_EQ(queue.getCapacity(), 16);
+	sim->setSpikeInjectionQueue(&queue);
+
+	// spikes at specific times, one spike as soon as possible, and one that does not fit into the spike buffer yet
+	std::vector<std::vector<int> > spkExpected(nNeur);
+	for (int i=0; i<nNeur; i++) {
+		EXPECT_TRUE(queue.pushSpike(gIn, i, 100+i*10));
+		spkExpected[i].push_back(100+i*10);
+	}
+	EXPECT_TRUE(queue.pushSpike(gIn, 9));
+	spkExpected[9].insert(spkExpected[9].begin(), 0);
+	EXPECT_TRUE(queue.pushSpike(gIn, 0, 1500));
+	spkExpected[0].push_back(1500);
+	EXPECT_TRUE(queue.pushCurrent(gOut, 3, 15.0f));
+
+	// fill up the queue, the last push does not fit anymore
+	for (int i=1; i<=4; i++)
+		EXPECT_EQ(queue.pushSpike(gIn, i), i<4);
+	EXPECT_EQ(queue.getNumRejected(), 1);
+
+	SpikeMonitor* SMin = sim->setSpikeMonitor(gIn, "NULL");
+	SpikeMonitor* SMout = sim->setSpikeMonitor(gOut, "NULL");
+	SMin->startRecording();
+	SMout->startRecording();
+	sim->runNetwork(2,0,false);
+	SMin->stopRecording();
+	SMout->stopRecording();
+
+	// the spikes that did fit in fire right away, same as neuron 9
+	for (int i=1; i<4; i++)
+		spkExpected[i].insert(spkExpected[i].begin(), 0);
+	EXPECT_TRUE(SMin->getSpikeVector2D() == spkExpected);
+	EXPECT_EQ(queue.getSimTime(), 1999);
+	for (int i=0; i<nNeur; i++) {
+		if (i==3) {
+			EXPECT_GT(SMout->getNeuronNumSpikes(i), 0);
+		} else {
+			EXPECT_EQ(SMout->getNeuronNumSpikes(i), 0);
+		}
+	}
+
+	delete sim;
+}
+
+TEST(SpikeGen, SpikeInjectionQueueDeath) {
+	::testing::FLAGS_gtest_death_test_style = "threadsafe";
+
+	CARLsim* sim = new CARLsim("SpikeGen.SpikeInjectionQueueDeath",CPU_MODE,SILENT,0,42);
+	int gIn = sim->createSpikeGeneratorGroup("input", 1, EXCITATORY_NEURON);
+	int gOut = sim->createGroup("output", 1, EXCITATORY_NEURON);
+	sim->setNeuronParameters(gOut, 0.02f, 0.2f, -65.0f, 8.0f);
+	sim->connect(gIn, gOut, "one-to-one", RangeWeight(0.0f), 1.0f);
+	sim->setConductances(false);
+
+	SpikeInjectionQueue queue;
+	EXPECT_DEATH({sim->setSpikeInjectionQueue(&queue);},""); // CONFIG state
+	sim->setupNetwork();
+	sim->setSpikeInjectionQueue(&queue);
+
+	// the death tests run in a child process, so the parent has to remove the offending events itself
+	injection_event_t ev;
+	queue.pushSpike(gOut, 0); // not a spike generator
+	EXPECT_DEATH({sim->runNetwork(0,1,false);},"");
+	EXPECT_TRUE(queue.pop(ev));
+	queue.pushCurrent(gIn, 0, 1.0f); // a spike generator
+	EXPECT_DEATH({sim->runNetwork(0,1,false);},"");
+	EXPECT_TRUE(queue.pop(ev));
+	queue.pushSpike(gIn, 1); // invalid neuron ID
+	EXPECT_DEATH({sim->runNetwork(0,1,false);},"");
+	EXPECT_TRUE(queue.pop(ev));
+
+	delete sim;
+}
+
+#if !(defined(WIN32) || defined(WIN64))
+namespace {
+	struct injection_producer_t {
+		SpikeInjectionQueue* queue;
+		int grpId;
+		int nNeur;
+		int done;
+	};
+
+	// pushes one spike per neuron, retrying whenever the queue is full
+	void* injectionProducer(void* arg) {
+		injection_producer_t* p = (injection_producer_t*)arg;
+		for (int i=0; i<p->nNeur; i++) {
+			while (!p->queue->pushSpike(p->grpId, i))
+				sched_yield();
+		}
+		__atomic_store_n(&p->done, 1, __ATOMIC_RELEASE);
+		return NULL;
+	}
+}
+
+TEST(SpikeGen, SpikeInjectionQueueThreaded) {
+	const int nNeur = 1000;
+	CARLsim* sim = new CARLsim("SpikeGen.SpikeInjectionQueueThreaded",CPU_MODE,SILENT,0,42);
+	int gIn = sim->createSpikeGeneratorGroup("input", nNeur, EXCITATORY_NEURON);
+	int gOut = sim->createGroup("output", 1, EXCITATORY_NEURON);
+	sim->setNeuronParameters(gOut, 0.02f, 0.2f, -65.0f, 8.0f);
+	sim->connect(gIn, gOut, "full", RangeWeight(0.0f), 1.0f);
+	sim->setConductances(false);
+	sim->setupNetwork();
+
+	// a queue much smaller than the number of spikes, so that the producer has to wait for the simulation
+	SpikeInjectionQueue queue(16);
+	sim->setSpikeInjectionQueue(&queue);
+	SpikeMonitor* SMin = sim->setSpikeMonitor(gIn, "NULL");
+	SMin->startRecording();
+
+	// keep the simulation running until the producer is done, no matter how the two threads are scheduled
+	injection_producer_t producer = {&queue, gIn, nNeur, 0};
+	pthread_t thread;
+	ASSERT_EQ(pthread_create(&thread, NULL, injectionProducer, &producer), 0);
+	do {
+		sim->runNetwork(0,100,false);
+	} while (!__atomic_load_n(&producer.done, __ATOMIC_ACQUIRE));
+	pthread_join(thread, NULL);
+
+	// whatever was pushed during the last time step is delivered in the next one
+	sim->runNetwork(0,1,false);
+	SMin->stopRecording();
+
+	EXPECT_EQ(SMin->getPopNumSpikes(), nNeur);
+	EXPECT_EQ(SMin->getNumSilentNeurons(), 0);
+
+	delete sim;
+}
+#endif
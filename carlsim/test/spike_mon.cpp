@@ -3,9 +3,13 @@
 
 #include <carlsim.h>
 #include <snn_definitions.h> // MAX_GRP_PER_SNN
+#include <spike_file_reader.h>
 
 #if defined(WIN32) || defined(WIN64)
 #include <periodic_spikegen.h>
+#else
+#include <sys/wait.h>	// waitpid
+#include <unistd.h>		// fork, pipe, getpid
 #endif
 
 // TODO: I should probably use a google tests figure for this to reduce the
@@ -145,9 +149,13 @@ TEST(SpikeMon, interfaceDeath) {
 	// set up network and test all API calls that are not valid in certain modes
 	sim.setupNetwork();
 
-	// \TODO SpikeMonitor mode COUNT not yet implemented
-	EXPECT_DEATH(spkMon->setMode(COUNT),"");
-	// after mode is implemented, make sure you cannot call getSpikeVector2D in COUNT mode, etc.
+	EXPECT_DEATH(spkMon->setMemoryBudgetMB(-2),"");
+	EXPECT_DEATH(spkMon->getNeuronISICV(-1),"");
+	EXPECT_DEATH(spkMon->getNeuronFanoFactor(5),"");
+	EXPECT_DEATH(spkMon->getPopPSTH(),""); // setPSTHBins not called
+	EXPECT_DEATH(spkMon->startTrial(),"");
+	EXPECT_DEATH(spkMon->setPSTHBins(0,10),"");
+	EXPECT_DEATH(spkMon->setPSTHBins(10,-1),"");
 
 	// test all APIs that cannot be called when recording is on
 	spkMon->startRecording();
@@ -168,6 +176,13 @@ TEST(SpikeMon, interfaceDeath) {
 	EXPECT_DEATH(spkMon->print(),"");
 	EXPECT_DEATH(spkMon->startRecording(),"");
 	EXPECT_DEATH(spkMon->setLogFile("meow.dat"),"");
+	EXPECT_DEATH(spkMon->setMode(COUNT),"");
+	EXPECT_DEATH(spkMon->setPSTHBins(10,10),"");
+	spkMon->stopRecording();
+
+	// spike times are not available in COUNT mode
+	spkMon->setMode(COUNT);
+	EXPECT_DEATH(spkMon->getSpikeVector2D(),"");
 }
 
 
@@ -397,6 +412,574 @@ TEST(SpikeMon, spikeTimes) {
 	}
 }
 
+/*
+ * This test makes sure that the epoch length only changes when the firing tables are cleared and the monitors are
+ * updated, but not what they record. The same network is run with an epoch shorter than the longest delay, the default,
+ * and a long epoch (which is not a divisor of the run time), and all spike times must be the same. The network mixes
+ * 1ms delays with longer ones, so that both firing tables and the spikes carried over from one epoch to the next are
+ * exercised. Delays are fixed, because delay ranges are drawn from rand(), which is not seeded per simulation.
+ */
+TEST(SpikeMon, epochLength) {
+	int epochMs[3] = {7, 1000, 2500};
+	std::vector<std::vector<int> > spkVectorExc[3], spkVectorInh[3];
+
+	for (int e=0; e<3; e++) {
+		CARLsim sim("SpikeMon.epochLength",CPU_MODE,SILENT,0,42);
+		int gIn = sim.createSpikeGeneratorGroup("input", 50, EXCITATORY_NEURON);
+		int gExc = sim.createGroup("excit", 40, EXCITATORY_NEURON);
+		sim.setNeuronParameters(gExc, 0.02f, 0.2f, -65.0f, 8.0f);
+		int gInh = sim.createGroup("inhib", 10, INHIBITORY_NEURON);
+		sim.setNeuronParameters(gInh, 0.1f, 0.2f, -65.0f, 2.0f);
+		sim.connect(gIn, gExc, "random", RangeWeight(0.05f), 0.2f, RangeDelay(20));
+		sim.connect(gExc, gInh, "random", RangeWeight(0.1f), 0.2f, RangeDelay(5));
+		sim.connect(gInh, gExc, "random", RangeWeight(0.05f), 0.2f, RangeDelay(1));
+		sim.setConductances(true);
+		sim.setEpochLength(epochMs[e]);
+		sim.setupNetwork();
+
+		PoissonRate in(50);
+		in.setRates(20.0f);
+		sim.setSpikeRate(gIn, &in);
+
+		SpikeMonitor* spkMonExc = sim.setSpikeMonitor(gExc, "NULL");
+		SpikeMonitor* spkMonInh = sim.setSpikeMonitor(gInh, "NULL");
+		spkMonExc->startRecording();
+		spkMonInh->startRecording();
+		sim.runNetwork(1,350);
+		sim.runNetwork(2,0);
+		spkMonExc->stopRecording();
+		spkMonInh->stopRecording();
+
+		spkVectorExc[e] = spkMonExc->getSpikeVector2D();
+		spkVectorInh[e] = spkMonInh->getSpikeVector2D();
+		EXPECT_GT(spkMonExc->getPopNumSpikes(), 0);
+		EXPECT_GT(spkMonInh->getPopNumSpikes(), 0);
+	}
+
+	for (int e=1; e<3; e++) {
+		EXPECT_TRUE(spkVectorExc[e] == spkVectorExc[0]);
+		EXPECT_TRUE(spkVectorInh[e] == spkVectorInh[0]);
+	}
+}
+
+/*
+ * All SpikeMonitors are served by a single sweep over the firing tables. This test makes sure that a monitor records
+ * the same spikes no matter how many other groups are monitored, and even if some monitors were updated on their own
+ * in the middle of an epoch (by starting or stopping the recording).
+ */
+TEST(SpikeMon, multipleMonitors) {
+	std::vector<std::vector<int> > spkVectorAlone, spkVectorShared;
+
+	for (int numMon=1; numMon<=3; numMon+=2) {
+		CARLsim sim("SpikeMon.multipleMonitors",CPU_MODE,SILENT,0,42);
+		int gIn = sim.createSpikeGeneratorGroup("input", 20, EXCITATORY_NEURON);
+		int gExc = sim.createGroup("excit", 20, EXCITATORY_NEURON);
+		sim.setNeuronParameters(gExc, 0.02f, 0.2f, -65.0f, 8.0f);
+		int gInh = sim.createGroup("inhib", 10, INHIBITORY_NEURON);
+		sim.setNeuronParameters(gInh, 0.1f, 0.2f, -65.0f, 2.0f);
+		sim.connect(gIn, gExc, "random", RangeWeight(0.1f), 0.3f, RangeDelay(3));
+		sim.connect(gExc, gInh, "random", RangeWeight(0.1f), 0.3f, RangeDelay(1));
+		sim.connect(gInh, gExc, "random", RangeWeight(0.05f), 0.3f, RangeDelay(1));
+		sim.setConductances(true);
+		sim.setupNetwork();
+
+		PoissonRate in(20);
+		in.setRates(30.0f);
+		sim.setSpikeRate(gIn, &in);
+
+		// the run is split up the same way in both cases, because the Poisson spike generation depends on it
+		SpikeMonitor* spkMonExc = sim.setSpikeMonitor(gExc, "NULL");
+		spkMonExc->startRecording();
+		if (numMon==1) {
+			sim.runNetwork(0,300);
+			sim.runNetwork(1,450);
+			sim.runNetwork(0,750);
+			spkMonExc->stopRecording();
+			spkVectorAlone = spkMonExc->getSpikeVector2D();
+		} else {
+			SpikeMonitor* spkMonIn = sim.setSpikeMonitor(gIn, "NULL");
+			SpikeMonitor* spkMonInh = sim.setSpikeMonitor(gInh, "NULL");
+			spkMonIn->startRecording();
+			sim.runNetwork(0,300);
+			spkMonIn->stopRecording();
+			spkMonInh->startRecording();
+			sim.runNetwork(1,450);
+			spkMonIn->startRecording();
+			sim.runNetwork(0,750);
+			spkMonExc->stopRecording();
+			spkMonIn->stopRecording();
+			spkMonInh->stopRecording();
+			spkVectorShared = spkMonExc->getSpikeVector2D();
+			EXPECT_GT(spkMonIn->getPopNumSpikes(), 0);
+			EXPECT_GT(spkMonInh->getPopNumSpikes(), 0);
+		}
+	}
+
+	EXPECT_GT(spkVectorAlone.size(), 0);
+	EXPECT_TRUE(spkVectorShared == spkVectorAlone);
+}
+
+/*
+ * Spike files are written in large blocks rather than spike by spike. This test records more spikes than fit into one
+ * block and makes sure that the spike file is complete and in order as soon as runNetwork returns, even though the
+ * SpikeMonitor is still recording.
+ */
+TEST(SpikeMon, spikeFileBlockWrites) {
+	const int GRP_SIZE = 1000;
+	const int rate = 50;
+	const int runTimeSec = 2; // 100k spikes, more than one block of SPIKE_FILE_BUFFER_SIZE
+
+	CARLsim sim("SpikeMon.spikeFileBlockWrites",CPU_MODE,SILENT,0,42);
+	int g0 = sim.createSpikeGeneratorGroup("input", GRP_SIZE, EXCITATORY_NEURON);
+	int g1 = sim.createGroup("excit", 1, EXCITATORY_NEURON);
+	sim.setNeuronParameters(g1, 0.02f, 0.2f, -65.0f, 8.0f);
+	sim.connect(g0, g1, "full", RangeWeight(0.0f), 1.0f);
+	sim.setConductances(false);
+
+	PeriodicSpikeGenerator spkGen(true);
+	spkGen.setRates(rate);
+	sim.setSpikeGenerator(g0, &spkGen);
+	sim.setupNetwork();
+
+	SpikeMonitor* spkMon = sim.setSpikeMonitor(g0, "spkBlock.dat");
+	spkMon->startRecording();
+	sim.runNetwork(runTimeSec,0);
+
+	int* inputArray = NULL;
+	int64_t inputSize;
+	readAndReturnSpikeFile("spkBlock.dat",inputArray,inputSize);
+	ASSERT_EQ(inputSize/2, GRP_SIZE*rate*runTimeSec);
+	for (int i=2; i<inputSize; i+=2) {
+		EXPECT_GE(inputArray[i], inputArray[i-2]);
+		EXPECT_EQ(inputArray[i]%(1000/rate), 0);
+	}
+	if (inputArray!=NULL) delete[] inputArray;
+
+	spkMon->stopRecording();
+#if defined(WIN32) || defined(WIN64)
+	int ret = system("del spkBlock.dat");
+#else
+	int ret = system("rm -rf spkBlock.dat");
+#endif
+}
+
+// Records the spikes of a large group in three periods with gaps in between (persistent mode), and compares the
+// decoded spike vector and spike counts to the spike file after the second and after the third period. Recording
+// again invalidates the spike vector, so it is built twice, the second time with more blocks than the first.
+// Returns the number of bytes of spike data that were held in memory at the end.
+static int64_t recordAndCompareAERStorage(const std::string& testName, int memBudgetMB) {
+	const int GRP_SIZE = 1000;
+	int recStart[3] = {0, 2200, 4500};
+	int recStop[3] = {1500, 4000, 5300};
+	std::string fileName = "spk_" + testName + ".dat";
+
+	CARLsim sim("SpikeMon." + testName,CPU_MODE,SILENT,0,42);
+	int g0 = sim.createSpikeGeneratorGroup("input", GRP_SIZE, EXCITATORY_NEURON);
+	int g1 = sim.createGroup("excit", 1, EXCITATORY_NEURON);
+	sim.setNeuronParameters(g1, 0.02f, 0.2f, -65.0f, 8.0f);
+	sim.connect(g0, g1, "full", RangeWeight(0.0f), 1.0f, RangeDelay(1,5));
+	sim.setConductances(false);
+	sim.setupNetwork();
+
+	PoissonRate in(GRP_SIZE);
+	in.setRates(40.0f);
+	sim.setSpikeRate(g0, &in);
+
+	SpikeMonitor* spkMon = sim.setSpikeMonitor(g0, fileName);
+	spkMon->setPersistentData(true);
+	spkMon->setMemoryBudgetMB(memBudgetMB);
+	for (int r=0; r<3; r++) {
+		if (recStart[r] > sim.getSimTime())
+			sim.runNetwork(0, recStart[r]-sim.getSimTime());
+		spkMon->startRecording();
+		sim.runNetwork((recStop[r]-recStart[r])/1000, (recStop[r]-recStart[r])%1000);
+		spkMon->stopRecording();
+		if (r==0)
+			continue;
+
+		// build the expected spike vector from all spikes in the file that fall into a recording period so far
+		int* inputArray = NULL;
+		int64_t inputSize;
+		readAndReturnSpikeFile(fileName,inputArray,inputSize);
+		std::vector<std::vector<int> > spkVectorFile(GRP_SIZE);
+		int numSpikes = 0;
+		for (int i=0; i<inputSize; i+=2) {
+			int time = inputArray[i];
+			for (int p=0; p<=r; p++) {
+				if (time>=recStart[p] && time<recStop[p]) {
+					spkVectorFile[inputArray[i+1]].push_back(time);
+					numSpikes++;
+				}
+			}
+		}
+		if (inputArray!=NULL) delete[] inputArray;
+
+		EXPECT_GT(numSpikes, 100000);
+		EXPECT_EQ(spkMon->getPopNumSpikes(), numSpikes);
+		std::vector<std::vector<int> > spkVector = spkMon->getSpikeVector2D();
+		EXPECT_TRUE(spkVector == spkVectorFile);
+		for (int i=0; i<GRP_SIZE; i++)
+			EXPECT_EQ(spkMon->getNeuronNumSpikes(i), spkVectorFile[i].size());
+	}
+
+	int64_t memBytes = spkMon->getMemoryUsageBytes();
+
+#if defined(WIN32) || defined(WIN64)
+	int ret = system(("del " + fileName).c_str());
+#else
+	int ret = system(("rm -rf " + fileName).c_str());
+#endif
+
+	return memBytes;
+}
+
+/*
+ * SpikeMonitor stores its spikes in compact, encoded AER blocks and builds the 2D spike vector only on demand. Every
+ * spike takes at least two bytes, all of which are kept in memory by default.
+ */
+TEST(SpikeMon, compactAERStorage) {
+	EXPECT_GE(recordAndCompareAERStorage("compactAERStorage", -1), 2*100000);
+}
+
+/*
+ * With a memory budget of zero, SpikeMonitor spills every sealed AER block to a temporary file, and only the block
+ * that is currently being filled stays in memory. The spike vector must not change when the spilled blocks are read
+ * back, and reading them back must not keep later blocks from being spilled.
+ */
+TEST(SpikeMon, compactAERStorageSpill) {
+	EXPECT_LE(recordAndCompareAERStorage("compactAERStorageSpill", 0), SPIKE_MON_AER_BLOCK_SIZE);
+}
+
+/*
+ * This test writes an indexed spike file and makes sure that SpikeFileReader finds the same spikes as the
+ * SpikeMonitor, for the entire file as well as for a time window and a subset of neurons. The same must hold for a
+ * flat spike file, and for an indexed file whose index is missing (as if the simulation had crashed).
+ */
+TEST(SpikeMon, indexedSpikeFile) {
+	// use threadsafe version because we have deathtests
+	::testing::FLAGS_gtest_death_test_style = "threadsafe";
+
+	const int GRP_SIZE = 1000;
+	const int runTimeMs = 4000;
+	CARLsim sim("SpikeMon.indexedSpikeFile",CPU_MODE,SILENT,0,42);
+	int gIdx = sim.createSpikeGeneratorGroup("indexed", GRP_SIZE, EXCITATORY_NEURON);
+	int gFlat = sim.createSpikeGeneratorGroup("flat", GRP_SIZE, EXCITATORY_NEURON);
+	int g1 = sim.createGroup("excit", 1, EXCITATORY_NEURON);
+	sim.setNeuronParameters(g1, 0.02f, 0.2f, -65.0f, 8.0f);
+	sim.connect(gIdx, g1, "full", RangeWeight(0.0f), 1.0f, RangeDelay(1));
+	sim.connect(gFlat, g1, "full", RangeWeight(0.0f), 1.0f, RangeDelay(1));
+	sim.setConductances(false);
+	sim.setupNetwork();
+
+	PoissonRate in(GRP_SIZE);
+	in.setRates(40.0f);
+	sim.setSpikeRate(gIdx, &in);
+	sim.setSpikeRate(gFlat, &in);
+
+	SpikeMonitor* spkMonIdx = sim.setSpikeMonitor(gIdx, "spkIndexed.dat");
+	SpikeMonitor* spkMonFlat = sim.setSpikeMonitor(gFlat, "spkFlat.dat");
+	spkMonIdx->setLogFileIndexed(true);
+	spkMonIdx->startRecording();
+	spkMonFlat->startRecording();
+	sim.runNetwork(runTimeMs/1000, runTimeMs%1000);
+	spkMonIdx->stopRecording();
+	spkMonFlat->stopRecording();
+
+	// spikes have been written, format can no longer be changed
+	EXPECT_DEATH(spkMonIdx->setLogFileIndexed(false),"");
+
+	// close the indexed file, which writes the index
+	spkMonIdx->setLogFile("NULL");
+
+	// time window and neuron subset to test
+	const int tStart = 1234, tEnd = 2345;
+	std::vector<int> neurIds;
+	neurIds.push_back(3); neurIds.push_back(500); neurIds.push_back(GRP_SIZE-1);
+
+	// cut off the index of the indexed file
+	FILE* fp = fopen("spkIndexed.dat", "rb");
+	fseek(fp, 0, SEEK_END);
+	long fileSize = ftell(fp);
+	std::vector<char> fileContent(fileSize);
+	fseek(fp, 0, SEEK_SET);
+	EXPECT_EQ(fread(&fileContent[0], 1, fileSize, fp), fileSize);
+	fclose(fp);
+	int64_t indexOffset;
+	memcpy(&indexOffset, &fileContent[fileSize-16], sizeof(int64_t));
+	fp = fopen("spkIndexedNoIdx.dat", "wb");
+	fwrite(&fileContent[0], 1, indexOffset, fp);
+	fclose(fp);
+
+	// let the first index entry point past the end of the file, which must be treated like a missing index
+	int64_t badBlockOffset = 2*(int64_t)fileSize;
+	memcpy(&fileContent[indexOffset], &badBlockOffset, sizeof(int64_t));
+	fp = fopen("spkIndexedBadIdx.dat", "wb");
+	fwrite(&fileContent[0], 1, fileSize, fp);
+	fclose(fp);
+
+	const char* fileNames[4] = {"spkIndexed.dat", "spkIndexedNoIdx.dat", "spkIndexedBadIdx.dat", "spkFlat.dat"};
+	for (int f=0; f<4; f++) {
+		SpikeMonitor* spkMon = (f<3) ? spkMonIdx : spkMonFlat;
+		std::vector<std::vector<int> > spkVector = spkMon->getSpikeVector2D();
+
+		SpikeFileReader reader(fileNames[f]);
+		EXPECT_EQ(reader.isIndexed(), f<3);
+		EXPECT_EQ(reader.getNumNeurons(), GRP_SIZE);
+		EXPECT_EQ(reader.getNumSpikes(), spkMon->getPopNumSpikes());
+		if (f<3)
+			EXPECT_GT(reader.getNumBlocks(), 1);
+
+		// read the entire file
+		std::vector<int> spkTimes, spkNeurIds;
+		reader.readSpikes(0, runTimeMs, spkTimes, spkNeurIds);
+		std::vector<std::vector<int> > spkVectorFile(GRP_SIZE);
+		for (size_t i=0; i<spkTimes.size(); i++)
+			spkVectorFile[spkNeurIds[i]].push_back(spkTimes[i]);
+		EXPECT_TRUE(spkVectorFile == spkVector);
+
+		// read a time window of some neurons
+		spkTimes.clear();
+		spkNeurIds.clear();
+		reader.readSpikes(tStart, tEnd, neurIds, spkTimes, spkNeurIds);
+		int numSpikes = 0;
+		for (size_t n=0; n<neurIds.size(); n++) {
+			std::vector<int> spkTimesNeur;
+			for (size_t i=0; i<spkTimes.size(); i++) {
+				if (spkNeurIds[i]==neurIds[n])
+					spkTimesNeur.push_back(spkTimes[i]);
+			}
+			std::vector<int> spkTimesExp;
+			for (size_t j=0; j<spkVector[neurIds[n]].size(); j++) {
+				if (spkVector[neurIds[n]][j]>=tStart && spkVector[neurIds[n]][j]<tEnd)
+					spkTimesExp.push_back(spkVector[neurIds[n]][j]);
+			}
+			EXPECT_TRUE(spkTimesNeur == spkTimesExp);
+			numSpikes += spkTimesExp.size();
+		}
+		EXPECT_GT(numSpikes, 0);
+		EXPECT_EQ(spkTimes.size(), numSpikes);
+	}
+
+#if defined(WIN32) || defined(WIN64)
+	int ret = system("del spkIndexed.dat spkIndexedNoIdx.dat spkIndexedBadIdx.dat spkFlat.dat");
+#else
+	int ret = system("rm -rf spkIndexed.dat spkIndexedNoIdx.dat spkIndexedBadIdx.dat spkFlat.dat");
+#endif
+}
+
+/*
+ * This test makes sure that the streaming statistics of COUNT mode match the ones computed from the spike file, and
+ * that they can be retrieved while recording. A periodic input has perfectly regular spike trains (ISI CV and Fano
+ * factor are zero), whereas a Poisson input has an ISI CV close to one.
+ */
+TEST(SpikeMon, streamingStatistics) {
+	const int GRP_SIZE = 500;
+	const int BIN_MS = 100;
+	const int midTime = 750;
+	const int stopTime = 3050;
+
+	CARLsim sim("SpikeMon.streamingStatistics",CPU_MODE,SILENT,0,42);
+	int gPer = sim.createSpikeGeneratorGroup("periodic", GRP_SIZE, EXCITATORY_NEURON);
+	int gPoi = sim.createSpikeGeneratorGroup("poisson", GRP_SIZE, EXCITATORY_NEURON);
+	int g1 = sim.createGroup("excit", 1, EXCITATORY_NEURON);
+	sim.setNeuronParameters(g1, 0.02f, 0.2f, -65.0f, 8.0f);
+	sim.connect(gPer, g1, "full", RangeWeight(0.0f), 1.0f, RangeDelay(1));
+	sim.connect(gPoi, g1, "full", RangeWeight(0.0f), 1.0f, RangeDelay(1));
+	sim.setConductances(false);
+
+	PeriodicSpikeGenerator spkGen(true);
+	spkGen.setRates(10.0f);
+	sim.setSpikeGenerator(gPer, &spkGen);
+	sim.setupNetwork();
+
+	PoissonRate in(GRP_SIZE);
+	in.setRates(20.0f);
+	sim.setSpikeRate(gPoi, &in);
+
+	SpikeMonitor* spkMonPer = sim.setSpikeMonitor(gPer, "NULL");
+	SpikeMonitor* spkMonPoi = sim.setSpikeMonitor(gPoi, "spkStreaming.dat");
+	spkMonPer->setMode(COUNT);
+	spkMonPoi->setMode(COUNT);
+	EXPECT_EQ(spkMonPoi->getMode(), COUNT);
+
+	spkMonPer->startRecording();
+	spkMonPoi->startRecording();
+	sim.runNetwork(0, midTime);
+
+	// metrics can be retrieved without stopping the recording
+	EXPECT_TRUE(spkMonPoi->isRecording());
+	EXPECT_EQ(spkMonPoi->getRecordingTotalTime(), midTime);
+	int midNumSpikes = spkMonPoi->getPopNumSpikes();
+	EXPECT_EQ(spkMonPer->getPopNumSpikes(), GRP_SIZE*8);
+	EXPECT_FLOAT_EQ(spkMonPer->getPopMeanFiringRate(), 8*1000.0f/midTime);
+
+	sim.runNetwork((stopTime-midTime)/1000, (stopTime-midTime)%1000);
+	spkMonPer->stopRecording();
+	spkMonPoi->stopRecording();
+
+	// periodic input: every 100 ms bin holds exactly one spike per neuron
+	for (int i=0; i<GRP_SIZE; i++) {
+		EXPECT_EQ(spkMonPer->getNeuronNumSpikes(i), stopTime/100+1);
+		EXPECT_FLOAT_EQ(spkMonPer->getNeuronMeanISI(i), 100.0f);
+		EXPECT_FLOAT_EQ(spkMonPer->getNeuronISICV(i), 0.0f);
+		EXPECT_FLOAT_EQ(spkMonPer->getNeuronFanoFactor(i), 0.0f);
+	}
+	EXPECT_NEAR(spkMonPer->getPopFiringRateStdOverTime(), 0.0f, 1e-3f);
+
+	// compute the expected statistics of the Poisson input from the spike file
+	int* inputArray = NULL;
+	int64_t inputSize;
+	readAndReturnSpikeFile("spkStreaming.dat",inputArray,inputSize);
+	const int numBins = stopTime/BIN_MS;
+	std::vector<std::vector<int> > spkTimes(GRP_SIZE);
+	std::vector<std::vector<int> > binCnt(GRP_SIZE, std::vector<int>(numBins,0));
+	std::vector<int> popBinCnt(numBins,0);
+	int numSpikes = 0, numSpikesMid = 0;
+	for (int i=0; i<inputSize; i+=2) {
+		int time = inputArray[i];
+		int nid = inputArray[i+1];
+		if (time >= stopTime)
+			continue;
+		spkTimes[nid].push_back(time);
+		numSpikes++;
+		if (time < midTime)
+			numSpikesMid++;
+		if (time/BIN_MS < numBins) {
+			binCnt[nid][time/BIN_MS]++;
+			popBinCnt[time/BIN_MS]++;
+		}
+	}
+	if (inputArray!=NULL) delete[] inputArray;
+
+	EXPECT_EQ(midNumSpikes, numSpikesMid);
+	EXPECT_EQ(spkMonPoi->getPopNumSpikes(), numSpikes);
+	EXPECT_EQ(spkMonPoi->getRecordingTotalTime(), stopTime);
+
+	double sumCV = 0.0;
+	for (int i=0; i<GRP_SIZE; i++) {
+		EXPECT_EQ(spkMonPoi->getNeuronNumSpikes(i), spkTimes[i].size());
+
+		// ISI mean and CV
+		int nISI = spkTimes[i].size()-1;
+		double isiMean = 0.0, isiVar = 0.0;
+		for (int j=0; j<nISI; j++)
+			isiMean += spkTimes[i][j+1]-spkTimes[i][j];
+		isiMean = (nISI>0) ? isiMean/nISI : 0.0;
+		for (int j=0; j<nISI; j++)
+			isiVar += (spkTimes[i][j+1]-spkTimes[i][j]-isiMean)*(spkTimes[i][j+1]-spkTimes[i][j]-isiMean);
+		double isiCV = (nISI>1) ? sqrt(isiVar/(nISI-1))/isiMean : 0.0;
+		EXPECT_NEAR(spkMonPoi->getNeuronMeanISI(i), isiMean, 1e-3);
+		EXPECT_NEAR(spkMonPoi->getNeuronISICV(i), isiCV, 1e-4);
+		sumCV += isiCV;
+
+		// Fano factor over complete bins
+		double cntMean = 0.0, cntVar = 0.0;
+		for (int b=0; b<numBins; b++)
+			cntMean += binCnt[i][b];
+		cntMean /= numBins;
+		for (int b=0; b<numBins; b++)
+			cntVar += (binCnt[i][b]-cntMean)*(binCnt[i][b]-cntMean);
+		double fano = (cntMean>0) ? cntVar/(numBins-1)/cntMean : 0.0;
+		EXPECT_NEAR(spkMonPoi->getNeuronFanoFactor(i), fano, 1e-4);
+	}
+	EXPECT_NEAR(sumCV/GRP_SIZE, 1.0, 0.1);
+
+	// population rate over time
+	double rateMean = 0.0, rateVar = 0.0;
+	for (int b=0; b<numBins; b++)
+		rateMean += popBinCnt[b]*1000.0/(BIN_MS*GRP_SIZE);
+	rateMean /= numBins;
+	for (int b=0; b<numBins; b++) {
+		double rate = popBinCnt[b]*1000.0/(BIN_MS*GRP_SIZE);
+		rateVar += (rate-rateMean)*(rate-rateMean);
+	}
+	EXPECT_NEAR(spkMonPoi->getPopFiringRateStdOverTime(), sqrt(rateVar/(numBins-1)), 1e-3);
+
+#if defined(WIN32) || defined(WIN64)
+	int ret = system("del spkStreaming.dat");
+#else
+	int ret = system("rm -rf spkStreaming.dat");
+#endif
+}
+
+/*
+ * This test checks the PSTHs that are accumulated over several trials. A periodic input fires at the same offset in
+ * every trial, so only two bins are non-zero. For a Poisson input, the PSTHs must match the ones computed from the 2D
+ * spike vector. PSTHs read in the middle of a trial must only be normalized by the time that has been recorded so far.
+ */
+TEST(SpikeMon, psth) {
+	const int GRP_SIZE = 50;
+	const int binSizeMs = 10, numBins = 20;
+	const int trialMs = 500, numTrials = 4;
+
+	CARLsim sim("SpikeMon.psth",CPU_MODE,SILENT,0,42);
+	int gPer = sim.createSpikeGeneratorGroup("periodic", GRP_SIZE, EXCITATORY_NEURON);
+	int gPoi = sim.createSpikeGeneratorGroup("poisson", GRP_SIZE, EXCITATORY_NEURON);
+	int g1 = sim.createGroup("excit", 1, EXCITATORY_NEURON);
+	sim.setNeuronParameters(g1, 0.02f, 0.2f, -65.0f, 8.0f);
+	sim.connect(gPer, g1, "full", RangeWeight(0.0f), 1.0f, RangeDelay(1));
+	sim.connect(gPoi, g1, "full", RangeWeight(0.0f), 1.0f, RangeDelay(1));
+	sim.setConductances(false);
+
+	PeriodicSpikeGenerator spkGen(true);
+	spkGen.setRates(10.0f);
+	sim.setSpikeGenerator(gPer, &spkGen);
+	sim.setupNetwork();
+
+	PoissonRate in(GRP_SIZE);
+	in.setRates(50.0f);
+	sim.setSpikeRate(gPoi, &in);
+
+	SpikeMonitor* spkMonPer = sim.setSpikeMonitor(gPer, "NULL");
+	SpikeMonitor* spkMonPoi = sim.setSpikeMonitor(gPoi, "NULL");
+	spkMonPer->setPSTHBins(binSizeMs, numBins);
+	spkMonPoi->setPSTHBins(binSizeMs, numBins);
+
+	spkMonPer->startRecording();
+	spkMonPoi->startRecording();
+	for (int t=0; t<numTrials; t++) {
+		spkMonPer->startTrial();
+		spkMonPoi->startTrial();
+		sim.runNetwork(0, trialMs/2);
+		if (t==1) {
+			// in the middle of a trial: every bin has been covered by one or two trials, rates don't change
+			std::vector<float> psth = spkMonPer->getPopPSTH();
+			for (int b=0; b<numBins; b++)
+				EXPECT_FLOAT_EQ(psth[b], (b==0 || b==10) ? 100.0f : 0.0f);
+		}
+		sim.runNetwork(0, trialMs/2);
+	}
+	spkMonPer->stopRecording();
+	spkMonPoi->stopRecording();
+	EXPECT_EQ(spkMonPer->getNumTrials(), numTrials);
+
+	// periodic input: one spike per neuron and trial at offset 0 and 100 ms
+	std::vector<float> psth = spkMonPer->getPopPSTH();
+	ASSERT_EQ(psth.size(), numBins);
+	for (int b=0; b<numBins; b++)
+		EXPECT_FLOAT_EQ(psth[b], (b==0 || b==10) ? 1000.0f/binSizeMs : 0.0f);
+
+	// Poisson input: compare to the spike vector
+	std::vector<std::vector<int> > spkVector = spkMonPoi->getSpikeVector2D();
+	std::vector<float> popPSTH(numBins, 0.0f);
+	for (int i=0; i<GRP_SIZE; i++) {
+		std::vector<float> neurPSTH(numBins, 0.0f);
+		for (size_t j=0; j<spkVector[i].size(); j++) {
+			int offset = spkVector[i][j] % trialMs;
+			if (offset < numBins*binSizeMs)
+				neurPSTH[offset/binSizeMs] += 1000.0f/(numTrials*binSizeMs);
+		}
+		std::vector<float> psthMon = spkMonPoi->getNeuronPSTH(i);
+		for (int b=0; b<numBins; b++) {
+			EXPECT_NEAR(psthMon[b], neurPSTH[b], 1e-3f);
+			popPSTH[b] += neurPSTH[b]/GRP_SIZE;
+		}
+	}
+	psth = spkMonPoi->getPopPSTH();
+	for (int b=0; b<numBins; b++)
+		EXPECT_NEAR(psth[b], popPSTH[b], 1e-3f);
+}
+
 /*
  * This test checks for the correctness of the getGroupFiringRate method.
  * A PeriodicSpikeGenerator is used to periodically generate input spikes, so that the input spike times are known.
@@ -693,3 +1276,159 @@ TEST(SpikeMon, setLogFile) {
 		delete sim;
 	}
 }
+
+#if !(defined(WIN32) || defined(WIN64))
+/*!
+ * \brief testing the shared-memory spike stream
+ *
+ * A consumer process (forked off after the stream was created) and an in-process SpikeStreamReader must both see
+ * exactly the spikes recorded by SpikeMonitor. A second, tiny stream of another group that is read only at the end
+ * must report the overwritten spikes as lost.
+ */
+TEST(SpikeMon, spikeStream) {
+	const int GRP_SIZE = 10;
+	const int runTimeMs = 1000;
+
+	std::stringstream name; name << "carlsim_test_spike_stream_" << getpid();
+	std::stringstream nameSmall; nameSmall << name.str() << "_small";
+
+	CARLsim* sim = new CARLsim("SpikeMon.spikeStream",CPU_MODE,SILENT,0,42);
+	int g0 = sim->createSpikeGeneratorGroup("input", GRP_SIZE, EXCITATORY_NEURON);
+	int g1 = sim->createGroup("excit", GRP_SIZE, EXCITATORY_NEURON);
+	sim->setNeuronParameters(g1, 0.02f, 0.2f, -65.0f, 8.0f);
+	sim->connect(g0, g1, "one-to-one", RangeWeight(0.8f), 1.0f, RangeDelay(1,5));
+	sim->setConductances(true);
+	sim->setSpikeStream(g0, name.str());
+	sim->setSpikeStream(g1, name.str());
+	int g2 = sim->createSpikeGeneratorGroup("input2", GRP_SIZE, EXCITATORY_NEURON);
+	sim->setSpikeStream(g2, nameSmall.str(), 10); // rounded up to 16 slots
+	sim->setupNetwork();
+
+	PoissonRate in(GRP_SIZE);
+	in.setRates(40.0f);
+	sim->setSpikeRate(g0, &in);
+	sim->setSpikeRate(g2, &in);
+	SpikeMonitor* spkMon[3] = {sim->setSpikeMonitor(g0, "NULL"), sim->setSpikeMonitor(g1, "NULL"),
+		sim->setSpikeMonitor(g2, "NULL")};
+
+	// the readers are created before the fork, so that the consumer inherits the mapping and does not miss anything
+	SpikeStreamReader reader(name.str());
+	SpikeStreamReader readerSmall(nameSmall.str());
+	ASSERT_TRUE(reader.isOpen());
+	ASSERT_TRUE(readerSmall.isOpen());
+	EXPECT_EQ(reader.getLastTime(), -1);
+
+	int fd[2];
+	ASSERT_EQ(pipe(fd), 0);
+	pid_t pid = fork();
+	ASSERT_GE(pid, 0);
+	if (pid == 0) {
+		// consumer: read until the last time step has been published, then send all spikes to the parent
+		close(fd[0]);
+		std::vector<int> times, grpIds, neurIds;
+		do {
+			reader.readSpikes(times, grpIds, neurIds);
+		} while (reader.getLastTime() < runTimeMs-1);
+		reader.readSpikes(times, grpIds, neurIds);
+		int numLost = reader.getNumSpikesLost();
+		int ok = write(fd[1], &numLost, sizeof(int)) == sizeof(int);
+		for (unsigned int i=0; ok && i<times.size(); i++) {
+			int spk[3] = {times[i], grpIds[i], neurIds[i]};
+			ok = write(fd[1], spk, sizeof(spk)) == sizeof(spk);
+		}
+		close(fd[1]);
+		_exit(ok ? 0 : 1);
+	}
+	close(fd[1]);
+
+	for (int g=0; g<3; g++)
+		spkMon[g]->startRecording();
+	sim->runNetwork(runTimeMs/1000, runTimeMs%1000);
+	for (int g=0; g<3; g++)
+		spkMon[g]->stopRecording();
+
+	// collect everything the consumer has read
+	int numLostChild = -1;
+	std::vector<std::vector<int> > spkChild[2];
+	spkChild[0].resize(GRP_SIZE);
+	spkChild[1].resize(GRP_SIZE);
+	EXPECT_EQ(read(fd[0], &numLostChild, sizeof(int)), sizeof(int));
+	int spk[3];
+	while (read(fd[0], spk, sizeof(spk)) == sizeof(spk)) {
+		ASSERT_TRUE(spk[1]==g0 || spk[1]==g1);
+		ASSERT_TRUE(spk[2]>=0 && spk[2]<GRP_SIZE);
+		spkChild[spk[1]==g0 ? 0 : 1][spk[2]].push_back(spk[0]);
+	}
+	close(fd[0]);
+	int status = -1;
+	waitpid(pid, &status, 0);
+	EXPECT_TRUE(WIFEXITED(status) && WEXITSTATUS(status)==0);
+	EXPECT_EQ(numLostChild, 0);
+
+	// the in-process reader must see the same spikes
+	std::vector<int> times, grpIds, neurIds;
+	reader.readSpikes(times, grpIds, neurIds);
+	EXPECT_EQ(reader.getLastTime(), runTimeMs-1);
+	EXPECT_EQ(reader.getNumSpikesLost(), 0);
+	std::vector<std::vector<int> > spkParent[2];
+	spkParent[0].resize(GRP_SIZE);
+	spkParent[1].resize(GRP_SIZE);
+	for (unsigned int i=0; i<times.size(); i++)
+		spkParent[grpIds[i]==g0 ? 0 : 1][neurIds[i]].push_back(times[i]);
+
+	int numSpikes = 0;
+	for (int g=0; g<2; g++) {
+		std::vector<std::vector<int> > spkVector = spkMon[g]->getSpikeVector2D();
+		numSpikes += spkMon[g]->getPopNumSpikes();
+		for (int n=0; n<GRP_SIZE; n++) {
+			EXPECT_EQ(spkChild[g][n], spkVector[n]);
+			EXPECT_EQ(spkParent[g][n], spkVector[n]);
+		}
+	}
+	EXPECT_GT(spkMon[1]->getPopNumSpikes(), 0);
+	EXPECT_EQ(times.size(), numSpikes);
+
+	// the tiny stream only keeps the last 16 spikes of g2
+	times.clear(); grpIds.clear(); neurIds.clear();
+	EXPECT_EQ(readerSmall.readSpikes(times, grpIds, neurIds), 16);
+	EXPECT_EQ(readerSmall.getNumSpikesLost(), spkMon[2]->getPopNumSpikes()-16);
+	for (unsigned int i=0; i<times.size(); i++)
+		EXPECT_EQ(grpIds[i], g2);
+
+	delete sim;
+
+	// the stream is unlinked along with the network
+	SpikeStreamReader readerGone(name.str());
+	EXPECT_FALSE(readerGone.isOpen());
+}
+
+/*!
+ * \brief testing spike streams whose name is already taken
+ *
+ * A second writer must not take over the stream of a simulation that is still running, unless it is asked to
+ * replace it. Capacities beyond SPIKE_STREAM_MAX_CAPACITY are rejected.
+ */
+TEST(SpikeMon, spikeStreamNameTaken) {
+	// use threadsafe version because we have deathtests
+	::testing::FLAGS_gtest_death_test_style = "threadsafe";
+
+	CARLsim* sim = new CARLsim("SpikeMon.spikeStreamNameTaken",CPU_MODE,SILENT,0,42);
+	int g0 = sim->createSpikeGeneratorGroup("input", 10, EXCITATORY_NEURON);
+
+	// death tests come first: the dying process would not unlink the streams it created
+	std::stringstream name; name << "carlsim_test_spike_stream_taken_" << getpid();
+	EXPECT_DEATH({sim->setSpikeStream(g0, name.str(), SPIKE_STREAM_MAX_CAPACITY+1);},"");
+
+	SpikeStreamWriter writer(name.str(), 16);
+	ASSERT_TRUE(writer.isOpen());
+	EXPECT_EQ(writer.getName(), "/" + name.str());
+	SpikeStreamWriter writerTaken(name.str(), 16);
+	EXPECT_FALSE(writerTaken.isOpen());
+
+	// replacing the stream unlinks it, so it is gone after the network is deleted
+	sim->setSpikeStream(g0, "/" + name.str(), 16, true);
+	delete sim;
+	SpikeStreamReader readerGone(name.str());
+	EXPECT_FALSE(readerGone.isOpen());
+}
+#endif
@@ -603,6 +603,128 @@ TEST(STDP, ISTDPPulseCurve) {
 	}
 }
 
+/*!
+ * \brief testing DA-modulated STDP with eligibility traces
+ * A single pre-post pairing is followed by a dopamine burst 300 ms later. With eligibility traces, the delayed reward
+ * is expected to strengthen the synapse. Without eligibility traces, the weight change of the pairing has already been
+ * applied by the time the reward arrives, so the reward is expected to have no effect.
+ */
+TEST(STDP, DASTDPEligibilityTraceDelayedReward) {
+	float weight[2][2]; // [elig][reward]
+
+	for (int elig=0; elig<2; elig++) {
+		for (int reward=0; reward<2; reward++) {
+			CARLsim* sim = new CARLsim("STDP.DASTDPEligibilityTraceDelayedReward", CPU_MODE, SILENT, 0, 42);
+
+			int g1 = sim->createGroup("post-ex", 1, EXCITATORY_NEURON);
+			sim->setNeuronParameters(g1, 0.02f, 0.2f, -65.0f, 8.0f);
+			int gin = sim->createSpikeGeneratorGroup("pre-ex", 1, EXCITATORY_NEURON);
+			int gdrive = sim->createSpikeGeneratorGroup("post-drive", 1, EXCITATORY_NEURON);
+			int gda = sim->createSpikeGeneratorGroup("DA neurons", 1, DOPAMINERGIC_NEURON);
+
+			sim->connect(gin, g1, "one-to-one", RangeWeight(0.0, 1.0f, 20.0f), 1.0f, RangeDelay(1), RadiusRF(-1), SYN_PLASTIC);
+			sim->connect(gdrive, g1, "one-to-one", RangeWeight(40.0f), 1.0f, RangeDelay(1), RadiusRF(-1), SYN_FIXED);
+			sim->connect(gda, g1, "full", RangeWeight(0.0), 1.0f, RangeDelay(1), RadiusRF(-1), SYN_FIXED);
+
+			sim->setConductances(false);
+			sim->setESTDP(g1, true, DA_MOD, ExpCurve(0.1f, 20.0f, -0.12f, 20.0f));
+			sim->setNeuromodulator(g1, 0.001f, 100.0f, 1.0f, 100.0f, 1.0f, 100.0f, 1.0f, 100.0f);
+			if (elig)
+				sim->setEligibilityTrace(g1, true, 1000.0f);
+			sim->setWeightAndWeightChangeUpdate(INTERVAL_10MS, false);
+
+			// pre spike at t=100ms, post spike a few ms later (LTP), DA burst at t=400ms (or after the run)
+			std::vector<int> spkPre(1, 100), spkDrive(1, 105), spkDA;
+			for (int t=0; t<20; t++)
+				spkDA.push_back(reward ? 400+t : 5000+t);
+			SpikeGeneratorFromVector sgPre(spkPre), sgDrive(spkDrive), sgDA(spkDA);
+			sim->setSpikeGenerator(gin, &sgPre);
+			sim->setSpikeGenerator(gdrive, &sgDrive);
+			sim->setSpikeGenerator(gda, &sgDA);
+
+			sim->setupNetwork();
+			ConnectionMonitor* CM = sim->setConnectionMonitor(gin, g1, "NULL");
+			SpikeMonitor* SM = sim->setSpikeMonitor(g1, "NULL");
+
+			SM->startRecording();
+			sim->runNetwork(1, 0, false);
+			SM->stopRecording();
+			ASSERT_EQ(SM->getPopNumSpikes(), 1);
+
+			weight[elig][reward] = CM->takeSnapshot()[0][0];
+			delete sim;
+		}
+	}
+
+	// without eligibility traces, a late reward does not matter
+	EXPECT_FLOAT_EQ(weight[0][0], weight[0][1]);
+
+	// with eligibility traces, the late reward potentiates the synapse
+	EXPECT_GT(weight[1][1], weight[1][0] + 1.0f);
+	EXPECT_GT(weight[1][0], 1.0f); // LTP gated by the (small) baseline DA concentration
+}
+
+/*!
+ * \brief testing the sparse weight update against a dense reference
+ * updateWeights only visits post-neurons with pending weight changes, unless weights were written from outside the
+ * STDP path (setWeight, scaleWeights, etc.), in which case every plastic synapse is visited and clamped once. The
+ * reference run calls scaleWeights with a factor of 1 before every weight update, which forces a visit of every
+ * neuron without changing any weight. Both runs are expected to end up with identical, clamped weights.
+ */
+TEST(STDP, sparseWeightUpdateMatchesDense) {
+	float maxWt = 20.0f;
+	std::vector< std::vector<float> > weights[2]; // [dense]
+
+	for (int dense=0; dense<2; dense++) {
+		CARLsim* sim = new CARLsim("STDP.sparseWeightUpdateMatchesDense", CPU_MODE, SILENT, 0, 42);
+
+		int g1 = sim->createGroup("post-ex", 10, EXCITATORY_NEURON);
+		sim->setNeuronParameters(g1, 0.02f, 0.2f, -65.0f, 8.0f);
+		int gin = sim->createSpikeGeneratorGroup("pre-ex", 20, EXCITATORY_NEURON);
+		int c1 = sim->connect(gin, g1, "full", RangeWeight(0.0f, maxWt/2, maxWt), 1.0f, RangeDelay(1), RadiusRF(-1),
+			SYN_PLASTIC);
+
+		sim->setConductances(false);
+		sim->setESTDP(g1, true, STANDARD, ExpCurve(0.1f, 20.0f, -0.12f, 20.0f));
+		sim->setWeightAndWeightChangeUpdate(INTERVAL_10MS, true, 0.9f);
+		sim->setupNetwork();
+
+		ConnectionMonitor* CM = sim->setConnectionMonitor(gin, g1, "NULL");
+		// sparse input, so that some post-neurons go without weight changes for a while
+		PoissonRate in(20);
+		in.setRates(2.0f);
+		sim->setSpikeRate(gin, &in);
+
+		for (int t=0; t<200; t++) {
+			if (dense)
+				sim->scaleWeights(c1, 1.0f);
+
+			// write weights from outside the STDP path, pushing many of them to the upper limit
+			if (t==100) {
+				sim->setWeight(c1, 0, 0, 2*maxWt);
+				sim->setWeight(c1, 1, 0, 0.0f);
+				sim->scaleWeights(c1, 3.0f);
+			}
+
+			sim->runNetwork(0, 10, false);
+		}
+
+		weights[dense] = CM->takeSnapshot();
+		delete sim;
+	}
+
+	bool wtChanged = false;
+	for (int i=0; i<weights[0].size(); i++) {
+		for (int j=0; j<weights[0][i].size(); j++) {
+			EXPECT_GE(weights[0][i][j], 0.0f);
+			EXPECT_LE(weights[0][i][j], maxWt);
+			EXPECT_FLOAT_EQ(weights[0][i][j], weights[1][i][j]);
+			wtChanged |= (weights[0][i][j] > 0.0f && weights[0][i][j] < maxWt);
+		}
+	}
+	EXPECT_TRUE(wtChanged);
+}
+
 TEST(STDP, setHomeoBaseFiringRate) {
 	::testing::FLAGS_gtest_death_test_style = "threadsafe";
 
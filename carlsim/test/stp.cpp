@@ -5,8 +5,11 @@
 
 #if defined(WIN32) || defined(WIN64)
 #include <periodic_spikegen.h>
+#include <spikegen_from_vector.h>
 #endif
 
+#include <cmath>
+
 /// **************************************************************************************************************** ///
 /// SHORT-TERM PLASTICITY STP
 /// **************************************************************************************************************** ///
@@ -252,3 +255,138 @@ TEST(STP, spikeTimesCPUvsGPU) {
 		}
 	}
 }
+
+//! STP state is only kept for groups with STP, so enabling STP on one group must not affect any other pathway,
+//! no matter where the STP group lies in the network
+TEST(STP, spikeTimesUnaffectedByOtherSTPGroup) {
+	CARLsim *sim = NULL;
+	SpikeMonitor *spkMonG2 = NULL, *spkMonG3 = NULL;
+	PeriodicSpikeGenerator *spkGenG0 = NULL, *spkGenG1 = NULL;
+
+#ifdef __NO_CUDA__
+	int numModes = 1;
+#else
+	int numModes = 2;
+#endif
+
+	for (int mode=0; mode<numModes; mode++) {
+		std::vector<std::vector<int> > spkTG2noSTP, spkTG3noSTP;
+
+		for (int hasSTP=0; hasSTP<=1; hasSTP++) {
+			sim = new CARLsim("STP.spikeTimesUnaffectedByOtherSTPGroup",mode?GPU_MODE:CPU_MODE,SILENT,0,42);
+			int g2=sim->createGroup("noSTP", 1, EXCITATORY_NEURON);
+			int g3=sim->createGroup("STD", 1, EXCITATORY_NEURON);
+			sim->setNeuronParameters(g2, 0.02f, 0.2f, -65.0f, 8.0f);
+			sim->setNeuronParameters(g3, 0.02f, 0.2f, -65.0f, 8.0f);
+			int g0=sim->createSpikeGeneratorGroup("input0", 1, EXCITATORY_NEURON);
+			int g1=sim->createSpikeGeneratorGroup("input1", 1, EXCITATORY_NEURON);
+
+			sim->connect(g0,g2,"full",RangeWeight(18.0f),1.0f,RangeDelay(1));
+			sim->connect(g1,g3,"full",RangeWeight(18.0f),1.0f,RangeDelay(1));
+			sim->setConductances(false);
+
+			if (hasSTP) {
+				sim->setSTP(g1, true, 0.45f, 50.0f, 750.0f); // depressive
+			}
+
+			spkGenG0 = new PeriodicSpikeGenerator(true);
+			spkGenG0->setRates(10.0f);
+			sim->setSpikeGenerator(g0, spkGenG0);
+			spkGenG1 = new PeriodicSpikeGenerator(true);
+			spkGenG1->setRates(10.0f);
+			sim->setSpikeGenerator(g1, spkGenG1);
+
+			sim->setupNetwork();
+
+			spkMonG2 = sim->setSpikeMonitor(g2,"NULL");
+			spkMonG3 = sim->setSpikeMonitor(g3,"NULL");
+			spkMonG2->startRecording();
+			spkMonG3->startRecording();
+			sim->runNetwork(2,0);
+			spkMonG2->stopRecording();
+			spkMonG3->stopRecording();
+
+			if (!hasSTP) {
+				spkTG2noSTP = spkMonG2->getSpikeVector2D();
+				spkTG3noSTP = spkMonG3->getSpikeVector2D();
+			} else {
+				// the pathway without STP must be exactly the same, the one with STP must be depressed
+				std::vector<std::vector<int> > spkTG2 = spkMonG2->getSpikeVector2D();
+				ASSERT_EQ(spkTG2.size(), spkTG2noSTP.size());
+				ASSERT_EQ(spkTG2[0].size(), spkTG2noSTP[0].size());
+				for (int i=0; i<spkTG2[0].size(); i++)
+					EXPECT_EQ(spkTG2[0][i], spkTG2noSTP[0][i]);
+
+				EXPECT_LT(spkMonG3->getPopNumSpikes(), spkTG3noSTP[0].size());
+			}
+
+			delete spkGenG0;
+			delete spkGenG1;
+			delete sim;
+		}
+	}
+}
+
+//! the lazily decayed STP variables must match an eager per-ms integration of the STP equations, no matter how long
+//! a neuron was silent (the synaptic efficacy u^+ * x^- is read off the jumps of the post-synaptic AMPA conductance)
+TEST(STP, lazyDecayMatchesPerMsReference) {
+	// silent intervals of 1 ms up to several seconds, longer than any STP ring buffer
+	int spkArr[] = {10, 11, 13, 17, 25, 40, 41, 70, 130, 250, 251, 500, 1000, 1002, 2000, 3500};
+	std::vector<int> spkTimes(spkArr, spkArr+sizeof(spkArr)/sizeof(spkArr[0]));
+	int runDurMs = 3510;
+
+	// depressive and facilitative synapses
+	float stpU[2] = {0.45f, 0.15f};
+	float stpTauU[2] = {50.0f, 750.0f};
+	float stpTauX[2] = {750.0f, 50.0f};
+
+	for (int isSTF=0; isSTF<=1; isSTF++) {
+		// eager reference: decay every ms, then apply the spike-dependent update
+		std::vector<float> refEff;
+		double u = 0.0, x = 1.0;
+		for (int t=0, k=0; t<runDurMs; t++) {
+			double uMinus = u, xMinus = x;
+			u = uMinus*(1.0-1.0/stpTauU[isSTF]);
+			x = xMinus + (1.0-xMinus)/stpTauX[isSTF];
+			if (k<spkTimes.size() && spkTimes[k]==t) {
+				u += stpU[isSTF]*(1.0-uMinus);
+				x -= u*xMinus;
+				refEff.push_back(u*xMinus/stpU[isSTF]); // STP_A = 1/U
+				k++;
+			}
+		}
+
+		CARLsim* sim = new CARLsim("STP.lazyDecayMatchesPerMsReference", CPU_MODE, SILENT, 0, 42);
+		int g0 = sim->createSpikeGeneratorGroup("input", 1, EXCITATORY_NEURON);
+		int g1 = sim->createGroup("excit", 1, EXCITATORY_NEURON);
+		sim->setNeuronParameters(g1, 0.02f, 0.2f, -65.0f, 8.0f);
+		sim->connect(g0, g1, "full", RangeWeight(0.01f), 1.0f, RangeDelay(1));
+		sim->setConductances(true);
+		sim->setSTP(g0, true, stpU[isSTF], stpTauU[isSTF], stpTauX[isSTF]);
+		SpikeGeneratorFromVector spkGen(spkTimes);
+		sim->setSpikeGenerator(g0, &spkGen);
+		sim->setupNetwork();
+
+		// step through the run 1 ms at a time and record the AMPA conductance of the post-synaptic neuron
+		std::vector<float> gAMPA(runDurMs);
+		for (int t=0; t<runDurMs; t++) {
+			sim->runNetwork(0,1,false);
+			gAMPA[t] = sim->getConductanceAMPA(g1)[0];
+		}
+
+		// every jump in gAMPA (beyond its exponential decay) is one delivered spike, scaled by u^+ * x^-
+		float decay = gAMPA[22]/gAMPA[21]; // no spike is delivered between 17 and 25 ms
+		std::vector<float> eff;
+		for (int t=1; t<runDurMs; t++) {
+			float jump = gAMPA[t] - gAMPA[t-1]*decay;
+			if (jump > 1e-4f)
+				eff.push_back(jump/0.01f);
+		}
+
+		ASSERT_EQ(eff.size(), refEff.size());
+		for (int k=0; k<eff.size(); k++)
+			EXPECT_NEAR(eff[k], refEff[k], 1e-3f*refEff[k]);
+
+		delete sim;
+	}
+}
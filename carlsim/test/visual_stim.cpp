@@ -0,0 +1,73 @@
+#include "gtest/gtest.h"
+#include "carlsim_tests.h"
+
+#include <carlsim.h>
+#include <stdio.h>
+
+#if defined(WIN32) || defined(WIN64)
+#include <visual_stimulus.h>
+#endif
+
+// writes a small grayscale stimulus file in VisualStimulus v1.0 format, pixel value = 10*frame + pixel
+static void writeStimulusFile(const std::string& fileName, int width, int height, int length) {
+	FILE* fp = fopen(fileName.c_str(), "wb");
+	ASSERT_TRUE(fp!=NULL);
+	int signature = 293390619, type = GRATING_STIM;
+	float version = 1.0f;
+	char channels = 1;
+	fwrite(&signature, sizeof(int), 1, fp);
+	fwrite(&version, sizeof(float), 1, fp);
+	fwrite(&type, sizeof(int), 1, fp);
+	fwrite(&channels, sizeof(char), 1, fp);
+	fwrite(&width, sizeof(int), 1, fp);
+	fwrite(&height, sizeof(int), 1, fp);
+	fwrite(&length, sizeof(int), 1, fp);
+	for (int f=0; f<length; f++) {
+		for (int i=0; i<width*height; i++) {
+			unsigned char px = (unsigned char)(10*f + i);
+			fwrite(&px, sizeof(unsigned char), 1, fp);
+		}
+	}
+	fclose(fp);
+}
+
+// tests reading frames (char and Poisson), wrapping around at the end of the file, and rewinding
+TEST(VisualStim, readFrames) {
+	const int width = 3, height = 2, length = 5;
+	std::string fileName = "results/visual_stim.dat";
+	writeStimulusFile(fileName, width, height, length);
+
+	VisualStimulus VS(fileName);
+	VS.setPrefetchFrames(2);
+	EXPECT_EQ(VS.getWidth(), width);
+	EXPECT_EQ(VS.getHeight(), height);
+	EXPECT_EQ(VS.getLength(), length);
+	EXPECT_EQ(VS.getChannels(), 1);
+
+	PoissonRate* firstRates = NULL;
+	for (int f=0; f<2*length+1; f++) {
+		if (f%2) {
+			unsigned char* frame = VS.readFrameChar();
+			for (int i=0; i<width*height; i++)
+				EXPECT_EQ(frame[i], 10*(f%length) + i);
+			EXPECT_TRUE(VS.getCurrentFramePoisson()==NULL);
+		} else {
+			PoissonRate* rates = VS.readFramePoisson(255.0f, 5.0f);
+			for (int i=0; i<width*height; i++)
+				EXPECT_FLOAT_EQ(rates->getRate(i), (10*(f%length) + i)*250.0f/255.0f + 5.0f);
+			EXPECT_TRUE(VS.getCurrentFramePoisson()==rates);
+
+			// the same PoissonRate object is reused for every frame
+			if (firstRates==NULL)
+				firstRates = rates;
+			EXPECT_TRUE(rates==firstRates);
+		}
+		EXPECT_EQ(VS.getCurrentFrameNumber(), f%length);
+	}
+
+	VS.rewind();
+	PoissonRate* rates = VS.readFramePoisson(51.0f);
+	EXPECT_EQ(VS.getCurrentFrameNumber(), 0);
+	for (int i=0; i<width*height; i++)
+		EXPECT_FLOAT_EQ(rates->getRate(i), i*51.0f/255.0f);
+}
@@ -3,7 +3,6 @@
 #include <carlsim.h>
 
 #include <user_errors.h>	// fancy error messages
-#include <algorithm>		// std::find
 #include <vector>			// std::vector
 #include <cassert>			// assert
 
@@ -51,9 +50,11 @@ public:
 
 		if (_spikeAtZero) {
 			// insert spike at t=0 for each neuron (keep track of neuron IDs to avoid getting stuck in infinite loop)
-			if (std::find(_nIdFiredAtZero.begin(), _nIdFiredAtZero.end(), nid)==_nIdFiredAtZero.end()) {
+			if (nid >= (int)_firedAtZero.size())
+				_firedAtZero.resize(nid+1, false);
+			if (!_firedAtZero[nid]) {
 				// spike at t=0 has not been scheduled yet for this neuron
-				_nIdFiredAtZero.push_back(nid);
+				_firedAtZero[nid] = true;
 				return 0;
 			}
 		}
@@ -62,6 +63,42 @@ public:
 		return lastScheduledSpikeTime + _isis[nid];
 	}
 
+	bool nextSpikeTimes(CARLsim* sim, int grpId, unsigned int currentTime, unsigned int endOfTimeSlice,
+		const std::vector<unsigned int>& lastScheduledSpikeTimes, std::vector<int>& nIds,
+		std::vector<unsigned int>& spkTimes)
+	{
+		int numNeur = lastScheduledSpikeTimes.size();
+		if (needToUpdateISI()) {
+			updateISI(numNeur, endOfTimeSlice);
+		}
+		if (_spikeAtZero && (int)_firedAtZero.size() < numNeur) {
+			_firedAtZero.resize(numNeur, false);
+		}
+
+		// emits the same spikes as repeated calls to nextSpikeTime would, neuron by neuron
+		for (int nid=0; nid<numNeur; nid++) {
+			unsigned int lastTime = lastScheduledSpikeTimes[nid];
+			if (_spikeAtZero && !_firedAtZero[nid]) {
+				_firedAtZero[nid] = true;
+				if (currentTime > 0 || endOfTimeSlice == 0)
+					continue; // spike at t=0 is rejected, which ends the time slice for this neuron
+				nIds.push_back(nid);
+				spkTimes.push_back(0);
+				lastTime = 0;
+			}
+
+			unsigned int nextTime = lastTime + _isis[nid];
+			while (nextTime > lastTime && nextTime < endOfTimeSlice && nextTime >= currentTime) {
+				nIds.push_back(nid);
+				spkTimes.push_back(nextTime);
+				lastTime = nextTime;
+				nextTime += _isis[nid];
+			}
+		}
+
+		return true;
+	}
+
 private:
 	bool needToUpdateISI() {
 		return _needToUpdateFromVector | _needToUpdateFromFloat;
@@ -109,7 +146,7 @@ private:
 
 	std::vector<int> _isis;			//!< vector of inter-spike intervals
 
-	std::vector<int> _nIdFiredAtZero; //!< keep track of all neuron IDs for which a spike at t=0 has been scheduled
+	std::vector<bool> _firedAtZero; //!< keep track of all neuron IDs for which a spike at t=0 has been scheduled
 	bool _spikeAtZero; //!< whether to emit a spike at t=0
 };
 
@@ -129,4 +166,10 @@ void PeriodicSpikeGenerator::setRates(std::vector<float> ratesHz) { _impl->setRa
 unsigned int PeriodicSpikeGenerator::nextSpikeTime(CARLsim* sim, int grpId, int nid, unsigned int currentTime, 
 		unsigned int lastScheduledSpikeTime, unsigned int endOfTimeSlice) {
 	return _impl->nextSpikeTime(sim, grpId, nid, currentTime, lastScheduledSpikeTime, endOfTimeSlice);
+}
+
+bool PeriodicSpikeGenerator::nextSpikeTimes(CARLsim* sim, int grpId, unsigned int currentTime,
+		unsigned int endOfTimeSlice, const std::vector<unsigned int>& lastScheduledSpikeTimes, std::vector<int>& nIds,
+		std::vector<unsigned int>& spkTimes) {
+	return _impl->nextSpikeTimes(sim, grpId, currentTime, endOfTimeSlice, lastScheduledSpikeTimes, nIds, spkTimes);
 }
\ No newline at end of file
@@ -63,6 +63,31 @@ unsigned int PrePostGroupSpikeGenerator::nextSpikeTime(CARLsim* s, int grpId, in
 	return 0xFFFFFFFF;
 }
 
+bool PrePostGroupSpikeGenerator::nextSpikeTimes(CARLsim* s, int grpId, unsigned int currentTime,
+	unsigned int endOfTimeSlice, const std::vector<unsigned int>& lastScheduledSpikeTimes, std::vector<int>& nIds,
+	std::vector<unsigned int>& spkTimes) {
+	if (grpId != g1 && grpId != g2)
+		return true;
+
+	for (int nid=0; nid<(int)lastScheduledSpikeTimes.size(); nid++) {
+		unsigned int lastTime = lastScheduledSpikeTimes[nid];
+		unsigned int nextTime = lastTime + isi;
+		if (grpId == g2 && !setOffset) {
+			setOffset = true;
+			nextTime += offset;
+		}
+
+		while (nextTime > lastTime && nextTime < endOfTimeSlice && nextTime >= currentTime) {
+			nIds.push_back(nid);
+			spkTimes.push_back(nextTime);
+			lastTime = nextTime;
+			nextTime = lastTime + isi;
+		}
+	}
+
+	return true;
+}
+
 void PrePostGroupSpikeGenerator::updateOffset(int newOffset) {
 	offset = newOffset;
 	setOffset = false;
@@ -59,6 +59,10 @@ public:
 	unsigned int nextSpikeTime(CARLsim* s, int grpId, int nid, unsigned int currentTime, 
 		unsigned int lastScheduledSpikeTime, unsigned int endOfTimeSlice);
 
+	bool nextSpikeTimes(CARLsim* s, int grpId, unsigned int currentTime, unsigned int endOfTimeSlice,
+		const std::vector<unsigned int>& lastScheduledSpikeTimes, std::vector<int>& nIds,
+		std::vector<unsigned int>& spkTimes);
+
 	void updateOffset(int newOffset);
 };
 
@@ -1,20 +1,24 @@
 #include <spikegen_from_file.h>
 
 #include <carlsim.h>
-//#include <user_errors.h>		// fancy user error messages
+#include <spike_file_reader.h>	// random access to spike files
 
-#include <stdio.h>				// fopen, fread, fclose
+#include <algorithm>			// std::min
 #include <string.h>				// std::string
 #include <assert.h>				// assert
 
 // #define VERBOSE
 
+// how far (ms) to read ahead of the current scheduling time slice
+#define SPIKEGEN_FROM_FILE_LOOKAHEAD_MS 1000
+
 SpikeGeneratorFromFile::SpikeGeneratorFromFile(std::string fileName, int offsetTimeMs) {
 	fileName_ = fileName;
-	fpBegin_ = NULL;
+	reader_ = NULL;
 
 	nNeur_ = -1;
-	szByteHeader_ = -1;
+	readUntilMs_ = 0;
+	lastSpikeTimeMs_ = -1;
 	offsetTimeMs_ = offsetTimeMs;
 
 	// move unsafe operations out of constructor
@@ -23,18 +27,14 @@ SpikeGeneratorFromFile::SpikeGeneratorFromFile(std::string fileName, int offsetT
 }
 
 SpikeGeneratorFromFile::~SpikeGeneratorFromFile() {
-	if (fpBegin_ != NULL) {
-		fclose(fpBegin_);
-	}
-	fpBegin_ = NULL;
+	delete reader_;
+	reader_ = NULL;
 }
 
 void SpikeGeneratorFromFile::loadFile(std::string fileName, int offsetTimeMs) {
 	// close previously opened file (if any)
-	if (fpBegin_ != NULL) {
-		fclose(fpBegin_);
-	}
-	fpBegin_ = NULL;
+	delete reader_;
+	reader_ = NULL;
 
 	// update file name and open
 	fileName_ = fileName;
@@ -47,32 +47,20 @@ void SpikeGeneratorFromFile::loadFile(std::string fileName, int offsetTimeMs) {
 void SpikeGeneratorFromFile::rewind(int offsetTimeMs) {
 	offsetTimeMs_ = offsetTimeMs;
 
-	// reset all iterators
-	spikesIt_.clear();
+	// empty the look-ahead buffers, they will be refilled from the beginning of the file
 	for (int i=0; i<nNeur_; i++) {
-		spikesIt_.push_back(spikes_[i].begin());
+		spikes_[i].clear();
+		spikesIdx_[i] = 0;
 	}
+	readUntilMs_ = 0;
 }
 
 void SpikeGeneratorFromFile::openFile() {
-	std::string funcName = "openFile("+fileName_+")";
-	fpBegin_ = fopen(fileName_.c_str(),"rb");
-	UserErrors::assertTrue(fpBegin_!=NULL, UserErrors::FILE_CANNOT_OPEN, funcName, fileName_);
-
-	// \TODO there should be a common/standard way to read spike files
-	// \FIXME: this is a hack...to get the size of the header section
-	// needs to be updated every time header changes
-	FILE* fp = fpBegin_;
-	szByteHeader_ = 4*sizeof(int)+1*sizeof(float);
-	fseek(fp, sizeof(int)+sizeof(float), SEEK_SET); // skipping signature+version
+	reader_ = new SpikeFileReader(fileName_);
 
 	// get number of neurons from header
-	nNeur_ = 1;
-	int grid;
-	for (int i=1; i<=3; i++) {
-		size_t result = fread(&grid, sizeof(int), 1, fp);
-		nNeur_ *= grid;
-	}
+	nNeur_ = reader_->getNumNeurons();
+	lastSpikeTimeMs_ = reader_->getLastSpikeTime();
 
 	// make sure number of neurons is now valid
 	assert(nNeur_>0);
@@ -81,40 +69,40 @@ void SpikeGeneratorFromFile::openFile() {
 void SpikeGeneratorFromFile::init() {
 	assert(nNeur_>0);
 
-	// allocate spike vector
+	// allocate look-ahead buffers
 	// we organize AER format into a 2D spike vector: first dim=neuron, second dim=spike times
-	// then we just need to maintain an iterator for each neuron to know which spike to schedule next
-	spikes_.clear();
-	for (int i=0; i<nNeur_; i++) {
-		spikes_.push_back(std::vector<int>());
-	}
+	// then we just need to maintain an index for each neuron to know which spike to schedule next
+	spikes_.assign(nNeur_, std::vector<int>());
+	spikesIdx_.assign(nNeur_, 0);
 
-	// read spike file
-	FILE* fp = fpBegin_;
-	fseek(fp, szByteHeader_, SEEK_SET); // skip header section
+	// initialize indices
+	rewind(offsetTimeMs_);
+}
 
-	int tmpTime = -1;
-	int tmpNeurId = -1;
-	size_t result;
+void SpikeGeneratorFromFile::readAhead(int64_t endTimeMs) {
+	assert(endTimeMs > readUntilMs_);
 
-	while (!feof(fp)) {
-		result = fread(&tmpTime, sizeof(int), 1, fp); // i-th time
-		result = fread(&tmpNeurId, sizeof(int), 1, fp); // i-th nid
-		spikes_[tmpNeurId].push_back(tmpTime); // add spike time to 2D vector
+	// discard all spikes that have already been scheduled
+	for (int i=0; i<nNeur_; i++) {
+		if (spikesIdx_[i]) {
+			spikes_[i].erase(spikes_[i].begin(), spikes_[i].begin()+spikesIdx_[i]);
+			spikesIdx_[i] = 0;
+		}
 	}
 
-#ifdef VERBOSE
-	for (int neurId=0; neurId<1; neurId++) {
-		printf("[%d]: ",neurId);
-		for (int i=0; i<spikes_[neurId].size(); i++) {
-			printf("%d ",spikes_[neurId][i]);
-		}
-		printf("\n");
+	// read the next time-ordered chunk of the file and sort it into the buffers
+	endTimeMs = (std::min)(endTimeMs, (int64_t)lastSpikeTimeMs_+1);
+	std::vector<int> spkTimes, spkNeurIds;
+	reader_->readSpikes((int)readUntilMs_, (int)endTimeMs, spkTimes, spkNeurIds);
+	for (size_t i=0; i<spkTimes.size(); i++) {
+		if (spkNeurIds[i]>=0 && spkNeurIds[i]<nNeur_)
+			spikes_[spkNeurIds[i]].push_back(spkTimes[i]);
 	}
-#endif
+	readUntilMs_ = endTimeMs;
 
-	// initialize iterators
-	rewind(offsetTimeMs_);
+#ifdef VERBOSE
+	printf("read %u spikes, buffered up to t=%ld ms\n", (unsigned int)spkTimes.size(), (long)readUntilMs_);
+#endif
 }
 
 unsigned int SpikeGeneratorFromFile::nextSpikeTime(CARLsim* sim, int grpId, int nid, unsigned int currentTime, 
@@ -122,20 +110,26 @@ unsigned int SpikeGeneratorFromFile::nextSpikeTime(CARLsim* sim, int grpId, int
 	assert(nNeur_>0);
 	assert(nid < nNeur_);
 
-	if (spikesIt_[nid] != spikes_[nid].end()) {
-		// if there are spikes left in the vector ...
+	// make sure the look-ahead buffers cover the current scheduling time slice
+	int64_t endOfTimeSliceFile = (int64_t)endOfTimeSlice - offsetTimeMs_;
+	if (endOfTimeSliceFile > readUntilMs_ && readUntilMs_ <= lastSpikeTimeMs_)
+		readAhead(endOfTimeSliceFile + SPIKEGEN_FROM_FILE_LOOKAHEAD_MS);
+
+	if (spikesIdx_[nid] < spikes_[nid].size()) {
+		// if there are spikes left in the buffer ...
+		int64_t nextTime = (int64_t)spikes_[nid][spikesIdx_[nid]] + offsetTimeMs_;
 
-		if (*(spikesIt_[nid])+offsetTimeMs_ < endOfTimeSlice) {
+		if (nextTime < (int64_t)endOfTimeSlice) {
 			// ... and if the next spike time is in the current scheduling time slice:
 #ifdef VERBOSE
 			if (nid==0) {
-			printf("[%d][%d]: currTime=%u, lastTime=%u, endOfTime=%u, offsetTimeMs=%u, nextSpike=%u\n", grpId, nid,
-				currentTime, lastScheduledSpikeTime, endOfTimeSlice, offsetTimeMs_,
-				(unsigned int) (*(spikesIt_[nid])+offsetTimeMs_));
+			printf("[%d][%d]: currTime=%u, lastTime=%u, endOfTime=%u, offsetTimeMs=%d, nextSpike=%ld\n", grpId, nid,
+				currentTime, lastScheduledSpikeTime, endOfTimeSlice, offsetTimeMs_, (long)nextTime);
 			}
 #endif
-			// return the next spike time and update iterator
-			return (unsigned int)(*(spikesIt_[nid]++)+offsetTimeMs_);
+			// return the next spike time and update index
+			spikesIdx_[nid]++;
+			return (unsigned int)nextTime;
 		}
 	}
 
@@ -143,3 +137,35 @@ unsigned int SpikeGeneratorFromFile::nextSpikeTime(CARLsim* sim, int grpId, int
 	// this will signal CARLsim to break the nextSpikeTime loop
 	return -1; // large positive number
 }
+
+bool SpikeGeneratorFromFile::nextSpikeTimes(CARLsim* sim, int grpId, unsigned int currentTime,
+	unsigned int endOfTimeSlice, const std::vector<unsigned int>& lastScheduledSpikeTimes, std::vector<int>& nIds,
+	std::vector<unsigned int>& spkTimes) {
+	assert(nNeur_>0);
+	assert((int)lastScheduledSpikeTimes.size() <= nNeur_);
+
+	// make sure the look-ahead buffers cover the current scheduling time slice
+	int64_t endOfTimeSliceFile = (int64_t)endOfTimeSlice - offsetTimeMs_;
+	if (endOfTimeSliceFile > readUntilMs_ && readUntilMs_ <= lastSpikeTimeMs_)
+		readAhead(endOfTimeSliceFile + SPIKEGEN_FROM_FILE_LOOKAHEAD_MS);
+
+	// emits the same spikes as repeated calls to nextSpikeTime would: every neuron consumes buffered spikes in the
+	// current time slice until one of them is rejected
+	for (int nid=0; nid<(int)lastScheduledSpikeTimes.size(); nid++) {
+		int64_t lastTime = lastScheduledSpikeTimes[nid];
+		while (spikesIdx_[nid] < spikes_[nid].size()) {
+			int64_t nextTime = (int64_t)spikes_[nid][spikesIdx_[nid]] + offsetTimeMs_;
+			if (nextTime >= (int64_t)endOfTimeSlice)
+				break;
+
+			spikesIdx_[nid]++;
+			if ((nextTime != 0 && nextTime <= lastTime) || nextTime < (int64_t)currentTime)
+				break;
+			nIds.push_back(nid);
+			spkTimes.push_back((unsigned int)nextTime);
+			lastTime = nextTime;
+		}
+	}
+
+	return true;
+}
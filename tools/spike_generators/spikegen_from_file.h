@@ -44,9 +44,11 @@
 #include <callback.h>
 #include <string>
 #include <vector>
+#include <stdint.h>
 
 
 class CARLsim;
+class SpikeFileReader;
 
 /*!
  * \brief a SpikeGeneratorFromFile schedules spikes from a spike file binary
@@ -72,9 +74,10 @@ class CARLsim;
  * It is also possible to repeatedly parse the spike file, adding different offsetTimeMs offsets per loop.
  * This can be achieved by passing an optional argument to SpikeGeneratorFromFile::rewind.
  *
- * Upon initialization, the class parses and buffers all spikes from the spike file in a format that allows for
- * more efficient scheduling. Note that this might take up a lot of memory if you have a large and highly active
- * neuron group.
+ * Spikes are streamed from the file: the class only buffers the spikes of a look-ahead window (the current
+ * scheduling time slice plus one second), which is read from the file in a single time-ordered chunk. The file
+ * is memory-mapped (see SpikeFileReader), so the memory footprint does not depend on the size of the file.
+ * Both the flat and the indexed spike file format are supported.
  *
  * Usage example:
  * \code
@@ -106,8 +109,6 @@ class CARLsim;
  *
  * \note Make sure the new neuron group has the exact same number of neurons as the group that was used to record
  * the spike file.
- * \attention Upon initializiation, all spikes from the spike file will be buffered as vectors of ints, which might
- * take up a lot of memory if you have a large and highly active neuron group.
  * \since v3.0
  */
 class SpikeGeneratorFromFile : public SpikeGenerator {
@@ -181,22 +182,42 @@ public:
 	unsigned int nextSpikeTime(CARLsim* sim, int grpId, int nid, unsigned int currentTime, 
 		unsigned int lastScheduledSpikeTime, unsigned int endOfTimeSlice);
 
+	/*!
+	 * \brief schedules all spikes of a group in the current scheduling time slice at once
+	 *
+	 * This function implements the batch interface of the base class. It appends the same spikes that repeated calls
+	 * to nextSpikeTime would schedule, for all neurons in the group at once.
+	 * \param[in] sim pointer to a CARLsim object
+	 * \param[in] grpId current group ID for which to schedule spikes
+	 * \param[in] currentTime current time (ms) at which spike scheduler is called
+	 * \param[in] endOfTimeSlice the end of the time slice (ms) for which to schedule spikes
+	 * \param[in] lastScheduledSpikeTimes the last time (ms) at which a spike was scheduled, for every neuron in grpId
+	 * \param[out] nIds neuron IDs of the scheduled spikes
+	 * \param[out] spkTimes times (ms) of the scheduled spikes
+	 * \returns true
+	 */
+	bool nextSpikeTimes(CARLsim* sim, int grpId, unsigned int currentTime, unsigned int endOfTimeSlice,
+		const std::vector<unsigned int>& lastScheduledSpikeTimes, std::vector<int>& nIds,
+		std::vector<unsigned int>& spkTimes);
+
 private:
 	void openFile();
 	void init();
 
+	//! reads all spikes with file time < endTimeMs into the look-ahead buffers (in a single chunk)
+	void readAhead(int64_t endTimeMs);
+
 	std::string fileName_;		//!< file name
-	FILE* fpBegin_;				//!< pointer to beginning of file
-	int szByteHeader_;          //!< number of bytes in header section
-                                //!< \FIXME: there should be a standardized SpikeReader++ utility
+	SpikeFileReader* reader_;	//!< gives random access to the (memory-mapped) spike file
 
-	//! A 2D vector of spike times, first dim=neuron ID, second dim=spike times.
-	//! This makes it easy to keep track of which spike needs to be scheduled next, by maintaining
-	//! a vector of iterators.
+	//! Look-ahead buffers of spike times (without offsetTimeMs_), first dim=neuron ID, second dim=spike times.
+	//! spikesIdx_ points to the next spike to be scheduled (per neuron). Spikes that have already been scheduled
+	//! are discarded on the next call to readAhead.
 	std::vector< std::vector<int> > spikes_;
+	std::vector<size_t> spikesIdx_;
 
-	//! A vector of iterators to easily keep track of which spike to schedule next (per neuron)
-	std::vector< std::vector<int>::iterator > spikesIt_;
+	int64_t readUntilMs_;		//!< all spikes with file time < readUntilMs_ have been read into the buffers
+	int lastSpikeTimeMs_;		//!< time (ms) of the last spike in the file, or -1
 
 	int nNeur_;                 //!< number of neurons in the group
 	int offsetTimeMs_;			//!< offset (ms) to add to every scheduled spike time
@@ -22,6 +22,27 @@ unsigned int SpikeGeneratorFromVector::nextSpikeTime(CARLsim* sim, int grpId, in
 	return -1; // -1: large positive number
 }
 
+bool SpikeGeneratorFromVector::nextSpikeTimes(CARLsim* sim, int grpId, unsigned int currentTime,
+	unsigned int endOfTimeSlice, const std::vector<unsigned int>& lastScheduledSpikeTimes, std::vector<int>& nIds,
+	std::vector<unsigned int>& spkTimes) {
+
+	// emits the same spikes as repeated calls to nextSpikeTime would: every neuron consumes spike times from the
+	// vector until one of them is rejected
+	for (int nid=0; nid<(int)lastScheduledSpikeTimes.size(); nid++) {
+		unsigned int lastTime = lastScheduledSpikeTimes[nid];
+		while (currentIndex_ < size_ && (unsigned int)spkTimes_[currentIndex_] < endOfTimeSlice) {
+			unsigned int nextTime = spkTimes_[currentIndex_++];
+			if ((nextTime != 0 && nextTime <= lastTime) || nextTime < currentTime)
+				break;
+			nIds.push_back(nid);
+			spkTimes.push_back(nextTime);
+			lastTime = nextTime;
+		}
+	}
+
+	return true;
+}
+
 void SpikeGeneratorFromVector::checkSpikeVector() {
 	UserErrors::assertTrue(size_>0,UserErrors::CANNOT_BE_ZERO, "SpikeGeneratorFromVector", "Vector size");
 	for (int i=0; i<size_; i++) {
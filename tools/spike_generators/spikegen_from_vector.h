@@ -79,6 +79,24 @@ public:
 	unsigned int nextSpikeTime(CARLsim* sim, int grpId, int nid, unsigned int currentTime, 
 		unsigned int lastScheduledSpikeTime, unsigned int endOfTimeSlice);
 
+	/*!
+	 * \brief schedules all spikes of a group in the current scheduling time slice at once
+	 *
+	 * This function implements the batch interface of the base class. It appends the same spikes that repeated calls
+	 * to nextSpikeTime would schedule, for all neurons in the group at once.
+	 * \param[in] sim pointer to a CARLsim object
+	 * \param[in] grpId current group ID for which to schedule spikes
+	 * \param[in] currentTime current time (ms) at which spike scheduler is called
+	 * \param[in] endOfTimeSlice the end of the time slice (ms) for which to schedule spikes
+	 * \param[in] lastScheduledSpikeTimes the last time (ms) at which a spike was scheduled, for every neuron in grpId
+	 * \param[out] nIds neuron IDs of the scheduled spikes
+	 * \param[out] spkTimes times (ms) of the scheduled spikes
+	 * \returns true
+	 */
+	bool nextSpikeTimes(CARLsim* sim, int grpId, unsigned int currentTime, unsigned int endOfTimeSlice,
+		const std::vector<unsigned int>& lastScheduledSpikeTimes, std::vector<int>& nIds,
+		std::vector<unsigned int>& spkTimes);
+
 private:
 	void checkSpikeVector();
 	
@@ -22,7 +22,7 @@ class Stopwatch::Impl {
 public:
 	// +++++ PUBLIC METHODS +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++ //
 
-	Impl(bool startTimer) {
+	Impl(bool startTimer) : _accumTimeMs(0), _isTimerOn(false) {
 		reset();
 		if (startTimer) {
 			start("start");
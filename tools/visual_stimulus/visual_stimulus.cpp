@@ -5,6 +5,16 @@
 #include <cassert> // assert
 #include <stdio.h> // fopen, fread, fclose
 #include <stdlib.h> // exit
+#include <string.h> // memcpy
+
+#if defined(WIN32) || defined(WIN64)
+	// no mmap: frames are read from the file stream
+#else
+	#include <sys/mman.h>		// mmap, munmap, madvise
+	#include <sys/stat.h>		// fstat
+	#include <fcntl.h>			// open
+	#include <unistd.h>			// close, sysconf
+#endif
 
 class VisualStimulus::Impl {
 public:
@@ -23,6 +33,13 @@ public:
 		_length = -1;
 
 		_framePoisson = NULL;
+		_framePoissonValid = false;
+		_lutMaxPoisson = -1.0f;
+		_lutMinPoisson = -1.0f;
+
+		_data = NULL;
+		_dataSizeBytes = 0;
+		_numPrefetchFrames = 8;
 
 		_channels = -1;
 		_type = UNKNOWN_STIM;
@@ -32,6 +49,13 @@ public:
 
 		// read the header section of the binary file
 		readHeader();
+
+		// frames are read into (and converted from) the same buffers over and over again
+		_frame = new unsigned char[getFrameSize()];
+
+		// map the file into memory, so that reading a frame is a mere memcpy
+		mapFile();
+		prefetchFrames(0, _numPrefetchFrames);
 	}
 
 	~Impl() {
@@ -43,6 +67,12 @@ public:
 			delete _framePoisson;
 		_framePoisson=NULL;
 
+#if !defined(WIN32) && !defined(WIN64)
+		if (_data!=NULL)
+			munmap(_data, _dataSizeBytes);
+		_data=NULL;
+#endif
+
 		if (_fileId!=NULL)
 			fclose(_fileId);
 	}
@@ -61,18 +91,38 @@ public:
 		// read next frame
 		readFramePrivate();
 
-		// create new Poisson object, assign 
-		_framePoisson = new PoissonRate(_width*_height*_channels);
-		for (int i=0; i<_width*_height*_channels; i++) {
-			_framePoisson->setRate(i, _frame[i]*(maxPoisson-minPoisson)/255.0f + minPoisson); // scale firing rates
+		// grayscale values are mapped to rates via a lookup table, which only changes with the rate range
+		if (maxPoisson!=_lutMaxPoisson || minPoisson!=_lutMinPoisson) {
+			for (int i=0; i<256; i++) {
+				_lut[i] = i*(maxPoisson-minPoisson)/255.0f + minPoisson; // scale firing rates
+			}
+			_lutMaxPoisson = maxPoisson;
+			_lutMinPoisson = minPoisson;
 		}
-		
+
+		// the PoissonRate object is allocated once, and overwritten with the rates of every new frame
+		if (_framePoisson==NULL)
+			_framePoisson = new PoissonRate(getFrameSize());
+		float* rates = _framePoisson->getRatePtrCPU();
+		for (int i=0; i<getFrameSize(); i++) {
+			rates[i] = _lut[_frame[i]];
+		}
+		_framePoissonValid = true;
+
 		return _framePoisson;
 	}
 
 	// rewind position of file stream to first frame
 	void rewind() {
-		fseek(_fileId, _fileHeaderSizeBytes, SEEK_SET);
+		_frameNum = -1;
+		if (_data==NULL)
+			fseek(_fileId, _fileHeaderSizeBytes, SEEK_SET);
+		prefetchFrames(0, _numPrefetchFrames);
+	}
+
+	void setPrefetchFrames(int numFrames) {
+		assert(numFrames>=0);
+		_numPrefetchFrames = numFrames;
 	}
 
 	void print() {
@@ -86,47 +136,86 @@ public:
 	int getChannels() { return _channels; }
 	stimType_t getType() { return _type; }
 
-	unsigned char* getCurrentFrameChar() { return _frame; }
-	PoissonRate* getCurrentFramePoisson() { return _framePoisson; }
+	unsigned char* getCurrentFrameChar() { return (_frameNum>=0) ? _frame : NULL; }
+	PoissonRate* getCurrentFramePoisson() { return _framePoissonValid ? _framePoisson : NULL; }
 	int getCurrentFrameNumber() { return _frameNum; }
 
 
 private:
 	// +++++ PRIVATE METHODS ++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++ //
 
-	// reads next frame and assigns char array and Poisson Rate
+	// number of bytes per frame (which is also the number of neurons per frame)
+	int getFrameSize() { return _width*_height*_channels; }
+
+	// maps the whole file into memory (POSIX only), falls back to reading frames from the file stream otherwise
+	void mapFile() {
+#if !defined(WIN32) && !defined(WIN64)
+		int fd = open(_fileName.c_str(), O_RDONLY);
+		if (fd<0)
+			return;
+
+		struct stat st;
+		if (fstat(fd, &st)==0 && st.st_size>=_fileHeaderSizeBytes+(long)getFrameSize()*_length) {
+			void* addr = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+			if (addr!=MAP_FAILED) {
+				_data = (unsigned char*)addr;
+				_dataSizeBytes = st.st_size;
+				madvise(_data, _dataSizeBytes, MADV_SEQUENTIAL);
+			}
+		}
+		close(fd);
+#endif
+	}
+
+	// asks the OS to read frames [firstFrame, firstFrame+numFrames) into memory in the background, so that they
+	// are resident by the time they are read
+	void prefetchFrames(int firstFrame, int numFrames) {
+#if !defined(WIN32) && !defined(WIN64)
+		if (_data==NULL || numFrames<=0 || firstFrame>=_length)
+			return;
+		if (firstFrame+numFrames > _length)
+			numFrames = _length-firstFrame;
+
+		long pageSize = sysconf(_SC_PAGESIZE);
+		long start = _fileHeaderSizeBytes + (long)firstFrame*getFrameSize();
+		long end = start + (long)numFrames*getFrameSize();
+		start -= start%pageSize; // madvise needs a page-aligned address
+		madvise(_data+start, end-start, MADV_WILLNEED);
+#endif
+	}
+
+	// reads next frame into the char array
 	void readFramePrivate() {
 		// make sure type is set
 		assert(_type!=UNKNOWN_STIM);
 
-		// keep at most one frame in memory
-		if (_frame!=NULL)
-			delete[] _frame;
-		if (_framePoisson!=NULL)
-			delete _framePoisson;
-		_frame = NULL; _framePoisson = NULL;
+		// the rates of the previous frame are no longer current
+		_framePoissonValid = false;
 
 		// have we reached EOF?
-		if (feof(_fileId) || (_frameNum==_length-1)) {
-			// reset frame index
-			_frameNum = -1;
-
+		if ((_data==NULL && feof(_fileId)) || (_frameNum==_length-1)) {
 			if (!_wrapAroundEOF) {
 				// we've reached end of file, print a warning
 				fprintf(stderr,"WARNING: End of file reached, starting from the top\n");
 			}
 
-			// rewind position of file stream to first frame
+			// rewind position of file stream to first frame (resets frame index)
 			rewind();
 		}
 
-		// read new frame
-		_frame = new unsigned char[_width*_height*_channels];
-		size_t result = fread(_frame, sizeof(unsigned char), _width*_height*_channels, _fileId);
-		if (result!=(size_t) (_width*_height*_channels)) {
-			fprintf(stderr,"VisualStimulus Error: Error while reading stimulus frame (expected %d elements, found %d\n",
-				_width*_height*_channels, (int)result);
-			exit(1);
+		if (_data!=NULL) {
+			// copy new frame from the mapped file, and have the frame that is numPrefetchFrames ahead read in
+			memcpy(_frame, _data + _fileHeaderSizeBytes + (long)(_frameNum+1)*getFrameSize(), getFrameSize());
+			if (_numPrefetchFrames>0 && (_frameNum+1)%_numPrefetchFrames==0)
+				prefetchFrames(_frameNum+1+_numPrefetchFrames, _numPrefetchFrames);
+		} else {
+			// read new frame
+			size_t result = fread(_frame, sizeof(unsigned char), getFrameSize(), _fileId);
+			if (result!=(size_t) getFrameSize()) {
+				fprintf(stderr,"VisualStimulus Error: Error while reading stimulus frame (expected %d elements, found %d\n",
+					getFrameSize(), (int)result);
+				exit(1);
+			}
 		}
 
 		// initialized as -1, so after reading first frame this sits at 0
@@ -211,6 +300,14 @@ private:
 	int _frameNum;				//!< current frame index (0-indexed)
 
 	PoissonRate* _framePoisson;	//!< pointer to a PoissonRate object that contains the current frame
+	bool _framePoissonValid;	//!< whether _framePoisson holds the rates of the current frame
+	float _lut[256];			//!< lookup table from grayscale values to rates
+	float _lutMaxPoisson;		//!< maxPoisson for which _lut was computed
+	float _lutMinPoisson;		//!< minPoisson for which _lut was computed
+
+	unsigned char* _data;		//!< memory-mapped file (NULL if frames are read from the file stream)
+	long _dataSizeBytes;		//!< size of the memory-mapped file (bytes)
+	int _numPrefetchFrames;		//!< number of frames to read ahead
 
 	int _width;					//!< stimulus width in number of pixels (neurons)
 	int _height;				//!< stimulus height in number of pixels (neurons)
@@ -234,6 +331,7 @@ PoissonRate* VisualStimulus::readFramePoisson(float maxPoisson, float minPoisson
 	return _impl->readFramePoisson(maxPoisson, minPoisson);
 }
 void VisualStimulus::rewind() { _impl->rewind(); }
+void VisualStimulus::setPrefetchFrames(int numFrames) { _impl->setPrefetchFrames(numFrames); }
 void VisualStimulus::print() { _impl->print(); }
 
 int VisualStimulus::getWidth() { return _impl->getWidth(); }
@@ -110,6 +110,9 @@ public:
 	 * \attention Each call to readFrame() will advance the frame index. If you want to access the char array or
 	 * PoissonRate object of a frame that has already been read, use getCurrentFrameChar() or getCurrentFramePoisson()
 	 * instead.
+	 * \note The same PoissonRate object is returned for every frame; its rates are overwritten with those of the new
+	 * frame. Still call setSpikeRate after every frame: in GPU mode, the rates are only copied to the device by
+	 * setSpikeRate.
 	 */
 	PoissonRate* readFramePoisson(float maxPoisson, float minPoisson=0.0f);
 
@@ -121,6 +124,16 @@ public:
 	 */
 	void rewind();
 
+	/*!
+	 * \brief Sets the number of frames to read ahead
+	 *
+	 * The stimulus file is memory-mapped (where supported), and the OS is asked to read the upcoming frames into
+	 * memory in the background, so that reading a frame does not stall on disk I/O. This function sets how many
+	 * frames are requested at a time. Set to 0 to disable read-ahead.
+	 * \param[in] numFrames number of frames to read ahead. Default: 8.
+	 */
+	void setPrefetchFrames(int numFrames);
+
 	void print();
 
 